@@ -2,6 +2,8 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "MainWindow.h"
 #include "AppState.h"
+#include "../core/audio/PluginSandbox.h"
+#include "../core/audio/PluginScanner.h"
 
 //==============================================================================
 class PianoDAWApplication : public juce::JUCEApplication
@@ -11,13 +13,28 @@ public:
 
     const juce::String getApplicationName() override { return "Piano DAW"; }
     const juce::String getApplicationVersion() override { return "0.1.0"; }
-    bool moreThanOneInstanceAllowed() override { return false; }
+    // Must be true so the plugin scanner and sandbox can launch this executable as a child process
+    bool moreThanOneInstanceAllowed() override { return true; }
 
     //==============================================================================
     void initialise(const juce::String& commandLine) override
     {
-        juce::ignoreUnused(commandLine);
-        
+        // Started as an out-of-process plugin scanner: no UI, no audio device
+        auto scannerWorker = std::make_unique<pianodaw::PluginScannerWorker>();
+        if (scannerWorker->initialiseFromCommandLine(commandLine, pianodaw::PluginScanner::childProcessID))
+        {
+            pluginScannerWorker = std::move(scannerWorker);
+            return;
+        }
+
+        // Started as a plugin sandbox: hosts one plugin for a SandboxedPlugin in the main app
+        auto sandboxWorker = std::make_unique<pianodaw::PluginSandboxWorker>();
+        if (sandboxWorker->initialiseFromCommandLine(commandLine, pianodaw::SandboxedPlugin::childProcessID))
+        {
+            pluginSandboxWorker = std::move(sandboxWorker);
+            return;
+        }
+
         appState = std::make_unique<pianodaw::AppState>();
         
         // Create main window
@@ -31,6 +48,8 @@ public:
     {
         mainWindow = nullptr;
         appState = nullptr;
+        pluginScannerWorker = nullptr;
+        pluginSandboxWorker = nullptr;
     }
 
     //==============================================================================
@@ -75,6 +94,8 @@ private:
 
     std::unique_ptr<pianodaw::AppState> appState;
     std::unique_ptr<pianodaw::MainWindow> mainWindow;
+    std::unique_ptr<pianodaw::PluginScannerWorker> pluginScannerWorker;
+    std::unique_ptr<pianodaw::PluginSandboxWorker> pluginSandboxWorker;
 };
 
 //==============================================================================
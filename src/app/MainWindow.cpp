@@ -1,6 +1,8 @@
 #include "MainWindow.h"
 #include "AppState.h"
 #include "../ui/MainComponent.h"
+#include "../core/audio/PrecisionBenchmark.h"
+#include "../core/audio/RealtimeSafety.h"
 #include "../ui/panels/DebugLogWindow.h"
 
 namespace pianodaw {
@@ -23,8 +25,15 @@ MainWindow::MainWindow(juce::String name, AppState& appState_)
     audioEngine = std::make_unique<AudioEngine>(*project, transport);
     audioPlayer.setProcessor(audioEngine.get());
     
+    // Only does anything in builds with PIANODAW_RT_CHECKS
+    RealtimeSafety::setEnabled(true);
+    
     auto* adm = appState.getAudioDeviceManager();
     adm->addAudioCallback(&audioPlayer);
+    audioEngine->setDeviceXRunCounter([adm] {
+        auto* device = adm->getCurrentAudioDevice();
+        return device != nullptr ? device->getXRunCount() : -1;
+    });
     
     // Register MIDI input callback to receive MIDI from all enabled devices
     for (auto& device : juce::MidiInput::getAvailableDevices())
@@ -51,6 +60,9 @@ MainWindow::MainWindow(juce::String name, AppState& appState_)
 
 MainWindow::~MainWindow()
 {
+    if (RealtimeSafety::getNumViolations() > 0)
+        DBG(RealtimeSafety::getReport());
+    
     // Unregister MIDI callbacks
     auto* adm = appState.getAudioDeviceManager();
     for (auto& device : juce::MidiInput::getAvailableDevices())
@@ -105,7 +117,7 @@ void MainWindow::closeButtonPressed()
 
 juce::StringArray MainWindow::getMenuBarNames()
 {
-    return { "File", "Edit" };
+    return { "File", "Edit", "Audio" };
 }
 
 juce::PopupMenu MainWindow::getMenuForIndex(int topLevelMenuIndex, const juce::String& menuName)
@@ -131,6 +143,13 @@ juce::PopupMenu MainWindow::getMenuForIndex(int topLevelMenuIndex, const juce::S
         menu.addItem(10, "Undo", undoStack.canUndo());
         menu.addItem(11, "Redo", undoStack.canRedo());
     }
+    else if (topLevelMenuIndex == 2) // Audio
+    {
+        menu.addItem(20, "Anticipative Rendering", audioEngine != nullptr,
+                     audioEngine != nullptr && audioEngine->isAnticipativeRendering());
+        menu.addItem(21, "64-bit Processing", audioEngine != nullptr, audioPlayer.getDoublePrecisionProcessing());
+        menu.addItem(22, "Benchmark Float vs Double", project != nullptr);
+    }
     
     return menu;
 }
@@ -152,8 +171,26 @@ void MainWindow::menuItemSelected(int menuItemID, int topLevelMenuIndex)
                     auto file = fc.getResult();
                     if (file.existsAsFile() && project)
                     {
-                        if (project->loadFromFile(file))
+                        // Parsed outside the lock the audio thread takes every block; only the swap happens under it
+                        auto opened = std::make_unique<Project>();
+                        bool loaded = opened->loadFromFile(file);
+
+                        if (loaded)
                         {
+                            {
+                                juce::ScopedLock sl(project->getLock());
+                                project->swapContents(*opened);
+                            }
+
+                            // Commands point into the replaced clips; the old content goes with 'opened'
+                            undoStack.clear();
+
+                            // Instruments load in the background; the project is usable right away
+                            if (auto* engineState = project->getEngineState())
+                                audioEngine->restoreStateXml(*engineState);
+                            else
+                                audioEngine->resetForNewProject();
+
                             mainComponent->resized();
                             mainComponent->repaint();
                         }
@@ -174,6 +211,7 @@ void MainWindow::menuItemSelected(int menuItemID, int topLevelMenuIndex)
                 auto file = project->getProjectFile();
                 if (file.existsAsFile())
                 {
+                    project->setEngineState(audioEngine->createStateXml());
                     project->saveToFile(file);
                 }
                 else
@@ -194,6 +232,7 @@ void MainWindow::menuItemSelected(int menuItemID, int topLevelMenuIndex)
                     auto file = fc.getResult();
                     if (file != juce::File() && project)
                     {
+                        project->setEngineState(audioEngine->createStateXml());
                         project->saveToFile(file);
                     }
                 });
@@ -234,6 +273,29 @@ void MainWindow::menuItemSelected(int menuItemID, int topLevelMenuIndex)
             undoStack.redo();
             break;
             
+        case 20: // Anticipative Rendering
+            audioEngine->setAnticipativeRendering(!audioEngine->isAnticipativeRendering());
+            break;
+            
+        case 21: // 64-bit Processing (the player re-prepares the engine in the new precision)
+            audioPlayer.setDoublePrecisionProcessing(!audioPlayer.getDoublePrecisionProcessing());
+            DebugLogWindow::addLog(juce::String("AudioEngine: Processing in ")
+                                   + (audioEngine->isUsingDoublePrecision() ? "64-bit" : "32-bit"));
+            break;
+
+        case 22: // Benchmark Float vs Double
+        {
+            auto* device = appState.getAudioDeviceManager()->getCurrentAudioDevice();
+            double sampleRate = device != nullptr ? device->getCurrentSampleRate() : 44100.0;
+            int blockSize = device != nullptr ? device->getCurrentBufferSizeSamples() : 512;
+
+            auto result = PrecisionBenchmark::run(*project, transport.getTempo(), sampleRate, blockSize, 30.0);
+            DebugLogWindow::addLog("Precision benchmark:\n" + result.toString());
+            DebugLogWindow::getInstance()->setVisible(true);
+            DebugLogWindow::getInstance()->toFront(true);
+            break;
+        }
+
         case 99: // Quit
             juce::JUCEApplication::getInstance()->systemRequestedQuit();
             break;
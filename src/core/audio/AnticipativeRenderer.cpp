@@ -0,0 +1,149 @@
+#include "AnticipativeRenderer.h"
+#include "TrackChain.h"
+#include "../../ui/panels/DebugLogWindow.h"
+
+namespace pianodaw {
+
+namespace
+{
+    int getNumWorkerThreads()
+    {
+        // Leave cores for the audio, message and plugin loader threads
+        return juce::jlimit(1, 4, juce::SystemStats::getNumCpus() - 2);
+    }
+}
+
+class AnticipativeRenderer::Worker : public juce::Thread
+{
+public:
+    Worker(AnticipativeRenderer& owner_, int index)
+        : juce::Thread("Anticipative render " + juce::String(index + 1)), owner(owner_)
+    {
+    }
+
+    ~Worker() override
+    {
+        stopThread(5000);
+    }
+
+    void wake() { workAvailable.signal(); }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // Keep going while there is something to render; otherwise wait for the next block
+            if (!owner.renderNextBlock())
+                workAvailable.wait(20);
+        }
+    }
+
+private:
+    AnticipativeRenderer& owner;
+    juce::WaitableEvent workAvailable;
+};
+
+AnticipativeRenderer::AnticipativeRenderer(std::vector<std::unique_ptr<TrackChain>>& chains_)
+    : chains(chains_)
+{
+}
+
+AnticipativeRenderer::~AnticipativeRenderer()
+{
+    setEnabled(false);
+}
+
+void AnticipativeRenderer::setEnabled(bool shouldBeEnabled)
+{
+    if (enabled.load() == shouldBeEnabled)
+        return;
+
+    if (shouldBeEnabled)
+    {
+        for (int i = 0; i < getNumWorkerThreads(); ++i)
+        {
+            workers.push_back(std::make_unique<Worker>(*this, i));
+            workers.back()->startThread(juce::Thread::Priority::high);
+        }
+        enabled = true;
+    }
+    else
+    {
+        // The audio thread takes every chain back once it sees the flag
+        enabled = false;
+        for (auto& worker : workers)
+            worker->signalThreadShouldExit();
+        workers.clear();
+    }
+
+    DebugLogWindow::addLog("AnticipativeRenderer: " + juce::String(shouldBeEnabled ? "On" : "Off")
+                           + " (" + juce::String((int)workers.size()) + " workers, "
+                           + juce::String(aheadMs, 0) + " ms ahead)");
+}
+
+void AnticipativeRenderer::setAheadMs(double ms)
+{
+    aheadMs = juce::jlimit(10.0, TrackChain::maxAheadSeconds * 1000.0, ms);
+    aheadSamples.store(juce::roundToInt(aheadMs * 0.001 * currentSampleRate));
+}
+
+void AnticipativeRenderer::prepare(double sampleRate)
+{
+    currentSampleRate = sampleRate > 0.0 ? sampleRate : 44100.0;
+    setAheadMs(aheadMs);
+}
+
+void AnticipativeRenderer::publish(int epoch, juce::int64 blockEnd, int blockSize, int latencySamples)
+{
+    publishedBlockEnd.store(blockEnd, std::memory_order_relaxed);
+    publishedBlockSize.store(blockSize, std::memory_order_relaxed);
+    publishedLatency.store(latencySamples, std::memory_order_relaxed);
+    currentEpoch.store(epoch, std::memory_order_release);
+
+    if (epoch >= 0)
+        for (auto& worker : workers)
+            worker->wake();
+}
+
+bool AnticipativeRenderer::renderNextBlock()
+{
+    int epoch = currentEpoch.load(std::memory_order_acquire);
+    if (epoch < 0 || !enabled.load())
+        return false;
+
+    int blockSize = publishedBlockSize.load(std::memory_order_relaxed);
+    auto limit = publishedBlockEnd.load(std::memory_order_relaxed) + aheadSamples.load();
+
+    const juce::ScopedReadLock listLock(chainListLock);
+
+    auto numChains = (unsigned int)chains.size();
+    auto first = nextChain++;
+
+    // Round-robin, so one heavy track can't starve the others
+    for (unsigned int i = 0; i < numChains; ++i)
+    {
+        auto& chain = *chains[(first + i) % numChains];
+
+        if (chain.getAheadEpoch() != epoch || chain.getAheadCursor() + blockSize > limit
+            || !chain.isAheadSequenced(blockSize))
+            continue;
+
+        // Another worker (or the callback) has it
+        const juce::ScopedTryLock renderLock(chain.getRenderLock());
+        if (!renderLock.isLocked() || chain.getAheadEpoch() != epoch || !chain.hasAheadSpace(blockSize))
+            continue;
+
+        renderChain(chain, blockSize);
+        return true;
+    }
+
+    return false;
+}
+
+void AnticipativeRenderer::renderChain(TrackChain& chain, int blockSize)
+{
+    int pathLatency = publishedLatency.load(std::memory_order_relaxed);
+    chain.renderAhead(blockSize, pathLatency - chain.getLatencySamples());
+}
+
+} // namespace pianodaw
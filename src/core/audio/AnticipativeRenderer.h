@@ -0,0 +1,85 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+class TrackChain;
+
+/**
+ * AnticipativeRenderer - Renders non-live track instruments ahead of the callback
+ *
+ * Only the record-armed track needs low latency. Every other track chain is
+ * handed to a small pool of worker threads, which render it block by block
+ * up to getAheadSamples() ahead of the audio thread and queue the result in
+ * the chain's ring. The audio thread sequences those blocks for them
+ * (TrackChain::sequenceAhead), so a worker never takes the project lock
+ * the callback needs. The callback then only copies
+ * those tracks, so heavy instruments no longer have to fit in a tiny
+ * buffer; a worker that falls behind drops out that one track instead of
+ * the device.
+ *
+ * The audio thread owns the hand-over: it bumps the epoch whenever the
+ * timeline changes (start, locate, tempo, loop, latency), renders chains
+ * itself until they follow the new epoch, and takes the armed track back.
+ */
+class AnticipativeRenderer
+{
+public:
+    explicit AnticipativeRenderer(std::vector<std::unique_ptr<TrackChain>>& chains);
+    ~AnticipativeRenderer();
+
+    /** Start or stop the worker threads (message thread) */
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled.load(); }
+
+    /** How far ahead the workers render (clamped to TrackChain::maxAheadSeconds) */
+    void setAheadMs(double ms);
+    double getAheadMs() const { return aheadMs; }
+    int getAheadSamples() const { return aheadSamples.load(); }
+
+    /** Set the rate used to turn the ahead time into samples (audio stopped) */
+    void prepare(double sampleRate);
+
+    /** Read-locked by workers while they walk the chains; write-lock it to add, remove or prepare chains */
+    juce::ReadWriteLock& getChainListLock() { return chainListLock; }
+
+    // === Audio thread ===
+
+    /**
+     * Tell the workers what to render after the block just finished
+     * @param epoch Current timeline epoch, or -1 to stop rendering ahead
+     * @param blockEnd Engine sample position at the end of the block
+     */
+    void publish(int epoch, juce::int64 blockEnd, int blockSize, int latencySamples);
+
+private:
+    class Worker;
+
+    bool renderNextBlock();
+    void renderChain(TrackChain& chain, int blockSize);
+
+    std::vector<std::unique_ptr<TrackChain>>& chains;
+    juce::ReadWriteLock chainListLock;
+
+    std::atomic<bool> enabled { false };
+    double aheadMs = 200.0;
+    double currentSampleRate = 44100.0;
+    std::atomic<int> aheadSamples { 8820 };
+
+    // Published by the audio thread every block
+    std::atomic<int> currentEpoch { -1 };
+    std::atomic<juce::int64> publishedBlockEnd { 0 };
+    std::atomic<int> publishedBlockSize { 512 };
+    std::atomic<int> publishedLatency { 0 };
+
+    std::atomic<unsigned int> nextChain { 0 };
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnticipativeRenderer)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,383 @@
+#include "AudioClipStreamer.h"
+#include "../model/Track.h"
+#include "../timeline/PPQ.h"
+#include <cmath>
+
+namespace pianodaw {
+
+namespace
+{
+    // Tick-clock rounding: positions this close to where a slot is continue from there
+    constexpr juce::int64 positionTolerance = 2;
+}
+
+AudioClipStreamer::AudioClipStreamer()
+    : juce::Thread("Audio Clip Streamer")
+{
+    formatManager.registerBasicFormats();
+
+    slots.reserve((size_t)numSlots);
+    for (int i = 0; i < numSlots; ++i)
+        slots.push_back(std::make_unique<Slot>());
+}
+
+AudioClipStreamer::~AudioClipStreamer()
+{
+    stopThread(2000);
+
+    // Release what was handed over but never picked up
+    for (auto& slot : slots)
+        takeHandover(*slot);
+}
+
+void AudioClipStreamer::prepare(double sampleRate)
+{
+    deviceSampleRate.store(sampleRate > 0.0 ? sampleRate : 44100.0);
+
+    for (auto& slot : slots)
+    {
+        if (slot->trackUid != 0)
+            startStream(*slot, nullptr, 0);
+        slot->trackUid = 0;
+    }
+}
+
+//==============================================================================
+// Audio thread
+//==============================================================================
+
+void AudioClipStreamer::beginBlock()
+{
+    ++blockCounter;
+}
+
+void AudioClipStreamer::endBlock()
+{
+    for (auto& slot : slots)
+    {
+        if (slot->trackUid != 0 && slot->lastUsedBlock != blockCounter)
+        {
+            startStream(*slot, nullptr, 0);
+            slot->trackUid = 0;
+        }
+    }
+}
+
+bool AudioClipStreamer::startStream(Slot& slot, const AudioClip* clip, juce::int64 position)
+{
+    if (clip != nullptr)
+    {
+        int start1, size1, start2, size2;
+        slot.handoverFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        // The reader hasn't picked up this slot's last few requests; try again next block
+        if (size1 + size2 == 0)
+            return false;
+
+        // The project lock is held, so the clip (and its reference) is alive; the reader thread releases this one
+        auto* fileSource = clip->getFileSource();
+        fileSource->incReferenceCount();
+        slot.handover[(size_t)(size1 > 0 ? start1 : start2)] = fileSource;
+        slot.handoverFifo.finishedWrite(1);
+    }
+
+    double ratio = clip != nullptr ? clip->getSampleRate() / deviceSampleRate.load(std::memory_order_relaxed) : 1.0;
+    slot.requestedPlaying.store(clip != nullptr, std::memory_order_relaxed);
+    slot.requestedStart.store(position, std::memory_order_relaxed);
+    slot.requestedRatio.store(ratio, std::memory_order_relaxed);
+    slot.requestGeneration.fetch_add(1, std::memory_order_release);
+    slot.position = position;
+    return true;
+}
+
+bool AudioClipStreamer::isStreamReady(const Slot& slot) const
+{
+    return slot.ackGeneration.load(std::memory_order_acquire)
+        == slot.requestGeneration.load(std::memory_order_relaxed);
+}
+
+AudioClipStreamer::Slot* AudioClipStreamer::findSlot(const Track& track, int regionId, juce::int64 position)
+{
+    // A region can hold two slots around a loop wrap: the one that plays and the one cued at the loop start
+    for (auto& slot : slots)
+    {
+        if (slot->trackUid == track.getUid() && slot->regionId == regionId
+            && position >= slot->position - positionTolerance && position < slot->position + bufferSamples / 2)
+        {
+            slot->lastUsedBlock = blockCounter;
+            return slot.get();
+        }
+    }
+
+    return nullptr;
+}
+
+AudioClipStreamer::Slot* AudioClipStreamer::acquireSlot(const Track& track, int regionId, const AudioClip* clip,
+                                                        juce::int64 position)
+{
+    for (auto& slot : slots)
+    {
+        if (slot->trackUid != 0)
+            continue;
+
+        if (!startStream(*slot, clip, position))
+            return nullptr;
+
+        slot->trackUid = track.getUid();
+        slot->regionId = regionId;
+        slot->lastUsedBlock = blockCounter;
+        return slot.get();
+    }
+
+    return nullptr;   // More regions at once than slots: the rest stay silent
+}
+
+void AudioClipStreamer::render(const Track& track, const BlockTickWindow* windows, int numWindows, double tempoBPM,
+                               juce::AudioBuffer<float>& dest)
+{
+    double sampleRate = deviceSampleRate.load(std::memory_order_relaxed);
+    double samplesPerTick = sampleRate * 60.0 / (tempoBPM * PPQ::TICKS_PER_QUARTER);
+
+    for (const auto& region : track.getClipRegions())
+    {
+        if (!region.isAudio() || region.muted)
+            continue;
+
+        auto clipLength = (juce::int64)((double)region.audioClip->getLengthInSamples() * sampleRate / region.audioClip->getSampleRate());
+
+        for (int i = 0; i < numWindows; ++i)
+        {
+            const auto& window = windows[i];
+            auto windowLength = (double)window.numSamples;
+
+            // Part of the window the region covers
+            int first = (int)juce::jlimit(0.0, windowLength, std::ceil(((double)region.startTick - window.exactStartTick) * samplesPerTick));
+            int end = (int)juce::jlimit(0.0, windowLength, std::ceil(((double)region.getEndTick() - window.exactStartTick) * samplesPerTick));
+
+            auto position = (juce::int64)std::llround((window.exactStartTick - (double)region.startTick + (double)region.offsetTick) * samplesPerTick) + first;
+            end = (int)juce::jmin((juce::int64)end, first + juce::jmax((juce::int64)0, clipLength - position));
+            if (end <= first || position < 0)
+                continue;
+
+            auto* slot = findSlot(track, region.id, position);
+            if (slot == nullptr)
+                slot = acquireSlot(track, region.id, region.audioClip, position);
+
+            if (slot != nullptr)
+                mixRegion(*slot, position, dest, window.startSample + first, end - first);
+        }
+    }
+}
+
+void AudioClipStreamer::cue(const Track& track, int64_t startTick, int64_t endTick, double tempoBPM)
+{
+    double sampleRate = deviceSampleRate.load(std::memory_order_relaxed);
+    double samplesPerTick = sampleRate * 60.0 / (tempoBPM * PPQ::TICKS_PER_QUARTER);
+
+    for (const auto& region : track.getClipRegions())
+    {
+        if (!region.isAudio() || region.muted || region.getEndTick() <= startTick || region.startTick >= endTick)
+            continue;
+
+        auto cueTick = juce::jmax(startTick, region.startTick);
+        auto position = (juce::int64)std::llround((double)(cueTick - region.startTick + region.offsetTick) * samplesPerTick);
+        auto clipLength = (juce::int64)((double)region.audioClip->getLengthInSamples() * sampleRate / region.audioClip->getSampleRate());
+        if (position < 0 || position >= clipLength)
+            continue;
+
+        if (findSlot(track, region.id, position) == nullptr)
+            acquireSlot(track, region.id, region.audioClip, position);
+    }
+}
+
+void AudioClipStreamer::mixRegion(Slot& slot, juce::int64 position, juce::AudioBuffer<float>& dest, int destStart, int numSamples)
+{
+    // Still seeking after a cue or a jump: silence, like any locate
+    if (!isStreamReady(slot))
+        return;
+
+    int start1, size1, start2, size2;
+
+    // Behind where the region is now (a late cue, or a block that ran dry): skip ahead in the FIFO
+    if (position - slot.position > positionTolerance)
+    {
+        slot.fifo.prepareToRead((int)juce::jmin(position - slot.position, (juce::int64)bufferSamples), start1, size1, start2, size2);
+        slot.fifo.finishedRead(size1 + size2);
+        slot.position += size1 + size2;
+
+        if (position - slot.position > positionTolerance)
+        {
+            if (!slot.endOfClip.load(std::memory_order_acquire))
+                underruns.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    slot.fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+    {
+        int source = juce::jmin(ch, 1);
+        if (size1 > 0)
+            dest.addFrom(ch, destStart, slot.ring, source, start1, size1);
+        if (size2 > 0)
+            dest.addFrom(ch, destStart + size1, slot.ring, source, start2, size2);
+    }
+
+    slot.fifo.finishedRead(size1 + size2);
+    slot.position += size1 + size2;
+
+    if (size1 + size2 < numSamples && !slot.endOfClip.load(std::memory_order_acquire))
+        underruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+int AudioClipStreamer::getNumActiveStreams() const
+{
+    int count = 0;
+    for (auto& slot : slots)
+    {
+        if (slot->requestedPlaying.load(std::memory_order_relaxed))
+            ++count;
+    }
+    return count;
+}
+
+//==============================================================================
+// Reader thread
+//==============================================================================
+
+void AudioClipStreamer::run()
+{
+    while (!threadShouldExit())
+    {
+        bool didWork = false;
+
+        for (int i = 0; i < (int)slots.size(); ++i)
+            didWork = serviceSlot(i) || didWork;
+
+        // startStream() doesn't signal us (that would need a lock in the callback). Regions
+        // are cued prerollSeconds early, so idling a couple of milliseconds is never heard.
+        if (!didWork)
+            wait(2);
+    }
+}
+
+void AudioClipStreamer::takeHandover(Slot& slot)
+{
+    int start1, size1, start2, size2;
+    slot.handoverFifo.prepareToRead(slot.handoverFifo.getNumReady(), start1, size1, start2, size2);
+
+    auto adopt = [&slot](int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            // handedOver holds its own reference, so dropping the audio thread's can't free the file here
+            auto* fileSource = slot.handover[(size_t)i];
+            slot.handedOver = fileSource;
+            fileSource->decReferenceCount();
+        }
+    };
+
+    adopt(start1, size1);
+    adopt(start2, size2);
+    slot.handoverFifo.finishedRead(size1 + size2);
+}
+
+std::shared_ptr<juce::AudioFormatReader> AudioClipStreamer::openSource(AudioClip::FileSource& fileSource)
+{
+    // Forget files only this cache still refers to: their clips are gone and no slot reads them
+    for (auto it = sources.begin(); it != sources.end();)
+    {
+        if (it->second.fileSource->getReferenceCount() == 1)
+            it = sources.erase(it);
+        else
+            ++it;
+    }
+
+    // A file is opened once; one that can't be read isn't retried for the same clip
+    auto& source = sources[&fileSource];
+    if (source.fileSource == nullptr)
+    {
+        source.fileSource = &fileSource;
+        source.reader.reset(formatManager.createReaderFor(fileSource.file));
+    }
+
+    return source.reader;
+}
+
+bool AudioClipStreamer::serviceSlot(int slotIndex)
+{
+    auto& slot = *slots[(size_t)slotIndex];
+
+    // A new cue or stop: mixRegion() leaves the slot alone until the ack below, so
+    // its FIFO can be emptied and its reader swapped for the requested file here
+    auto generation = slot.requestGeneration.load(std::memory_order_acquire);
+    if (generation != slot.ackGeneration.load(std::memory_order_relaxed))
+    {
+        // Everything handed over up to this generation is in the queue by now; the newest is this request's
+        takeHandover(slot);
+        bool playing = slot.requestedPlaying.load(std::memory_order_relaxed);
+        auto start = slot.requestedStart.load(std::memory_order_relaxed);
+
+        slot.fifo.reset();
+        slot.reader = playing && slot.handedOver != nullptr ? openSource(*slot.handedOver) : nullptr;
+        slot.ratio = slot.requestedRatio.load(std::memory_order_relaxed);
+        slot.sourcePosition = (juce::int64)std::floor((double)start * slot.ratio);
+        slot.sourceLength = slot.reader != nullptr ? slot.reader->lengthInSamples : 0;
+        for (auto& interpolator : slot.interpolators)
+            interpolator.reset();
+
+        slot.endOfClip.store(slot.reader == nullptr, std::memory_order_relaxed);
+        slot.ackGeneration.store(generation, std::memory_order_release);
+    }
+
+    if (slot.reader == nullptr || slot.endOfClip.load(std::memory_order_relaxed))
+        return false;
+
+    if (slot.sourcePosition >= slot.sourceLength)
+    {
+        slot.endOfClip.store(true, std::memory_order_release);
+        return false;
+    }
+
+    int toWrite = juce::jmin(slot.fifo.getFreeSpace(), readChunkSamples);
+    if (toWrite <= 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    slot.fifo.prepareToWrite(toWrite, start1, size1, start2, size2);
+
+    for (auto [start, size] : { std::make_pair(start1, size1), std::make_pair(start2, size2) })
+    {
+        if (size <= 0)
+            continue;
+
+        // Mono readers are duplicated into both channels by AudioFormatReader::read
+        if (slot.ratio == 1.0)
+        {
+            slot.reader->read(&slot.ring, start, size, slot.sourcePosition, true, true);
+            slot.sourcePosition += size;
+            continue;
+        }
+
+        // Resampled to the device rate; the interpolators carry their history across reads
+        int numInput = (int)std::ceil(size * slot.ratio) + 4;
+        sourceScratch.setSize(2, numInput, false, false, true);
+        slot.reader->read(&sourceScratch, 0, numInput, slot.sourcePosition, true, true);
+
+        int used = 0;
+        for (int ch = 0; ch < 2; ++ch)
+            used = slot.interpolators[(size_t)ch].process(slot.ratio, sourceScratch.getReadPointer(ch),
+                                                          slot.ring.getWritePointer(ch, start), size, numInput, 0);
+        slot.sourcePosition += used;
+    }
+
+    slot.fifo.finishedWrite(size1 + size2);
+
+    if (slot.sourcePosition >= slot.sourceLength)
+        slot.endOfClip.store(true, std::memory_order_release);
+
+    return true;
+}
+
+} // namespace pianodaw
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+#include "../model/AudioClip.h"
+#include "../timeline/SamplePlayhead.h"
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+class Track;
+
+/**
+ * AudioClipStreamer - Background disk reader that plays audio track regions
+ *
+ * Every region that plays, or is about to, owns a stream slot with its own
+ * read-ahead FIFO, filled at the device rate (resampled on the reader
+ * thread when the file's rate differs). As in SampleStreamer, the audio
+ * thread only flips atomics to request/stop a stream and pops what the
+ * reader thread has queued, so it shares no locks with it.
+ *
+ * Regions are cued prerollSeconds before they start (and at the loop start
+ * before the loop wraps), so playback begins from a full buffer. Positions
+ * are in device samples into the region's audio; a position the slot has
+ * not reached yet is skipped to, one it has passed restarts the stream.
+ *
+ * Files are opened on the reader thread. A request hands over a reference
+ * to the clip's FileSource, taken while the audio thread holds the project
+ * lock, so the reader never looks the clip up and the file stays valid if
+ * the clip is removed before the request is picked up.
+ */
+class AudioClipStreamer : public juce::Thread
+{
+public:
+    static constexpr int numSlots = 32;
+    static constexpr int bufferSamples = 32768;     // Per-slot ring, ~0.7s at 48kHz
+    static constexpr double prerollSeconds = 0.25;
+
+    AudioClipStreamer();
+    ~AudioClipStreamer() override;
+
+    /** Audio stopped: drop every stream (positions are in device samples) */
+    void prepare(double sampleRate);
+
+    // === Audio thread ===
+
+    /** Start of a block: slots neither rendered nor cued until endBlock() are released */
+    void beginBlock();
+    void endBlock();
+
+    /** Mix the track's audio regions at the windows' positions into dest */
+    void render(const Track& track, const BlockTickWindow* windows, int numWindows, double tempoBPM,
+                juce::AudioBuffer<float>& dest);
+
+    /** Make sure regions playing within [startTick, endTick) are streaming from there */
+    void cue(const Track& track, int64_t startTick, int64_t endTick, double tempoBPM);
+
+    // === Stats ===
+    int getNumActiveStreams() const;
+    juce::uint32 getUnderrunCount() const { return underruns.load(); }
+    void resetUnderrunCount() { underruns.store(0); }
+
+private:
+    void run() override;
+
+    /** Service one slot; returns true if any samples were read */
+    bool serviceSlot(int slotIndex);
+
+    /** A clip file's reader, shared with every slot reading it so dropping the entry never frees one mid-stream */
+    struct Source
+    {
+        AudioClip::FileSource::Ptr fileSource;
+        std::shared_ptr<juce::AudioFormatReader> reader;
+    };
+
+    /** Reader thread: the open reader for a file, or nullptr if it can't be read */
+    std::shared_ptr<juce::AudioFormatReader> openSource(AudioClip::FileSource& fileSource);
+
+    struct Slot
+    {
+        // Written by audio thread
+        std::atomic<bool> requestedPlaying { false };    // false = stop
+        std::atomic<juce::int64> requestedStart { 0 };   // Device samples into the clip
+        std::atomic<double> requestedRatio { 1.0 };      // File rate / device rate
+        std::atomic<juce::uint32> requestGeneration { 0 };
+
+        // Written by reader thread
+        std::atomic<juce::uint32> ackGeneration { 0 };
+        std::atomic<bool> endOfClip { false };
+
+        // Audio thread -> reader thread (single producer / single consumer): one reference per request
+        static constexpr int handoverCapacity = 8;
+        juce::AbstractFifo handoverFifo { handoverCapacity };
+        std::array<AudioClip::FileSource*, handoverCapacity> handover {};
+
+        // Reader thread private
+        AudioClip::FileSource::Ptr handedOver;           // Newest file taken from the handover queue
+        std::shared_ptr<juce::AudioFormatReader> reader;
+        juce::int64 sourcePosition = 0;                  // Next file sample to read
+        juce::int64 sourceLength = 0;
+        double ratio = 1.0;
+        std::array<juce::LagrangeInterpolator, 2> interpolators;
+
+        // Audio thread private
+        int trackUid = 0;                                // 0 = free
+        int regionId = 0;
+        juce::int64 position = 0;                        // Device sample the FIFO delivers next
+        juce::uint32 lastUsedBlock = 0;
+
+        juce::AbstractFifo fifo { bufferSamples };
+        juce::AudioBuffer<float> ring { 2, bufferSamples };
+    };
+
+    // Audio thread
+    bool startStream(Slot& slot, const AudioClip* clip, juce::int64 position);
+    bool isStreamReady(const Slot& slot) const;
+    Slot* findSlot(const Track& track, int regionId, juce::int64 position);
+    Slot* acquireSlot(const Track& track, int regionId, const AudioClip* clip, juce::int64 position);
+    void mixRegion(Slot& slot, juce::int64 position, juce::AudioBuffer<float>& dest, int destStart, int numSamples);
+
+    /** Reader thread: adopt the references the audio thread handed over, keeping the newest */
+    void takeHandover(Slot& slot);
+
+    juce::AudioFormatManager formatManager;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::atomic<double> deviceSampleRate { 44100.0 };
+    juce::uint32 blockCounter = 0;                       // Audio thread
+
+    // Reader thread
+    std::map<const AudioClip::FileSource*, Source> sources;
+    juce::AudioBuffer<float> sourceScratch;
+    int readChunkSamples = 4096;                          // Max samples per slot per pass (keeps slots fair)
+
+    std::atomic<juce::uint32> underruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioClipStreamer)
+};
+
+} // namespace pianodaw
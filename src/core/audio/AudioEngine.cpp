@@ -1,17 +1,33 @@
 #include "AudioEngine.h"
+#include "AnticipativeRenderer.h"
+#include "AudioClipStreamer.h"
+#include "AudioInputRecorder.h"
+#include "BusGraph.h"
+#include "ConvolutionReverb.h"
 #include "MidiRecorder.h"
+#include "PluginLoader.h"
+#include "PluginSandbox.h"
+#include "PianoResonance.h"
+#include "PluginScanner.h"
+#include "RealtimeSafety.h"
+#include "SampledPiano.h"
+#include "SamplePool.h"
+#include "TrackFreezer.h"
+#include "TrackSequencer.h"
+#include "../edit/RegionCommands.h"
 #include "../model/Clip.h"
 #include "../model/Project.h"
 #include "../model/Track.h"
 #include "../timeline/Transport.h"
 #include "../timeline/PPQ.h"
 #include "../../ui/panels/DebugLogWindow.h"
+#include <array>
 #include <cmath>
 
 namespace pianodaw {
 
-// Basic Piano Voice using Sine with simple envelope
-struct SimplePianoVoice : public juce::SynthesiserVoice
+// Basic Piano Voice: a sine with two weaker partials, decaying like a struck string
+struct SimplePianoVoice : public PooledVoice
 {
     SimplePianoVoice() {}
 
@@ -22,8 +38,15 @@ struct SimplePianoVoice : public juce::SynthesiserVoice
 
     void startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound*, int /*currentPitchWheelPosition*/) override
     {
-        level = velocity * 0.15f;
+        level = velocity * 0.11;
         tailOff = 0.0;
+        tailFactor = 0.99;
+        envelope = 1.0;
+
+        // Rings for ~10 s in the bass down to ~1.5 s at the top while held (by the key or a pedal)
+        auto position = juce::jlimit(0.0, 1.0, (midiNoteNumber - 21) / 87.0);
+        auto ringSeconds = 10.0 * std::pow(0.15, position);
+        decay = std::exp(-6.907755 / (ringSeconds * getSampleRate()));
 
         auto cyclesPerSample = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber) / getSampleRate();
         angleDelta = cyclesPerSample * 2.0 * juce::MathConstants<double>::pi;
@@ -44,52 +67,70 @@ struct SimplePianoVoice : public juce::SynthesiserVoice
         }
     }
 
+    float getLevel() const override
+    {
+        return angleDelta == 0.0 ? 0.0f : (float)(level * envelope * (tailOff > 0.0 ? tailOff : 1.0));
+    }
+
+    void fadeOutForSteal() override
+    {
+        // Down to the 0.005 cut-off within VoicePool::stealFadeSeconds
+        if (tailOff == 0.0)
+            tailOff = 1.0;
+        tailFactor = std::pow(0.005 / tailOff, 1.0 / (VoicePool::stealFadeSeconds * getSampleRate()));
+    }
+
     void pitchWheelMoved(int) override {}
+
+    // Sustain and sostenuto are handled by juce::Synthesiser: it only calls stopNote() once no pedal holds the key
     void controllerMoved(int, int) override {}
 
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
     {
-        if (angleDelta != 0.0)
-        {
-            if (tailOff > 0.0)
-            {
-                while (--numSamples >= 0)
-                {
-                    auto sample = (float)(std::sin(currentAngle) * level * tailOff);
+        render(outputBuffer, startSample, numSamples);
+    }
 
-                    for (int i = outputBuffer.getNumChannels(); --i >= 0;)
-                        outputBuffer.addSample(i, startSample, sample);
+    void renderNextBlock(juce::AudioBuffer<double>& outputBuffer, int startSample, int numSamples) override
+    {
+        render(outputBuffer, startSample, numSamples);
+    }
+
+    template <typename SampleType>
+    void render(juce::AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples)
+    {
+        if (angleDelta == 0.0)
+            return;
 
-                    currentAngle += angleDelta;
-                    ++startSample;
+        while (--numSamples >= 0)
+        {
+            // 2nd and 3rd partials from the fundamental's sine and cosine, so octaves and fifths resonate
+            auto s = std::sin(currentAngle);
+            auto c = std::cos(currentAngle);
+            auto wave = s + 0.3 * (2.0 * s * c) + 0.12 * s * (3.0 - 4.0 * s * s);
+            auto sample = (SampleType)(wave * level * envelope * (tailOff > 0.0 ? tailOff : 1.0));
 
-                    tailOff *= 0.99;
+            for (int i = outputBuffer.getNumChannels(); --i >= 0;)
+                outputBuffer.addSample(i, startSample, sample);
 
-                    if (tailOff <= 0.005)
-                    {
-                        clearCurrentNote();
-                        angleDelta = 0.0;
-                        break;
-                    }
-                }
-            }
-            else
-            {
-                while (--numSamples >= 0)
-                {
-                    auto sample = (float)(std::sin(currentAngle) * level);
+            currentAngle += angleDelta;
+            ++startSample;
+            envelope *= decay;
 
-                    for (int i = outputBuffer.getNumChannels(); --i >= 0;)
-                        outputBuffer.addSample(i, startSample, sample);
+            if (tailOff > 0.0)
+                tailOff *= tailFactor;
 
-                    currentAngle += angleDelta;
-                    ++startSample;
-                }
+            // Damped, or rung out under the pedal: either way the voice is free again
+            if ((tailOff > 0.0 && tailOff <= 0.005) || envelope <= 0.001)
+            {
+                clearCurrentNote();
+                angleDelta = 0.0;
+                break;
             }
         }
     }
 
-    double currentAngle = 0.0, angleDelta = 0.0, level = 0.0, tailOff = 0.0;
+    double currentAngle = 0.0, angleDelta = 0.0, level = 0.0, tailOff = 0.0, tailFactor = 0.99;
+    double envelope = 1.0, decay = 1.0;
 };
 
 struct SimplePianoSound : public juce::SynthesiserSound
@@ -103,13 +144,27 @@ struct SimplePianoSound : public juce::SynthesiserSound
 
 AudioEngine::AudioEngine(Project& project_, Transport& transport_)
     : AudioProcessor(BusesProperties()
-        .withInput("Input", juce::AudioChannelSet::stereo(), true)  // For audio recording (future)
+        .withInput("Input", juce::AudioChannelSet::stereo(), true)  // Recorded onto the armed audio track (AudioInputRecorder)
         .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
       project(project_), transport(transport_)
 {
     pluginFormatManager.addDefaultFormats();
-    mainGraph = std::make_unique<juce::AudioProcessorGraph>();
+
+    pluginScanner = std::make_unique<PluginScanner>(knownPluginList,
+        juce::File::getSpecialLocation(juce::File::currentApplicationFile).getSiblingFile("plugins.xml"));
     loadPluginList();
+    pluginLoader = std::make_unique<PluginLoader>(pluginFormatManager);
+    trackFreezer = std::make_unique<TrackFreezer>(project, transport, *pluginLoader);
+    trackFreezer->onInvalidated = [this](int trackUid) { thawTrack(trackUid, true, "its clips or the tempo changed"); };
+    busGraph = std::make_unique<BusGraph>();
+    masterEffect.setBypassWhenEmpty(true);
+    masterEffectMidi.ensureSize(64);
+    audioClipStreamer = std::make_unique<AudioClipStreamer>();
+    audioClipStreamer->startThread(juce::Thread::Priority::high);
+    audioInputRecorder = std::make_unique<AudioInputRecorder>();
+    pianoResonance = std::make_unique<PianoResonance>();
+    incomingMidi.ensureSize(2048);
+    anticipativeRenderer = std::make_unique<AnticipativeRenderer>(trackChains);
     setupVoices();
     
     // Create MIDI recorder
@@ -123,35 +178,56 @@ bool AudioEngine::acceptsMidi() const { return true; }
 bool AudioEngine::producesMidi() const { return false; }
 bool AudioEngine::isMidiEffect() const { return false; }
 double AudioEngine::getTailLengthSeconds() const { return 0.0; }
+bool AudioEngine::supportsDoublePrecisionProcessing() const { return true; }
 
 void AudioEngine::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     synth.setCurrentPlaybackSampleRate(sampleRate);
-    
-    if (mainGraph != nullptr)
-    {
-        mainGraph->setPlayConfigDetails(getMainBusNumInputChannels(),
-                                      getMainBusNumOutputChannels(),
-                                      sampleRate, samplesPerBlock);
-        mainGraph->prepareToPlay(sampleRate, samplesPerBlock);
-        updateGraph();
-    }
+    playhead.prepare(sampleRate);
+    anticipativeRenderer->prepare(sampleRate);
+    trackFreezer->setSampleRate(sampleRate);
+    audioClipStreamer->prepare(sampleRate);
+    audioInputRecorder->prepare(sampleRate, getMainBusNumInputChannels());
+    metronome.prepare(sampleRate, samplesPerBlock);
+    pianoResonance->prepare(sampleRate, samplesPerBlock);
+
+    // The main instrument renders straight into the host's buffer, so it follows its precision
+    mainChain.setProcessingPrecision(getProcessingPrecision());
+    mainChain.prepare(sampleRate, samplesPerBlock, getMainBusNumOutputChannels());
+    busGraph->prepare(sampleRate, samplesPerBlock, getMainBusNumOutputChannels());
+    masterEffect.setProcessingPrecision(getProcessingPrecision());
+    masterEffect.prepare(sampleRate, samplesPerBlock, getMainBusNumOutputChannels());
+    masterMeter.prepare(sampleRate, samplesPerBlock);
+    profiler.prepare(sampleRate);
+
+    // Workers must not render while the chains reallocate
+    const juce::ScopedWriteLock chainListLock(anticipativeRenderer->getChainListLock());
+    juce::ScopedLock sl(project.getLock());
+    for (auto& chain : trackChains)
+        chain->prepare(sampleRate, samplesPerBlock, getMainBusNumOutputChannels());
 }
 
 void AudioEngine::releaseResources() {}
 
 void AudioEngine::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    // Debug: Check if MIDI is being received
-    if (!midiMessages.isEmpty()) {
-        static int counter = 0;
-        if (++counter % 30 == 0) {  // Log every 30th message to avoid spam
-            DBG("AudioEngine: Received " << midiMessages.getNumEvents() << " MIDI events");
-            DebugLogWindow::addLog("MIDI: Received " + juce::String(midiMessages.getNumEvents()) + " events (playing=" + juce::String(transport.isPlaying() ? "YES" : "NO") + ")");
-        }
-    }
-    
+    renderBlock(buffer, midiMessages);
+}
+
+void AudioEngine::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    renderBlock(buffer, midiMessages);
+}
+
+template <typename SampleType>
+void AudioEngine::renderBlock(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
+{
+    // Debug builds with PIANODAW_RT_CHECKS flag allocations, lock waits and system calls from here on
+    const RealtimeSafety::ScopedRealtime realtime;
+
+    profiler.beginBlock(buffer.getNumSamples());
     juce::ScopedLock sl(project.getLock());
+    profiler.mark(CallbackProfiler::lockWait);
     
     // Merge hardware MIDI input
     {
@@ -160,8 +236,9 @@ void AudioEngine::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffe
         hardwareMidiBuffer.clear();
     }
     
-    // Copy incoming MIDI for recording
-    juce::MidiBuffer incomingMidi = midiMessages;
+    // Copy incoming MIDI for recording (into storage reserved up front)
+    incomingMidi.clear();
+    incomingMidi.addEvents(midiMessages, 0, -1, 0);
     
     // Always merge incoming MIDI (keyboard input should always work)
     // This allows MIDI keyboard to play even when stopped
@@ -172,17 +249,46 @@ void AudioEngine::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffe
         midiMessages.addEvents(uiMidiBuffer, 0, buffer.getNumSamples(), 0);
         uiMidiBuffer.clear();
     }
+    profiler.mark(CallbackProfiler::midiMerge);
+
+    for (auto& chain : trackChains)
+        chain->beginBlock();
+
+    int numSamples = buffer.getNumSamples();
+    updateMixer(numSamples);
+    profiler.mark(CallbackProfiler::mix);
+
+    // Sequence ahead by the longest path so delayed instruments still sound on time
+    int pathLatency = computePathLatency();
+    compensationLatency.store(pathLatency, std::memory_order_relaxed);
 
-    if (transport.isPlaying())
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> windows;
+    int numWindows = 0;
+
+    // A count-in clicks on the sample clock; playback (and recording) starts at its downbeat
+    int beatsPerBar = project.getTimeSignatureNumerator();
+    int beatTicks = PPQ::TICKS_PER_QUARTER * 4 / project.getTimeSignatureDenominator();
+    metronome.beginBlock(numSamples);
+    int countInSamples = metronome.countIn(transport.isPlaying(), numSamples, transport.getTempo(), beatsPerBar, beatTicks);
+    bool playing = transport.isPlaying() && countInSamples < numSamples;
+
+    if (playing)
     {
-        // Generate MIDI from all tracks
-        processMidiSequencer(midiMessages);
+        // The input is still in the buffer here; the take starts at the tick heard at its first sample
+        audioInputRecorder->push(buffer, countInSamples, numSamples - countInSamples,
+                                 countInSamples > 0 ? metronome.getCountInTick() : transport.getPosition());
+        profiler.mark(CallbackProfiler::recording);
+
+        numWindows = advancePlayhead(numSamples, countInSamples, pathLatency, windows.data(), midiMessages);
+        metronome.render(windows.data(), numWindows, beatsPerBar, beatTicks);
+        profiler.mark(CallbackProfiler::sequencer);
         
         // Record incoming MIDI if armed
         int64_t currentTick = transport.getPosition();
         processMidiRecording(incomingMidi, currentTick);
+        profiler.mark(CallbackProfiler::recording);
     }
-    else if (lastProcessedTick != -1)
+    else if (sequencing)
     {
         synth.allNotesOff(0, false);
         
@@ -191,95 +297,342 @@ void AudioEngine::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffe
         {
             midiMessages.addEvent(juce::MidiMessage::allNotesOff(ch), 0);
             midiMessages.addEvent(juce::MidiMessage::allSoundOff(ch), 0);
+
+            // Pedals too: one left down would hold every note played after the stop
+            midiMessages.addEvent(juce::MidiMessage::controllerEvent(ch, 64, 0), 0);
+            midiMessages.addEvent(juce::MidiMessage::controllerEvent(ch, 66, 0), 0);
+
+            for (auto& chain : trackChains)
+            {
+                chain->getMidi().addEvent(juce::MidiMessage::allNotesOff(ch), 0);
+                chain->getMidi().addEvent(juce::MidiMessage::allSoundOff(ch), 0);
+                chain->getMidi().addEvent(juce::MidiMessage::controllerEvent(ch, 64, 0), 0);
+                chain->getMidi().addEvent(juce::MidiMessage::controllerEvent(ch, 66, 0), 0);
+            }
         }
         
-        lastProcessedTick = -1;
+        sequencing = false;
+        playhead.reset();
     }
 
-    if (mainGraph != nullptr && instrumentNode != nullptr)
+    // Volume/pan automation follows the compensated outputs, so it reads where the block is heard
+    automateMixer(playing, numSamples);
+    profiler.mark(CallbackProfiler::mix);
+
+    // Anticipative rendering: audio rendered ahead is stale once the timeline changes
+    bool renderAhead = playing && anticipativeRenderer->isEnabled();
+    if (renderAhead && (!renderingAhead || playhead.hasTimelineChanged()))
+        aheadEpoch = (aheadEpoch + 1) & 0x3fffffff;
+    renderingAhead = renderAhead;
+
+    int armedUid = getRecordArmedTrackUid();
+
+    for (auto& chain : trackChains)
     {
-        mainGraph->processBlock(buffer, midiMessages);
+        // Instruments other tracks play through are sequenced here with them, so never rendered ahead
+        bool live = chain->getTrackUid() == armedUid || isPlayedByOtherTracks(chain->getTrackUid());
+        bool underrun = false;
+
+        if (renderAhead && !live && chain->getAheadEpoch() == aheadEpoch && chain->playAhead(numSamples, underrun))
+        {
+            if (underrun)
+                ++aheadUnderruns;
+            continue;
+        }
+
+        // A worker is still busy with it: skip the block rather than wait
+        if (!chain->claimForCallback())
+        {
+            if (chain->getAheadEpoch() >= 0)
+                ++aheadUnderruns;
+            chain->skipBlock(numSamples);
+        }
     }
-    else
+    profiler.mark(CallbackProfiler::render);
+
+    // Generate MIDI from all tracks
+    if (numWindows > 0)
+        processMidiSequencer(windows.data(), numWindows, midiMessages);
+    profiler.mark(CallbackProfiler::sequencer);
+
+    // Track instruments; a track whose instrument is still loading plays on the main one
+    audioClipStreamer->beginBlock();
+    for (auto& chain : trackChains)
+    {
+        if (!chain->isClaimedByCallback())
+            continue;
+
+        // Audio tracks play their regions from the disk streamer, delayed like frozen audio
+        auto* track = findTrack(chain->getTrackUid());
+        if (track != nullptr && track->isAudio())
+        {
+            chain->renderAudio(*audioClipStreamer, *track, windows.data(), numWindows, numSamples, transport.getTempo());
+            chain->compensate(chain->getBuffer(), numSamples, pathLatency);
+            continue;
+        }
+
+        // Frozen audio has no latency of its own, and is never rendered ahead
+        if (chain->isFrozen())
+        {
+            chain->renderFrozen(windows.data(), numWindows, numSamples, transport.getTempo());
+            chain->compensate(chain->getBuffer(), numSamples, pathLatency);
+            continue;
+        }
+
+        int chainLatency = chain->getLatencySamples();
+
+        if (chain->render(numSamples))
+        {
+            chain->compensate(chain->getBuffer(), numSamples, pathLatency - chainLatency);
+
+            // From the next block on a worker renders it ahead
+            if (renderAhead && chain->getTrackUid() != armedUid && !isPlayedByOtherTracks(chain->getTrackUid()))
+                chain->followEpoch(aheadEpoch, playhead, samplePosition + numSamples);
+        }
+        else
+        {
+            midiMessages.addEvents(chain->getMidi(), 0, numSamples, 0);
+        }
+    }
+
+    // Main instrument (crossfades on swaps); falls back to the built-in synth
+    int mainLatency = mainChain.getLatencySamples();
+    if (!mainChain.renderInto(buffer, midiMessages))
     {
         buffer.clear();
-        synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
+        synth.renderNextBlock(buffer, midiMessages, 0, numSamples);
+        pianoResonance->process(buffer, midiMessages, numSamples);
+    }
+    mainChain.compensate(buffer, numSamples, pathLatency - mainLatency);
+
+    // Streams for regions coming up; the ones nothing asked for this block are released
+    cueAudioRegions(windows.data(), numWindows);
+    audioClipStreamer->endBlock();
+    profiler.mark(CallbackProfiler::render);
+
+    // Master bus: the main instrument plus every track chain through its channel strip, directly or via its buses
+    for (auto& chain : trackChains)
+    {
+        if (auto* chainBuffer = chain->getBlockOutput())
+        {
+            auto& strip = chain->getStrip();
+            int bus = chain->getOutputBus();
+            if (bus >= 0)
+                strip.mixInto(*chainBuffer, busGraph->getBusInput(bus), numSamples);
+            else
+                strip.mixInto(*chainBuffer, buffer, numSamples);
+
+            chain->getMeter().process(*chainBuffer, numSamples, strip.getGain(0), strip.getGain(1));
+        }
+        else
+        {
+            chain->getMeter().processSilence(numSamples);
+        }
+
+        chain->releaseFromCallback();
     }
+
+    busGraph->process(buffer, numSamples);
+    masterEffectMidi.clear();
+    masterEffect.process(buffer, masterEffectMidi);
+    masterMeter.process(buffer, numSamples);
+
+    // The click joins after the meter, delayed like the tracks so it lands on the beat they are heard on
+    metronome.addTo(buffer, numSamples, pathLatency);
+
+    if (renderAhead)
+        sequenceAhead(numSamples);
+
+    samplePosition += numSamples;
+    anticipativeRenderer->publish(renderAhead ? aheadEpoch : -1, samplePosition, numSamples, pathLatency);
+    profiler.mark(CallbackProfiler::mix);
+    profiler.endBlock();
+}
+
+void AudioEngine::sequenceAhead(int numSamples)
+{
+    // Workers render only what is sequenced here, under the project lock this callback already holds
+    auto upTo = samplePosition + numSamples + anticipativeRenderer->getAheadSamples();
+
+    for (auto& chain : trackChains)
+        if (chain->getAheadEpoch() == aheadEpoch)
+            if (auto* track = findTrack(chain->getTrackUid()))
+                chain->sequenceAhead(*track, upTo, numSamples, maxAheadStepsPerBlock);
 }
 
-void AudioEngine::processBlock(juce::AudioBuffer<double>& /*buffer*/, juce::MidiBuffer& /*midiMessages*/)
+void AudioEngine::updateMixer(int numSamples)
 {
-    // Double precision not used in this MVP
+    const auto& tracks = project.getTracks();
+    mixer.beginBlock(tracks);
+    busGraph->beginBlock(tracks, mixer, numSamples);
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (auto* chain = findTrackChain(tracks[i]->getUid()))
+        {
+            chain->getStrip().setTarget(tracks[i]->getVolume(), tracks[i]->getPan(), mixer.isActive(i));
+            chain->setOutputBus(busGraph->getOutputBus(mixer, i));
+        }
+    }
 }
 
-void AudioEngine::processMidiSequencer(juce::MidiBuffer& midiMessages)
+void AudioEngine::automateMixer(bool playing, int numSamples)
 {
-    // No lock here as it's called from processBlock which already has the lock
-    int64_t currentTick = transport.getPosition();
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> audibleWindows;
+    int numAudible = playing ? playhead.getAudibleWindows(audibleWindows.data()) : 0;
+    auto holdTick = playing ? playhead.getPosition() : transport.getPosition();
+
+    auto readable = [](const AutomationLane* lane) { return lane != nullptr && lane->isEnabled() && !lane->isEmpty() ? lane : nullptr; };
 
-    if (lastProcessedTick == -1)
+    const auto& tracks = project.getTracks();
+    for (size_t i = 0; i < tracks.size(); ++i)
     {
-        lastProcessedTick = currentTick;
-        return;
+        const auto& track = *tracks[i];
+        if (track.getAutomationLanes().empty())
+            continue;
+
+        auto* volumeLane = readable(track.findAutomationLane(AutomationLane::Target::Volume));
+        auto* panLane = readable(track.findAutomationLane(AutomationLane::Target::Pan));
+        if (volumeLane == nullptr && panLane == nullptr)
+            continue;
+
+        ChannelStrip* strip = track.isBus() ? busGraph->getBusStrip(i) : nullptr;
+        if (!track.isBus())
+            if (auto* chain = findTrackChain(track.getUid()))
+                strip = &chain->getStrip();
+
+        if (strip != nullptr)
+            strip->automate(volumeLane, panLane, audibleWindows.data(), numAudible, holdTick, numSamples);
     }
+}
+
+int AudioEngine::computePathLatency() const
+{
+    // Each path is a single instrument graph, whose latency already covers its own nodes
+    int latency = mainChain.getLatencySamples();
+    for (auto& chain : trackChains)
+        latency = juce::jmax(latency, chain->getLatencySamples());
+
+    return juce::jlimit(0, mainChain.getMaxCompensationSamples(), latency);
+}
+
+int AudioEngine::advancePlayhead(int numSamples, int startOffset, int lookaheadSamples, BlockTickWindow* windows,
+                                 juce::MidiBuffer& midiMessages)
+{
+    // The generation first: setPosition() stores the tick before bumping it
+    auto locateGeneration = transport.getLocateGeneration();
+
+    // Started by a count-in mid-block: the windows start on the downbeat sample, nothing plays before it
+    auto transportTick = startOffset > 0 ? metronome.getCountInTick() : transport.getPosition();
 
-    if (currentTick < lastProcessedTick) // Looped or jumped back
+    playhead.setLoop(transport.isLooping(), transport.getLoopStart(), transport.getLoopEnd());
+    int numWindows = playhead.advance(transportTick, locateGeneration, transport.getTempo(), numSamples,
+                                      lookaheadSamples, windows, startOffset);
+    sequencing = true;
+
+    // The sample clock drives the transport, not the other way round
+    transport.publishClockPosition(playhead.getPosition(), playhead.getLocateGeneration());
+
+    if (playhead.hasJumped()) // Located or jumped back
     {
         synth.allNotesOff(0, false);
-        lastProcessedTick = currentTick;
+
+        // Only the channels each instrument is sequenced on; live input keeps playing on the others
+        TrackSequencer::addAllNotesOff(midiMessages, getMidiChannelMask(nullptr), 0);
+        for (auto& chain : trackChains)
+            TrackSequencer::addAllNotesOff(chain->getMidi(), getMidiChannelMask(chain.get()), 0);
     }
 
-    // Play all tracks
-    for (const auto& track : project.getTracks())
+    return numWindows;
+}
+
+void AudioEngine::processMidiSequencer(const BlockTickWindow* windows, int numWindows, juce::MidiBuffer& midiMessages)
+{
+    // No lock here as it's called from processBlock which already has the lock
+    const auto& tracks = project.getTracks();
+    for (size_t i = 0; i < tracks.size(); ++i)
     {
-        // Skip muted tracks
-        if (track->isMuted())
+        const auto& track = *tracks[i];
+
+        // Tracks with their own instrument get their own MIDI; a worker sequences those rendered ahead
+        auto* chain = findMidiDestination(track);
+        if (chain != nullptr && (chain->isPlayingAhead() || chain->isFrozen()))
             continue;
-        
-        // Play each clip region in the track
-        for (const auto& clipRegion : track->getClipRegions())
+
+        // Their channel strip fades muted/unsoloed chains; tracks sharing an instrument just go quiet
+        if (chain != nullptr && chain->getTrackUid() == track.getUid())
         {
-            Clip* clip = clipRegion.clip;
-            if (!clip)
-                continue;
-            
-            int64_t clipStartTick = clipRegion.startTick;
-            int64_t clipOffset = clipRegion.offsetTick;
-            int64_t clipLengthTick = clipRegion.lengthTick;
-            int64_t clipEndTick = clipStartTick + clipLengthTick;
-            
-            // Check if we're currently playing this clip region
-            if (currentTick < clipStartTick || currentTick >= clipEndTick)
-                continue;
-            
-            // Play notes from this clip
-            auto& notes = clip->getNotes();
-            for (const auto& note : notes)
-            {
-                // Convert note time to timeline time (add clip start + offset)
-                int64_t noteAbsoluteStart = clipStartTick + (note.startTick - clipOffset);
-                int64_t noteAbsoluteEnd = clipStartTick + (note.endTick - clipOffset);
-                
-                // Check if note is within clip region bounds
-                if (noteAbsoluteStart < clipStartTick || noteAbsoluteEnd > clipEndTick)
-                    continue;
-                
-                // Note On
-                if (noteAbsoluteStart >= lastProcessedTick && noteAbsoluteStart < currentTick)
-                {
-                    midiMessages.addEvent(juce::MidiMessage::noteOn(1, note.pitch, (juce::uint8)note.velocity), 0);
-                }
-                
-                // Note Off
-                if (noteAbsoluteEnd >= lastProcessedTick && noteAbsoluteEnd < currentTick)
-                {
-                    midiMessages.addEvent(juce::MidiMessage::noteOff(1, note.pitch), 0);
-                }
-            }
+            TrackSequencer::sequence(track, windows, numWindows, chain->getMidi(), 0, false);
+            ParameterAutomation::sequence(track, windows, numWindows, chain->getParameterChanges());
         }
+        else if (mixer.isActive(i))
+            TrackSequencer::sequence(track, windows, numWindows, chain != nullptr ? chain->getMidi() : midiMessages);
+    }
+}
+
+void AudioEngine::cueAudioRegions(const BlockTickWindow* windows, int numWindows)
+{
+    double tempo = transport.getTempo();
+    auto prerollTicks = PPQ::secondsToTick(AudioClipStreamer::prerollSeconds, tempo);
+    bool looping = transport.isLooping() && transport.getLoopEnd() > transport.getLoopStart();
+
+    // Where the next block continues (the transport while stopped, so play starts from a full buffer)
+    int64_t from = transport.getPosition();
+    if (numWindows > 0)
+        from = windows[numWindows - 1].endsAtLoopEnd ? transport.getLoopStart() : windows[numWindows - 1].endTick;
+
+    int64_t to = from + prerollTicks;
+    int64_t wrapTo = 0;   // Cued from the loop start when the preroll crosses the loop end
+    if (looping && from < transport.getLoopEnd() && to > transport.getLoopEnd())
+    {
+        wrapTo = transport.getLoopStart() + (to - transport.getLoopEnd());
+        to = transport.getLoopEnd();
+    }
+
+    for (const auto& track : project.getTracks())
+    {
+        if (!track->isAudio() || findTrackChain(track->getUid()) == nullptr)
+            continue;
+
+        audioClipStreamer->cue(*track, from, to, tempo);
+        if (wrapTo > 0)
+            audioClipStreamer->cue(*track, transport.getLoopStart(), wrapTo, tempo);
     }
+}
+
+TrackChain* AudioEngine::findMidiDestination(const Track& track) const
+{
+    // A frozen instrument plays its rendered audio only; the track falls back to its own
+    if (track.getMidiTargetUid() != 0)
+    {
+        auto* target = findTrackChain(track.getMidiTargetUid());
+        if (target != nullptr && !target->isFrozen())
+            return target;
+    }
+
+    return findTrackChain(track.getUid());
+}
+
+juce::uint16 AudioEngine::getMidiChannelMask(const TrackChain* destination) const
+{
+    juce::uint16 mask = 0;
+    for (const auto& track : project.getTracks())
+        if (!track->isBus() && findMidiDestination(*track) == destination)
+            mask |= TrackSequencer::getChannelBit(track->getMidiChannel());
+
+    return mask;
+}
 
-    lastProcessedTick = currentTick;
+bool AudioEngine::isPlayedByOtherTracks(int trackUid) const
+{
+    auto* track = findTrack(trackUid);
+    return track != nullptr && project.isMidiTarget(*track);
+}
+
+int AudioEngine::getRecordArmedTrackUid()
+{
+    auto* track = project.getTrack(recordArmedTrackIndex);
+    return track != nullptr ? track->getUid() : -1;
 }
 
 void AudioEngine::processMidiRecording(const juce::MidiBuffer& midiMessages, int64_t currentTick)
@@ -303,186 +656,1110 @@ void AudioEngine::changeProgramName(int /*index*/, const juce::String& /*newName
 
 void AudioEngine::getStateInformation(juce::MemoryBlock& destData)
 {
-    auto xml = std::make_unique<juce::XmlElement>("PianoDAWAudioSettings");
-    
-    if (instrumentNode != nullptr && instrumentNode->getProcessor() != nullptr)
+    copyXmlToBinary(*createStateXml(), destData);
+}
+
+void AudioEngine::setStateInformation(const void* data, int sizeInBytes)
+{
+    if (auto xmlState = getXmlFromBinary(data, sizeInBytes))
+        restoreStateXml(*xmlState);
+}
+
+namespace
+{
+    void writePluginState(juce::XmlElement& xml, juce::AudioProcessor* plugin, const juce::PluginDescription& description)
     {
-        auto* plugin = instrumentNode->getProcessor();
-        xml->setAttribute("pluginDescription", currentPluginDescription.createIdentifierString());
-        
+        if (plugin == nullptr)
+            return;
+
+        xml.setAttribute("pluginDescription", description.createIdentifierString());
+        xml.setAttribute("sandboxed", dynamic_cast<SandboxedPlugin*>(plugin) != nullptr);
+
         juce::MemoryBlock pluginState;
         plugin->getStateInformation(pluginState);
-        xml->setAttribute("pluginState", pluginState.toBase64Encoding());
+        xml.setAttribute("pluginState", pluginState.toBase64Encoding());
     }
-    
-    copyXmlToBinary(*xml, destData);
-}
 
-void AudioEngine::setStateInformation(const void* data, int sizeInBytes)
-{
-    auto xmlState = getXmlFromBinary(data, sizeInBytes);
-    
-    if (xmlState != nullptr && xmlState->hasTagName("PianoDAWAudioSettings"))
+    void writeFreezeState(juce::XmlElement& xml, const TrackFreezer::Freeze& freeze)
     {
-        juce::String pluginID = xmlState->getStringAttribute("pluginDescription");
-        if (pluginID.isNotEmpty())
-        {
-            auto desc = knownPluginList.getTypeForIdentifierString(pluginID);
-            if (desc != nullptr)
-            {
-                if (loadPlugin(*desc))
-                {
-                    auto stateStr = xmlState->getStringAttribute("pluginState");
-                    if (stateStr.isNotEmpty())
-                    {
-                        juce::MemoryBlock pluginState;
-                        pluginState.fromBase64Encoding(stateStr);
-                        if (instrumentNode != nullptr)
-                            instrumentNode->getProcessor()->setStateInformation(pluginState.getData(), (int)pluginState.getSize());
-                    }
-                }
-            }
-        }
+        // The instrument as it was at freeze time, so unfreezing still works after a reload
+        xml.setAttribute("pluginDescription", freeze.description.createIdentifierString());
+        xml.setAttribute("sandboxed", freeze.sandboxed);
+        xml.setAttribute("pluginState", freeze.state.toBase64Encoding());
+        xml.setAttribute("frozenFile", freeze.file.getFullPathName());
+        xml.setAttribute("frozenFingerprint", juce::String::toHexString((juce::int64)freeze.fingerprint));
     }
 }
 
-void AudioEngine::setupVoices()
+std::unique_ptr<juce::XmlElement> AudioEngine::createStateXml() const
 {
-    for (int i = 0; i < 32; ++i)
-        synth.addVoice(new SimplePianoVoice());
+    auto xml = std::make_unique<juce::XmlElement>("PianoDAWAudioSettings");
+    writePluginState(*xml, mainChain.getInstrument(), mainChain.getInstrumentDescription());
 
-    synth.addSound(new SimplePianoSound());
-}
+    // Tracks are identified by position; uids are not persisted
+    for (int i = 0; i < project.getNumTracks(); ++i)
+    {
+        auto* chain = findTrackChain(project.getTracks()[(size_t)i]->getUid());
+        auto* freeze = chain != nullptr ? trackFreezer->getFreeze(chain->getTrackUid()) : nullptr;
+        if (chain == nullptr || (!chain->hasInstrument() && freeze == nullptr))
+            continue;
 
-void AudioEngine::updateGraph()
-{
-    if (mainGraph == nullptr) return;
+        auto* trackXml = xml->createNewChildElement("TrackInstrument");
+        trackXml->setAttribute("track", i);
+
+        if (freeze != nullptr)
+            writeFreezeState(*trackXml, *freeze);
+        else
+            writePluginState(*trackXml, chain->getInstrument(), chain->getInstrumentDescription());
+    }
 
-    mainGraph->clear();
+    for (int i = 0; i < project.getNumTracks(); ++i)
+    {
+        int busUid = project.getTracks()[(size_t)i]->getUid();
+        auto* effect = busGraph->getEffect(busUid);
+        if (effect == nullptr)
+            continue;
 
-    audioOutNode = mainGraph->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(
-        juce::AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode));
+        auto* busXml = xml->createNewChildElement("BusEffect");
+        busXml->setAttribute("track", i);
+        writePluginState(*busXml, effect, *busGraph->getEffectDescription(busUid));
+    }
 
-    midiInNode = mainGraph->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(
-        juce::AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode));
+    if (auto* effect = getMasterEffect())
+        writePluginState(*xml->createNewChildElement("MasterEffect"), effect, masterEffectDescription);
 
-    // Connections will be made when a plugin is loaded
+    return xml;
 }
 
-void AudioEngine::scanPlugins()
+void AudioEngine::resetForNewProject()
 {
-    // Basic standard paths
-    juce::FileSearchPath searchPath;
-#if JUCE_WINDOWS
-    searchPath.add(juce::File("C:\\Program Files\\Common Files\\VST3"));
-    searchPath.add(juce::File("C:\\Program Files\\VSTPlugins"));
-#elif JUCE_MAC
-    searchPath.add(juce::File("/Library/Audio/Plug-Ins/VST3"));
-#endif
-
-    juce::AudioPluginFormatManager manager;
-    manager.addDefaultFormats();
+    // The project was just replaced: chains and bus effects of vanished tracks go, the rest start empty
+    pruneTrackChains();
+    busGraph->prune(project.getTracks(), project.getLock());
+    for (auto& track : project.getTracks())
+    {
+        if (track->isBus())
+            unloadBusEffect(*track);
+    }
 
-    knownPluginList.clear();
-    
-    for (auto* format : manager.getFormats())
+    unloadMasterEffect();
+    mainChain.clearInstrument();
+    for (auto& chain : trackChains)
     {
-        juce::PluginDirectoryScanner scanner(knownPluginList, *format, searchPath, true, juce::File());
-        juce::String name;
-        while (scanner.scanNextFile(true, name)) {}
+        chain->clearInstrument();
+        chain->setFrozen(nullptr, project.getLock());
     }
 
-    savePluginList();
-}
+    // Frozen files of the closed project stay in the cache for when it is opened again
+    trackFreezer->releaseAll();
 
-void AudioEngine::handleNoteOn(int midiNoteNumber, float velocity)
-{
-    juce::ScopedLock sl(uiMidiLock);
-    uiMidiBuffer.addEvent(juce::MidiMessage::noteOn(1, midiNoteNumber, velocity), 0);
+    // Audio tracks have no instrument to restore, only a chain to play through
+    for (auto& track : project.getTracks())
+    {
+        if (track->isAudio())
+            getOrCreateTrackChain(track->getUid());
+    }
 }
 
-void AudioEngine::handleNoteOff(int midiNoteNumber)
+void AudioEngine::restoreStateXml(const juce::XmlElement& xml)
 {
-    juce::ScopedLock sl(uiMidiLock);
-    uiMidiBuffer.addEvent(juce::MidiMessage::noteOff(1, midiNoteNumber), 0);
-}
+    resetForNewProject();
 
-bool AudioEngine::loadPlugin(const juce::PluginDescription& description)
-{
-    juce::String errorMessage;
-    auto instance = pluginFormatManager.createPluginInstance(description, getSampleRate(), getBlockSize(), errorMessage);
+    if (!xml.hasTagName("PianoDAWAudioSettings"))
+        return;
 
-    if (instance == nullptr)
+    auto findDescription = [this](const juce::XmlElement& e) -> std::unique_ptr<juce::PluginDescription>
     {
-        DBG("AudioEngine: Failed to load plugin: " + errorMessage);
-        return false;
-    }
+        juce::String pluginID = e.getStringAttribute("pluginDescription");
+        if (pluginID.isEmpty())
+            return nullptr;
+
+        auto desc = knownPluginList.getTypeForIdentifierString(pluginID);
+        if (desc == nullptr && pluginID == SandboxedPlugin::getTestToneDescription().createIdentifierString())
+            desc = std::make_unique<juce::PluginDescription>(SandboxedPlugin::getTestToneDescription());
+        if (desc == nullptr && pluginID == ConvolutionReverb::getDescription().createIdentifierString())
+            desc = std::make_unique<juce::PluginDescription>(ConvolutionReverb::getDescription());
 
-    currentPluginDescription = description;
+        if (desc == nullptr)
+            DebugLogWindow::addLog("AudioEngine: Plugin not in plugin list: " + pluginID);
 
-    if (audioOutNode == nullptr || midiInNode == nullptr)
-        updateGraph();
+        return desc;
+    };
 
-    if (mainGraph == nullptr) return false;
+    auto restore = [this, &findDescription](const juce::XmlElement& e, int trackUid)
+    {
+        auto desc = findDescription(e);
+        if (desc == nullptr)
+            return;
+
+        juce::MemoryBlock pluginState;
+        pluginState.fromBase64Encoding(e.getStringAttribute("pluginState"));
+
+        // A frozen track plays its file as long as it still matches the track
+        auto* track = findTrack(trackUid);
+        if (track != nullptr && e.hasAttribute("frozenFile"))
+        {
+            TrackFreezer::Freeze freeze;
+            freeze.file = juce::File(e.getStringAttribute("frozenFile"));
+            freeze.description = *desc;
+            freeze.state = pluginState;
+            freeze.sandboxed = e.getBoolAttribute("sandboxed");
+            freeze.fingerprint = (juce::uint64)e.getStringAttribute("frozenFingerprint").getHexValue64();
+
+            juce::String error;
+            if (auto reader = trackFreezer->adopt(*track, std::move(freeze), error))
+            {
+                getOrCreateTrackChain(trackUid).setFrozen(std::move(reader), project.getLock());
+                return;
+            }
 
-    // Remove old instrument if exists
-    if (instrumentNode != nullptr)
-        mainGraph->removeNode(instrumentNode);
+            DebugLogWindow::addLog("AudioEngine: Loading the instrument of frozen track " + track->getName() + " (" + error + ")");
+        }
 
-    instrumentNode = mainGraph->addNode(std::move(instance));
+        loadPluginIntoChain(trackUid, *desc, pluginState, e.getBoolAttribute("sandboxed"), nullptr);
+    };
 
-    // Connect MIDI
-    mainGraph->addConnection({ { midiInNode->nodeID, juce::AudioProcessorGraph::midiChannelIndex },
-                             { instrumentNode->nodeID, juce::AudioProcessorGraph::midiChannelIndex } });
+    restore(xml, TrackChain::mainUid);
 
-    // Connect Audio
-    for (int i = 0; i < getMainBusNumOutputChannels(); ++i)
+    for (auto* trackXml : xml.getChildWithTagNameIterator("TrackInstrument"))
     {
-        mainGraph->addConnection({ { instrumentNode->nodeID, i },
-                                 { audioOutNode->nodeID, i } });
+        if (auto* track = project.getTrack(trackXml->getIntAttribute("track", -1)))
+            restore(*trackXml, track->getUid());
     }
 
-    instrumentNode->getProcessor()->prepareToPlay(getSampleRate(), getBlockSize());
+    for (auto* busXml : xml.getChildWithTagNameIterator("BusEffect"))
+    {
+        auto* bus = project.getTrack(busXml->getIntAttribute("track", -1));
+        auto desc = bus != nullptr && bus->isBus() ? findDescription(*busXml) : nullptr;
+        if (desc == nullptr)
+            continue;
 
-    return true;
+        juce::MemoryBlock pluginState;
+        pluginState.fromBase64Encoding(busXml->getStringAttribute("pluginState"));
+        loadEffectIntoBus(bus->getUid(), *desc, pluginState, busXml->getBoolAttribute("sandboxed"), nullptr);
+    }
+
+    if (auto* masterXml = xml.getChildByName("MasterEffect"))
+    {
+        if (auto desc = findDescription(*masterXml))
+        {
+            juce::MemoryBlock pluginState;
+            pluginState.fromBase64Encoding(masterXml->getStringAttribute("pluginState"));
+            loadEffectIntoMaster(*desc, pluginState, masterXml->getBoolAttribute("sandboxed"), nullptr);
+        }
+    }
 }
 
-juce::AudioProcessor* AudioEngine::getCurrentPlugin() const
+void AudioEngine::setupVoices()
 {
-    if (instrumentNode != nullptr)
-        return instrumentNode->getProcessor();
-    return nullptr;
+    // All preallocated: the pool's ceiling limits how many sound, the rest cover steal fades
+    for (int i = 0; i < VoicePool::maxVoices + VoicePool::maxReserve; ++i)
+        synth.addVoice(new SimplePianoVoice());
+
+    synth.addSound(new SimplePianoSound());
 }
 
-void AudioEngine::showEditor()
+void AudioEngine::setPianoResonance(float level)
 {
-    // This will be implemented using a separate window class
-    // For now, we'll trigger it from VstBrowserPanel or a dedicated button
+    pianoResonance->setLevel(level);
 }
 
-void AudioEngine::savePluginList()
+float AudioEngine::getPianoResonance() const
 {
-    auto file = juce::File::getSpecialLocation(juce::File::currentApplicationFile)
-                    .getSiblingFile("plugins.xml");
-    
-    auto xml = knownPluginList.createXml();
-    if (xml != nullptr)
-        xml->writeTo(file);
+    return pianoResonance->getLevel();
 }
 
-void AudioEngine::loadPluginList()
+void AudioEngine::loadSampledPiano(const juce::File& folder, size_t ramBudgetBytes, SampledPianoCallback onDone)
 {
-    auto file = juce::File::getSpecialLocation(juce::File::currentApplicationFile)
-                    .getSiblingFile("plugins.xml");
-    
-    if (file.existsAsFile())
+    SamplePool::Options options;
+    options.ramBudgetBytes = ramBudgetBytes;
+
+    ++sampledPianoLoads;
+    DebugLogWindow::addLog("AudioEngine: Loading piano samples from " + folder.getFullPathName() + "...");
+
+    juce::WeakReference<AudioEngine> weakThis(this);
+    samplePoolLoader.addJob([weakThis, folder, options, onDone]
     {
-        auto xml = juce::XmlDocument::parse(file);
-        if (xml != nullptr)
+        // Reading the heads is the slow part; the pool is only shared once it is complete
+        auto newPool = std::make_shared<std::unique_ptr<SamplePool>>(std::make_unique<SamplePool>());
+        auto error = std::make_shared<juce::String>();
+        bool loaded = (*newPool)->loadFolder(folder, options, *error);
+
+        // The engine may have been destroyed during the load; the pool is only handed over on the message thread
+        juce::MessageManager::callAsync([weakThis, newPool, error, loaded, onDone]
         {
-            knownPluginList.recreateFromXml(*xml);
-        }
-    }
+            auto* engine = weakThis.get();
+            if (engine == nullptr)
+                return;
+
+            --engine->sampledPianoLoads;
+            for (auto& line : (*newPool)->getLoadLog())
+                DebugLogWindow::addLog(line);
+
+            if (!loaded)
+                DebugLogWindow::addLog("AudioEngine: Sampled piano failed: " + *error);
+            else
+                engine->installSamplePool(std::move(*newPool));
+
+            if (onDone != nullptr)
+                onDone(loaded, loaded ? juce::String() : *error);
+        });
+    });
+}
+
+void AudioEngine::installSamplePool(std::unique_ptr<SamplePool> newPool)
+{
+    // Synthesiser guards its voice/sound lists with its own lock, so this is safe
+    // while playing. Voices must go before the pool whose streamer they use.
+    synth.clearVoices();
+    synth.clearSounds();
+    samplePool = std::move(newPool);
+
+    auto& streamer = samplePool->getStreamer();
+    for (int i = 0; i < streamer.getNumSlots(); ++i)
+        synth.addVoice(new SampledPianoVoice(streamer, i));
+
+    synth.addSound(new SampledPianoSound(*samplePool));
+
+    // The built-in instrument only plays when no VSTi is loaded
+    unloadPlugin();
+
+    DebugLogWindow::addLog("AudioEngine: Sampled piano loaded (" + juce::String(samplePool->getNumSamples()) + " zones)");
+}
+
+void AudioEngine::scanPlugins()
+{
+    // Runs in the background; listeners on getPluginScanner() see progress and results
+    pluginScanner->startScan();
+}
+
+void AudioEngine::handleNoteOn(int midiNoteNumber, float velocity)
+{
+    juce::ScopedLock sl(uiMidiLock);
+    uiMidiBuffer.addEvent(juce::MidiMessage::noteOn(1, midiNoteNumber, velocity), 0);
+}
+
+void AudioEngine::handleNoteOff(int midiNoteNumber)
+{
+    juce::ScopedLock sl(uiMidiLock);
+    uiMidiBuffer.addEvent(juce::MidiMessage::noteOff(1, midiNoteNumber), 0);
+}
+
+Track* AudioEngine::findTrack(int trackUid) const
+{
+    for (auto& track : project.getTracks())
+    {
+        if (track->getUid() == trackUid)
+            return track.get();
+    }
+    return nullptr;
+}
+
+TrackChain* AudioEngine::findTrackChain(int trackUid) const
+{
+    for (auto& chain : trackChains)
+    {
+        if (chain->getTrackUid() == trackUid)
+            return chain.get();
+    }
+    return nullptr;
+}
+
+void AudioEngine::prepareTrackChain(TrackChain& chain)
+{
+    double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+    chain.prepare(sampleRate, blockSize, getMainBusNumOutputChannels());
+}
+
+TrackChain& AudioEngine::getOrCreateTrackChain(int trackUid)
+{
+    if (auto* existing = findTrackChain(trackUid))
+        return *existing;
+
+    pruneTrackChains();
+
+    // Prepared before the audio thread can see it
+    auto chain = std::make_unique<TrackChain>(trackUid);
+    prepareTrackChain(*chain);
+
+    auto& result = *chain;
+    const juce::ScopedWriteLock chainListLock(anticipativeRenderer->getChainListLock());
+    juce::ScopedLock sl(project.getLock());
+    trackChains.push_back(std::move(chain));
+    return result;
+}
+
+void AudioEngine::pruneTrackChains()
+{
+    std::vector<std::unique_ptr<TrackChain>> removed;
+
+    {
+        const juce::ScopedWriteLock chainListLock(anticipativeRenderer->getChainListLock());
+        juce::ScopedLock sl(project.getLock());
+        for (auto it = trackChains.begin(); it != trackChains.end();)
+        {
+            bool trackExists = false;
+            for (auto& track : project.getTracks())
+                trackExists = trackExists || track->getUid() == (*it)->getTrackUid();
+
+            if (trackExists)
+            {
+                ++it;
+            }
+            else
+            {
+                removed.push_back(std::move(*it));
+                it = trackChains.erase(it);
+            }
+        }
+    }
+
+    // Destroyed outside the lock: releasing plugins can take a while
+    removed.clear();
+    busGraph->prune(project.getTracks(), project.getLock());
+}
+
+void AudioEngine::loadPlugin(const juce::PluginDescription& description, Track* track, PluginLoadedCallback onLoaded)
+{
+    // A new instrument makes the frozen audio meaningless
+    if (track != nullptr && trackFreezer->isFrozen(track->getUid()))
+        thawTrack(track->getUid(), false, "a new instrument was loaded");
+
+    loadPluginIntoChain(track != nullptr ? track->getUid() : TrackChain::mainUid, description, {},
+                        sandboxNewPlugins, std::move(onLoaded));
+}
+
+void AudioEngine::loadPluginIntoChain(int trackUid, const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                                      bool sandboxed, PluginLoadedCallback onLoaded)
+{
+    auto& chain = trackUid == TrackChain::mainUid ? mainChain : getOrCreateTrackChain(trackUid);
+    int generation = chain.beginLoad();
+
+    double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+
+    pluginLoader->load(description, state, sampleRate, blockSize, getMainBusNumOutputChannels(), sandboxed,
+        [this, trackUid, generation, description, onLoaded](PluginLoader::Result result)
+        {
+            // The track may be gone, or a newer load/unload may have superseded this one
+            auto* target = trackUid == TrackChain::mainUid ? &mainChain : findTrackChain(trackUid);
+            if (target == nullptr || !target->isCurrentLoad(generation))
+                return;
+
+            if (result.graph == nullptr)
+            {
+                DebugLogWindow::addLog("AudioEngine: Failed to load plugin " + description.name + ": " + result.error);
+                if (onLoaded != nullptr)
+                    onLoaded(nullptr, result.error);
+                return;
+            }
+
+            target->setInstrument(std::move(result.graph), result.instrumentNode, description);
+            DebugLogWindow::addLog("AudioEngine: Loaded " + description.name);
+
+            if (onLoaded != nullptr)
+                onLoaded(target->getInstrument(), {});
+        });
+}
+
+void AudioEngine::setInstrument(std::unique_ptr<juce::AudioPluginInstance> instrument, Track* track)
+{
+    if (track != nullptr && trackFreezer->isFrozen(track->getUid()))
+        thawTrack(track->getUid(), false, "a new instrument was loaded");
+
+    auto& chain = track == nullptr ? mainChain : getOrCreateTrackChain(track->getUid());
+    chain.beginLoad();
+
+    double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+    auto description = instrument->getPluginDescription();
+
+    juce::AudioProcessorGraph::Node::Ptr node;
+    auto graph = PluginLoader::createInstrumentGraph(std::move(instrument), sampleRate, blockSize,
+                                                     getMainBusNumOutputChannels(), node);
+    chain.setInstrument(std::move(graph), node, description);
+    DebugLogWindow::addLog("AudioEngine: Hosting " + description.name);
+}
+
+void AudioEngine::unloadPlugin(Track* track)
+{
+    if (track != nullptr && trackFreezer->isFrozen(track->getUid()))
+        thawTrack(track->getUid(), false, "its instrument was unloaded");
+
+    if (track == nullptr)
+        mainChain.clearInstrument();
+    else if (auto* chain = findTrackChain(track->getUid()))
+        chain->clearInstrument();
+}
+
+void AudioEngine::loadBusEffect(const juce::PluginDescription& description, Track& bus, PluginLoadedCallback onLoaded)
+{
+    if (!bus.isBus())
+    {
+        if (onLoaded != nullptr)
+            onLoaded(nullptr, "Effects can only be inserted on group and folder tracks");
+        return;
+    }
+
+    loadEffectIntoBus(bus.getUid(), description, {}, sandboxNewPlugins, std::move(onLoaded));
+}
+
+void AudioEngine::loadEffectIntoBus(int busUid, const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                                    bool sandboxed, PluginLoadedCallback onLoaded)
+{
+    int generation = ++busEffectLoads[busUid];
+
+    double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+
+    pluginLoader->load(description, state, sampleRate, blockSize, getMainBusNumOutputChannels(), sandboxed,
+        [this, busUid, generation, description, onLoaded](PluginLoader::Result result)
+        {
+            // The bus may be gone, or a newer load/unload may have superseded this one
+            auto* bus = findTrack(busUid);
+            if (bus == nullptr || busEffectLoads[busUid] != generation)
+                return;
+
+            juce::String error = result.error;
+            if (result.graph != nullptr
+                && !busGraph->setEffect(busUid, std::move(result.graph), result.instrumentNode, description, project.getLock()))
+                error = "Every one of the " + juce::String(BusGraph::maxBuses) + " bus slots is taken";
+
+            if (error.isNotEmpty())
+            {
+                DebugLogWindow::addLog("AudioEngine: Failed to load effect " + description.name + " on " + bus->getName() + ": " + error);
+                if (onLoaded != nullptr)
+                    onLoaded(nullptr, error);
+                return;
+            }
+
+            DebugLogWindow::addLog("AudioEngine: Loaded effect " + description.name + " on " + bus->getName());
+
+            if (onLoaded != nullptr)
+                onLoaded(busGraph->getEffect(busUid), {});
+        });
+}
+
+void AudioEngine::unloadBusEffect(Track& bus)
+{
+    ++busEffectLoads[bus.getUid()];
+    busGraph->setEffect(bus.getUid(), nullptr, nullptr, {}, project.getLock());
+}
+
+juce::AudioProcessor* AudioEngine::getBusEffect(const Track& bus) const
+{
+    return busGraph->getEffect(bus.getUid());
+}
+
+void AudioEngine::loadMasterEffect(const juce::PluginDescription& description, PluginLoadedCallback onLoaded)
+{
+    loadEffectIntoMaster(description, {}, sandboxNewPlugins, std::move(onLoaded));
+}
+
+void AudioEngine::loadEffectIntoMaster(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                                       bool sandboxed, PluginLoadedCallback onLoaded)
+{
+    int generation = ++masterEffectLoads;
+
+    double sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+
+    pluginLoader->load(description, state, sampleRate, blockSize, getMainBusNumOutputChannels(), sandboxed,
+        [this, generation, description, onLoaded](PluginLoader::Result result)
+        {
+            // A newer load/unload may have superseded this one
+            if (masterEffectLoads != generation)
+                return;
+
+            if (result.graph == nullptr)
+            {
+                DebugLogWindow::addLog("AudioEngine: Failed to load master effect " + description.name + ": " + result.error);
+                if (onLoaded != nullptr)
+                    onLoaded(nullptr, result.error);
+                return;
+            }
+
+            // Crossfades from the previous effect (or the dry master) on the audio thread
+            masterEffect.submit(std::move(result.graph));
+            masterEffectNode = result.instrumentNode;
+            masterEffectDescription = description;
+
+            DebugLogWindow::addLog("AudioEngine: Loaded master effect " + description.name);
+
+            if (onLoaded != nullptr)
+                onLoaded(getMasterEffect(), {});
+        });
+}
+
+void AudioEngine::unloadMasterEffect()
+{
+    ++masterEffectLoads;
+    if (masterEffectNode == nullptr)
+        return;
+
+    masterEffect.submit(nullptr);
+    masterEffectNode = nullptr;
+    masterEffectDescription = juce::PluginDescription();
+}
+
+juce::AudioProcessor* AudioEngine::getMasterEffect() const
+{
+    return masterEffectNode != nullptr ? masterEffectNode->getProcessor() : nullptr;
+}
+
+void AudioEngine::loadConvolutionReverb(const juce::File& impulseResponse, Track* bus, PluginLoadedCallback onLoaded)
+{
+    if (!impulseResponse.existsAsFile())
+    {
+        if (onLoaded != nullptr)
+            onLoaded(nullptr, "Impulse response not found: " + impulseResponse.getFullPathName());
+        return;
+    }
+
+    float wet = 0.3f, dry = 1.0f;
+    if (auto* current = dynamic_cast<ConvolutionReverb*>(bus != nullptr ? getBusEffect(*bus) : getMasterEffect()))
+    {
+        wet = current->getWet();
+        dry = current->getDry();
+    }
+
+    auto state = ConvolutionReverb::createState(impulseResponse, wet, dry);
+    if (bus != nullptr)
+        loadEffectIntoBus(bus->getUid(), ConvolutionReverb::getDescription(), state, false, std::move(onLoaded));
+    else
+        loadEffectIntoMaster(ConvolutionReverb::getDescription(), state, false, std::move(onLoaded));
+}
+
+bool AudioEngine::readTrackMeter(const Track& track, LevelMeter::Reading& reading)
+{
+    if (track.isBus())
+        return busGraph->readMeter(track.getUid(), reading);
+
+    auto* chain = findTrackChain(track.getUid());
+    return chain != nullptr && chain->getMeter().read(reading);
+}
+
+bool AudioEngine::readMasterMeter(LevelMeter::Reading& reading)
+{
+    return masterMeter.read(reading);
+}
+
+juce::AudioProcessor* AudioEngine::getCurrentPlugin(Track* track) const
+{
+    if (track == nullptr)
+        return mainChain.getInstrument();
+
+    auto* chain = findTrackChain(track->getUid());
+    return chain != nullptr ? chain->getInstrument() : nullptr;
+}
+
+int AudioEngine::getNumPluginsLoading() const
+{
+    return pluginLoader->getNumPending();
+}
+
+void AudioEngine::freezeTrack(Track& track, FreezeCallback onDone)
+{
+    int trackUid = track.getUid();
+    auto* chain = findTrackChain(trackUid);
+    auto* plugin = chain != nullptr ? chain->getInstrument() : nullptr;
+
+    juce::String error;
+    if (trackFreezer->isFrozen(trackUid) || trackFreezer->isFreezing(trackUid))
+        error = "Track is already frozen";
+    else if (plugin == nullptr)
+        error = "Track has no instrument of its own to freeze";
+    else if (project.isMidiTarget(track))
+        error = "Other tracks play through its instrument";
+
+    if (error.isNotEmpty())
+    {
+        DebugLogWindow::addLog("AudioEngine: Cannot freeze " + track.getName() + ": " + error);
+        if (onDone != nullptr)
+            onDone(false, error);
+        return;
+    }
+
+    juce::MemoryBlock state;
+    plugin->getStateInformation(state);
+    bool sandboxed = dynamic_cast<SandboxedPlugin*>(plugin) != nullptr;
+    int generation = chain->getLoadGeneration();
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+
+    DebugLogWindow::addLog("AudioEngine: Freezing " + track.getName() + "...");
+
+    trackFreezer->freeze(track, chain->getInstrumentDescription(), state, sandboxed, blockSize, getMainBusNumOutputChannels(),
+        [this, trackUid, generation, onDone](std::unique_ptr<FrozenTrackReader> reader, const juce::String& renderError)
+        {
+            juce::String freezeError = renderError;
+            auto* target = findTrackChain(trackUid);
+
+            // The instrument was replaced (or the track removed) while rendering
+            if (reader != nullptr && (target == nullptr || !target->isCurrentLoad(generation)))
+            {
+                reader = nullptr;
+                trackFreezer->release(trackUid).file.deleteFile();
+                freezeError = "Instrument changed while the track was being frozen";
+            }
+
+            if (reader == nullptr)
+            {
+                DebugLogWindow::addLog("AudioEngine: Freeze failed: " + freezeError);
+                if (onDone != nullptr)
+                    onDone(false, freezeError);
+                return;
+            }
+
+            target->clearInstrument();
+            target->setFrozen(std::move(reader), project.getLock());
+
+            auto* track = findTrack(trackUid);
+            DebugLogWindow::addLog("AudioEngine: Froze " + (track != nullptr ? track->getName() : juce::String()));
+
+            if (onDone != nullptr)
+                onDone(true, {});
+        });
+}
+
+void AudioEngine::unfreezeTrack(Track& track)
+{
+    if (trackFreezer->isFrozen(track.getUid()))
+        thawTrack(track.getUid(), true, "on request");
+}
+
+bool AudioEngine::isTrackFrozen(const Track& track) const
+{
+    return trackFreezer->isFrozen(track.getUid());
+}
+
+bool AudioEngine::isTrackFreezing(const Track& track) const
+{
+    return trackFreezer->isFreezing(track.getUid());
+}
+
+void AudioEngine::thawTrack(int trackUid, bool reloadInstrument, const juce::String& reason)
+{
+    auto freeze = trackFreezer->release(trackUid);
+
+    // The reader must be closed before its file can go
+    if (auto* chain = findTrackChain(trackUid))
+        chain->setFrozen(nullptr, project.getLock());
+
+    if (freeze.file.existsAsFile())
+        freeze.file.deleteFile();
+
+    auto* track = findTrack(trackUid);
+    if (track == nullptr)
+        return;
+
+    DebugLogWindow::addLog("AudioEngine: Unfroze " + track->getName() + " (" + reason + ")");
+
+    if (reloadInstrument && freeze.description.fileOrIdentifier.isNotEmpty())
+        loadPluginIntoChain(trackUid, freeze.description, freeze.state, freeze.sandboxed, nullptr);
+}
+
+void AudioEngine::bounceRegion(Track& track, int regionId, BounceCallback onDone)
+{
+    int trackUid = track.getUid();
+    auto* region = track.findClipRegion(regionId);
+
+    // The instrument the region is heard through: the track's own, another track's, or the main one
+    auto* destination = findMidiDestination(track);
+    auto& instrumentChain = destination != nullptr ? *destination : mainChain;
+
+    juce::PluginDescription description;
+    juce::MemoryBlock state;
+    bool sandboxed = false;
+    juce::String error;
+
+    if (region == nullptr || region->clip == nullptr)
+        error = "Only MIDI regions can be bounced";
+    else if (trackFreezer->isBouncing(trackUid, regionId))
+        error = "Region is already being bounced";
+    else if (auto* freeze = trackFreezer->getFreeze(instrumentChain.getTrackUid()))
+    {
+        description = freeze->description;
+        state = freeze->state;
+        sandboxed = freeze->sandboxed;
+    }
+    else if (auto* plugin = instrumentChain.getInstrument())
+    {
+        plugin->getStateInformation(state);
+        sandboxed = dynamic_cast<SandboxedPlugin*>(plugin) != nullptr;
+        description = instrumentChain.getInstrumentDescription();
+    }
+    else
+        error = "The built-in piano only plays live; load an instrument plugin to bounce";
+
+    if (error.isNotEmpty())
+    {
+        DebugLogWindow::addLog("AudioEngine: Cannot bounce on " + track.getName() + ": " + error);
+        if (onDone != nullptr)
+            onDone(nullptr, error);
+        return;
+    }
+
+    auto name = juce::File::createLegalFileName(track.getName() + " " + region->clip->getName() + " Bounce");
+    auto file = getAudioFolder().getNonexistentChildFile(name, ".wav", false);
+    int blockSize = getBlockSize() > 0 ? getBlockSize() : 512;
+
+    DebugLogWindow::addLog("AudioEngine: Bouncing " + region->clip->getName() + " on " + track.getName() + "...");
+
+    trackFreezer->bounce(track, regionId, description, state, sandboxed, blockSize, getMainBusNumOutputChannels(), file,
+        [this, trackUid, regionId, onDone](const juce::File& rendered, const juce::String& renderError)
+        {
+            juce::String bounceError = renderError;
+            std::unique_ptr<BounceInPlaceCommand> bounce;
+
+            if (rendered != juce::File())
+            {
+                if (auto* source = findTrack(trackUid))
+                    bounce = createBounce(*source, regionId, rendered, bounceError);
+                else
+                    bounceError = "Track was removed";
+
+                if (bounce == nullptr)
+                    rendered.deleteFile();
+            }
+
+            if (bounce == nullptr)
+                DebugLogWindow::addLog("AudioEngine: Bounce failed: " + bounceError);
+            else
+                DebugLogWindow::addLog("AudioEngine: Bounced " + rendered.getFileName());
+
+            if (bounce != nullptr)
+                bounceError.clear();
+
+            if (onDone != nullptr)
+                onDone(std::move(bounce), bounceError);
+        });
+}
+
+bool AudioEngine::isRegionBouncing(const Track& track, int regionId) const
+{
+    return trackFreezer->isBouncing(track.getUid(), regionId);
+}
+
+std::unique_ptr<BounceInPlaceCommand> AudioEngine::createBounce(Track& source, int regionId, const juce::File& file,
+                                                               juce::String& errorMessage)
+{
+    auto* region = source.findClipRegion(regionId);
+    if (region == nullptr)
+    {
+        errorMessage = "Region was removed";
+        return nullptr;
+    }
+
+    auto audioClip = createAudioClip(file, errorMessage);
+    if (audioClip == nullptr)
+        return nullptr;
+
+    // Every bounce of a track collects on one audio track, set up to sound like the source
+    auto bounceName = source.getName() + " Bounce";
+    Track* bounceTrack = nullptr;
+    for (const auto& track : project.getTracks())
+    {
+        if (track->isAudio() && track->getName() == bounceName)
+        {
+            bounceTrack = track.get();
+            break;
+        }
+    }
+
+    std::unique_ptr<Track> newTrack;
+    if (bounceTrack == nullptr)
+    {
+        newTrack = std::make_unique<Track>(bounceName, Track::Type::Audio);
+        newTrack->setColour(source.getColour());
+        newTrack->setVolume(source.getVolume());
+        newTrack->setPan(source.getPan());
+        newTrack->setOutputUid(source.getOutputUid());
+        bounceTrack = newTrack.get();
+    }
+
+    // The chain is ready before the command puts the track in the project
+    getOrCreateTrackChain(bounceTrack->getUid());
+
+    auto lengthTicks = juce::jmax((int64_t)1, PPQ::secondsToTick(audioClip->getLengthSeconds(), transport.getTempo()));
+    return std::make_unique<BounceInPlaceCommand>(project, source, regionId, std::move(newTrack), bounceTrack->getUid(),
+                                                  std::move(audioClip), region->startTick, lengthTicks);
+}
+
+void AudioEngine::setAnticipativeRendering(bool shouldRenderAhead)
+{
+    anticipativeRenderer->setEnabled(shouldRenderAhead);
+}
+
+bool AudioEngine::importAudioFile(const juce::File& file, Track& track, int64_t startTick, juce::String& errorMessage)
+{
+    if (!track.isAudio())
+    {
+        errorMessage = "Audio files can only be placed on audio tracks";
+        return false;
+    }
+
+    auto newClip = createAudioClip(file, errorMessage);
+    if (newClip == nullptr)
+        return false;
+
+    getOrCreateTrackChain(track.getUid());
+
+    auto seconds = newClip->getLengthSeconds();
+    auto clipRate = newClip->getSampleRate();
+
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* audioClip = project.addAudioClip(std::move(newClip));
+
+        auto lengthTicks = juce::jmax((int64_t)1, PPQ::secondsToTick(seconds, transport.getTempo()));
+        track.addClipRegion(ClipRegion(audioClip, startTick, lengthTicks));
+        project.setModified(true);
+    }
+
+    DebugLogWindow::addLog("AudioEngine: Placed " + file.getFileName() + " on " + track.getName() + " ("
+                         + juce::String(seconds, 1) + " s, " + juce::String(clipRate, 0) + " Hz)");
+    return true;
+}
+
+std::unique_ptr<AudioClip> AudioEngine::createAudioClip(const juce::File& file, juce::String& errorMessage) const
+{
+    // Just the header: the samples are streamed when the region plays
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+    {
+        errorMessage = "Not a readable audio file: " + file.getFileName();
+        return nullptr;
+    }
+
+    auto audioClip = std::make_unique<AudioClip>(file, file.getFileNameWithoutExtension());
+    audioClip->setFormat(reader->sampleRate, (int)reader->numChannels, reader->lengthInSamples);
+    return audioClip;
+}
+
+int AudioEngine::getNumAudioClipUnderruns() const
+{
+    return (int)audioClipStreamer->getUnderrunCount();
+}
+
+bool AudioEngine::startAudioRecording(Track& track, juce::String& errorMessage)
+{
+    if (!track.isAudio())
+    {
+        errorMessage = "Audio can only be recorded onto audio tracks";
+        return false;
+    }
+
+    if (audioInputRecorder->isRecording())
+    {
+        errorMessage = "Already recording audio";
+        return false;
+    }
+
+    if (getMainBusNumInputChannels() == 0)
+    {
+        errorMessage = "The audio device has no inputs enabled";
+        return false;
+    }
+
+    auto name = juce::File::createLegalFileName(track.getName() + " " + juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S"));
+    auto file = getAudioFolder().getNonexistentChildFile(name, ".wav", false);
+
+    if (!audioInputRecorder->start(file, errorMessage))
+        return false;
+
+    getOrCreateTrackChain(track.getUid());
+    audioRecordingTrackUid = track.getUid();
+    audioRecordingFile = file;
+
+    DebugLogWindow::addLog("AudioEngine: Recording " + track.getName() + " to " + file.getFullPathName());
+    return true;
+}
+
+AudioClip* AudioEngine::stopAudioRecording(juce::String& errorMessage)
+{
+    if (!audioInputRecorder->isRecording())
+    {
+        errorMessage = "Not recording audio";
+        return nullptr;
+    }
+
+    auto samplesWritten = audioInputRecorder->stop();
+    auto startTick = audioInputRecorder->getStartTick();
+    auto dropped = audioInputRecorder->getDroppedSamples();
+    auto* track = project.findTrackByUid(audioRecordingTrackUid);
+    audioRecordingTrackUid = 0;
+
+    if (dropped > 0)
+        DebugLogWindow::addLog("AudioEngine: The take lost " + juce::String(dropped) + " input samples (disk too slow)");
+
+    if (samplesWritten == 0 || startTick < 0 || track == nullptr)
+    {
+        audioRecordingFile.deleteFile();
+        errorMessage = track == nullptr ? "The track was removed while recording" : "Nothing was recorded";
+        return nullptr;
+    }
+
+    if (!importAudioFile(audioRecordingFile, *track, startTick, errorMessage))
+        return nullptr;
+
+    return track->getClipRegions().back().audioClip;
+}
+
+bool AudioEngine::isRecordingAudio() const
+{
+    return audioInputRecorder->isRecording();
+}
+
+juce::int64 AudioEngine::getNumDroppedInputSamples() const
+{
+    return audioInputRecorder->getDroppedSamples();
+}
+
+juce::File AudioEngine::getAudioFolder() const
+{
+    auto projectFile = project.getProjectFile();
+    return projectFile != juce::File()
+        ? projectFile.getSiblingFile(projectFile.getFileNameWithoutExtension() + " Audio")
+        : juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile("PianoDAW").getChildFile("Recordings");
+}
+
+bool AudioEngine::isAnticipativeRendering() const
+{
+    return anticipativeRenderer->isEnabled();
+}
+
+CallbackProfiler::Snapshot AudioEngine::getPerformance() const
+{
+    auto snapshot = profiler.getSnapshot();
+    if (deviceXRunCounter != nullptr)
+        snapshot.deviceXRuns = deviceXRunCounter();
+    return snapshot;
+}
+
+void AudioEngine::resetPerformance()
+{
+    profiler.reset();
+    aheadUnderruns.store(0);
+    audioClipStreamer->resetUnderrunCount();
+    synth.resetStats();
+}
+
+juce::String AudioEngine::createPerformanceReport() const
+{
+    auto perf = getPerformance();
+    auto percent = [](float load) { return juce::String(load * 100.0f, 1) + "%"; };
+
+    juce::String report;
+    report << "PianoDAW performance report - " << juce::Time::getCurrentTime().toString(true, true) << "\n"
+           << "Project: " << project.getName() << "\n\n";
+
+    report << "Sample rate:        " << juce::String(perf.sampleRate, 0) << " Hz\n"
+           << "Block size:         " << perf.blockSize << " samples";
+    if (perf.sampleRate > 0.0)
+        report << " (" << juce::String(1000.0 * perf.blockSize / perf.sampleRate, 2) << " ms deadline)";
+    report << "\n"
+           << "Precision:          " << (getProcessingPrecision() == doublePrecision ? "64-bit (main instrument and mix; tracks 32-bit)"
+                                                                                    : "32-bit") << "\n"
+           << "Render ahead:       " << (isAnticipativeRendering() ? "on" : "off")
+           << " (" << getNumAheadUnderruns() << " underruns)\n"
+           << "Audio streams:      " << audioClipStreamer->getNumActiveStreams() << " active ("
+           << getNumAudioClipUnderruns() << " underruns)\n"
+           << "Audio input:        " << (isRecordingAudio() ? "recording" : "idle")
+           << " (" << juce::String(getNumDroppedInputSamples()) << " samples dropped)\n"
+           << "Compensation:       " << getCompensationLatencySamples() << " samples\n\n";
+
+    report << "Callbacks:          " << (int)perf.numBlocks << "\n"
+           << "Over deadline:      " << (int)perf.overruns << "\n"
+           << "Late callbacks:     " << (int)perf.lateCallbacks << "\n"
+           << "Device xruns:       " << (perf.deviceXRuns >= 0 ? juce::String(perf.deviceXRuns) : juce::String("not reported")) << "\n"
+           << "Load average/peak:  " << percent(perf.averageLoad) << " / " << percent(perf.peakLoad) << "\n"
+           << "Load p50/p99/p99.9: " << percent(perf.getLoadPercentile(0.5)) << " / "
+           << percent(perf.getLoadPercentile(0.99)) << " / " << percent(perf.getLoadPercentile(0.999)) << "\n\n";
+
+    report << "Average load per stage:\n";
+    for (int s = 0; s < CallbackProfiler::numStages; ++s)
+        report << "  " << juce::String(CallbackProfiler::getStageName(s)).paddedRight(' ', 12)
+               << percent(perf.stageLoad[(size_t)s]) << "\n";
+
+    // Buckets as a bar chart, scaled to the fullest one
+    juce::uint32 fullest = 1;
+    for (auto count : perf.histogram)
+        fullest = juce::jmax(fullest, count);
+
+    report << "\nCallback duration (share of the deadline):\n";
+    for (int i = 0; i < CallbackProfiler::numBuckets; ++i)
+    {
+        auto count = perf.histogram[(size_t)i];
+        if (count == 0)
+            continue;
+
+        auto from = juce::roundToInt((float)i * CallbackProfiler::bucketWidth * 100.0f);
+        juce::String label = i == CallbackProfiler::numBuckets - 1 ? ">" + juce::String(from) + "%"
+                                                                  : juce::String(from) + "-" + juce::String(from + 5) + "%";
+        report << "  " << label.paddedLeft(' ', 9) << " " << juce::String((int)count).paddedLeft(' ', 8) << " "
+               << juce::String::repeatedString("#", juce::jmax(1, (int)(40u * count / fullest))) << "\n";
+    }
+
+    report << "\nMain instrument: ";
+    if (auto* instrument = mainChain.getInstrument())
+        report << instrument->getName() << " (" << mainChain.getLatencySamples() << " samples latency)\n";
+    else
+        report << (samplePool != nullptr ? "sampled piano" : "built-in synth") << "\n";
+
+    auto voices = getVoiceStats();
+    report << "Piano voices: " << voices.active << " active, " << voices.peak << " peak, "
+           << voices.ceiling << " ceiling of " << voices.allocated << " allocated ("
+           << juce::String(voices.steals) << " stolen, " << juce::String(voices.cutSteals) << " cut short)\n";
+
+    if (auto* effect = getMasterEffect())
+        report << "Master effect: " << effect->getName() << "\n";
+
+    const juce::ScopedLock sl(project.getLock());
+    report << "Tracks: " << project.getNumTracks() << "\n";
+    for (auto& track : project.getTracks())
+    {
+        report << "  " << track->getName();
+        if (track->isBus())
+        {
+            report << " [bus]";
+            if (auto* effect = busGraph->getEffect(track->getUid()))
+                report << " effect: " << effect->getName();
+        }
+        else if (auto* chain = findTrackChain(track->getUid()))
+        {
+            if (chain->isFrozen())
+                report << " [frozen]";
+            else if (track->isAudio())
+                report << " [audio, " << (int)track->getClipRegions().size() << " regions]";
+            else if (auto* instrument = chain->getInstrument())
+                report << " instrument: " << instrument->getName() << " (" << chain->getLatencySamples() << " samples latency)";
+        }
+        report << "\n";
+    }
+
+    if (RealtimeSafety::isAvailable())
+        report << "\nReal-time safety:\n" << RealtimeSafety::getReport() << "\n";
+
+    return report;
+}
+
+void AudioEngine::showEditor()
+{
+    // This will be implemented using a separate window class
+    // For now, we'll trigger it from VstBrowserPanel or a dedicated button
+}
+
+void AudioEngine::savePluginList()
+{
+    pluginScanner->saveList();
+}
+
+void AudioEngine::loadPluginList()
+{
+    pluginScanner->loadList();
 }
 
 void AudioEngine::handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message)
@@ -4,7 +4,17 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_devices/juce_audio_devices.h>
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "CallbackProfiler.h"
+#include "GraphSwapper.h"
+#include "LevelMeter.h"
+#include "Metronome.h"
+#include "Mixer.h"
+#include "TrackChain.h"
+#include "VoicePool.h"
+#include "../timeline/SamplePlayhead.h"
+#include <atomic>
 #include <cstdint>
+#include <map>
 
 namespace pianodaw {
 
@@ -12,6 +22,18 @@ class Clip;
 class Project;
 class Transport;
 class MidiRecorder;
+class SamplePool;
+class PluginScanner;
+class PluginLoader;
+class AnticipativeRenderer;
+class AudioClip;
+class AudioClipStreamer;
+class BounceInPlaceCommand;
+class AudioInputRecorder;
+class TrackFreezer;
+class PianoResonance;
+class BusGraph;
+class Track;
 
 /**
  * AudioEngine - Main audio processing unit
@@ -20,7 +42,26 @@ class MidiRecorder;
  * Supports:
  * - Multi-track playback from Project
  * - MIDI recording via MidiRecorder
- * - VST3 instrument hosting per track (future)
+ * - Built-in sine or disk-streaming sampled piano (SamplePool), with pedals and sympathetic resonance
+ * - VST3 instrument hosting, main or per track, loaded in the background
+ * - Plugin delay compensation with sample-accurate sequencing
+ * - Anticipative rendering of tracks that aren't record-armed
+ * - Track freeze: tracks render to cached audio and unload their instrument
+ * - Mixer: per-track volume, pan, mute and solo, summed into the master bus
+ * - Volume/pan automation lanes, applied as per-sample gain ramps
+ * - Plugin parameter lanes, delivered at sample offsets (ParameterAutomation)
+ * - Group/folder buses with effect inserts, summed as a DAG across threads
+ * - A master effect insert; built-in zero-latency convolution reverb (ConvolutionReverb)
+ * - Per-track MIDI channels; tracks can share another track's multi-timbral instrument
+ * - Audio tracks: regions stream from disk with per-region read-ahead (AudioClipStreamer)
+ * - Audio recording: input is queued lock-free and written by a background thread (AudioInputRecorder)
+ * - Single or double precision (set by the host before prepareToPlay); 64-bit covers
+ *   the main instrument, master effect, delay compensation, strips and bus/master
+ *   sums only. Track instruments, bus effects, freezes, bounces and audio regions
+ *   render in float and are summed into the 64-bit mix.
+ * - Sample-accurate metronome with accented bar starts and a count-in before recording
+ * - Peak/RMS/true-peak meters per track, bus and master, read lock-free by the UI
+ * - Per-stage callback timing, load histogram and xrun counts
  */
 class AudioEngine : public juce::AudioProcessor
 {
@@ -35,6 +76,7 @@ public:
     
     void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
     void processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     const juce::String getName() const override;
     bool acceptsMidi() const override;
@@ -56,6 +98,7 @@ public:
 
     // Recording
     MidiRecorder& getMidiRecorder() { return *midiRecorder; }
+    Metronome& getMetronome() { return metronome; }
     void setRecordArmedTrack(int trackIndex) { recordArmedTrackIndex = trackIndex; }
     int getRecordArmedTrack() const { return recordArmedTrackIndex; }
 
@@ -68,9 +111,21 @@ public:
 private:
     Project& project;
     Transport& transport;
-    juce::Synthesiser synth;
     
-    int64_t lastProcessedTick = -1;
+    // Declared before synth: sampled voices stop their streams on destruction
+    std::unique_ptr<SamplePool> samplePool;
+    VoicePool synth;
+    std::unique_ptr<PianoResonance> pianoResonance;   // Strings of the built-in piano, after the synth
+    
+    // Sequencer position, advanced by the sample clock
+    SamplePlayhead playhead;
+    bool sequencing = false;
+
+    // Solo/mute mask for the block (audio thread)
+    Mixer mixer;
+
+    // Longest instrument path; every other path is delayed to match it
+    std::atomic<int> compensationLatency { 0 };
     
     // Recording
     std::unique_ptr<MidiRecorder> midiRecorder;
@@ -79,33 +134,294 @@ private:
     // Hardware MIDI input buffer
     juce::MidiBuffer hardwareMidiBuffer;
     juce::CriticalSection hardwareMidiLock;
+
+    // Audio thread: this block's live input, kept for the recorder
+    juce::MidiBuffer incomingMidi;
     
+    /** One block of either precision: sequencing is shared, the master bus runs in SampleType */
+    template <typename SampleType>
+    void renderBlock(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
+
     void setupVoices();
-    void processMidiSequencer(juce::MidiBuffer& midiMessages);
+    int advancePlayhead(int numSamples, int startOffset, int lookaheadSamples, BlockTickWindow* windows,
+                        juce::MidiBuffer& midiMessages);
+    void processMidiSequencer(const BlockTickWindow* windows, int numWindows, juce::MidiBuffer& midiMessages);
+    void cueAudioRegions(const BlockTickWindow* windows, int numWindows);
+    void sequenceAhead(int numSamples);
+    void updateMixer(int numSamples);
+    void automateMixer(bool playing, int numSamples);
+    int computePathLatency() const;
+    int getRecordArmedTrackUid();
     void processMidiRecording(const juce::MidiBuffer& midiMessages, int64_t currentTick);
     
     // VST Hosting
     juce::AudioPluginFormatManager pluginFormatManager;
-    std::unique_ptr<juce::AudioProcessorGraph> mainGraph;
     juce::KnownPluginList knownPluginList;
-    
-    juce::AudioProcessorGraph::Node::Ptr audioInNode;
-    juce::AudioProcessorGraph::Node::Ptr audioOutNode;
-    juce::AudioProcessorGraph::Node::Ptr midiInNode;
-    juce::AudioProcessorGraph::Node::Ptr instrumentNode;
+    std::unique_ptr<PluginScanner> pluginScanner;
+    std::unique_ptr<PluginLoader> pluginLoader;
+
+    // Declared before the chains: their frozen readers stream on its thread
+    std::unique_ptr<TrackFreezer> trackFreezer;
+
+    // Reads audio track regions ahead of the callback
+    std::unique_ptr<AudioClipStreamer> audioClipStreamer;
+
+    // Writes the input of an audio take behind the callback
+    std::unique_ptr<AudioInputRecorder> audioInputRecorder;
+    int audioRecordingTrackUid = 0;
+    juce::File audioRecordingFile;
+
+    // Instruments are loaded off the audio thread and swapped in at a block boundary
+    TrackChain mainChain { TrackChain::mainUid };
+    std::vector<std::unique_ptr<TrackChain>> trackChains;  // Guarded by project lock; mutated on the message thread
+
+    // Chains sum into its bus inputs; its helper threads stop before the chains go
+    std::unique_ptr<BusGraph> busGraph;
+    std::map<int, int> busEffectLoads;   // Bus track uid -> latest effect load, so superseded loads are dropped
+
+    // Insert on the summed master, before the meter (passes through while empty)
+    GraphSwapper masterEffect;
+    juce::AudioProcessorGraph::Node::Ptr masterEffectNode;   // Message thread
+    juce::PluginDescription masterEffectDescription;         // Message thread
+    int masterEffectLoads = 0;                                // Message thread: superseded loads are dropped
+    juce::MidiBuffer masterEffectMidi;                        // Always empty: effects get no notes
+
+    LevelMeter masterMeter;
+    Metronome metronome;
+    CallbackProfiler profiler;
+    std::function<int()> deviceXRunCounter;
+
+    // Declared after the chains it renders, so its workers stop first
+    std::unique_ptr<AnticipativeRenderer> anticipativeRenderer;
+    int aheadEpoch = 0;               // Audio thread: bumped whenever rendered-ahead audio goes stale
+    static constexpr int maxAheadStepsPerBlock = 4;   // Blocks sequenced ahead per chain and callback
+    bool renderingAhead = false;      // Audio thread
+    juce::int64 samplePosition = 0;   // Audio thread: samples rendered since start-up
+    std::atomic<int> aheadUnderruns { 0 };
     juce::MidiMessage currentNoteOn;
     juce::MidiBuffer uiMidiBuffer;
     juce::CriticalSection uiMidiLock;
-    juce::PluginDescription currentPluginDescription;
 
-    void updateGraph();
+    Track* findTrack(int trackUid) const;
+    TrackChain* findTrackChain(int trackUid) const;
+
+    /** Chain whose instrument plays the track's MIDI this block, nullptr for the main instrument */
+    TrackChain* findMidiDestination(const Track& track) const;
+
+    /** Channels sequenced into a destination (nullptr = main instrument), bit 0 = channel 1 */
+    juce::uint16 getMidiChannelMask(const TrackChain* destination) const;
+
+    bool isPlayedByOtherTracks(int trackUid) const;
+    TrackChain& getOrCreateTrackChain(int trackUid);
+    void pruneTrackChains();
+    void prepareTrackChain(TrackChain& chain);
+
+    void loadPluginIntoChain(int trackUid, const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                             bool sandboxed, std::function<void(juce::AudioProcessor*, const juce::String&)> onLoaded);
+
+    void loadEffectIntoBus(int busUid, const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                           bool sandboxed, std::function<void(juce::AudioProcessor*, const juce::String&)> onLoaded);
+
+    void loadEffectIntoMaster(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                              bool sandboxed, std::function<void(juce::AudioProcessor*, const juce::String&)> onLoaded);
+
+    void thawTrack(int trackUid, bool reloadInstrument, const juce::String& reason);
+
+    /** The command putting a bounced region's file on the source's bounce track and muting the region */
+    std::unique_ptr<BounceInPlaceCommand> createBounce(Track& source, int regionId, const juce::File& file,
+                                                       juce::String& errorMessage);
+
+    /** Read an audio file's header into a clip that isn't in the project yet */
+    std::unique_ptr<AudioClip> createAudioClip(const juce::File& file, juce::String& errorMessage) const;
+
+    /** Where recordings and bounces are written: next to the project, or the app's data folder until it is saved */
+    juce::File getAudioFolder() const;
+
+    bool sandboxNewPlugins = false;
 
 public:
     void scanPlugins();
     void showEditor();
     const juce::KnownPluginList& getKnownPluginList() const { return knownPluginList; }
-    bool loadPlugin(const juce::PluginDescription& description);
-    juce::AudioProcessor* getCurrentPlugin() const;
+    PluginScanner& getPluginScanner() { return *pluginScanner; }
+
+    using PluginLoadedCallback = std::function<void(juce::AudioProcessor* instrument, const juce::String& error)>;
+
+    /**
+     * Load an instrument in the background and hot-swap it in when ready
+     * @param track Track to host it on, or nullptr for the main instrument
+     * @param onLoaded Called on the message thread (instrument is nullptr on failure)
+     */
+    void loadPlugin(const juce::PluginDescription& description, Track* track = nullptr, PluginLoadedCallback onLoaded = nullptr);
+    void unloadPlugin(Track* track = nullptr);
+
+    /**
+     * Host an instrument the caller created itself (built-in instruments, tests)
+     * It is wrapped and prepared here on the message thread, then swapped in
+     * like a loaded plugin, superseding any load still in flight.
+     * @param track Track to host it on, or nullptr for the main instrument
+     */
+    void setInstrument(std::unique_ptr<juce::AudioPluginInstance> instrument, Track* track = nullptr);
+    juce::AudioProcessor* getCurrentPlugin(Track* track = nullptr) const;
+    int getNumPluginsLoading() const;
+
+    /**
+     * Load an effect insert onto a group/folder bus in the background
+     * Everything routed to the bus goes through it once, summed.
+     * @param onLoaded Called on the message thread (effect is nullptr on failure)
+     */
+    void loadBusEffect(const juce::PluginDescription& description, Track& bus, PluginLoadedCallback onLoaded = nullptr);
+    void unloadBusEffect(Track& bus);
+    juce::AudioProcessor* getBusEffect(const Track& bus) const;
+
+    /**
+     * Load an effect insert onto the master bus in the background
+     * It processes the sum of every track and bus, before the master meter.
+     * @param onLoaded Called on the message thread (effect is nullptr on failure)
+     */
+    void loadMasterEffect(const juce::PluginDescription& description, PluginLoadedCallback onLoaded = nullptr);
+    void unloadMasterEffect();
+    juce::AudioProcessor* getMasterEffect() const;
+
+    /**
+     * Insert the built-in convolution reverb, playing this impulse response
+     * The file is read, resampled and partitioned in the background, and an
+     * existing reverb in the slot keeps its wet and dry levels.
+     * @param bus Group/folder bus to insert it on, or nullptr for the master
+     */
+    void loadConvolutionReverb(const juce::File& impulseResponse, Track* bus = nullptr, PluginLoadedCallback onLoaded = nullptr);
+
+    /**
+     * Post-fader levels since the last read (message thread, a single reader per meter)
+     * @return false for tracks without a chain or bus of their own, or before the first block
+     */
+    bool readTrackMeter(const Track& track, LevelMeter::Reading& reading);
+    bool readMasterMeter(LevelMeter::Reading& reading);
+
+    /** Callback load and xruns since the last reset (message thread) */
+    CallbackProfiler::Snapshot getPerformance() const;
+    void resetPerformance();
+
+    /** Where the device's own xrun count comes from (returns -1 when unknown) */
+    void setDeviceXRunCounter(std::function<int()> counter) { deviceXRunCounter = std::move(counter); }
+
+    /** Plain-text report of the load statistics and the session's setup, for attaching to bug reports */
+    juce::String createPerformanceReport() const;
+
+    /** Delay added by plugin delay compensation (the longest instrument latency) */
+    int getCompensationLatencySamples() const { return compensationLatency.load(); }
+
+    /**
+     * Render track instruments ahead of the callback on worker threads
+     * The record-armed track (and the main instrument, which plays live input)
+     * still renders in the callback.
+     */
+    void setAnticipativeRendering(bool shouldRenderAhead);
+    bool isAnticipativeRendering() const;
+
+    /** Blocks where a worker had not finished a track in time */
+    int getNumAheadUnderruns() const { return aheadUnderruns.load(); }
+
+    using FreezeCallback = std::function<void(bool frozen, const juce::String& error)>;
+
+    /**
+     * Render a track's instrument to a cached audio file, then play that and unload the instrument
+     * The track keeps playing live until the file is ready. Editing its clips
+     * (or the tempo) later unfreezes it automatically.
+     * @param onDone Called on the message thread
+     */
+    void freezeTrack(Track& track, FreezeCallback onDone = nullptr);
+
+    /** Reload the instrument (with its state from freeze time) and drop the frozen audio */
+    void unfreezeTrack(Track& track);
+
+    bool isTrackFrozen(const Track& track) const;
+    bool isTrackFreezing(const Track& track) const;
+
+    using BounceCallback = std::function<void(std::unique_ptr<BounceInPlaceCommand> bounce, const juce::String& error)>;
+
+    /**
+     * Bounce in place: render one MIDI region to audio and play that instead
+     * A fresh instance of the instrument the track plays through renders the
+     * region plus its release tail on a worker thread; playback goes on
+     * meanwhile. The result is an undoable command that places the audio on
+     * the "<track> Bounce" audio track (created with the source's colour,
+     * level, pan and output) at the region's start and mutes the MIDI region
+     * rather than deleting it; the caller executes it on its UndoStack.
+     * @param onDone Called on the message thread; bounce is nullptr on failure
+     */
+    void bounceRegion(Track& track, int regionId, BounceCallback onDone = nullptr);
+    bool isRegionBouncing(const Track& track, int regionId) const;
+
+    /**
+     * Place an audio file on an audio track, streamed from disk when played
+     * Only the file's header is read here. The region is as long as the file
+     * at the current tempo.
+     */
+    bool importAudioFile(const juce::File& file, Track& track, int64_t startTick, juce::String& errorMessage);
+
+    /** Blocks where an audio region's stream ran dry before its read-ahead caught up */
+    int getNumAudioClipUnderruns() const;
+
+    /**
+     * Record the audio input onto an audio track while the transport plays
+     * The take goes to a WAV file next to the project (the app's data folder
+     * until it is saved); nothing is written to disk on the audio thread.
+     */
+    bool startAudioRecording(Track& track, juce::String& errorMessage);
+
+    /**
+     * Finish the take and place it on its track where recording started
+     * @return The take's clip, or nullptr if nothing was recorded
+     */
+    AudioClip* stopAudioRecording(juce::String& errorMessage);
+
+    bool isRecordingAudio() const;
+
+    /** Input samples the take lost because the disk fell behind by more than the recorder's FIFO */
+    juce::int64 getNumDroppedInputSamples() const;
+
+    /** Samples between plugin parameter updates on automation ramps (lower is smoother, but splits blocks more) */
+    void setAutomationGranularity(int samples) { ParameterAutomation::setGranularity(samples); }
+    int getAutomationGranularity() const { return ParameterAutomation::getGranularity(); }
+
+    /** Host newly loaded plugins in a crash-isolated child process (SandboxedPlugin) */
+    void setSandboxNewPlugins(bool shouldSandbox) { sandboxNewPlugins = shouldSandbox; }
+    bool isSandboxingNewPlugins() const { return sandboxNewPlugins; }
+
+    /** Instruments and their plugin state (message thread) */
+    std::unique_ptr<juce::XmlElement> createStateXml() const;
+
+    /** Restore instruments without blocking: every plugin loads in parallel in the background */
+    void restoreStateXml(const juce::XmlElement& xml);
+
+    /** Drop instruments, effects and frozen renders left from the previous project (restoreStateXml starts with this) */
+    void resetForNewProject();
+
+    using SampledPianoCallback = std::function<void(bool loaded, const juce::String& error)>;
+
+    /**
+     * Replace the built-in sine with a disk-streaming sampled piano
+     * The folder is mapped and the attack heads are read on a worker thread;
+     * the current piano keeps playing until the new one is swapped in.
+     * @param folder Folder of "<note>_v<layer>.wav" zones
+     * @param ramBudgetBytes Upper bound for attack heads + stream buffers
+     * @param onDone Called on the message thread
+     */
+    void loadSampledPiano(const juce::File& folder, size_t ramBudgetBytes, SampledPianoCallback onDone = nullptr);
+    bool isLoadingSampledPiano() const { return sampledPianoLoads > 0; }
+    SamplePool* getSamplePool() const { return samplePool.get(); }
+
+    /** Level of the built-in piano's sympathetic string resonance (0 turns it off) */
+    void setPianoResonance(float level);
+    float getPianoResonance() const;
+
+    /** Most voices of the built-in piano sounding at once; a note beyond it steals (see VoicePool) */
+    void setMaxVoices(int numVoices) { synth.setMaxVoices(numVoices); }
+    int getMaxVoices() const { return synth.getMaxVoices(); }
+
+    /** Built-in piano voice counts and steals (any thread); reset with resetPerformance() */
+    VoicePool::Stats getVoiceStats() const { return synth.getStats(); }
 
     void handleNoteOn(int midiNoteNumber, float velocity);
     void handleNoteOff(int midiNoteNumber);
@@ -114,6 +430,14 @@ public:
     void loadPluginList();
 
 private:
+    /** Put a loaded sample pool behind the built-in piano's voices (message thread) */
+    void installSamplePool(std::unique_ptr<SamplePool> newPool);
+
+    // Declared last, so a sample folder still loading is waited for before the rest is torn down
+    juce::ThreadPool samplePoolLoader { 1 };
+    int sampledPianoLoads = 0;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(AudioEngine)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEngine)
 };
 
@@ -0,0 +1,157 @@
+#include "AudioInputRecorder.h"
+
+namespace pianodaw {
+
+AudioInputRecorder::AudioInputRecorder()
+    : juce::Thread("Audio Input Writer")
+{
+}
+
+AudioInputRecorder::~AudioInputRecorder()
+{
+    stop();
+}
+
+void AudioInputRecorder::prepare(double newSampleRate, int newNumChannels)
+{
+    if (isRecording())
+        return;
+
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    numChannels = juce::jmax(1, newNumChannels);
+
+    int capacity = (int)(fifoSeconds * sampleRate);
+    fifo.setTotalSize(capacity);
+    ring.setSize(numChannels, capacity);
+}
+
+bool AudioInputRecorder::start(const juce::File& file, juce::String& errorMessage)
+{
+    stop();
+
+    if (!file.getParentDirectory().createDirectory() || (file.exists() && !file.deleteFile()))
+    {
+        errorMessage = "Cannot create " + file.getFullPathName();
+        return false;
+    }
+
+    auto stream = file.createOutputStream();
+    if (stream == nullptr)
+    {
+        errorMessage = "Cannot write " + file.getFullPathName();
+        return false;
+    }
+
+    juce::WavAudioFormat wav;
+    writer.reset(wav.createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels, bitsPerSample, {}, 0));
+    if (writer == nullptr)
+    {
+        errorMessage = "Cannot create a " + juce::String(numChannels) + " channel WAV writer at "
+                     + juce::String(sampleRate, 0) + " Hz";
+        return false;
+    }
+    stream.release();   // Owned by the writer now
+
+    fifo.reset();
+    samplesWritten = 0;
+    startTick.store(-1);
+    droppedSamples.store(0);
+
+    startThread(juce::Thread::Priority::high);
+    armed.store(true);
+    return true;
+}
+
+juce::int64 AudioInputRecorder::stop()
+{
+    if (writer == nullptr)
+        return 0;
+
+    // Paired with push(): once armed is clear and no push is in flight, nothing more enters the FIFO
+    armed.store(false);
+    while (pushing.load())
+        juce::Thread::yield();
+
+    // The writer thread drains the rest before it exits; closing the writer finishes the file's header
+    stopThread(10000);
+    writer.reset();
+
+    return samplesWritten;
+}
+
+void AudioInputRecorder::push(const juce::AudioBuffer<float>& input, int startSample, int numSamples, juce::int64 tick)
+{
+    pushSamples(input, startSample, numSamples, tick);
+}
+
+void AudioInputRecorder::push(const juce::AudioBuffer<double>& input, int startSample, int numSamples, juce::int64 tick)
+{
+    pushSamples(input, startSample, numSamples, tick);
+}
+
+template <typename SampleType>
+void AudioInputRecorder::pushSamples(const juce::AudioBuffer<SampleType>& input, int startSample, int numSamples, juce::int64 tick)
+{
+    pushing.store(true);
+
+    if (armed.load())
+    {
+        if (startTick.load(std::memory_order_relaxed) < 0)
+            startTick.store(tick, std::memory_order_relaxed);
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            // A mono input is recorded on every channel
+            const auto* source = input.getReadPointer(juce::jmin(ch, input.getNumChannels() - 1), startSample);
+            auto* dest = ring.getWritePointer(ch);
+
+            for (int i = 0; i < size1; ++i)
+                dest[start1 + i] = (float)source[i];
+            for (int i = 0; i < size2; ++i)
+                dest[start2 + i] = (float)source[size1 + i];
+        }
+
+        fifo.finishedWrite(size1 + size2);
+
+        if (size1 + size2 < numSamples)
+            droppedSamples.fetch_add(numSamples - (size1 + size2), std::memory_order_relaxed);
+    }
+
+    pushing.store(false);
+}
+
+void AudioInputRecorder::run()
+{
+    while (!threadShouldExit())
+    {
+        // Polled rather than notified: waking this thread from the callback would mean a system call there
+        if (!drain())
+            wait(10);
+    }
+
+    drain();
+}
+
+bool AudioInputRecorder::drain()
+{
+    int ready = fifo.getNumReady();
+    if (ready == 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(ready, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        writer->writeFromAudioSampleBuffer(ring, start1, size1);
+    if (size2 > 0)
+        writer->writeFromAudioSampleBuffer(ring, start2, size2);
+
+    fifo.finishedRead(size1 + size2);
+    samplesWritten += size1 + size2;
+    return true;
+}
+
+} // namespace pianodaw
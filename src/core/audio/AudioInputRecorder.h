@@ -0,0 +1,83 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <memory>
+
+namespace pianodaw {
+
+/**
+ * AudioInputRecorder - Records the audio input to a WAV file without touching the disk in the callback
+ *
+ * The audio thread copies its input into a FIFO allocated by prepare(); a
+ * writer thread, running only while recording, drains it into the file.
+ * The FIFO holds fifoSeconds of audio, so a disk that stalls for less than
+ * that loses nothing; beyond it the overflow is dropped and counted, never
+ * waited for. Memory stays the same however long the take.
+ *
+ * The audio thread shares only atomics with the message thread: stop()
+ * waits until a push in flight has finished before the writer's final drain.
+ */
+class AudioInputRecorder : private juce::Thread
+{
+public:
+    static constexpr double fifoSeconds = 4.0;
+    static constexpr int bitsPerSample = 24;
+
+    AudioInputRecorder();
+    ~AudioInputRecorder() override;
+
+    /** Audio stopped: size the FIFO for the device (ignored while recording) */
+    void prepare(double sampleRate, int numChannels);
+
+    // === Message thread ===
+
+    /** Create the file and start taking input from the next push() */
+    bool start(const juce::File& file, juce::String& errorMessage);
+
+    /**
+     * Stop taking input, write what is still queued and close the file
+     * @return Samples written
+     */
+    juce::int64 stop();
+
+    bool isRecording() const { return armed.load(); }
+
+    /** Tick the first recorded sample was played at, -1 before it */
+    juce::int64 getStartTick() const { return startTick.load(); }
+
+    /** Input samples lost because the writer fell more than the FIFO behind */
+    juce::int64 getDroppedSamples() const { return droppedSamples.load(); }
+
+    // === Audio thread ===
+
+    /** Queue numSamples of input's channels from startSample, the first of them played at tick */
+    void push(const juce::AudioBuffer<float>& input, int startSample, int numSamples, juce::int64 tick);
+    void push(const juce::AudioBuffer<double>& input, int startSample, int numSamples, juce::int64 tick);
+
+private:
+    void run() override;
+
+    /** Writer thread: write everything queued; returns false when there was nothing */
+    bool drain();
+
+    template <typename SampleType>
+    void pushSamples(const juce::AudioBuffer<SampleType>& input, int startSample, int numSamples, juce::int64 tick);
+
+    double sampleRate = 44100.0;
+    int numChannels = 2;
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> ring;
+    std::unique_ptr<juce::AudioFormatWriter> writer;    // Writer thread while recording, message thread otherwise
+    juce::int64 samplesWritten = 0;
+
+    std::atomic<bool> armed { false };
+    std::atomic<bool> pushing { false };
+    std::atomic<juce::int64> startTick { -1 };
+    std::atomic<juce::int64> droppedSamples { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioInputRecorder)
+};
+
+} // namespace pianodaw
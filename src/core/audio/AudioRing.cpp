@@ -0,0 +1,61 @@
+#include "AudioRing.h"
+
+namespace pianodaw {
+
+void AudioRing::prepare(int numChannels, int capacity)
+{
+    // AbstractFifo keeps one slot free to tell full from empty
+    data.setSize(juce::jmax(1, numChannels), juce::jmax(1, capacity) + 1);
+    data.clear();
+    fifo.setTotalSize(data.getNumSamples());
+}
+
+bool AudioRing::push(const juce::AudioBuffer<float>& source, int numSamples)
+{
+    if (numSamples <= 0 || fifo.getFreeSpace() < numSamples)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < data.getNumChannels(); ++ch)
+    {
+        // Mono sources feed every channel
+        int sourceChannel = juce::jmin(ch, source.getNumChannels() - 1);
+        data.copyFrom(ch, start1, source, sourceChannel, 0, size1);
+        if (size2 > 0)
+            data.copyFrom(ch, start2, source, sourceChannel, size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+    return true;
+}
+
+bool AudioRing::pop(juce::AudioBuffer<float>& dest, int destStart, int numSamples)
+{
+    if (numSamples <= 0 || fifo.getNumReady() < numSamples)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < juce::jmin(dest.getNumChannels(), data.getNumChannels()); ++ch)
+    {
+        dest.copyFrom(ch, destStart, data, ch, start1, size1);
+        if (size2 > 0)
+            dest.copyFrom(ch, destStart + size1, data, ch, start2, size2);
+    }
+
+    fifo.finishedRead(size1 + size2);
+    return true;
+}
+
+int AudioRing::discard(int numSamples)
+{
+    int count = juce::jmin(numSamples, fifo.getNumReady());
+    if (count > 0)
+        fifo.finishedRead(count);
+    return count;
+}
+
+} // namespace pianodaw
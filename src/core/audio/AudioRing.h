@@ -0,0 +1,44 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace pianodaw {
+
+/**
+ * AudioRing - Lock-free single-producer/single-consumer multichannel FIFO
+ *
+ * Sized once in prepare(); push and pop only copy samples, so either side
+ * may be the audio thread. reset() belongs to the consumer and is only
+ * safe while the producer is known to be idle.
+ */
+class AudioRing
+{
+public:
+    AudioRing() = default;
+
+    /** Allocate room for capacity samples per channel (no thread may be using the ring) */
+    void prepare(int numChannels, int capacity);
+
+    /** Drop everything queued (consumer, producer idle) */
+    void reset() { fifo.reset(); }
+
+    int getNumReady() const { return fifo.getNumReady(); }
+    int getFreeSpace() const { return fifo.getFreeSpace(); }
+
+    /** Producer: append numSamples from source, or nothing if they don't fit */
+    bool push(const juce::AudioBuffer<float>& source, int numSamples);
+
+    /** Consumer: move numSamples into dest at destStart, or nothing if fewer are ready */
+    bool pop(juce::AudioBuffer<float>& dest, int destStart, int numSamples);
+
+    /** Consumer: throw away up to numSamples; returns how many were dropped */
+    int discard(int numSamples);
+
+private:
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> data;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioRing)
+};
+
+} // namespace pianodaw
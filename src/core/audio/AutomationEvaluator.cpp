@@ -0,0 +1,69 @@
+#include "AutomationEvaluator.h"
+#include "../model/Automation.h"
+
+namespace pianodaw {
+
+void AutomationEvaluator::renderCurve(const AutomationLane& lane, const BlockTickWindow* windows, int numWindows,
+                                      int64_t holdTick, float* curve, int numSamples)
+{
+    juce::FloatVectorOperations::fill(curve, lane.getValueAt(holdTick), numSamples);
+
+    const auto& points = lane.getPoints();
+    int numPoints = (int)points.size();
+
+    for (int w = 0; w < numWindows; ++w)
+    {
+        const auto& window = windows[w];
+        int count = juce::jmin(window.numSamples, numSamples - window.startSample);
+        if (count <= 0 || numPoints == 0)
+            continue;
+
+        auto* out = curve + window.startSample;
+        double startTick = window.exactStartTick;
+        double ticksPerSample = ((double)window.endTick - startTick) / window.numSamples;
+        int segment = lane.findPoint((int64_t)std::floor(startTick));
+
+        for (int s = 0; s < count;)
+        {
+            // Up to the next breakpoint (or the window end), the value is one straight line
+            int end = count;
+            if (segment + 1 < numPoints && ticksPerSample > 0.0)
+            {
+                auto samplesToNext = std::ceil(((double)points[(size_t)segment + 1].tick - startTick) / ticksPerSample);
+                end = (int)juce::jlimit((double)s, (double)count, samplesToNext);
+
+                if (end == s)
+                {
+                    ++segment;
+                    continue;
+                }
+            }
+
+            double tick = startTick + s * ticksPerSample;
+            float value = lane.getValueAt(tick, segment);
+            float step = 0.0f;
+
+            if (segment >= 0 && segment + 1 < numPoints)
+            {
+                const auto& a = points[(size_t)segment];
+                const auto& b = points[(size_t)segment + 1];
+                step = (float)((b.value - a.value) / (double)(b.tick - a.tick) * ticksPerSample);
+            }
+
+            if (step == 0.0f)
+            {
+                juce::FloatVectorOperations::fill(out + s, value, end - s);
+            }
+            else
+            {
+                for (int i = s; i < end; ++i)
+                    out[i] = value + step * (float)(i - s);
+            }
+
+            s = end;
+            ++segment;
+        }
+    }
+}
+
+} // namespace pianodaw
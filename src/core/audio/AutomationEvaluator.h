@@ -0,0 +1,36 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "../timeline/SamplePlayhead.h"
+
+namespace pianodaw {
+
+class AutomationLane;
+
+/**
+ * AutomationEvaluator - Turns automation lanes into per-sample values for a block
+ *
+ * A block is described by its tick windows, as for sequencing, so
+ * automation follows loops and tempo exactly like the notes do and renders
+ * the same whether the block is played or rendered offline. The segment at
+ * the block start is found with a binary search; from there each
+ * breakpoint-to-breakpoint piece is written as a linear ramp.
+ *
+ * Audio thread, project lock held (lanes are read in place).
+ */
+class AutomationEvaluator
+{
+public:
+    /**
+     * Fill curve[0, numSamples) with the lane's normalised values along the windows
+     * @param holdTick Position whose value fills samples outside every window (stopped, or catching up after a locate)
+     */
+    static void renderCurve(const AutomationLane& lane, const BlockTickWindow* windows, int numWindows,
+                            int64_t holdTick, float* curve, int numSamples);
+
+    /** Pan lanes store 0..1 for -1..1 */
+    static float toPan(float normalised) { return normalised * 2.0f - 1.0f; }
+    static float fromPan(float pan) { return (pan + 1.0f) * 0.5f; }
+};
+
+} // namespace pianodaw
@@ -0,0 +1,363 @@
+#include "BusGraph.h"
+#include "RealtimeSafety.h"
+#include "../model/Track.h"
+
+namespace pianodaw {
+
+namespace
+{
+    int getNumHelperThreads()
+    {
+        // The audio thread works too; leave room for the render workers and the message thread
+        return juce::jlimit(0, 3, juce::SystemStats::getNumCpus() - 3);
+    }
+}
+
+class BusGraph::Helper : public juce::Thread
+{
+public:
+    Helper(BusGraph& owner_, int index)
+        : juce::Thread("Bus graph " + juce::String(index + 1)), owner(owner_)
+    {
+    }
+
+    ~Helper() override
+    {
+        signalThreadShouldExit();
+        wake();
+        stopThread(2000);
+    }
+
+    void wake() { workAvailable.signal(); }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            // Only process() and the destructor wake it: no polling between blocks
+            workAvailable.wait(-1);
+            if (!threadShouldExit())
+                owner.help();
+        }
+    }
+
+private:
+    BusGraph& owner;
+    juce::WaitableEvent workAvailable;
+};
+
+BusGraph::BusGraph()
+{
+    for (int i = 0; i < maxBuses; ++i)
+    {
+        nodes.push_back(std::make_unique<Node>());
+        nodes.back()->effect.setBypassWhenEmpty(true);
+    }
+
+    trackToNode.reserve(Mixer::reservedTracks);
+
+    for (int i = 0; i < getNumHelperThreads(); ++i)
+    {
+        helpers.push_back(std::make_unique<Helper>(*this, i));
+
+        // The audio thread may wait on a helper, so it must not be preempted by ordinary threads
+        if (!helpers.back()->startRealtimeThread(juce::Thread::RealtimeOptions{}))
+            helpers.back()->startThread(juce::Thread::Priority::highest);
+    }
+}
+
+BusGraph::~BusGraph()
+{
+    helpers.clear();
+}
+
+void BusGraph::prepare(double sampleRate, int blockSize, int numChannels)
+{
+    for (auto& node : nodes)
+    {
+        node->input.setSize(juce::jmax(1, numChannels), juce::jmax(1, blockSize));
+        node->output.setSize(juce::jmax(1, numChannels), juce::jmax(1, blockSize));
+        node->midi.ensureSize(256);
+        node->strip.prepare(sampleRate, blockSize);
+        node->meter.prepare(sampleRate, blockSize);
+        node->effect.prepare(sampleRate, blockSize, numChannels);
+    }
+}
+
+BusGraph::Node* BusGraph::findNode(int busUid) const
+{
+    for (auto& node : nodes)
+    {
+        if (node->busUid == busUid)
+            return node.get();
+    }
+    return nullptr;
+}
+
+int BusGraph::claimNode(int busUid)
+{
+    int freeNode = -1;
+
+    for (int i = 0; i < maxBuses; ++i)
+    {
+        if (nodes[(size_t)i]->busUid == busUid)
+            return i;
+        if (freeNode < 0 && nodes[(size_t)i]->busUid == 0)
+            freeNode = i;
+    }
+
+    if (freeNode >= 0)
+        nodes[(size_t)freeNode]->busUid = busUid;
+
+    return freeNode;
+}
+
+bool BusGraph::setEffect(int busUid, std::unique_ptr<juce::AudioProcessorGraph> graph,
+                         juce::AudioProcessorGraph::Node::Ptr effectNode, const juce::PluginDescription& description,
+                         juce::CriticalSection& projectLock)
+{
+    Node* node = nullptr;
+    {
+        const juce::ScopedLock sl(projectLock);
+        if (graph == nullptr && findNode(busUid) == nullptr)
+            return true;  // Nothing to remove
+
+        int index = claimNode(busUid);
+        if (index < 0)
+            return false;
+
+        node = nodes[(size_t)index].get();
+        node->effectLoaded.store(graph != nullptr);
+    }
+
+    // Crossfades from the dry signal on the audio thread
+    node->effect.submit(std::move(graph));
+    node->effectNode = effectNode;
+    node->effectDescription = effectNode != nullptr ? description : juce::PluginDescription();
+    return true;
+}
+
+juce::AudioProcessor* BusGraph::getEffect(int busUid) const
+{
+    auto* node = findNode(busUid);
+    return node != nullptr && node->effectNode != nullptr ? node->effectNode->getProcessor() : nullptr;
+}
+
+const juce::PluginDescription* BusGraph::getEffectDescription(int busUid) const
+{
+    auto* node = findNode(busUid);
+    return node != nullptr && node->effectNode != nullptr ? &node->effectDescription : nullptr;
+}
+
+bool BusGraph::readMeter(int busUid, LevelMeter::Reading& reading) const
+{
+    auto* node = findNode(busUid);
+    return node != nullptr && node->meter.read(reading);
+}
+
+void BusGraph::prune(const std::vector<std::unique_ptr<Track>>& tracks, juce::CriticalSection& projectLock)
+{
+    for (auto& node : nodes)
+    {
+        if (node->busUid == 0 || node->effectNode == nullptr)
+            continue;
+
+        bool busExists = false;
+        for (auto& track : tracks)
+            busExists = busExists || (track->getUid() == node->busUid && track->isBus());
+
+        if (!busExists)
+            setEffect(node->busUid, nullptr, nullptr, {}, projectLock);
+    }
+}
+
+void BusGraph::beginBlock(const std::vector<std::unique_ptr<Track>>& tracks, const Mixer& mixer, int numSamples)
+{
+    currentNumSamples = numSamples;
+    numActive = 0;
+    numEffects = 0;
+
+    for (auto& node : nodes)
+    {
+        node->trackIndex = -1;
+        node->numChildren = 0;
+    }
+
+    // Within the capacity reserved up front unless the project has an unusual number of tracks
+    trackToNode.assign(tracks.size(), -1);
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        const auto& track = *tracks[i];
+        if (!track.isBus())
+            continue;
+
+        int index = claimNode(track.getUid());
+        if (index < 0)
+            continue;  // Out of bus nodes: its children go to the master
+
+        auto& node = *nodes[(size_t)index];
+        node.trackIndex = (int)i;
+        node.strip.setTarget(track.getVolume(), track.getPan(), mixer.isActive(i));
+        node.input.setSize(node.input.getNumChannels(), numSamples, false, false, true);
+        node.output.setSize(node.output.getNumChannels(), numSamples, false, false, true);
+        node.input.clear();
+
+        trackToNode[i] = index;
+        active[(size_t)numActive++] = index;
+
+        if (node.effectLoaded.load(std::memory_order_relaxed))
+            ++numEffects;
+    }
+
+    // Nodes nobody uses any more are free again, unless an effect still lives in them
+    for (auto& node : nodes)
+    {
+        if (node->busUid != 0 && node->trackIndex < 0 && !node->effectLoaded.load(std::memory_order_relaxed))
+            node->busUid = 0;
+    }
+
+    // Dependencies come from the mixer's routing, which has already broken any loops
+    for (int a = 0; a < numActive; ++a)
+    {
+        auto& node = *nodes[(size_t)active[(size_t)a]];
+        node.parent = getOutputBus(mixer, (size_t)node.trackIndex);
+
+        if (node.parent >= 0)
+        {
+            auto& parent = *nodes[(size_t)node.parent];
+            parent.children[(size_t)parent.numChildren++] = active[(size_t)a];
+        }
+    }
+}
+
+int BusGraph::getOutputBus(const Mixer& mixer, size_t trackIndex) const
+{
+    // A bus that got no node (pool exhausted) sends its inputs to the master
+    int parentTrack = mixer.getParentIndex(trackIndex);
+    return parentTrack >= 0 && (size_t)parentTrack < trackToNode.size() ? trackToNode[(size_t)parentTrack] : -1;
+}
+
+template <typename SampleType>
+void BusGraph::process(juce::AudioBuffer<SampleType>& master, int numSamples)
+{
+    if (numActive == 0)
+        return;
+
+    // No helper is inside help() between blocks, so the queue can be reset here
+    for (int i = 0; i < numActive; ++i)
+        readySlots[(size_t)i].store(0, std::memory_order_relaxed);
+    readyPushed.store(0, std::memory_order_relaxed);
+    readyPopped.store(0, std::memory_order_relaxed);
+    remaining.store(numActive, std::memory_order_relaxed);
+
+    for (int a = 0; a < numActive; ++a)
+    {
+        auto& node = *nodes[(size_t)active[(size_t)a]];
+        node.pendingChildren.store(node.numChildren, std::memory_order_relaxed);
+    }
+
+    for (int a = 0; a < numActive; ++a)
+    {
+        if (nodes[(size_t)active[(size_t)a]]->numChildren == 0)
+            pushReady(active[(size_t)a]);
+    }
+
+    evaluating.store(true, std::memory_order_release);
+
+    // Summing alone is cheaper than waking anyone up
+    if (parallel.load(std::memory_order_relaxed) && numEffects >= 2)
+        for (auto& helper : helpers)
+            helper->wake();
+
+    help();
+
+    // Dekker handshake with help(): sequentially consistent on both sides, so either a late
+    // helper sees evaluating == false or this thread sees it in activeHelpers and waits
+    evaluating.store(false, std::memory_order_seq_cst);
+    while (activeHelpers.load(std::memory_order_seq_cst) > 0)
+        juce::Thread::yield();
+
+    for (int a = 0; a < numActive; ++a)
+    {
+        auto& node = *nodes[(size_t)active[(size_t)a]];
+        if (node.parent >= 0)
+            continue;
+
+        for (int ch = 0; ch < juce::jmin(master.getNumChannels(), node.output.getNumChannels()); ++ch)
+            addScaled(master.getWritePointer(ch), node.output.getReadPointer(ch), 1.0f, numSamples);
+    }
+}
+
+template void BusGraph::process(juce::AudioBuffer<float>&, int);
+template void BusGraph::process(juce::AudioBuffer<double>&, int);
+
+void BusGraph::help()
+{
+    // Helpers work to the callback's deadline, so they're held to the same rules
+    const RealtimeSafety::ScopedRealtime realtime;
+    activeHelpers.fetch_add(1, std::memory_order_seq_cst);
+
+    while (evaluating.load(std::memory_order_seq_cst) && remaining.load(std::memory_order_acquire) > 0)
+    {
+        int index = popReady();
+        if (index >= 0)
+            processNode(index, currentNumSamples);
+        else
+            juce::Thread::yield();  // Every ready bus is taken; the rest wait on those
+    }
+
+    activeHelpers.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void BusGraph::processNode(int index, int numSamples)
+{
+    auto& node = *nodes[(size_t)index];
+    int numChannels = node.input.getNumChannels();
+
+    for (int c = 0; c < node.numChildren; ++c)
+    {
+        auto& child = *nodes[(size_t)node.children[(size_t)c]];
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::add(node.input.getWritePointer(ch), child.output.getReadPointer(ch), numSamples);
+    }
+
+    node.midi.clear();
+    node.effect.process(node.input, node.midi);
+
+    node.output.clear();
+    node.strip.mixInto(node.input, node.output, numSamples);
+    node.meter.process(node.output, numSamples);
+
+    if (node.parent >= 0 && nodes[(size_t)node.parent]->pendingChildren.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        pushReady(node.parent);
+
+    remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void BusGraph::pushReady(int index)
+{
+    int slot = readyPushed.fetch_add(1, std::memory_order_acq_rel);
+    readySlots[(size_t)slot].store(index + 1, std::memory_order_release);
+}
+
+int BusGraph::popReady()
+{
+    int slot = readyPopped.load(std::memory_order_acquire);
+
+    while (slot < readyPushed.load(std::memory_order_acquire))
+    {
+        if (readyPopped.compare_exchange_weak(slot, slot + 1, std::memory_order_acq_rel))
+        {
+            // The pusher bumps the count before it fills the slot
+            int value;
+            while ((value = readySlots[(size_t)slot].load(std::memory_order_acquire)) == 0)
+                juce::Thread::yield();
+            return value - 1;
+        }
+    }
+
+    return -1;
+}
+
+} // namespace pianodaw
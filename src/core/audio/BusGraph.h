@@ -0,0 +1,146 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "GraphSwapper.h"
+#include "LevelMeter.h"
+#include "Mixer.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+class Track;
+
+/**
+ * BusGraph - Group and folder buses, summed as a DAG across worker threads
+ *
+ * Every Group/Folder track that is in use gets a bus node from a fixed pool
+ * (allocated up front, so routing changes never allocate on the audio
+ * thread). Track chains add their strip output into their bus's input; a
+ * bus then sums its child buses, runs its effect insert (one reverb per
+ * group instead of one per track) and applies its own channel strip.
+ *
+ * Evaluation follows the routing: a bus is ready once all its child buses
+ * are done. Ready buses are picked up by the audio thread and, when there
+ * is enough effect work to be worth it, by helper threads; the audio
+ * thread helps until the whole graph is done, then sums the top-level
+ * buses into the master. Helpers sleep until a block has work for them
+ * and run at realtime priority where the system allows it, since the
+ * audio thread waits for any still inside the graph before returning.
+ *
+ * The pool is guarded by the project lock; effects are set on the message
+ * thread and swapped in by each node's GraphSwapper.
+ *
+ * Bus buffers and effects are float in either engine precision; only the
+ * final sum into the master follows the host's buffer.
+ */
+class BusGraph
+{
+public:
+    static constexpr int maxBuses = 32;
+
+    BusGraph();
+    ~BusGraph();
+
+    /** Allocate block-sized buffers (audio stopped) */
+    void prepare(double sampleRate, int blockSize, int numChannels);
+
+    // === Message thread ===
+
+    /**
+     * Insert an effect on a bus (nullptr graph removes it)
+     * @return false if every bus node is taken
+     */
+    bool setEffect(int busUid, std::unique_ptr<juce::AudioProcessorGraph> graph,
+                   juce::AudioProcessorGraph::Node::Ptr node, const juce::PluginDescription& description,
+                   juce::CriticalSection& projectLock);
+
+    juce::AudioProcessor* getEffect(int busUid) const;
+    const juce::PluginDescription* getEffectDescription(int busUid) const;
+
+    /** Post-fader level of a bus (one reader) */
+    bool readMeter(int busUid, LevelMeter::Reading& reading) const;
+
+    /** Drop effects of buses that are no longer in the project */
+    void prune(const std::vector<std::unique_ptr<Track>>& tracks, juce::CriticalSection& projectLock);
+
+    // === Audio thread, project lock held ===
+
+    /** Assign nodes to this block's buses, set their strips and clear their inputs */
+    void beginBlock(const std::vector<std::unique_ptr<Track>>& tracks, const Mixer& mixer, int numSamples);
+
+    /** Bus node the track at trackIndex sums into this block, or -1 for the master */
+    int getOutputBus(const Mixer& mixer, size_t trackIndex) const;
+
+    /** Strip of the bus node the bus track at trackIndex has this block, or nullptr */
+    ChannelStrip* getBusStrip(size_t trackIndex)
+    {
+        return trackIndex < trackToNode.size() && trackToNode[trackIndex] >= 0
+            ? &nodes[(size_t)trackToNode[trackIndex]]->strip : nullptr;
+    }
+
+    /** Where a chain routed to bus adds its output */
+    juce::AudioBuffer<float>& getBusInput(int bus) { return nodes[(size_t)bus]->input; }
+
+    /** Evaluate every bus and add the top-level ones into master (buses themselves run in float) */
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& master, int numSamples);
+
+    /** Run bus effects on helper threads (they only join when at least two effects are live) */
+    void setParallel(bool shouldRunInParallel) { parallel.store(shouldRunInParallel); }
+
+private:
+    struct Node
+    {
+        int busUid = 0;                  // 0 = free
+        int trackIndex = -1;             // -1 = not in use this block
+        int parent = -1;                 // Bus node this one sums into, -1 = master
+        int numChildren = 0;
+        std::array<int, maxBuses> children {};
+        std::atomic<int> pendingChildren { 0 };
+
+        juce::AudioBuffer<float> input;  // Sum of everything routed here; the effect runs in place
+        juce::AudioBuffer<float> output; // After the bus's channel strip
+        juce::MidiBuffer midi;           // Always empty: effects get no notes
+        ChannelStrip strip;
+        LevelMeter meter;                // Of output, on whichever thread evaluated the node
+
+        GraphSwapper effect;
+        juce::AudioProcessorGraph::Node::Ptr effectNode;  // Message thread
+        juce::PluginDescription effectDescription;        // Message thread
+        std::atomic<bool> effectLoaded { false };
+    };
+
+    class Helper;
+
+    Node* findNode(int busUid) const;
+    int claimNode(int busUid);
+    void processNode(int index, int numSamples);
+    void pushReady(int index);
+    int popReady();
+    void help();
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<int> trackToNode;                  // Project index -> node, this block
+    std::array<int, maxBuses> active {};           // Nodes in use this block
+    int numActive = 0;
+    int numEffects = 0;
+    int currentNumSamples = 0;
+
+    // Ready queue: each node is pushed once per block, so one slot per node suffices
+    std::array<std::atomic<int>, maxBuses> readySlots {};
+    std::atomic<int> readyPushed { 0 };
+    std::atomic<int> readyPopped { 0 };
+    std::atomic<int> remaining { 0 };
+    std::atomic<bool> evaluating { false };
+    std::atomic<int> activeHelpers { 0 };
+
+    std::atomic<bool> parallel { true };
+    std::vector<std::unique_ptr<Helper>> helpers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BusGraph)
+};
+
+} // namespace pianodaw
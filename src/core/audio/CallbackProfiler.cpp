@@ -0,0 +1,138 @@
+#include "CallbackProfiler.h"
+#include <cmath>
+
+namespace pianodaw {
+
+const char* CallbackProfiler::getStageName(int stage)
+{
+    switch (stage)
+    {
+        case lockWait:  return "Lock wait";
+        case midiMerge: return "MIDI merge";
+        case sequencer: return "Sequencer";
+        case recording: return "Recording";
+        case render:    return "Render";
+        case mix:       return "Mix";
+        default:        return "?";
+    }
+}
+
+float CallbackProfiler::Snapshot::getLoadPercentile(double fraction) const
+{
+    juce::uint64 total = 0;
+    for (auto count : histogram)
+        total += count;
+
+    if (total == 0)
+        return 0.0f;
+
+    // Upper edge of the bucket the percentile falls into
+    auto target = (juce::uint64)std::ceil(fraction * (double)total);
+    juce::uint64 seen = 0;
+    for (int i = 0; i < numBuckets; ++i)
+    {
+        seen += histogram[(size_t)i];
+        if (seen >= target)
+            return (float)(i + 1) * bucketWidth;
+    }
+
+    return (float)numBuckets * bucketWidth;
+}
+
+void CallbackProfiler::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate > 0.0 ? newSampleRate : 44100.0);
+    previousStart = 0;
+    previousPeriod = 0.0;
+}
+
+void CallbackProfiler::beginBlock(int numSamples)
+{
+    auto now = juce::Time::getHighResolutionTicks();
+
+    if (resetRequested.exchange(false, std::memory_order_acquire))
+    {
+        averageStageLoad.fill(0.0);
+        averageTotalLoad = 0.0;
+        peakLoad.store(0.0f, std::memory_order_relaxed);
+        numBlocks.store(0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        lateCallbacks.store(0, std::memory_order_relaxed);
+        for (auto& bucket : histogram)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+
+    // A callback far later than the last period predicted means the device waited on us, or dropped out
+    if (previousStart != 0 && previousPeriod > 0.0
+        && juce::Time::highResolutionTicksToSeconds(now - previousStart) > previousPeriod * 1.5)
+        lateCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+    currentPeriod = (double)numSamples / sampleRate.load(std::memory_order_relaxed);
+    lastBlockSize.store(numSamples, std::memory_order_relaxed);
+    blockStageSeconds.fill(0.0);
+    blockStart = now;
+    lastMark = now;
+}
+
+void CallbackProfiler::mark(Stage stage)
+{
+    auto now = juce::Time::getHighResolutionTicks();
+    blockStageSeconds[(size_t)stage] += juce::Time::highResolutionTicksToSeconds(now - lastMark);
+    lastMark = now;
+}
+
+void CallbackProfiler::endBlock()
+{
+    auto now = juce::Time::getHighResolutionTicks();
+    previousStart = blockStart;
+    previousPeriod = currentPeriod;
+
+    if (currentPeriod <= 0.0)
+        return;
+
+    double load = juce::Time::highResolutionTicksToSeconds(now - blockStart) / currentPeriod;
+
+    // One-pole averages over averagingSeconds of audio
+    double coefficient = 1.0 - std::exp(-currentPeriod / averagingSeconds);
+    for (int s = 0; s < numStages; ++s)
+    {
+        averageStageLoad[(size_t)s] += (blockStageSeconds[(size_t)s] / currentPeriod - averageStageLoad[(size_t)s]) * coefficient;
+        publishedStageLoad[(size_t)s].store((float)averageStageLoad[(size_t)s], std::memory_order_relaxed);
+    }
+
+    averageTotalLoad += (load - averageTotalLoad) * coefficient;
+    publishedAverageLoad.store((float)averageTotalLoad, std::memory_order_relaxed);
+
+    if ((float)load > peakLoad.load(std::memory_order_relaxed))
+        peakLoad.store((float)load, std::memory_order_relaxed);
+
+    if (load > 1.0)
+        overruns.fetch_add(1, std::memory_order_relaxed);
+
+    int bucket = juce::jlimit(0, numBuckets - 1, (int)(load / bucketWidth));
+    histogram[(size_t)bucket].fetch_add(1, std::memory_order_relaxed);
+    numBlocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+CallbackProfiler::Snapshot CallbackProfiler::getSnapshot() const
+{
+    Snapshot snapshot;
+    snapshot.sampleRate = sampleRate.load(std::memory_order_relaxed);
+    snapshot.blockSize = lastBlockSize.load(std::memory_order_relaxed);
+
+    for (int s = 0; s < numStages; ++s)
+        snapshot.stageLoad[(size_t)s] = publishedStageLoad[(size_t)s].load(std::memory_order_relaxed);
+
+    snapshot.averageLoad = publishedAverageLoad.load(std::memory_order_relaxed);
+    snapshot.peakLoad = peakLoad.load(std::memory_order_relaxed);
+    snapshot.numBlocks = numBlocks.load(std::memory_order_relaxed);
+    snapshot.overruns = overruns.load(std::memory_order_relaxed);
+    snapshot.lateCallbacks = lateCallbacks.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < numBuckets; ++i)
+        snapshot.histogram[(size_t)i] = histogram[(size_t)i].load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+} // namespace pianodaw
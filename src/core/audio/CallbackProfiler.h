@@ -0,0 +1,107 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+namespace pianodaw {
+
+/**
+ * CallbackProfiler - How close the audio callback runs to its deadline
+ *
+ * The audio thread stamps the start of a block, every stage boundary and
+ * the end with the high-resolution clock. Each block's duration is taken
+ * as a share of its buffer period (the deadline) and counted into a
+ * histogram; blocks past the deadline are overruns, and a callback that
+ * starts much later than the previous period predicted is counted as late
+ * (the device most likely dropped out in between).
+ *
+ * Everything the UI sees is a relaxed atomic written only by the audio
+ * thread, so a snapshot is not one consistent instant - fine for
+ * statistics. reset() is a request the audio thread honours at its next block.
+ */
+class CallbackProfiler
+{
+public:
+    enum Stage
+    {
+        lockWait,     // Waiting for the project lock
+        midiMerge,    // Hardware and UI MIDI merged into the block
+        sequencer,    // Playhead and clip sequencing
+        recording,    // MIDI recording
+        render,       // Instrument graphs, frozen audio and the built-in synth
+        mix,          // Mixer, channel strips, buses and meters
+        numStages
+    };
+
+    static constexpr int numBuckets = 41;         // 5% of the period each; the last holds everything beyond 200%
+    static constexpr float bucketWidth = 0.05f;
+    static constexpr double averagingSeconds = 1.0;
+
+    static const char* getStageName(int stage);
+
+    struct Snapshot
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;                            // Of the latest block
+        std::array<float, numStages> stageLoad {};    // Average share of the period per stage
+        float averageLoad = 0.0f;
+        float peakLoad = 0.0f;                        // Since the last reset
+        juce::uint32 numBlocks = 0;
+        juce::uint32 overruns = 0;                    // Blocks that took longer than their period
+        juce::uint32 lateCallbacks = 0;
+        std::array<juce::uint32, numBuckets> histogram {};
+        int deviceXRuns = -1;                         // Reported by the device, -1 if it can't tell
+
+        /** Load (share of the period) below which the given fraction of blocks finished */
+        float getLoadPercentile(double fraction) const;
+    };
+
+    CallbackProfiler() = default;
+
+    /** Audio stopped: forget the previous callback, so the restart isn't counted as late */
+    void prepare(double sampleRate);
+
+    // === Audio thread ===
+
+    void beginBlock(int numSamples);
+
+    /** Charge the time since the previous mark to stage (stages may be charged several times) */
+    void mark(Stage stage);
+
+    void endBlock();
+
+    // === Message thread ===
+
+    Snapshot getSnapshot() const;
+    void reset() { resetRequested.store(true); }
+
+private:
+    // Audio thread
+    juce::int64 blockStart = 0;
+    juce::int64 lastMark = 0;
+    juce::int64 previousStart = 0;
+    double previousPeriod = 0.0;
+    double currentPeriod = 0.0;
+    std::array<double, numStages> blockStageSeconds {};
+    std::array<double, numStages> averageStageLoad {};
+    double averageTotalLoad = 0.0;
+
+    // Audio thread -> message thread
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<int> lastBlockSize { 0 };
+    std::array<std::atomic<float>, numStages> publishedStageLoad {};
+    std::atomic<float> publishedAverageLoad { 0.0f };
+    std::atomic<float> peakLoad { 0.0f };
+    std::atomic<juce::uint32> numBlocks { 0 };
+    std::atomic<juce::uint32> overruns { 0 };
+    std::atomic<juce::uint32> lateCallbacks { 0 };
+    std::array<std::atomic<juce::uint32>, numBuckets> histogram {};
+
+    // Message thread -> audio thread
+    std::atomic<bool> resetRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CallbackProfiler)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,228 @@
+#include "ConvolutionReverb.h"
+#include <cmath>
+
+namespace pianodaw {
+
+juce::PluginDescription ConvolutionReverb::getDescription()
+{
+    juce::PluginDescription desc;
+    desc.name = "Convolution Reverb";
+    desc.descriptiveName = "Built-in impulse response reverb";
+    desc.pluginFormatName = "Internal";
+    desc.category = "Reverb";
+    desc.manufacturerName = "PianoDAW";
+    desc.fileOrIdentifier = "pianodaw:convolution-reverb";
+    desc.isInstrument = false;
+    desc.numInputChannels = 2;
+    desc.numOutputChannels = 2;
+    return desc;
+}
+
+bool ConvolutionReverb::isConvolutionReverb(const juce::PluginDescription& desc)
+{
+    return desc.pluginFormatName == "Internal" && desc.fileOrIdentifier == getDescription().fileOrIdentifier;
+}
+
+juce::MemoryBlock ConvolutionReverb::createState(const juce::File& impulseResponse, float wet, float dry)
+{
+    juce::XmlElement xml("ConvolutionReverb");
+    xml.setAttribute("impulseResponse", impulseResponse.getFullPathName());
+    xml.setAttribute("wet", wet);
+    xml.setAttribute("dry", dry);
+
+    juce::MemoryBlock state;
+    copyXmlToBinary(xml, state);
+    return state;
+}
+
+ConvolutionReverb::ConvolutionReverb(int numChannels_)
+    : AudioPluginInstance(BusesProperties()
+          .withInput("Input", juce::AudioChannelSet::canonicalChannelSet(juce::jmax(1, numChannels_)), true)
+          .withOutput("Output", juce::AudioChannelSet::canonicalChannelSet(juce::jmax(1, numChannels_)), true)),
+      numChannels(juce::jmax(1, numChannels_))
+{
+    addParameter(wet = new juce::AudioParameterFloat(juce::ParameterID { "wet", 1 }, "Wet", 0.0f, 1.0f, 0.3f));
+    addParameter(dry = new juce::AudioParameterFloat(juce::ParameterID { "dry", 1 }, "Dry", 0.0f, 1.0f, 1.0f));
+}
+
+ConvolutionReverb::~ConvolutionReverb() {}
+
+void ConvolutionReverb::fillInPluginDescription(juce::PluginDescription& description) const
+{
+    description = getDescription();
+}
+
+bool ConvolutionReverb::loadImpulseResponse(const juce::File& file, juce::String& errorMessage)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(file));
+    if (reader == nullptr)
+    {
+        errorMessage = "Not a readable audio file: " + file.getFullPathName();
+        return false;
+    }
+
+    if (reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+    {
+        errorMessage = "The impulse response is empty: " + file.getFullPathName();
+        return false;
+    }
+
+    // Anything longer is silence as far as a reverb is concerned
+    auto length = (int)juce::jmin(reader->lengthInSamples, (juce::int64)(maxImpulseSeconds * reader->sampleRate));
+    int channels = juce::jlimit(1, numChannels, (int)reader->numChannels);
+
+    impulse.setSize(channels, length);
+    reader->read(&impulse, 0, length, 0, true, channels > 1);
+
+    impulseFile = file;
+    impulseSampleRate = reader->sampleRate;
+    partitionedRate = 0.0;
+    return true;
+}
+
+void ConvolutionReverb::partition(double sampleRate)
+{
+    convolvers.clear();
+    partitionedRate = sampleRate;
+
+    if (impulse.getNumSamples() == 0)
+        return;
+
+    juce::AudioBuffer<float> response;
+    if (std::abs(impulseSampleRate - sampleRate) > 1.0e-6)
+    {
+        // ResamplingAudioSource low-passes when it downsamples, so a 96 kHz response doesn't alias at 44.1 kHz
+        auto ratio = impulseSampleRate / sampleRate;
+        int length = (int)std::ceil(impulse.getNumSamples() / ratio);
+
+        juce::MemoryAudioSource source(impulse, false);
+        juce::ResamplingAudioSource resampler(&source, false, impulse.getNumChannels());
+        resampler.setResamplingRatio(ratio);
+        resampler.prepareToPlay(length, sampleRate);
+
+        response.setSize(impulse.getNumChannels(), length);
+        resampler.getNextAudioBlock(juce::AudioSourceChannelInfo(response));
+    }
+    else
+    {
+        response.makeCopyOf(impulse);
+    }
+
+    // Drop the tail below -90 dB; it would only cost partitions
+    int length = 0;
+    for (int ch = 0; ch < response.getNumChannels(); ++ch)
+    {
+        const auto* data = response.getReadPointer(ch);
+        for (int i = response.getNumSamples(); --i >= length;)
+        {
+            if (std::abs(data[i]) > 3.0e-5f)
+            {
+                length = i + 1;
+                break;
+            }
+        }
+    }
+
+    double energy = 0.0;
+    for (int ch = 0; ch < response.getNumChannels(); ++ch)
+    {
+        const auto* data = response.getReadPointer(ch);
+        double channelEnergy = 0.0;
+        for (int i = 0; i < length; ++i)
+            channelEnergy += (double)data[i] * data[i];
+        energy = juce::jmax(energy, channelEnergy);
+    }
+
+    if (energy > 0.0)
+        response.applyGain(0, length, (float)(1.0 / std::sqrt(energy)));
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        convolvers.push_back(std::make_unique<PartitionedConvolver>());
+        convolvers.back()->load(response.getReadPointer(juce::jmin(ch, response.getNumChannels() - 1)), length);
+    }
+}
+
+void ConvolutionReverb::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    // Loaders prepare on their worker thread; a later prepare at the same rate keeps the partitions
+    if (sampleRate != partitionedRate)
+        partition(sampleRate);
+
+    for (auto& convolver : convolvers)
+        convolver->reset();
+
+    wetBuffer.setSize(numChannels, juce::jmax(1, maximumExpectedSamplesPerBlock));
+    wetGain.reset(sampleRate, 0.05);
+    dryGain.reset(sampleRate, 0.05);
+    wetGain.setCurrentAndTargetValue(wet->get());
+    dryGain.setCurrentAndTargetValue(dry->get());
+}
+
+void ConvolutionReverb::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    int numSamples = buffer.getNumSamples();
+    int channels = juce::jmin(buffer.getNumChannels(), (int)convolvers.size());
+
+    // The wet signal is rendered apart so the dry one can ramp in place
+    wetBuffer.setSize(numChannels, numSamples, false, false, true);
+    for (int ch = 0; ch < channels; ++ch)
+        convolvers[(size_t)ch]->process(buffer.getReadPointer(ch), wetBuffer.getWritePointer(ch), numSamples);
+
+    wetGain.setTargetValue(wet->get());
+    dryGain.setTargetValue(dry->get());
+    auto wetStart = wetGain.getCurrentValue(), wetEnd = wetGain.skip(numSamples);
+    auto dryStart = dryGain.getCurrentValue(), dryEnd = dryGain.skip(numSamples);
+
+    buffer.applyGainRamp(0, numSamples, dryStart, dryEnd);
+    for (int ch = 0; ch < channels; ++ch)
+        buffer.addFromWithRamp(ch, 0, wetBuffer.getReadPointer(ch), numSamples, wetStart, wetEnd);
+}
+
+double ConvolutionReverb::getTailLengthSeconds() const
+{
+    return impulseSampleRate > 0.0 ? impulse.getNumSamples() / impulseSampleRate : 0.0;
+}
+
+void ConvolutionReverb::getStateInformation(juce::MemoryBlock& destData)
+{
+    destData = createState(impulseFile, wet->get(), dry->get());
+}
+
+void ConvolutionReverb::setStateInformation(const void* data, int sizeInBytes)
+{
+    juce::String error;
+    restoreState(data, sizeInBytes, error);
+}
+
+bool ConvolutionReverb::restoreState(const void* data, int sizeInBytes, juce::String& errorMessage)
+{
+    auto xml = getXmlFromBinary(data, sizeInBytes);
+    if (xml == nullptr || !xml->hasTagName("ConvolutionReverb"))
+    {
+        errorMessage = "Not a Convolution Reverb state";
+        return false;
+    }
+
+    *wet = (float)xml->getDoubleAttribute("wet", wet->get());
+    *dry = (float)xml->getDoubleAttribute("dry", dry->get());
+
+    // A missing file leaves the reverb dry; the path is kept in the project either way
+    auto path = xml->getStringAttribute("impulseResponse");
+    if (!juce::File::isAbsolutePath(path))
+        return true;
+
+    juce::File file(path);
+    if (file == impulseFile || loadImpulseResponse(file, errorMessage))
+        return true;
+
+    impulseFile = file;
+    return false;
+}
+
+} // namespace pianodaw
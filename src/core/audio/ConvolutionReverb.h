@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "PartitionedConvolver.h"
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+/**
+ * ConvolutionReverb - Built-in reverb insert convolving with a sampled impulse response
+ *
+ * An AudioPluginInstance like any hosted effect, so it loads through
+ * PluginLoader, sits in a GraphSwapper on the master or a bus, and saves
+ * with the project as its plugin state (the impulse response's path plus
+ * the wet and dry levels). Setting the state reads the file and preparing
+ * resamples it to the engine rate and partitions it, both on the loader's
+ * worker thread; switching impulse responses loads a new instance, which
+ * the swapper crossfades to.
+ *
+ * Each output channel convolves its input with the matching channel of the
+ * response (a mono response serves both) through a zero-latency
+ * PartitionedConvolver. The response is normalised to unit energy, so a wet
+ * level of 1 is about as loud as the dry signal.
+ */
+class ConvolutionReverb : public juce::AudioPluginInstance
+{
+public:
+    static constexpr double maxImpulseSeconds = 20.0;
+
+    static juce::PluginDescription getDescription();
+    static bool isConvolutionReverb(const juce::PluginDescription& description);
+
+    /** Plugin state for a reverb playing this impulse response */
+    static juce::MemoryBlock createState(const juce::File& impulseResponse, float wet, float dry);
+
+    explicit ConvolutionReverb(int numChannels);
+    ~ConvolutionReverb() override;
+
+    /** Read an impulse response (not on the audio thread, before the reverb is live); used from the next prepare */
+    bool loadImpulseResponse(const juce::File& file, juce::String& errorMessage);
+    const juce::File& getImpulseResponseFile() const { return impulseFile; }
+
+    float getWet() const { return wet->get(); }
+    float getDry() const { return dry->get(); }
+
+    // AudioPluginInstance
+    void fillInPluginDescription(juce::PluginDescription& description) const override;
+
+    // AudioProcessor
+    const juce::String getName() const override { return "Convolution Reverb"; }
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override {}
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
+
+    double getTailLengthSeconds() const override;
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+
+    juce::AudioProcessorEditor* createEditor() override { return new juce::GenericAudioProcessorEditor(*this); }
+    bool hasEditor() const override { return true; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    /** setStateInformation, reporting a state it can't read or an impulse response that didn't load */
+    bool restoreState(const void* data, int sizeInBytes, juce::String& errorMessage);
+
+private:
+    /** Resample the response to sampleRate, normalise it and partition it per channel */
+    void partition(double sampleRate);
+
+    const int numChannels;
+    juce::AudioParameterFloat* wet = nullptr;
+    juce::AudioParameterFloat* dry = nullptr;
+
+    juce::File impulseFile;
+    juce::AudioBuffer<float> impulse;         // As read from the file
+    double impulseSampleRate = 0.0;
+    double partitionedRate = 0.0;             // Rate the convolvers were built for, 0 = stale
+
+    std::vector<std::unique_ptr<PartitionedConvolver>> convolvers;
+    juce::AudioBuffer<float> wetBuffer;
+    juce::LinearSmoothedValue<float> wetGain, dryGain;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvolutionReverb)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,78 @@
+#include "DelayLine.h"
+
+namespace pianodaw {
+
+void DelayLine::prepare(int numChannels, int maxDelaySamples, int maxBlockSize, bool doublePrecision)
+{
+    maxDelay = juce::jmax(0, maxDelaySamples);
+    chunkSize = juce::jmax(1, maxBlockSize);
+    history.setSize(juce::jmax(1, numChannels), maxDelay + chunkSize);
+
+    if (doublePrecision)
+        historyDouble.setSize(history.getNumChannels(), history.getNumSamples());
+    else
+        historyDouble.setSize(0, 0);
+
+    delay = juce::jmin(delay, maxDelay);
+    reset();
+}
+
+void DelayLine::reset()
+{
+    history.clear();
+    historyDouble.clear();
+    writePosition = 0;
+}
+
+void DelayLine::setDelay(int delaySamples)
+{
+    delay = juce::jlimit(0, maxDelay, delaySamples);
+}
+
+void DelayLine::process(juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    processHistory(history, buffer, numSamples);
+}
+
+void DelayLine::process(juce::AudioBuffer<double>& buffer, int numSamples)
+{
+    // Not prepared for double precision: passes through undelayed rather than allocate here
+    jassert(historyDouble.getNumSamples() > 0);
+    processHistory(historyDouble, buffer, numSamples);
+}
+
+template <typename SampleType>
+void DelayLine::processHistory(juce::AudioBuffer<SampleType>& ring, juce::AudioBuffer<SampleType>& buffer, int numSamples)
+{
+    int size = ring.getNumSamples();
+    int numChannels = juce::jmin(buffer.getNumChannels(), ring.getNumChannels());
+
+    if (size == 0)
+        return;
+
+    // Blocks larger than announced are handled in pieces that fit the history
+    for (int start = 0; start < numSamples;)
+    {
+        int count = juce::jmin(numSamples - start, chunkSize);
+        int readPosition = (writePosition - delay + size) % size;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* io = buffer.getWritePointer(ch, start);
+            auto* past = ring.getWritePointer(ch);
+
+            int firstWrite = juce::jmin(count, size - writePosition);
+            juce::FloatVectorOperations::copy(past + writePosition, io, firstWrite);
+            juce::FloatVectorOperations::copy(past, io + firstWrite, count - firstWrite);
+
+            int firstRead = juce::jmin(count, size - readPosition);
+            juce::FloatVectorOperations::copy(io, past + readPosition, firstRead);
+            juce::FloatVectorOperations::copy(io + firstRead, past, count - firstRead);
+        }
+
+        writePosition = (writePosition + count) % size;
+        start += count;
+    }
+}
+
+} // namespace pianodaw
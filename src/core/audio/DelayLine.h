@@ -0,0 +1,52 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace pianodaw {
+
+/**
+ * DelayLine - Preallocated multichannel delay for latency compensation
+ *
+ * Whole-sample delay up to the maximum given to prepare(). The history is
+ * always written, so changing the delay while running reads valid (older)
+ * audio instead of stale memory. Never allocates on the audio thread.
+ * A line prepared for double precision keeps a second, double history so
+ * the 64-bit path is delayed without a round trip through float.
+ */
+class DelayLine
+{
+public:
+    DelayLine() = default;
+
+    /** Allocate history (audio stopped, or line not yet visible to the audio thread) */
+    void prepare(int numChannels, int maxDelaySamples, int maxBlockSize, bool doublePrecision = false);
+
+    /** Clear the history */
+    void reset();
+
+    // === Audio thread ===
+
+    /** Clamped to [0, getMaxDelay()] */
+    void setDelay(int delaySamples);
+    int getDelay() const { return delay; }
+    int getMaxDelay() const { return maxDelay; }
+
+    /** Delay the first numSamples of buffer in place */
+    void process(juce::AudioBuffer<float>& buffer, int numSamples);
+    void process(juce::AudioBuffer<double>& buffer, int numSamples);
+
+private:
+    template <typename SampleType>
+    void processHistory(juce::AudioBuffer<SampleType>& ring, juce::AudioBuffer<SampleType>& buffer, int numSamples);
+
+    juce::AudioBuffer<float> history;
+    juce::AudioBuffer<double> historyDouble;   // Empty unless prepared for double precision
+    int writePosition = 0;
+    int delay = 0;
+    int maxDelay = 0;
+    int chunkSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayLine)
+};
+
+} // namespace pianodaw
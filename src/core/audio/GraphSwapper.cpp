@@ -0,0 +1,220 @@
+#include "GraphSwapper.h"
+
+namespace pianodaw {
+
+GraphSwapper::GraphSwapper()
+{
+    // Retired graphs are collected on the message thread
+    startTimerHz(10);
+}
+
+GraphSwapper::~GraphSwapper()
+{
+    stopTimer();
+
+    delete pending.exchange(nullptr);
+    delete active;
+    if (fadingOut != &silentSlot)
+        delete fadingOut;
+    timerCallback();
+}
+
+void GraphSwapper::prepare(double sampleRate, int blockSize, int numChannels)
+{
+    currentSampleRate = sampleRate > 0.0 ? sampleRate : 44100.0;
+    currentBlockSize = blockSize > 0 ? blockSize : 512;
+    currentNumChannels = juce::jmax(1, numChannels);
+
+    fadeBuffer.setSize(currentNumChannels, currentBlockSize);
+    fadeBufferDouble.setSize(precision == juce::AudioProcessor::doublePrecision ? currentNumChannels : 0,
+                             precision == juce::AudioProcessor::doublePrecision ? currentBlockSize : 0);
+    fadeMidi.ensureSize(256);
+    setCrossfadeMs(crossfadeMs);
+
+    // The device is stopped while we are prepared, so the live graphs can be touched here
+    if (active != nullptr && active->graph != nullptr)
+        prepareGraph(*active->graph);
+    publishLatency();
+
+    if (auto* slot = pending.load(std::memory_order_acquire))
+        if (slot->graph != nullptr)
+            prepareGraph(*slot->graph);
+}
+
+void GraphSwapper::setCrossfadeMs(double ms)
+{
+    crossfadeMs = juce::jmax(0.0, ms);
+    crossfadeSamples.store(juce::roundToInt(crossfadeMs * 0.001 * currentSampleRate));
+}
+
+void GraphSwapper::prepareGraph(juce::AudioProcessorGraph& graph)
+{
+    graph.setProcessingPrecision(precision);
+    graph.setPlayConfigDetails(currentNumChannels, currentNumChannels, currentSampleRate, currentBlockSize);
+    graph.prepareToPlay(currentSampleRate, currentBlockSize);
+}
+
+void GraphSwapper::submit(std::unique_ptr<juce::AudioProcessorGraph> graph)
+{
+    // Loaders prepare in single precision; not live yet, so it can be redone here
+    if (graph != nullptr && graph->getProcessingPrecision() != precision)
+        prepareGraph(*graph);
+
+    auto* slot = new GraphSlot();
+    slot->graph = std::move(graph);
+    latestSubmitted = slot->graph.get();
+
+    // A graph the audio thread never picked up can be dropped right here
+    delete pending.exchange(slot, std::memory_order_acq_rel);
+}
+
+bool GraphSwapper::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    return processWith(buffer, midiMessages, fadeBuffer);
+}
+
+bool GraphSwapper::process(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    return processWith(buffer, midiMessages, fadeBufferDouble);
+}
+
+template <typename SampleType>
+bool GraphSwapper::processWith(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages,
+                               juce::AudioBuffer<SampleType>& fade)
+{
+    // Pick up a new graph at the block boundary (only if both old graphs can be retired)
+    if (pending.load(std::memory_order_relaxed) != nullptr && retireFifo.getFreeSpace() >= 2)
+    {
+        if (auto* incoming = pending.exchange(nullptr, std::memory_order_acq_rel))
+        {
+            // Swapping again mid-fade: drop the graph that was already fading out
+            if (fadingOut != nullptr)
+                retire(fadingOut);
+
+            fadingOut = active != nullptr ? active : &silentSlot;
+            active = incoming;
+            publishLatency();
+            fadePosition = 0;
+            fadeLength = crossfadeSamples.load(std::memory_order_relaxed);
+
+            if (fadeLength <= 0 && fadingOut != nullptr)
+            {
+                retire(fadingOut);
+                fadingOut = nullptr;
+            }
+        }
+    }
+
+    bool activeLive = active != nullptr && active->graph != nullptr;
+    bool fadingLive = fadingOut != nullptr && fadingOut->graph != nullptr;
+
+    if (!activeLive && !fadingLive)
+    {
+        // Fading between two empty slots: nothing left to do
+        if (fadingOut != nullptr)
+        {
+            retire(fadingOut);
+            fadingOut = nullptr;
+        }
+        return false;
+    }
+
+    int numSamples = buffer.getNumSamples();
+
+    // The outgoing graph renders from the same input but gets no new MIDI
+    if (fadingOut != nullptr)
+    {
+        fade.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+
+        if (fadingLive || bypassWhenEmpty)
+        {
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                fade.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+        }
+        else
+        {
+            fade.clear();
+        }
+
+        if (fadingLive)
+        {
+            fadeMidi.clear();
+            fadingOut->graph->processBlock(fade, fadeMidi);
+        }
+    }
+
+    if (activeLive)
+        active->graph->processBlock(buffer, midiMessages);
+    else if (!bypassWhenEmpty)
+        buffer.clear();
+
+    if (fadingOut != nullptr)
+    {
+        int rampSamples = juce::jmin(numSamples, fadeLength - fadePosition);
+        auto startGain = (SampleType)fadePosition / (SampleType)fadeLength;
+        auto endGain = (SampleType)(fadePosition + rampSamples) / (SampleType)fadeLength;
+
+        buffer.applyGainRamp(0, rampSamples, startGain, endGain);
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            buffer.addFromWithRamp(ch, 0, fade.getReadPointer(ch), rampSamples, (SampleType)1 - startGain, (SampleType)1 - endGain);
+
+        fadePosition += rampSamples;
+        if (fadePosition >= fadeLength)
+        {
+            retire(fadingOut);
+            fadingOut = nullptr;
+        }
+    }
+
+    return true;
+}
+
+void GraphSwapper::publishLatency()
+{
+    // Read after the swap, so compensation picks up the incoming graph's latency one block late
+    liveLatency.store(active != nullptr && active->graph != nullptr ? active->graph->getLatencySamples() : 0,
+                      std::memory_order_relaxed);
+}
+
+void GraphSwapper::retire(GraphSlot* slot)
+{
+    if (slot == nullptr || slot == &silentSlot)
+        return;
+
+    int start1, size1, start2, size2;
+    retireFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    // Space was reserved before the swap was accepted
+    jassert(size1 + size2 == 1);
+
+    if (size1 > 0)
+        retireQueue[(size_t)start1] = slot;
+    else if (size2 > 0)
+        retireQueue[(size_t)start2] = slot;
+
+    retireFifo.finishedWrite(size1 + size2);
+}
+
+void GraphSwapper::timerCallback()
+{
+    int start1, size1, start2, size2;
+    retireFifo.prepareToRead(retireFifo.getNumReady(), start1, size1, start2, size2);
+
+    auto collect = [this](int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            auto* slot = retireQueue[(size_t)i];
+            if (slot->graph.get() == latestSubmitted)
+                latestSubmitted = nullptr;
+            delete slot;
+        }
+    };
+
+    collect(start1, size1);
+    collect(start2, size2);
+    retireFifo.finishedRead(size1 + size2);
+}
+
+} // namespace pianodaw
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_events/juce_events.h>
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace pianodaw {
+
+/**
+ * GraphSwapper - Double-buffered AudioProcessorGraph for glitch-free swaps
+ *
+ * The message thread builds and prepares a complete graph, then submits it.
+ * The audio thread picks it up at the next block boundary and crossfades
+ * from the previous graph (or from/to silence). Retired graphs are handed
+ * back through a lock-free queue and deleted on the message thread, so the
+ * audio thread never allocates, frees, or waits on the graph's lock.
+ * Graphs run at the swapper's processing precision; in double precision
+ * the graph itself converts for plugins that only process floats.
+ */
+class GraphSwapper : private juce::Timer
+{
+public:
+    GraphSwapper();
+    ~GraphSwapper() override;
+
+    /** Allocate crossfade scratch and re-prepare the live graph (audio stopped) */
+    void prepare(double sampleRate, int blockSize, int numChannels);
+
+    /** Precision graphs are prepared for from the next prepare() on (audio stopped) */
+    void setProcessingPrecision(juce::AudioProcessor::ProcessingPrecision newPrecision) { precision = newPrecision; }
+    juce::AudioProcessor::ProcessingPrecision getProcessingPrecision() const { return precision; }
+
+    /** Crossfade length used for the next swaps */
+    void setCrossfadeMs(double ms);
+
+    /** For effect inserts: no graph passes the input through instead of rendering silence */
+    void setBypassWhenEmpty(bool shouldBypass) { bypassWhenEmpty = shouldBypass; }
+
+    // === Message thread ===
+
+    /** Hand over a fully built, already prepared graph (nullptr fades to silence; re-prepared if its precision differs) */
+    void submit(std::unique_ptr<juce::AudioProcessorGraph> graph);
+
+    /** The graph most recently submitted (valid on the message thread only) */
+    juce::AudioProcessorGraph* getCurrentGraph() const { return latestSubmitted; }
+
+    // === Audio thread ===
+
+    /**
+     * Render the live graph, crossfading if a swap is in progress
+     * @return false when no graph is live (caller renders its fallback)
+     */
+    bool process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
+    bool process(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages);
+
+    /**
+     * Latency of the live graph (0 when silent); a graph still fading out is ignored
+     * Published by the audio thread when it swaps a graph in, so any thread can read it.
+     */
+    int getLatencySamples() const { return liveLatency.load(std::memory_order_relaxed); }
+
+private:
+    struct GraphSlot
+    {
+        std::unique_ptr<juce::AudioProcessorGraph> graph;
+    };
+
+    template <typename SampleType>
+    bool processWith(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages, juce::AudioBuffer<SampleType>& fade);
+
+    void timerCallback() override;
+    void retire(GraphSlot* slot);
+    void prepareGraph(juce::AudioProcessorGraph& graph);
+    void publishLatency();
+
+    // Message thread -> audio thread
+    std::atomic<GraphSlot*> pending { nullptr };
+
+    // Audio thread -> message thread (single producer / single consumer)
+    static constexpr int retireCapacity = 16;
+    juce::AbstractFifo retireFifo { retireCapacity };
+    std::array<GraphSlot*, retireCapacity> retireQueue {};
+
+    // Audio thread state
+    GraphSlot* active = nullptr;
+    GraphSlot* fadingOut = nullptr;
+    GraphSlot silentSlot;               // Stand-in "previous graph" for fades from silence
+    int fadePosition = 0;
+    int fadeLength = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+    juce::AudioBuffer<double> fadeBufferDouble;
+    juce::MidiBuffer fadeMidi;
+
+    // Settings
+    double currentSampleRate = 44100.0;
+    int currentBlockSize = 512;
+    int currentNumChannels = 2;
+    double crossfadeMs = 20.0;
+    bool bypassWhenEmpty = false;
+    juce::AudioProcessor::ProcessingPrecision precision = juce::AudioProcessor::singlePrecision;
+    std::atomic<int> crossfadeSamples { 882 };
+    std::atomic<int> liveLatency { 0 };
+
+    juce::AudioProcessorGraph* latestSubmitted = nullptr;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GraphSwapper)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,253 @@
+#include "LevelMeter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pianodaw {
+
+namespace
+{
+    constexpr int historySamples = LevelMeter::tapsPerPhase - 1;
+
+    float sumOf(const float* values, int numSamples)
+    {
+        // Independent lanes, so the compiler can keep them in one vector register
+        std::array<float, 8> lanes {};
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8)
+            for (int lane = 0; lane < 8; ++lane)
+                lanes[(size_t)lane] += values[i + lane];
+
+        float sum = 0.0f;
+        for (; i < numSamples; ++i)
+            sum += values[i];
+        for (auto lane : lanes)
+            sum += lane;
+        return sum;
+    }
+
+    float absoluteMax(const float* values, int numSamples)
+    {
+        auto range = juce::FloatVectorOperations::findMinAndMax(values, numSamples);
+        return juce::jmax(-range.getStart(), range.getEnd());
+    }
+}
+
+LevelMeter::LevelMeter()
+{
+    // Phase p interpolates p/oversampling of the way between the two centre taps
+    // (phase 0 is the sample itself). Hann-windowed sinc, unity gain at DC.
+    for (int p = 1; p < oversampling; ++p)
+    {
+        auto& phase = coefficients[(size_t)p];
+        double sum = 0.0;
+
+        for (int k = 0; k < tapsPerPhase; ++k)
+        {
+            double x = (double)(tapsPerPhase / 2 - 1 - k) + (double)p / (double)oversampling;
+            double sinc = std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+            double window = 0.5 * (1.0 + std::cos(juce::MathConstants<double>::pi * x / (tapsPerPhase / 2)));
+            phase[(size_t)k] = (float)(sinc * window);
+            sum += sinc * window;
+        }
+
+        for (auto& c : phase)
+            c = (float)(c / sum);
+    }
+}
+
+void LevelMeter::prepare(double newSampleRate, int blockSize)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    chunkSize = juce::jmax(1, blockSize);
+    lines.setSize(maxChannels, historySamples + chunkSize);
+    lines.clear();
+    scratch.setSize(2, chunkSize);
+
+    heldPeak.fill(0.0f);
+    heldTruePeak.fill(0.0f);
+    meanSquare.fill(0.0);
+    blockSquares.fill(0.0);
+    overs = 0;
+    blockOver = false;
+    lastPublished = 0;
+    sequence.store(0);
+    consumed.store(0);
+}
+
+void LevelMeter::beginBlock()
+{
+    // Peaks are held until the UI has seen them
+    if (consumed.load(std::memory_order_acquire) == lastPublished)
+    {
+        heldPeak.fill(0.0f);
+        heldTruePeak.fill(0.0f);
+    }
+
+    blockOver = false;
+}
+
+void LevelMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples, float gainLeft, float gainRight)
+{
+    if (chunkSize == 0)
+        return;
+
+    beginBlock();
+
+    int numChannels = juce::jmin(maxChannels, buffer.getNumChannels());
+    for (int ch = 0; ch < numChannels; ++ch)
+        measure(ch, buffer.getReadPointer(ch), numSamples, ch == 0 ? gainLeft : gainRight);
+
+    publish(numChannels, numSamples);
+}
+
+void LevelMeter::process(const juce::AudioBuffer<double>& buffer, int numSamples)
+{
+    if (chunkSize == 0)
+        return;
+
+    beginBlock();
+
+    // Measured in float: a meter needs no more than 24 bits
+    int numChannels = juce::jmin(maxChannels, buffer.getNumChannels());
+    auto* converted = scratch.getWritePointer(1);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* source = buffer.getReadPointer(ch);
+        double squares = 0.0;
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            int count = juce::jmin(numSamples - start, chunkSize);
+            for (int i = 0; i < count; ++i)
+                converted[i] = (float)source[start + i];
+
+            measure(ch, converted, count, 1.0f);
+            squares += blockSquares[(size_t)ch];
+        }
+
+        blockSquares[(size_t)ch] = squares;
+    }
+
+    publish(numChannels, numSamples);
+}
+
+void LevelMeter::processSilence(int numSamples)
+{
+    if (chunkSize == 0)
+        return;
+
+    beginBlock();
+    blockSquares.fill(0.0);
+    lines.clear();
+    publish(juce::jmax(1, publishedChannels.load(std::memory_order_relaxed)), numSamples);
+}
+
+void LevelMeter::measure(int channel, const float* samples, int numSamples, float gain)
+{
+    auto* line = lines.getWritePointer(channel);
+    auto* work = scratch.getWritePointer(0);
+
+    float peak = 0.0f;
+    float truePeak = 0.0f;
+    double squares = 0.0;
+
+    // Blocks larger than announced are measured in prepared-size pieces
+    for (int start = 0; start < numSamples;)
+    {
+        int count = juce::jmin(numSamples - start, chunkSize);
+        const float* in = samples + start;
+
+        peak = juce::jmax(peak, absoluteMax(in, count));
+
+        juce::FloatVectorOperations::multiply(work, in, in, count);
+        squares += sumOf(work, count);
+
+        // Interpolated phases: each output is a dot product over the line, done tap by tap across the chunk
+        juce::FloatVectorOperations::copy(line + historySamples, in, count);
+        for (int p = 1; p < oversampling; ++p)
+        {
+            const auto& phase = coefficients[(size_t)p];
+            juce::FloatVectorOperations::clear(work, count);
+            for (int k = 0; k < tapsPerPhase; ++k)
+                juce::FloatVectorOperations::addWithMultiply(work, line + k, phase[(size_t)k], count);
+
+            truePeak = juce::jmax(truePeak, absoluteMax(work, count));
+        }
+        std::copy(line + count, line + count + historySamples, line);
+
+        start += count;
+    }
+
+    peak *= gain;
+    truePeak = juce::jmax(peak, truePeak * gain);
+
+    heldPeak[(size_t)channel] = juce::jmax(heldPeak[(size_t)channel], peak);
+    heldTruePeak[(size_t)channel] = juce::jmax(heldTruePeak[(size_t)channel], truePeak);
+    blockSquares[(size_t)channel] = squares * (double)gain * (double)gain;
+    blockOver = blockOver || truePeak > 1.0f;
+}
+
+void LevelMeter::publish(int numChannels, int numSamples)
+{
+    // One-pole integration, stepped once per block
+    double coefficient = 1.0 - std::exp(-(double)numSamples / (rmsSeconds * sampleRate));
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        double blockMeanSquare = numSamples > 0 ? blockSquares[(size_t)ch] / (double)numSamples : 0.0;
+        meanSquare[(size_t)ch] += (blockMeanSquare - meanSquare[(size_t)ch]) * coefficient;
+    }
+
+    if (blockOver)
+        ++overs;
+
+    auto seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    publishedChannels.store(numChannels, std::memory_order_relaxed);
+    for (int ch = 0; ch < maxChannels; ++ch)
+    {
+        bool used = ch < numChannels;
+        publishedPeak[(size_t)ch].store(used ? heldPeak[(size_t)ch] : 0.0f, std::memory_order_relaxed);
+        publishedTruePeak[(size_t)ch].store(used ? heldTruePeak[(size_t)ch] : 0.0f, std::memory_order_relaxed);
+        publishedRms[(size_t)ch].store(used ? (float)std::sqrt(meanSquare[(size_t)ch]) : 0.0f, std::memory_order_relaxed);
+    }
+    publishedOvers.store(overs, std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+    lastPublished = seq + 2;
+}
+
+bool LevelMeter::read(Reading& reading)
+{
+    // A few tries; if the writer keeps overwriting, the next frame will do
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        auto before = sequence.load(std::memory_order_acquire);
+        if (before == 0)
+            return false;
+        if ((before & 1) != 0)
+            continue;
+
+        reading.numChannels = publishedChannels.load(std::memory_order_relaxed);
+        for (int ch = 0; ch < maxChannels; ++ch)
+        {
+            reading.peak[(size_t)ch] = publishedPeak[(size_t)ch].load(std::memory_order_relaxed);
+            reading.truePeak[(size_t)ch] = publishedTruePeak[(size_t)ch].load(std::memory_order_relaxed);
+            reading.rms[(size_t)ch] = publishedRms[(size_t)ch].load(std::memory_order_relaxed);
+        }
+        reading.overs = publishedOvers.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+        {
+            consumed.store(before, std::memory_order_release);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace pianodaw
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+namespace pianodaw {
+
+/**
+ * LevelMeter - Peak, RMS and true-peak metering published lock-free to the UI
+ *
+ * The audio thread measures each block with vector operations: sample peak
+ * from a min/max scan, mean square for an RMS with rmsSeconds integration,
+ * and true peak (ITU-R BS.1770 style) from 4x polyphase windowed-sinc
+ * interpolation between samples. Results are published every block as a
+ * seqlock-guarded snapshot of atomics. Peaks are held until the UI has read
+ * them, so short overs between two display frames are never missed.
+ *
+ * One writer (whichever thread renders the signal) and one reader (the
+ * message thread, at display rate).
+ */
+class LevelMeter
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr double rmsSeconds = 0.3;
+
+    struct Reading
+    {
+        int numChannels = 0;
+        std::array<float, maxChannels> peak {};       // Linear, highest since the last read
+        std::array<float, maxChannels> truePeak {};   // Linear, highest since the last read
+        std::array<float, maxChannels> rms {};        // Linear, current
+        juce::uint32 overs = 0;                       // Blocks that went over 0 dBTP since prepare()
+    };
+
+    LevelMeter();
+
+    /** Allocate scratch and clear the history (meter not in use) */
+    void prepare(double sampleRate, int blockSize);
+
+    // === Audio thread ===
+
+    /**
+     * Measure numSamples of buffer, as heard after the given per-side gains
+     * (a track's fader and pan, so its meter is post-fader)
+     */
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples, float gainLeft = 1.0f, float gainRight = 1.0f);
+    void process(const juce::AudioBuffer<double>& buffer, int numSamples);
+
+    /** A block without output: the RMS falls and zero peaks are published */
+    void processSilence(int numSamples);
+
+    // === Message thread ===
+
+    /** Latest snapshot; false until the first block was measured */
+    bool read(Reading& reading);
+
+private:
+    void beginBlock();
+    void measure(int channel, const float* samples, int numSamples, float gain);
+    void publish(int numChannels, int numSamples);
+
+    // Audio thread
+    juce::AudioBuffer<float> lines;      // Per channel: tapsPerPhase - 1 samples of history + one chunk
+    juce::AudioBuffer<float> scratch;    // Squares / interpolated phase / double->float conversion
+    std::array<std::array<float, tapsPerPhase>, oversampling> coefficients {};
+    std::array<float, maxChannels> heldPeak {}, heldTruePeak {};
+    std::array<double, maxChannels> meanSquare {};
+    std::array<double, maxChannels> blockSquares {};
+    double sampleRate = 44100.0;
+    int chunkSize = 0;
+    juce::uint32 overs = 0;
+    bool blockOver = false;
+    juce::uint32 lastPublished = 0;
+
+    // Audio thread -> message thread
+    std::atomic<juce::uint32> sequence { 0 };          // Odd while a snapshot is being written
+    std::atomic<int> publishedChannels { 0 };
+    std::array<std::atomic<float>, maxChannels> publishedPeak {}, publishedTruePeak {}, publishedRms {};
+    std::atomic<juce::uint32> publishedOvers { 0 };
+
+    // Message thread -> audio thread: the snapshot whose peaks were consumed
+    std::atomic<juce::uint32> consumed { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LevelMeter)
+};
+
+} // namespace pianodaw
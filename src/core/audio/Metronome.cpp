@@ -0,0 +1,176 @@
+#include "Metronome.h"
+#include "TrackChain.h"
+#include "../timeline/PPQ.h"
+#include <cmath>
+
+namespace pianodaw {
+
+namespace
+{
+    void renderClick(juce::AudioBuffer<float>& click, double sampleRate, double frequency, float gain)
+    {
+        int length = juce::jmax(1, juce::roundToInt(Metronome::clickSeconds * sampleRate));
+        click.setSize(1, length);
+
+        // A short sine burst: 1 ms attack so it doesn't pop, then an exponential decay to silence
+        auto* data = click.getWritePointer(0);
+        double attack = 0.001 * sampleRate;
+        for (int i = 0; i < length; ++i)
+        {
+            double envelope = juce::jmin(1.0, i / attack) * std::exp(-6.0 * i / length);
+            data[i] = gain * (float)(envelope * std::sin(juce::MathConstants<double>::twoPi * frequency * i / sampleRate));
+        }
+    }
+
+    int64_t floorDiv(int64_t value, int64_t divisor)
+    {
+        auto quotient = value / divisor;
+        return (value % divisor != 0 && value < 0) ? quotient - 1 : quotient;
+    }
+}
+
+void Metronome::prepare(double newSampleRate, int blockSize)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+
+    renderClick(accentClick, sampleRate, 1760.0, 1.0f);
+    renderClick(beatClick, sampleRate, 1320.0, 0.7f);
+
+    block.setSize(1, juce::jmax(1, blockSize));
+    block.clear();
+    compensation.prepare(1, juce::roundToInt(TrackChain::maxCompensationSeconds * sampleRate), blockSize);
+
+    ringing = nullptr;
+    ringPosition = 0;
+    countingIn.store(false);
+}
+
+void Metronome::requestCountIn(int bars, int64_t startTick)
+{
+    countInBars.store(juce::jlimit(0, maxCountInBars, bars));
+    countInTick.store(startTick);
+    countInPending.store(bars > 0);
+}
+
+void Metronome::beginBlock(int numSamples)
+{
+    // The clicks for this block are mixed here first, then delayed by the compensation
+    block.setSize(1, numSamples, false, false, true);
+    block.clear(0, numSamples);
+    blockSamples = numSamples;
+    cursor = 0;
+}
+
+int Metronome::countIn(bool transportPlaying, int numSamples, double tempoBPM, int beatsPerBar, int beatTicks)
+{
+    // Stopped during the count-in: forget it (a request made just before the start is kept)
+    if (!transportPlaying)
+    {
+        countingIn.store(false);
+        return 0;
+    }
+
+    if (countInPending.exchange(false))
+    {
+        samplesPerCountInBeat = 60.0 / tempoBPM * sampleRate * beatTicks / PPQ::TICKS_PER_QUARTER;
+        countInBeatsPerBar = juce::jmax(1, beatsPerBar);
+        countInLength = juce::roundToInt(countInBars.load() * countInBeatsPerBar * samplesPerCountInBeat);
+        countInElapsed = 0;
+        countingIn.store(countInLength > 0);
+    }
+
+    if (!countingIn.load())
+        return 0;
+
+    // Beats whose onset falls into this block, in order
+    auto numBeats = (int64_t)countInBars.load() * countInBeatsPerBar;
+    for (auto beat = (int64_t)std::ceil(countInElapsed / samplesPerCountInBeat); beat < numBeats; ++beat)
+    {
+        auto onset = (int64_t)std::llround(beat * samplesPerCountInBeat);
+        if (onset >= countInElapsed + numSamples)
+            break;
+        if (onset >= countInElapsed)
+            startClick((int)(onset - countInElapsed), beat % countInBeatsPerBar == 0);
+    }
+
+    auto remaining = countInLength - countInElapsed;
+    countInElapsed += numSamples;
+
+    if (remaining > numSamples)
+        return numSamples;
+
+    countingIn.store(false);
+    return (int)juce::jmax((int64_t)0, remaining);
+}
+
+void Metronome::render(const BlockTickWindow* windows, int numWindows, int beatsPerBar, int beatTicks)
+{
+    if (!enabled.load() || beatTicks <= 0)
+        return;
+
+    for (int w = 0; w < numWindows; ++w)
+    {
+        const auto& window = windows[w];
+
+        // The first beat at or after the window start; nothing before the song starts
+        auto beat = juce::jmax((int64_t)0, floorDiv(window.startTick + beatTicks - 1, beatTicks));
+        for (auto tick = beat * beatTicks; tick < window.endTick; tick += beatTicks, ++beat)
+            startClick(window.sampleOffsetFor(tick), beat % juce::jmax(1, beatsPerBar) == 0);
+    }
+}
+
+void Metronome::startClick(int offset, bool accent)
+{
+    offset = juce::jlimit(cursor, blockSamples, offset);
+    playUntil(offset);
+
+    ringing = accent ? &accentClick : &beatClick;
+    ringPosition = 0;
+}
+
+void Metronome::playUntil(int end)
+{
+    if (ringing != nullptr && end > cursor)
+    {
+        int count = juce::jmin(end - cursor, ringing->getNumSamples() - ringPosition);
+        block.copyFrom(0, cursor, *ringing, 0, ringPosition, count);
+        ringPosition += count;
+
+        if (ringPosition >= ringing->getNumSamples())
+            ringing = nullptr;
+    }
+
+    cursor = juce::jmax(cursor, end);
+}
+
+void Metronome::addTo(juce::AudioBuffer<float>& dest, int numSamples, int delaySamples)
+{
+    mixInto(dest, numSamples, delaySamples);
+}
+
+void Metronome::addTo(juce::AudioBuffer<double>& dest, int numSamples, int delaySamples)
+{
+    mixInto(dest, numSamples, delaySamples);
+}
+
+template <typename SampleType>
+void Metronome::mixInto(juce::AudioBuffer<SampleType>& dest, int numSamples, int delaySamples)
+{
+    playUntil(numSamples);
+
+    // Always run, so the history stays current while the clicks are off
+    compensation.setDelay(delaySamples);
+    compensation.process(block, numSamples);
+
+    auto gain = level.load();
+    const auto* clicks = block.getReadPointer(0);
+
+    for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+    {
+        auto* out = dest.getWritePointer(ch);
+        for (int i = 0; i < numSamples; ++i)
+            out[i] += (SampleType)(clicks[i] * gain);
+    }
+}
+
+} // namespace pianodaw
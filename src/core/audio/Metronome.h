@@ -0,0 +1,102 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "DelayLine.h"
+#include "../timeline/SamplePlayhead.h"
+#include <atomic>
+
+namespace pianodaw {
+
+/**
+ * Metronome - Click track and count-in, placed at exact sample offsets
+ *
+ * Two clicks (accented for bar starts) are rendered once in prepare() and
+ * copied into a preallocated block buffer at the sample offsets of the
+ * beats inside the block's tick windows, so a click lands on its beat
+ * whatever the block size. Like the tracks, the clicks are sequenced ahead
+ * by the path latency and delayed back by it before they reach the output.
+ *
+ * A count-in requested on the message thread runs on the sample clock
+ * before the playhead starts: countIn() reports where in the block the
+ * downbeat falls, and the engine starts playback (and recording) exactly
+ * there.
+ */
+class Metronome
+{
+public:
+    static constexpr double clickSeconds = 0.03;
+    static constexpr int maxCountInBars = 4;
+
+    Metronome() = default;
+
+    /** Render the clicks and size the block buffer (audio stopped) */
+    void prepare(double sampleRate, int blockSize);
+
+    // === Message thread ===
+
+    void setEnabled(bool shouldClick) { enabled.store(shouldClick); }
+    bool isEnabled() const { return enabled.load(); }
+
+    /** Linear gain of the clicks */
+    void setLevel(float newLevel) { level.store(juce::jlimit(0.0f, 2.0f, newLevel)); }
+    float getLevel() const { return level.load(); }
+
+    /** Count in this many bars before the next start from stopped, which will be at startTick */
+    void requestCountIn(int bars, int64_t startTick);
+    bool isCountingIn() const { return countInPending.load() || countingIn.load(); }
+
+    // === Audio thread ===
+
+    /** Start of a block: clears the block buffer and lets the previous click ring on */
+    void beginBlock(int numSamples);
+
+    /**
+     * Advance the count-in by one block (transportPlaying false cancels it)
+     * @return Samples of this block before the downbeat (numSamples while the whole block counts in)
+     */
+    int countIn(bool transportPlaying, int numSamples, double tempoBPM, int beatsPerBar, int beatTicks);
+
+    /** Tick the count-in leads into (the playhead syncs to it at the downbeat) */
+    int64_t getCountInTick() const { return countInTick.load(std::memory_order_relaxed); }
+
+    /** Clicks for the beats inside the windows (nothing while disabled) */
+    void render(const BlockTickWindow* windows, int numWindows, int beatsPerBar, int beatTicks);
+
+    /** Finish the block, delay it by delaySamples and add it to every channel of dest */
+    void addTo(juce::AudioBuffer<float>& dest, int numSamples, int delaySamples);
+    void addTo(juce::AudioBuffer<double>& dest, int numSamples, int delaySamples);
+
+private:
+    /** Let the ringing click play up to offset, then start the next one there */
+    void startClick(int offset, bool accent);
+    void playUntil(int end);
+
+    template <typename SampleType>
+    void mixInto(juce::AudioBuffer<SampleType>& dest, int numSamples, int delaySamples);
+
+    double sampleRate = 44100.0;
+    juce::AudioBuffer<float> accentClick, beatClick;
+    juce::AudioBuffer<float> block;      // Mono, this block's clicks
+    DelayLine compensation;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<float> level { 0.5f };
+    std::atomic<int> countInBars { 0 };
+    std::atomic<bool> countInPending { false };
+    std::atomic<bool> countingIn { false };
+    std::atomic<int64_t> countInTick { 0 };
+
+    // Audio thread
+    const juce::AudioBuffer<float>* ringing = nullptr;
+    int ringPosition = 0;
+    int cursor = 0;                      // Block samples before this are written
+    int blockSamples = 0;
+    int64_t countInElapsed = 0;          // Samples since the count-in started
+    int64_t countInLength = 0;
+    double samplesPerCountInBeat = 0.0;
+    int countInBeatsPerBar = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Metronome)
+};
+
+} // namespace pianodaw
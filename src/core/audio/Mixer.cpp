@@ -0,0 +1,258 @@
+#include "Mixer.h"
+#include "AutomationEvaluator.h"
+#include "../model/Automation.h"
+#include "../model/Track.h"
+
+namespace pianodaw {
+
+void addScaled(float* dest, const float* source, float gain, int numSamples)
+{
+    if (gain == 1.0f)
+        juce::FloatVectorOperations::add(dest, source, numSamples);
+    else if (gain != 0.0f)
+        juce::FloatVectorOperations::addWithMultiply(dest, source, gain, numSamples);
+}
+
+void addScaled(double* dest, const float* source, float gain, int numSamples)
+{
+    if (gain == 0.0f)
+        return;
+
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] += (double)source[i] * (double)gain;
+}
+
+void addScaled(float* dest, const float* source, const float* gains, int numSamples)
+{
+    juce::FloatVectorOperations::addWithMultiply(dest, source, gains, numSamples);
+}
+
+void addScaled(double* dest, const float* source, const float* gains, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+        dest[i] += (double)source[i] * (double)gains[i];
+}
+
+//==============================================================================
+
+void ChannelStrip::prepare(double sampleRate, int blockSize)
+{
+    leftGain.reset(sampleRate, rampSeconds);
+    rightGain.reset(sampleRate, rampSeconds);
+    audibleGain.reset(sampleRate, rampSeconds);
+    ramps.setSize(2, juce::jmax(1, blockSize));
+    curves.setSize(2, juce::jmax(1, blockSize));
+    automated = false;
+}
+
+void ChannelStrip::setTarget(float newVolume, float newPan, bool audible)
+{
+    volume = newVolume;
+    pan = newPan;
+    automated = false;
+
+    float gain = audible ? volume : 0.0f;
+    leftGain.setTargetValue(gain * juce::jmin(1.0f, 1.0f - pan));
+    rightGain.setTargetValue(gain * juce::jmin(1.0f, 1.0f + pan));
+    audibleGain.setTargetValue(audible ? 1.0f : 0.0f);
+}
+
+void ChannelStrip::automate(const AutomationLane* volumeLane, const AutomationLane* panLane,
+                            const BlockTickWindow* windows, int numWindows, int64_t holdTick, int numSamples)
+{
+    if ((volumeLane == nullptr && panLane == nullptr) || numSamples <= 0)
+        return;
+
+    ramps.setSize(2, numSamples, false, false, true);
+    curves.setSize(2, numSamples, false, false, true);
+
+    auto* volumes = curves.getWritePointer(0);
+    auto* pans = curves.getWritePointer(1);
+    auto* left = ramps.getWritePointer(0);
+    auto* right = ramps.getWritePointer(1);
+
+    if (volumeLane != nullptr)
+        AutomationEvaluator::renderCurve(*volumeLane, windows, numWindows, holdTick, volumes, numSamples);
+    else
+        juce::FloatVectorOperations::fill(volumes, volume, numSamples);
+
+    // Balance law as in setTarget(): left = volume * min(1, 1 - pan), right = volume * min(1, 1 + pan)
+    if (panLane != nullptr)
+    {
+        AutomationEvaluator::renderCurve(*panLane, windows, numWindows, holdTick, pans, numSamples);
+        juce::FloatVectorOperations::multiply(pans, 2.0f, numSamples);
+        juce::FloatVectorOperations::add(pans, -1.0f, numSamples);
+
+        juce::FloatVectorOperations::negate(left, pans, numSamples);
+        juce::FloatVectorOperations::add(left, 1.0f, numSamples);
+        juce::FloatVectorOperations::min(left, left, 1.0f, numSamples);
+        juce::FloatVectorOperations::multiply(left, volumes, numSamples);
+
+        juce::FloatVectorOperations::copy(right, pans, numSamples);
+        juce::FloatVectorOperations::add(right, 1.0f, numSamples);
+        juce::FloatVectorOperations::min(right, right, 1.0f, numSamples);
+        juce::FloatVectorOperations::multiply(right, volumes, numSamples);
+    }
+    else
+    {
+        juce::FloatVectorOperations::multiply(left, volumes, juce::jmin(1.0f, 1.0f - pan), numSamples);
+        juce::FloatVectorOperations::multiply(right, volumes, juce::jmin(1.0f, 1.0f + pan), numSamples);
+    }
+
+    // Mute/solo still fade, on top of the automation
+    if (audibleGain.isSmoothing())
+    {
+        for (int i = 0; i < numSamples; ++i)
+            volumes[i] = audibleGain.getNextValue();
+        juce::FloatVectorOperations::multiply(left, volumes, numSamples);
+        juce::FloatVectorOperations::multiply(right, volumes, numSamples);
+    }
+    else if (audibleGain.getTargetValue() == 0.0f)
+    {
+        juce::FloatVectorOperations::clear(left, numSamples);
+        juce::FloatVectorOperations::clear(right, numSamples);
+    }
+
+    // Static blocks after this one ramp on from where the automation ended
+    leftGain.setCurrentAndTargetValue(left[numSamples - 1]);
+    rightGain.setCurrentAndTargetValue(right[numSamples - 1]);
+    automated = true;
+}
+
+template <typename DestType>
+void ChannelStrip::mixInto(const juce::AudioBuffer<float>& source, juce::AudioBuffer<DestType>& dest, int numSamples)
+{
+    int numChannels = juce::jmin(source.getNumChannels(), dest.getNumChannels());
+
+    if (automated)
+    {
+        automated = false;
+        for (int ch = 0; ch < numChannels; ++ch)
+            addScaled(dest.getWritePointer(ch), source.getReadPointer(ch), ramps.getReadPointer(ch & 1), numSamples);
+        return;
+    }
+
+    audibleGain.skip(numSamples);
+    juce::LinearSmoothedValue<float>* gains[] = { &leftGain, &rightGain };
+
+    // Blocks larger than announced are mixed in ramp-sized pieces
+    for (int start = 0; start < numSamples;)
+    {
+        int count = juce::jmin(numSamples - start, ramps.getNumSamples());
+        const float* ramp[2] = { nullptr, nullptr };
+        float constant[2] = { 0.0f, 0.0f };
+
+        for (int side = 0; side < 2; ++side)
+        {
+            auto& gain = *gains[side];
+
+            if (gain.isSmoothing())
+            {
+                auto* values = ramps.getWritePointer(side);
+                for (int i = 0; i < count; ++i)
+                    values[i] = gain.getNextValue();
+                ramp[side] = values;
+            }
+            else
+            {
+                constant[side] = gain.getTargetValue();
+            }
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            int side = ch & 1;
+            auto* out = dest.getWritePointer(ch, start);
+            auto* in = source.getReadPointer(ch, start);
+
+            if (ramp[side] != nullptr)
+                addScaled(out, in, ramp[side], count);
+            else
+                addScaled(out, in, constant[side], count);
+        }
+
+        start += count;
+    }
+}
+
+template void ChannelStrip::mixInto(const juce::AudioBuffer<float>&, juce::AudioBuffer<float>&, int);
+template void ChannelStrip::mixInto(const juce::AudioBuffer<float>&, juce::AudioBuffer<double>&, int);
+
+//==============================================================================
+
+Mixer::Mixer()
+{
+    activeMask.reserve(reservedTracks);
+    soloMask.reserve(reservedTracks);
+    parents.reserve(reservedTracks);
+}
+
+void Mixer::resolveRouting(const std::vector<std::unique_ptr<Track>>& tracks)
+{
+    size_t numTracks = tracks.size();
+    parents.resize(numTracks);
+
+    // Quadratic, but arrangements have tens of tracks, not thousands
+    for (size_t i = 0; i < numTracks; ++i)
+    {
+        parents[i] = -1;
+        int busUid = tracks[i]->getOutputUid();
+        if (busUid == 0)
+            continue;
+
+        for (size_t j = 0; j < numTracks; ++j)
+        {
+            if (j != i && tracks[j]->getUid() == busUid && tracks[j]->isBus())
+            {
+                parents[i] = (int)j;
+                break;
+            }
+        }
+    }
+
+    // A walk longer than the track count has run into a loop
+    for (size_t i = 0; i < numTracks; ++i)
+    {
+        size_t steps = 0;
+        for (int p = parents[i]; p >= 0 && steps <= numTracks; p = parents[(size_t)p])
+            ++steps;
+
+        if (steps > numTracks)
+            parents[i] = -1;
+    }
+}
+
+void Mixer::beginBlock(const std::vector<std::unique_ptr<Track>>& tracks)
+{
+    size_t numTracks = tracks.size();
+    resolveRouting(tracks);
+
+    soloActive = false;
+    for (const auto& track : tracks)
+        soloActive = soloActive || track->isSolo();
+
+    soloMask.assign(numTracks, 0);
+    if (soloActive)
+    {
+        for (size_t i = 0; i < numTracks; ++i)
+        {
+            bool underSoloedBus = false;
+            for (int p = parents[i]; p >= 0; p = parents[(size_t)p])
+                underSoloedBus = underSoloedBus || tracks[(size_t)p]->isSolo();
+
+            if (!tracks[i]->isSolo() && !underSoloedBus)
+                continue;
+
+            // The track and every bus it feeds
+            soloMask[i] = 1;
+            for (int p = parents[i]; p >= 0; p = parents[(size_t)p])
+                soloMask[(size_t)p] = 1;
+        }
+    }
+
+    activeMask.resize(numTracks);
+    for (size_t i = 0; i < numTracks; ++i)
+        activeMask[i] = !tracks[i]->isMuted() && (!soloActive || soloMask[i] != 0) ? 1 : 0;
+}
+
+} // namespace pianodaw
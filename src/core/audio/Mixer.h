@@ -0,0 +1,108 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+class AutomationLane;
+class Track;
+struct BlockTickWindow;
+
+/** dest += source * gain, also into a 64-bit master (FloatVectorOperations can't mix sample types) */
+void addScaled(float* dest, const float* source, float gain, int numSamples);
+void addScaled(double* dest, const float* source, float gain, int numSamples);
+
+/** dest += source * gains[i] */
+void addScaled(float* dest, const float* source, const float* gains, int numSamples);
+void addScaled(double* dest, const float* source, const float* gains, int numSamples);
+
+/**
+ * ChannelStrip - A track's volume and pan, applied while summing into the master bus
+ *
+ * Gains ramp linearly to new targets over rampSeconds, so moving a fader or
+ * toggling mute/solo never clicks. Automated blocks take per-sample gains
+ * from the lanes instead, computed with vector operations. Pan is a
+ * balance law with unity at the centre: even channels take the left gain,
+ * odd channels the right one.
+ * Scratch is sized in prepare(); mixInto() never allocates.
+ */
+class ChannelStrip
+{
+public:
+    static constexpr double rampSeconds = 0.02;
+
+    ChannelStrip() = default;
+
+    void prepare(double sampleRate, int blockSize);
+
+    /** Audio thread: gains to ramp towards (audible false fades the track out) */
+    void setTarget(float volume, float pan, bool audible);
+
+    /**
+     * Audio thread, after setTarget(): this block's volume and/or pan follow
+     * automation lanes (nullptr keeps the setTarget value); the next
+     * mixInto() applies them per sample
+     */
+    void automate(const AutomationLane* volumeLane, const AutomationLane* panLane,
+                  const BlockTickWindow* windows, int numWindows, int64_t holdTick, int numSamples);
+
+    /** Audio thread: add numSamples of source into dest at the strip's gains */
+    template <typename DestType>
+    void mixInto(const juce::AudioBuffer<float>& source, juce::AudioBuffer<DestType>& dest, int numSamples);
+
+    /** Audio thread: gain the last mixInto() ended on (side 0 = left) */
+    float getGain(int side) const { return side == 0 ? leftGain.getCurrentValue() : rightGain.getCurrentValue(); }
+
+private:
+    juce::LinearSmoothedValue<float> leftGain, rightGain;
+    juce::LinearSmoothedValue<float> audibleGain;   // Mute/solo fade, applied on top of automation
+    juce::AudioBuffer<float> ramps;   // One ramp per side, block-sized
+    juce::AudioBuffer<float> curves;  // Automated volume and pan, block-sized
+    float volume = 1.0f, pan = 0.0f;  // Last setTarget()
+    bool automated = false;           // ramps hold this block's gains
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelStrip)
+};
+
+/**
+ * Mixer - Works out which tracks are audible in a block, and where they go
+ *
+ * Builds the active-track mask (not muted, and soloed when any track is)
+ * once per block, so the sequencer and the channel strips don't each
+ * re-scan the project for solos. Solo follows the bus routing: soloing a
+ * group keeps its children audible, and soloing a child keeps the buses it
+ * feeds audible. Routing loops are broken by sending the track to the master.
+ */
+class Mixer
+{
+public:
+    /** More tracks than this grow the mask once, on the audio thread */
+    static constexpr int reservedTracks = 256;
+
+    Mixer();
+
+    /** Audio thread, project lock held: refresh the mask for this block */
+    void beginBlock(const std::vector<std::unique_ptr<Track>>& tracks);
+
+    /** Track at this project index may be heard this block */
+    bool isActive(size_t trackIndex) const { return trackIndex < activeMask.size() && activeMask[trackIndex] != 0; }
+
+    bool hasSolo() const { return soloActive; }
+
+    /** Project index of the bus the track at trackIndex sums into, or -1 for the master */
+    int getParentIndex(size_t trackIndex) const { return trackIndex < parents.size() ? parents[trackIndex] : -1; }
+
+private:
+    void resolveRouting(const std::vector<std::unique_ptr<Track>>& tracks);
+
+    std::vector<juce::uint8> activeMask;
+    std::vector<juce::uint8> soloMask;
+    std::vector<int> parents;
+    bool soloActive = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Mixer)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,138 @@
+#include "ParameterAutomation.h"
+#include "GraphSwapper.h"
+#include "../model/Track.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pianodaw {
+
+void ParameterAutomation::bind(juce::AudioProcessor* instrument)
+{
+    parameters.clear();
+    if (instrument != nullptr)
+        parameters = instrument->getParameters();
+
+    sentValues.assign((size_t)parameters.size(), -1.0f);
+}
+
+void ParameterAutomation::sequence(const Track& track, const BlockTickWindow* windows, int numWindows, Changes& changes)
+{
+    int step = getGranularity();
+
+    for (const auto& lane : track.getAutomationLanes())
+    {
+        if (lane->getTarget() != AutomationLane::Target::PluginParameter || !lane->isEnabled() || lane->isEmpty())
+            continue;
+
+        const auto& points = lane->getPoints();
+        int numPoints = (int)points.size();
+        float last = -1.0f;
+
+        for (int w = 0; w < numWindows; ++w)
+        {
+            const auto& window = windows[w];
+            if (window.numSamples <= 0)
+                continue;
+
+            double startTick = window.exactStartTick;
+            double ticksPerSample = ((double)window.endTick - startTick) / window.numSamples;
+            int segment = lane->findPoint((int64_t)std::floor(startTick));
+
+            for (int s = 0; s < window.numSamples;)
+            {
+                double tick = startTick + s * ticksPerSample;
+                while (segment + 1 < numPoints && (double)points[(size_t)segment + 1].tick <= tick)
+                    ++segment;
+
+                float value = lane->getValueAt(tick, segment);
+                if (value != last)
+                    changes.add(window.startSample + s, lane->getParameterIndex(), value);
+                last = value;
+
+                // Next breakpoint; a ramp also steps every granularity samples, a flat stretch jumps straight there
+                int next = window.numSamples;
+                if (segment + 1 < numPoints && ticksPerSample > 0.0)
+                {
+                    auto toBreakpoint = std::ceil(((double)points[(size_t)segment + 1].tick - startTick) / ticksPerSample);
+                    next = (int)juce::jlimit((double)s + 1, (double)window.numSamples, toBreakpoint);
+                }
+
+                bool ramp = segment >= 0 && segment + 1 < numPoints
+                         && points[(size_t)segment].value != points[(size_t)segment + 1].value;
+                if (ramp)
+                    next = juce::jmin(next, (s / step + 1) * step);
+
+                s = next;
+            }
+        }
+    }
+}
+
+template <typename ProcessPiece>
+bool ParameterAutomation::renderPieces(ProcessPiece&& processPiece, juce::AudioBuffer<float>& buffer, int numSamples,
+                                       juce::MidiBuffer& midi, Changes& changes)
+{
+    auto& list = changes.getChanges();
+    if (list.empty())
+        return processPiece(buffer, midi);
+
+    // Lanes were sequenced one after another; std::sort works in place
+    std::sort(list.begin(), list.end(), [](const Change& a, const Change& b) { return a.sampleOffset < b.sampleOffset; });
+
+    bool live = true;
+    size_t next = 0;
+
+    for (int start = 0; start < numSamples;)
+    {
+        while (next < list.size() && list[next].sampleOffset <= start)
+            apply(list[next++]);
+
+        int end = next < list.size() ? juce::jmin(numSamples, list[next].sampleOffset) : numSamples;
+
+        // A view of the block's channels (no allocation) and its MIDI moved to the piece's start
+        juce::AudioBuffer<float> piece(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, end - start);
+        pieceMidi.clear();
+        pieceMidi.addEvents(midi, start, end - start, -start);
+
+        live = processPiece(piece, pieceMidi) && live;
+        start = end;
+    }
+
+    changes.clear();
+    return live;
+}
+
+bool ParameterAutomation::render(GraphSwapper& instrument, juce::AudioBuffer<float>& buffer, int numSamples,
+                                 juce::MidiBuffer& midi, Changes& changes)
+{
+    return renderPieces([&instrument](juce::AudioBuffer<float>& audio, juce::MidiBuffer& events)
+                        { return instrument.process(audio, events); },
+                        buffer, numSamples, midi, changes);
+}
+
+void ParameterAutomation::render(juce::AudioProcessor& processor, juce::AudioBuffer<float>& buffer, int numSamples,
+                                 juce::MidiBuffer& midi, Changes& changes)
+{
+    renderPieces([&processor](juce::AudioBuffer<float>& audio, juce::MidiBuffer& events)
+                 { processor.processBlock(audio, events); return true; },
+                 buffer, numSamples, midi, changes);
+}
+
+void ParameterAutomation::apply(const Change& change)
+{
+    if (change.parameterIndex < 0 || change.parameterIndex >= parameters.size())
+        return;
+
+    auto& sent = sentValues[(size_t)change.parameterIndex];
+    if (sent == change.value)
+    {
+        coalesced.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Not setValueNotifyingHost: listeners may lock or allocate; the plugin picks the value up when it processes
+    parameters.getUnchecked(change.parameterIndex)->setValue(change.value);
+    sent = change.value;
+}
+
+} // namespace pianodaw
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "../timeline/SamplePlayhead.h"
+#include <atomic>
+#include <vector>
+
+namespace pianodaw {
+
+class GraphSwapper;
+class Track;
+
+/**
+ * ParameterAutomation - Delivers a track's plugin parameter lanes to its instrument
+ *
+ * Sequencing turns the lanes into a block's list of (sample offset,
+ * parameter, value) changes alongside the MIDI: a change at every
+ * breakpoint and, on ramps, at most one every granularity samples. A value
+ * equal to the last one sent for that lane is dropped, so flat stretches
+ * cost nothing. Rendering then splits the block at the changes and sets the
+ * parameters right before the piece they belong to.
+ *
+ * The instrument's parameters are cached by index when it is bound, so a
+ * block never searches the plugin for them; the cache and the values last
+ * sent are only touched with the chain's render lock held.
+ */
+class ParameterAutomation
+{
+public:
+    static constexpr int maxChanges = 1024;
+    static constexpr int defaultGranularity = 32;
+
+    struct Change
+    {
+        int sampleOffset = 0;
+        int parameterIndex = 0;
+        float value = 0.0f;
+    };
+
+    /** One block's changes (storage reserved up front; extra changes are dropped) */
+    class Changes
+    {
+    public:
+        Changes() { changes.reserve(maxChanges); }
+
+        void clear() { changes.clear(); }
+        bool isEmpty() const { return changes.empty(); }
+        void add(int sampleOffset, int parameterIndex, float value)
+        {
+            if ((int)changes.size() < maxChanges)
+                changes.push_back({ sampleOffset, parameterIndex, value });
+        }
+
+        std::vector<Change>& getChanges() { return changes; }
+
+    private:
+        std::vector<Change> changes;
+    };
+
+    ParameterAutomation() { pieceMidi.ensureSize(1024); }
+
+    /** Ramp step in samples, for every chain (applies from the next block) */
+    static void setGranularity(int samples) { granularity.store(juce::jlimit(1, 4096, samples)); }
+    static int getGranularity() { return granularity.load(); }
+
+    /** Render lock held: cache the instrument's parameters (nullptr clears) */
+    void bind(juce::AudioProcessor* instrument);
+
+    /** Sequencing, project lock held: add the changes of the track's parameter lanes within the windows */
+    static void sequence(const Track& track, const BlockTickWindow* windows, int numWindows, Changes& changes);
+
+    /**
+     * Render lock held: render numSamples of buffer in pieces split at the changes, then clear them
+     * @return false when no instrument is live
+     */
+    bool render(GraphSwapper& instrument, juce::AudioBuffer<float>& buffer, int numSamples,
+                juce::MidiBuffer& midi, Changes& changes);
+
+    /** The same for offline renders (freeze, bounce), straight into the processor holding the bound instrument */
+    void render(juce::AudioProcessor& processor, juce::AudioBuffer<float>& buffer, int numSamples,
+                juce::MidiBuffer& midi, Changes& changes);
+
+    /** Parameter updates skipped because the plugin already had the value */
+    juce::uint32 getNumCoalesced() const { return coalesced.load(std::memory_order_relaxed); }
+
+private:
+    template <typename ProcessPiece>
+    bool renderPieces(ProcessPiece&& processPiece, juce::AudioBuffer<float>& buffer, int numSamples,
+                      juce::MidiBuffer& midi, Changes& changes);
+
+    void apply(const Change& change);
+
+    inline static std::atomic<int> granularity { defaultGranularity };
+
+    juce::Array<juce::AudioProcessorParameter*> parameters;
+    std::vector<float> sentValues;           // -1 = not sent since bind()
+    juce::MidiBuffer pieceMidi;
+    std::atomic<juce::uint32> coalesced { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterAutomation)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,250 @@
+#include "PartitionedConvolver.h"
+#include <algorithm>
+#include <array>
+
+namespace pianodaw {
+
+namespace
+{
+    // Partition sizes along the response; the first is also the direct-form head
+    constexpr std::array<int, 3> stageSizes { PartitionedConvolver::headSize, 512, 4096 };
+
+    /** acc += a * b, complex, for spectra in split layout (numBins reals, then numBins imaginaries) */
+    void multiplyAccumulate(float* acc, const float* a, const float* b, int numBins)
+    {
+        using FVO = juce::FloatVectorOperations;
+
+        FVO::addWithMultiply(acc, a, b, numBins);
+        FVO::subtractWithMultiply(acc, a + numBins, b + numBins, numBins);
+        FVO::addWithMultiply(acc + numBins, a, b + numBins, numBins);
+        FVO::addWithMultiply(acc + numBins, a + numBins, b, numBins);
+    }
+
+    int log2(int powerOfTwo)
+    {
+        int order = 0;
+        while ((1 << order) < powerOfTwo)
+            ++order;
+        return order;
+    }
+}
+
+/**
+ * One uniformly partitioned overlap-save convolution of a section of the response
+ *
+ * Each boundary transforms the last two input blocks and, for the
+ * partitions of the section, sums the spectra of past input blocks times
+ * the partition spectra. A stage starting one block into the response
+ * (the first) needs the sum at the boundary itself; one starting two
+ * blocks in is deferred, accumulating while the next block fills and
+ * transforming back at the boundary after.
+ */
+struct PartitionedConvolver::Stage
+{
+    Stage(const float* impulse, int begin, int end, int blockSize_, bool deferred_)
+        : blockSize(blockSize_),
+          numBins(blockSize_ + 1),
+          numPartitions((end - begin + blockSize_ - 1) / blockSize_),
+          deferred(deferred_),
+          fft(log2(2 * blockSize_)),
+          partitions((size_t)(numPartitions * 2 * numBins)),
+          spectra(partitions.size()),
+          window((size_t)(2 * blockSize)),
+          accumulator((size_t)(2 * numBins)),
+          result((size_t)blockSize),
+          scratch((size_t)(4 * blockSize))
+    {
+        for (int k = 0; k < numPartitions; ++k)
+        {
+            std::fill(scratch.begin(), scratch.end(), 0.0f);
+            int start = begin + k * blockSize;
+            std::copy(impulse + start, impulse + juce::jmin(end, start + blockSize), scratch.begin());
+
+            fft.performRealOnlyForwardTransform(scratch.data(), true);
+            split(getPartition(k));
+        }
+    }
+
+    void reset()
+    {
+        std::fill(spectra.begin(), spectra.end(), 0.0f);
+        std::fill(window.begin(), window.end(), 0.0f);
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        std::fill(result.begin(), result.end(), 0.0f);
+        newest = 0;
+        fill = 0;
+        accumulated = 0;
+    }
+
+    /** Add this stage's share of the output for the samples of input */
+    void process(const float* input, float* output, int numSamples)
+    {
+        for (int done = 0; done < numSamples;)
+        {
+            int n = juce::jmin(numSamples - done, blockSize - fill);
+            std::copy(input + done, input + done + n, window.begin() + blockSize + fill);
+            juce::FloatVectorOperations::add(output + done, result.data() + fill, n);
+
+            fill += n;
+            done += n;
+
+            // Keep pace with the block, so the boundary only has the inverse transform left
+            if (deferred)
+                accumulate((numPartitions * fill + blockSize - 1) / blockSize);
+
+            if (fill == blockSize)
+                boundary();
+        }
+    }
+
+private:
+    void boundary()
+    {
+        if (deferred)
+        {
+            accumulate(numPartitions);
+            inverse();
+            transform();
+        }
+        else
+        {
+            transform();
+            accumulate(numPartitions);
+            inverse();
+        }
+
+        std::copy(window.begin() + blockSize, window.end(), window.begin());
+        fill = 0;
+    }
+
+    /** Spectrum of the last two input blocks into the delay line; starts a new sum */
+    void transform()
+    {
+        newest = (newest + 1) % numPartitions;
+
+        std::copy(window.begin(), window.end(), scratch.begin());
+        std::fill(scratch.begin() + 2 * blockSize, scratch.end(), 0.0f);
+        fft.performRealOnlyForwardTransform(scratch.data(), true);
+        split(getSpectrum(0));
+
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        accumulated = 0;
+    }
+
+    void accumulate(int upTo)
+    {
+        for (; accumulated < upTo; ++accumulated)
+            multiplyAccumulate(accumulator.data(), getSpectrum(accumulated), getPartition(accumulated), numBins);
+    }
+
+    /** The second half of the inverse transform is the valid (non-wrapped) part */
+    void inverse()
+    {
+        std::fill(scratch.begin(), scratch.end(), 0.0f);
+        for (int i = 0; i < numBins; ++i)
+        {
+            scratch[(size_t)(2 * i)] = accumulator[(size_t)i];
+            scratch[(size_t)(2 * i + 1)] = accumulator[(size_t)(numBins + i)];
+        }
+
+        fft.performRealOnlyInverseTransform(scratch.data());
+        std::copy(scratch.begin() + blockSize, scratch.begin() + 2 * blockSize, result.begin());
+    }
+
+    /** Interleaved transform output in scratch -> split layout */
+    void split(float* dest) const
+    {
+        for (int i = 0; i < numBins; ++i)
+        {
+            dest[i] = scratch[(size_t)(2 * i)];
+            dest[numBins + i] = scratch[(size_t)(2 * i + 1)];
+        }
+    }
+
+    float* getPartition(int k) { return partitions.data() + (size_t)k * 2 * (size_t)numBins; }
+
+    /** Input spectrum from `age` blocks before the newest */
+    float* getSpectrum(int age)
+    {
+        int slot = (newest - age + numPartitions) % numPartitions;
+        return spectra.data() + (size_t)slot * 2 * (size_t)numBins;
+    }
+
+    const int blockSize;
+    const int numBins;
+    const int numPartitions;
+    const bool deferred;
+
+    juce::dsp::FFT fft;
+    std::vector<float> partitions;    // Spectra of the response, one per partition
+    std::vector<float> spectra;       // Frequency-domain delay line of input blocks
+    std::vector<float> window;        // Previous block, then the one filling
+    std::vector<float> accumulator;
+    std::vector<float> result;        // Output for the block filling now
+    std::vector<float> scratch;       // FFT in place (twice the transform size)
+
+    int newest = 0;
+    int fill = 0;
+    int accumulated = 0;
+};
+
+PartitionedConvolver::PartitionedConvolver()
+{
+    history.resize((size_t)(headSize - 1 + maxChunk));
+}
+
+PartitionedConvolver::~PartitionedConvolver() {}
+
+void PartitionedConvolver::load(const float* impulse, int numSamples)
+{
+    length = juce::jmax(0, numSamples);
+    headTaps = juce::jmin(headSize, length);
+    head.assign(impulse, impulse + headTaps);
+
+    // Stage i covers the response from two of its blocks in (one for the first) up to where stage i + 1 starts
+    stages.clear();
+    for (size_t i = 0; i < stageSizes.size(); ++i)
+    {
+        int begin = i == 0 ? stageSizes[0] : 2 * stageSizes[i];
+        int end = i + 1 < stageSizes.size() ? juce::jmin(length, 2 * stageSizes[i + 1]) : length;
+
+        if (begin < end)
+            stages.push_back(std::make_unique<Stage>(impulse, begin, end, stageSizes[i], i > 0));
+    }
+
+    reset();
+}
+
+void PartitionedConvolver::reset()
+{
+    std::fill(history.begin(), history.end(), 0.0f);
+
+    for (auto& stage : stages)
+        stage->reset();
+}
+
+void PartitionedConvolver::process(const float* input, float* output, int numSamples)
+{
+    for (int done = 0; done < numSamples;)
+    {
+        int n = juce::jmin(maxChunk, numSamples - done);
+
+        // The stages read the input from here, so output may alias it
+        auto* x = history.data() + headSize - 1;
+        std::copy(input + done, input + done + n, x);
+
+        // Head: one vectorised pass over the chunk per tap
+        auto* y = output + done;
+        juce::FloatVectorOperations::clear(y, n);
+        for (int tap = 0; tap < headTaps; ++tap)
+            juce::FloatVectorOperations::addWithMultiply(y, x - tap, head[(size_t)tap], n);
+
+        for (auto& stage : stages)
+            stage->process(x, y, n);
+
+        std::copy(x + n - (headSize - 1), x + n, history.begin());
+        done += n;
+    }
+}
+
+} // namespace pianodaw
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+/**
+ * PartitionedConvolver - Zero-latency convolution of one channel with a long impulse response
+ *
+ * The first headSize taps run as a direct-form FIR, so the output starts on
+ * the sample that excites it. The rest of the response is split into
+ * uniformly partitioned overlap-save stages whose partition size grows
+ * along the response (64, 512, then 4096 samples). A stage only starts
+ * where its FFT block has had time to fill, so the early reflections go
+ * through small, frequent FFTs and the long tail through few large ones.
+ * The larger stages have a block of slack before their result is due and
+ * spread their multiply-accumulate over it instead of doing it all at a
+ * block boundary.
+ *
+ * Spectra are kept in split (real, imaginary) layout so the complex
+ * multiply-accumulate runs on FloatVectorOperations (SIMD). Everything is
+ * sized in load(); process() never allocates.
+ */
+class PartitionedConvolver
+{
+public:
+    static constexpr int headSize = 64;
+
+    PartitionedConvolver();
+    ~PartitionedConvolver();
+
+    /** Partition an impulse response, computing the spectrum of every partition (not on the audio thread) */
+    void load(const float* impulse, int numSamples);
+
+    /** Forget the input history */
+    void reset();
+
+    /** Audio thread: output = input convolved with the response (output may be input) */
+    void process(const float* input, float* output, int numSamples);
+
+    /** Taps of the response, 0 when nothing is loaded */
+    int getLength() const { return length; }
+
+private:
+    struct Stage;
+
+    static constexpr int maxChunk = 256;
+
+    int length = 0;
+    int headTaps = 0;
+    std::vector<float> head;
+    std::vector<float> history;   // headSize - 1 samples of past input, then the current chunk
+    std::vector<std::unique_ptr<Stage>> stages;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,170 @@
+#include "PianoResonance.h"
+#include <cmath>
+
+namespace pianodaw {
+
+namespace
+{
+    // Free strings ring long in the bass and short in the treble; dampers stop any of them quickly
+    constexpr double bassRingSeconds = 6.0;
+    constexpr double trebleRingSeconds = 1.0;
+    constexpr double dampedRingSeconds = 0.08;
+
+    // Below this (about -120 dB) a damped string is silent and stops being run
+    constexpr float silentEnergy = 1.0e-12f;
+
+    /** Pole radius that decays by 60 dB in seconds */
+    double poleRadius(double seconds, double sampleRate)
+    {
+        return std::exp(-6.907755 / (seconds * sampleRate));
+    }
+}
+
+void PianoResonance::prepare(double sampleRate, int blockSize)
+{
+    sampleRate = sampleRate > 0.0 ? sampleRate : 44100.0;
+
+    for (int i = 0; i < numStrings; ++i)
+    {
+        int key = lowestKey + i;
+        auto omega = juce::MathConstants<double>::twoPi * juce::MidiMessage::getMidiNoteInHertz(key) / sampleRate;
+        auto position = (double)i / (numStrings - 1);
+        auto ringSeconds = bassRingSeconds * std::pow(trebleRingSeconds / bassRingSeconds, position);
+
+        // y = g (x[n] - x[n-2]) + a1 y[n-1] - a2 y[n-2]; g = (1 - r^2) / 2 puts the peak at unity
+        auto& string = strings[(size_t)i];
+        auto r = poleRadius(ringSeconds, sampleRate);
+        string.freeA1 = (float)(2.0 * r * std::cos(omega));
+        string.freeA2 = (float)(r * r);
+        string.freeGain = (float)((1.0 - r * r) * 0.5);
+
+        auto damped = poleRadius(dampedRingSeconds, sampleRate);
+        string.dampedA1 = (float)(2.0 * damped * std::cos(omega));
+        string.dampedA2 = (float)(damped * damped);
+
+        string.y1 = string.y2 = 0.0f;
+    }
+
+    drive.setSize(1, juce::jmax(1, blockSize));
+    ringing.setSize(1, juce::jmax(1, blockSize));
+    x1 = x2 = 0.0f;
+
+    keyDown.fill(false);
+    sostenutoHeld.fill(false);
+    sustain = sostenuto = false;
+}
+
+void PianoResonance::updateDampers(const juce::MidiBuffer& midi)
+{
+    // One piano: pedals and keys count whatever channel they come in on
+    for (const auto metadata : midi)
+    {
+        auto message = metadata.getMessage();
+
+        if (message.isNoteOn())
+            keyDown[(size_t)message.getNoteNumber()] = true;
+        else if (message.isNoteOff())
+            keyDown[(size_t)message.getNoteNumber()] = false;
+        else if (message.isSustainPedalOn())
+            sustain = true;
+        else if (message.isSustainPedalOff())
+            sustain = false;
+        else if (message.isSostenutoPedalOn())
+        {
+            // Catches the dampers of the keys down right now, until it is released
+            if (!sostenuto)
+                sostenutoHeld = keyDown;
+            sostenuto = true;
+        }
+        else if (message.isSostenutoPedalOff())
+        {
+            sostenutoHeld.fill(false);
+            sostenuto = false;
+        }
+        else if (message.isAllNotesOff() || message.isAllSoundOff())
+        {
+            keyDown.fill(false);
+        }
+    }
+}
+
+template <typename SampleType>
+void PianoResonance::process(juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midi, int numSamples)
+{
+    juce::ScopedNoDenormals noDenormals;
+    updateDampers(midi);
+
+    auto gain = level.load();
+    int numChannels = buffer.getNumChannels();
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    // Keeps the allocation from prepare() unless the host exceeds the announced block size
+    drive.setSize(1, numSamples, false, false, true);
+    ringing.setSize(1, numSamples, false, false, true);
+
+    // Mono excitation, differenced once for every string (the resonators' zeros at DC and Nyquist)
+    auto* in = drive.getWritePointer(0);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        SampleType sum = 0;
+        for (int ch = 0; ch < numChannels; ++ch)
+            sum += buffer.getSample(ch, i);
+
+        auto x = gain > 0.0f ? (float)sum / (float)numChannels : 0.0f;
+        in[i] = x - x2;
+        x2 = x1;
+        x1 = x;
+    }
+
+    auto* out = ringing.getWritePointer(0);
+    juce::FloatVectorOperations::clear(out, numSamples);
+    int run = 0;
+
+    for (int s = 0; s < numStrings; ++s)
+    {
+        auto& string = strings[(size_t)s];
+        auto key = (size_t)(lowestKey + s);
+        bool undamped = gain > 0.0f && (sustain || keyDown[key] || sostenutoHeld[key]);
+
+        if (!undamped && string.y1 * string.y1 + string.y2 * string.y2 < silentEnergy)
+        {
+            string.y1 = string.y2 = 0.0f;
+            continue;
+        }
+
+        // String-major: each resonator runs through the block with its state in registers
+        float a1 = undamped ? string.freeA1 : string.dampedA1;
+        float a2 = undamped ? string.freeA2 : string.dampedA2;
+        float g = undamped ? string.freeGain : 0.0f;
+        float y1 = string.y1, y2 = string.y2;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float y = g * in[i] + a1 * y1 - a2 * y2;
+            y2 = y1;
+            y1 = y;
+            out[i] += y;
+        }
+
+        string.y1 = y1;
+        string.y2 = y2;
+        ++run;
+    }
+
+    numRinging.store(run, std::memory_order_relaxed);
+    if (run == 0)
+        return;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* dest = buffer.getWritePointer(ch);
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] += (SampleType)(out[i] * gain);
+    }
+}
+
+template void PianoResonance::process(juce::AudioBuffer<float>&, const juce::MidiBuffer&, int);
+template void PianoResonance::process(juce::AudioBuffer<double>&, const juce::MidiBuffer&, int);
+
+} // namespace pianodaw
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+namespace pianodaw {
+
+/**
+ * PianoResonance - Sympathetic string resonance for the built-in piano
+ *
+ * A bank of 88 two-pole resonators, one per string, tuned to the keys and
+ * driven by the piano's own output. Which strings are free to ring follows
+ * the dampers: every string while the sustain pedal is down, otherwise the
+ * keys held down and those caught by the sostenuto pedal. Damped strings
+ * get no input and die away within a few tens of milliseconds.
+ *
+ * The damper state and the coefficients are updated once per block from
+ * the block's MIDI, and only strings that are undamped or still ringing are
+ * run, so the cost is bounded by the 88 strings however many voices a full
+ * pedal cluster holds. Each resonator has unity gain at its own pitch.
+ */
+class PianoResonance
+{
+public:
+    static constexpr int lowestKey = 21;   // A0
+    static constexpr int numStrings = 88;
+
+    PianoResonance() = default;
+
+    /** Tune the strings and size the scratch (audio stopped) */
+    void prepare(double sampleRate, int blockSize);
+
+    /** Message thread: gain of the resonance added to the piano (0 turns it off) */
+    void setLevel(float newLevel) { level.store(juce::jlimit(0.0f, 1.0f, newLevel)); }
+    float getLevel() const { return level.load(); }
+
+    /** Audio thread: follow the dampers through this block's MIDI, then add the ringing strings to buffer */
+    template <typename SampleType>
+    void process(juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midi, int numSamples);
+
+    /** Strings run in the last block */
+    int getNumRinging() const { return numRinging.load(std::memory_order_relaxed); }
+
+private:
+    void updateDampers(const juce::MidiBuffer& midi);
+
+    struct Resonator
+    {
+        float freeA1 = 0.0f, freeA2 = 0.0f, freeGain = 0.0f;   // Undamped
+        float dampedA1 = 0.0f, dampedA2 = 0.0f;
+        float y1 = 0.0f, y2 = 0.0f;
+    };
+
+    std::array<Resonator, numStrings> strings;
+    std::array<bool, 128> keyDown {};
+    std::array<bool, 128> sostenutoHeld {};
+    bool sustain = false;
+    bool sostenuto = false;
+
+    juce::AudioBuffer<float> drive;        // Mono input, differenced (x[n] - x[n-2])
+    juce::AudioBuffer<float> ringing;      // Sum of the strings
+    float x1 = 0.0f, x2 = 0.0f;            // Input history across blocks
+
+    std::atomic<float> level { 0.15f };
+    std::atomic<int> numRinging { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoResonance)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,184 @@
+#include "PluginLoader.h"
+#include "ConvolutionReverb.h"
+#include "PluginSandbox.h"
+
+namespace pianodaw {
+
+namespace
+{
+    constexpr int sandboxLaunchTimeoutMs = 30000;
+
+    int getNumLoaderThreads()
+    {
+        // Leave a core for the audio and message threads
+        return juce::jlimit(1, 4, juce::SystemStats::getNumCpus() - 1);
+    }
+}
+
+PluginLoader::PluginLoader(juce::AudioPluginFormatManager& formatManager_)
+    : formatManager(formatManager_), pool(getNumLoaderThreads())
+{
+}
+
+PluginLoader::~PluginLoader()
+{
+    // Results still queued on the message thread are dropped by the weak reference
+    pool.removeAllJobs(true, 30000);
+}
+
+void PluginLoader::load(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                        double sampleRate, int blockSize, int numChannels, bool sandboxed, Callback onLoaded)
+{
+    ++numPending;
+
+    // Built-in effects are our own code: never sandboxed, nothing for the formats to create
+    if (ConvolutionReverb::isConvolutionReverb(description))
+    {
+        loadBuiltInOnPool(state, sampleRate, blockSize, numChannels, std::move(onLoaded));
+        return;
+    }
+
+    if (sandboxed || SandboxedPlugin::isTestTone(description))
+    {
+        loadSandboxedOnPool(description, state, sampleRate, blockSize, numChannels, std::move(onLoaded));
+        return;
+    }
+
+    juce::WeakReference<PluginLoader> weakThis(this);
+
+    formatManager.createPluginInstanceAsync(description, sampleRate, blockSize,
+        [weakThis, state, sampleRate, blockSize, numChannels, onLoaded]
+        (std::unique_ptr<juce::AudioPluginInstance> instance, const juce::String& error)
+        {
+            auto* self = weakThis.get();
+            if (self == nullptr)
+                return;
+
+            if (instance == nullptr)
+            {
+                auto result = std::make_shared<Result>();
+                result->error = error.isNotEmpty() ? error : juce::String("Plugin could not be created");
+                self->deliver(result, onLoaded);
+                return;
+            }
+
+            // Restoring state is where samplers load their content: keep it off the message thread
+            self->finishOnPool(std::move(instance), state, sampleRate, blockSize, numChannels, onLoaded);
+        });
+}
+
+void PluginLoader::finishOnPool(std::unique_ptr<juce::AudioPluginInstance> instance, const juce::MemoryBlock& state,
+                                double sampleRate, int blockSize, int numChannels, Callback onLoaded)
+{
+    auto pendingInstance = std::make_shared<std::unique_ptr<juce::AudioPluginInstance>>(std::move(instance));
+    juce::WeakReference<PluginLoader> weakThis(this);
+
+    pool.addJob([weakThis, pendingInstance, state, sampleRate, blockSize, numChannels, onLoaded]
+    {
+        auto result = std::make_shared<Result>();
+        auto& plugin = *pendingInstance;
+
+        if (state.getSize() > 0)
+            plugin->setStateInformation(state.getData(), (int)state.getSize());
+
+        result->graph = createInstrumentGraph(std::move(plugin), sampleRate, blockSize, numChannels,
+                                              result->instrumentNode);
+        deliverFromPool(weakThis, result, onLoaded);
+    });
+}
+
+void PluginLoader::loadSandboxedOnPool(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                                       double sampleRate, int blockSize, int numChannels, Callback onLoaded)
+{
+    juce::WeakReference<PluginLoader> weakThis(this);
+
+    pool.addJob([weakThis, description, state, sampleRate, blockSize, numChannels, onLoaded]
+    {
+        auto result = std::make_shared<Result>();
+        auto plugin = std::make_unique<SandboxedPlugin>(description, numChannels, sampleRate, blockSize);
+
+        // The child loads the plugin itself; its state goes over with the first message
+        if (state.getSize() > 0)
+            plugin->setStateInformation(state.getData(), (int)state.getSize());
+
+        juce::String error;
+        if (plugin->launch(sandboxLaunchTimeoutMs, error))
+            result->graph = createInstrumentGraph(std::move(plugin), sampleRate, blockSize, numChannels,
+                                                  result->instrumentNode);
+        else
+            result->error = error;
+
+        deliverFromPool(weakThis, result, onLoaded);
+    });
+}
+
+void PluginLoader::loadBuiltInOnPool(const juce::MemoryBlock& state, double sampleRate, int blockSize, int numChannels,
+                                     Callback onLoaded)
+{
+    juce::WeakReference<PluginLoader> weakThis(this);
+
+    pool.addJob([weakThis, state, sampleRate, blockSize, numChannels, onLoaded]
+    {
+        auto result = std::make_shared<Result>();
+        auto reverb = std::make_unique<ConvolutionReverb>(numChannels);
+
+        // Reads the impulse response here; preparing the graph resamples and partitions it
+        juce::String error;
+        if (state.getSize() == 0 || reverb->restoreState(state.getData(), (int)state.getSize(), error))
+            result->graph = createInstrumentGraph(std::move(reverb), sampleRate, blockSize, numChannels,
+                                                  result->instrumentNode);
+        else
+            result->error = error;
+
+        deliverFromPool(weakThis, result, onLoaded);
+    });
+}
+
+void PluginLoader::deliverFromPool(juce::WeakReference<PluginLoader> weakThis, std::shared_ptr<Result> result, Callback onLoaded)
+{
+    // The weak reference was taken on the message thread; it is only dereferenced there
+    juce::MessageManager::callAsync([weakThis, result, onLoaded]
+    {
+        if (auto* loader = weakThis.get())
+            loader->deliver(result, onLoaded);
+    });
+}
+
+void PluginLoader::deliver(std::shared_ptr<Result> result, const Callback& onLoaded)
+{
+    --numPending;
+
+    if (onLoaded != nullptr)
+        onLoaded(std::move(*result));
+}
+
+std::unique_ptr<juce::AudioProcessorGraph> PluginLoader::createInstrumentGraph(std::unique_ptr<juce::AudioPluginInstance> instance,
+                                                                               double sampleRate, int blockSize, int numChannels,
+                                                                               juce::AudioProcessorGraph::Node::Ptr& instrumentNodeOut)
+{
+    using IOProcessor = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+
+    auto graph = std::make_unique<juce::AudioProcessorGraph>();
+    graph->setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+
+    auto audioInNode = graph->addNode(std::make_unique<IOProcessor>(IOProcessor::audioInputNode));
+    auto audioOutNode = graph->addNode(std::make_unique<IOProcessor>(IOProcessor::audioOutputNode));
+    auto midiInNode = graph->addNode(std::make_unique<IOProcessor>(IOProcessor::midiInputNode));
+    instrumentNodeOut = graph->addNode(std::move(instance));
+
+    graph->addConnection({ { midiInNode->nodeID, juce::AudioProcessorGraph::midiChannelIndex },
+                           { instrumentNodeOut->nodeID, juce::AudioProcessorGraph::midiChannelIndex } });
+
+    for (int i = 0; i < numChannels; ++i)
+        graph->addConnection({ { instrumentNodeOut->nodeID, i }, { audioOutNode->nodeID, i } });
+
+    // Instruments without inputs simply refuse these
+    for (int i = 0; i < juce::jmin(numChannels, instrumentNodeOut->getProcessor()->getTotalNumInputChannels()); ++i)
+        graph->addConnection({ { audioInNode->nodeID, i }, { instrumentNodeOut->nodeID, i } });
+
+    // Prepares every node here, on the caller's thread, instead of inside the audio callback
+    graph->prepareToPlay(sampleRate, blockSize);
+    return graph;
+}
+
+} // namespace pianodaw
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <atomic>
+#include <functional>
+
+namespace pianodaw {
+
+/**
+ * PluginLoader - Asynchronous instrument instantiation and state restore
+ *
+ * Creates plugins with createPluginInstanceAsync (the format decides whether
+ * that needs the message thread), then restores their state, builds the
+ * MIDI in -> instrument -> audio out graph and prepares it on a worker pool.
+ * Several loads run in parallel, so opening a project with many heavy
+ * sampler tracks no longer blocks the UI. Results are delivered on the
+ * message thread, ready to hand to a GraphSwapper. Sandboxed plugins are
+ * launched (child process start + plugin load) entirely on the pool, and so
+ * are built-in effects (ConvolutionReverb).
+ */
+class PluginLoader
+{
+public:
+    struct Result
+    {
+        std::unique_ptr<juce::AudioProcessorGraph> graph;
+        juce::AudioProcessorGraph::Node::Ptr instrumentNode;
+        juce::String error;   // Empty on success
+    };
+
+    using Callback = std::function<void(Result)>;
+
+    explicit PluginLoader(juce::AudioPluginFormatManager& formatManager);
+    ~PluginLoader();
+
+    /**
+     * Start loading (message thread); onLoaded is called on the message thread
+     * @param state Plugin state to restore before the graph is prepared (may be empty)
+     * @param sandboxed Host the plugin in a child process (SandboxedPlugin)
+     */
+    void load(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+              double sampleRate, int blockSize, int numChannels, bool sandboxed, Callback onLoaded);
+
+    /** Loads that have been started but not yet delivered */
+    int getNumPending() const { return numPending.load(); }
+
+    /** Build and prepare a MIDI in -> instrument -> audio out graph on the calling thread (effects also get audio in) */
+    static std::unique_ptr<juce::AudioProcessorGraph> createInstrumentGraph(std::unique_ptr<juce::AudioPluginInstance> instance,
+                                                                            double sampleRate, int blockSize, int numChannels,
+                                                                            juce::AudioProcessorGraph::Node::Ptr& instrumentNodeOut);
+
+private:
+    void deliver(std::shared_ptr<Result> result, const Callback& onLoaded);
+    void finishOnPool(std::unique_ptr<juce::AudioPluginInstance> instance, const juce::MemoryBlock& state,
+                      double sampleRate, int blockSize, int numChannels, Callback onLoaded);
+    void loadSandboxedOnPool(const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                             double sampleRate, int blockSize, int numChannels, Callback onLoaded);
+    void loadBuiltInOnPool(const juce::MemoryBlock& state, double sampleRate, int blockSize, int numChannels,
+                           Callback onLoaded);
+    static void deliverFromPool(juce::WeakReference<PluginLoader> loader, std::shared_ptr<Result> result, Callback onLoaded);
+
+    juce::AudioPluginFormatManager& formatManager;
+    juce::ThreadPool pool;
+    std::atomic<int> numPending { 0 };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(PluginLoader)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginLoader)
+};
+
+} // namespace pianodaw
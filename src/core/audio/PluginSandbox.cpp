@@ -0,0 +1,926 @@
+#include "PluginSandbox.h"
+#include "../../ui/panels/DebugLogWindow.h"
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <cerrno>
+ #include <fcntl.h>
+ #include <semaphore.h>
+ #include <signal.h>
+ #include <time.h>
+ #include <unistd.h>
+#endif
+
+namespace pianodaw {
+
+//==============================================================================
+// InterProcessSemaphore
+//==============================================================================
+
+/** Named counting semaphore shared by host and child (the creator owns the name) */
+class InterProcessSemaphore
+{
+public:
+    InterProcessSemaphore(const juce::String& name, bool create)
+    {
+#if JUCE_WINDOWS
+        auto fullName = "Local\\" + name;
+        handle = create ? CreateSemaphoreW(nullptr, 0, 0x7fffffff, fullName.toWideCharPointer())
+                        : OpenSemaphoreW(SEMAPHORE_ALL_ACCESS, FALSE, fullName.toWideCharPointer());
+#else
+        posixName = "/" + name;
+        if (create)
+        {
+            sem_unlink(posixName.toRawUTF8());
+            semaphore = sem_open(posixName.toRawUTF8(), O_CREAT | O_EXCL, 0600, 0);
+            owner = true;
+        }
+        else
+        {
+            semaphore = sem_open(posixName.toRawUTF8(), 0);
+        }
+
+        if (semaphore == SEM_FAILED)
+            semaphore = nullptr;
+#endif
+    }
+
+    ~InterProcessSemaphore()
+    {
+#if JUCE_WINDOWS
+        if (handle != nullptr)
+            CloseHandle(handle);
+#else
+        if (semaphore != nullptr)
+            sem_close(semaphore);
+        if (owner)
+            sem_unlink(posixName.toRawUTF8());
+#endif
+    }
+
+    bool isValid() const
+    {
+#if JUCE_WINDOWS
+        return handle != nullptr;
+#else
+        return semaphore != nullptr;
+#endif
+    }
+
+    void post()
+    {
+#if JUCE_WINDOWS
+        ReleaseSemaphore(handle, 1, nullptr);
+#else
+        sem_post(semaphore);
+#endif
+    }
+
+    bool wait(double timeoutMs)
+    {
+#if JUCE_WINDOWS
+        return WaitForSingleObject(handle, (DWORD)std::ceil(juce::jmax(0.0, timeoutMs))) == WAIT_OBJECT_0;
+#elif JUCE_MAC || JUCE_IOS
+        // No sem_timedwait on Apple platforms: poll, sleeping only when the deadline is far away
+        auto deadline = juce::Time::getMillisecondCounterHiRes() + timeoutMs;
+        for (;;)
+        {
+            if (sem_trywait(semaphore) == 0)
+                return true;
+
+            auto remaining = deadline - juce::Time::getMillisecondCounterHiRes();
+            if (remaining <= 0.0)
+                return false;
+
+            if (remaining > 2.0)
+                juce::Thread::sleep(1);
+            else
+                std::this_thread::yield();
+        }
+#else
+        timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        auto nanos = (long long)deadline.tv_nsec + (long long)(juce::jmax(0.0, timeoutMs) * 1.0e6);
+        deadline.tv_sec += (time_t)(nanos / 1000000000LL);
+        deadline.tv_nsec = (long)(nanos % 1000000000LL);
+
+        int result;
+        while ((result = sem_timedwait(semaphore, &deadline)) == -1 && errno == EINTR) {}
+        return result == 0;
+#endif
+    }
+
+private:
+#if JUCE_WINDOWS
+    HANDLE handle = nullptr;
+#else
+    juce::String posixName;
+    sem_t* semaphore = nullptr;
+    bool owner = false;
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE(InterProcessSemaphore)
+};
+
+namespace
+{
+    constexpr double deadlineFraction = 0.75;   // Share of a block's duration the child may take
+    constexpr int maxFailedRestarts = 5;
+    constexpr int hangMissedBlocks = 50;        // Deadlines missed in a row before the child counts as hung
+    constexpr double hangTimeoutMs = 1000.0;    // Or this long waiting on one block, whatever the block size
+
+    juce::int64 getCurrentProcessId()
+    {
+#if JUCE_WINDOWS
+        return (juce::int64)GetCurrentProcessId();
+#else
+        return (juce::int64)getpid();
+#endif
+    }
+
+    juce::MemoryBlock toMemoryBlock(const juce::XmlElement& xml)
+    {
+        auto text = xml.toString();
+        return juce::MemoryBlock(text.toRawUTF8(), text.getNumBytesAsUTF8());
+    }
+
+    /** Stand-in instrument used to exercise the sandbox without a third-party plugin */
+    class SandboxTestTone : public juce::AudioProcessor
+    {
+    public:
+        SandboxTestTone()
+            : AudioProcessor(BusesProperties().withOutput("Output", juce::AudioChannelSet::stereo(), true))
+        {
+        }
+
+        const juce::String getName() const override { return "Sandbox Test Tone"; }
+
+        void prepareToPlay(double sampleRate, int) override
+        {
+            currentSampleRate = sampleRate;
+            for (auto& v : voices)
+                v = Voice();
+        }
+
+        void releaseResources() override {}
+
+        void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+        {
+            buffer.clear();
+            int position = 0;
+
+            for (const auto metadata : midiMessages)
+            {
+                render(buffer, position, metadata.samplePosition - position);
+                position = juce::jmax(position, metadata.samplePosition);
+                handleMessage(metadata.getMessage());
+            }
+
+            render(buffer, position, buffer.getNumSamples() - position);
+        }
+
+        double getTailLengthSeconds() const override { return 0.1; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return false; }
+        juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram(int) override {}
+        const juce::String getProgramName(int) override { return {}; }
+        void changeProgramName(int, const juce::String&) override {}
+        void getStateInformation(juce::MemoryBlock&) override {}
+        void setStateInformation(const void*, int) override {}
+
+    private:
+        struct Voice
+        {
+            int note = -1;
+            double phase = 0.0, delta = 0.0;
+            float level = 0.0f, target = 0.0f;
+        };
+
+        void handleMessage(const juce::MidiMessage& message)
+        {
+            if (message.isNoteOn())
+            {
+               #if defined(PIANODAW_SANDBOX_FAULT_HOOKS) && PIANODAW_SANDBOX_FAULT_HOOKS
+                // Test builds only: lets PluginSandboxTests crash and hang the child on purpose
+                if (message.getNoteNumber() == 0)
+                    std::abort();
+                if (message.getNoteNumber() == 1)
+                    for (;;)
+                        juce::Thread::sleep(100);
+               #endif
+
+                auto* voice = findVoice(-1);
+                if (voice == nullptr)
+                    voice = &voices[0];   // All busy: steal the first
+
+                voice->note = message.getNoteNumber();
+                voice->phase = 0.0;
+                voice->delta = juce::MathConstants<double>::twoPi
+                             * juce::MidiMessage::getMidiNoteInHertz(voice->note) / currentSampleRate;
+                voice->target = message.getFloatVelocity() * 0.15f;
+            }
+            else if (message.isNoteOff())
+            {
+                if (auto* voice = findVoice(message.getNoteNumber()))
+                    voice->target = 0.0f;
+            }
+            else if (message.isAllNotesOff() || message.isAllSoundOff())
+            {
+                for (auto& v : voices)
+                    v.target = 0.0f;
+            }
+        }
+
+        /** Voice playing note, or a free voice for note == -1 */
+        Voice* findVoice(int note)
+        {
+            for (auto& v : voices)
+                if (v.note == note || (note == -1 && v.level <= 0.0f && v.target <= 0.0f))
+                    return &v;
+            return nullptr;
+        }
+
+        void render(juce::AudioBuffer<float>& buffer, int start, int count)
+        {
+            if (count <= 0)
+                return;
+
+            auto step = (float)(1.0 / (0.005 * currentSampleRate));   // 5 ms ramps
+            for (auto& v : voices)
+            {
+                if (v.note < 0)
+                    continue;
+
+                for (int i = start; i < start + count; ++i)
+                {
+                    v.level = v.level < v.target ? juce::jmin(v.target, v.level + step)
+                                                 : juce::jmax(v.target, v.level - step);
+                    auto sample = (float)std::sin(v.phase) * v.level;
+                    v.phase += v.delta;
+
+                    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                        buffer.addSample(ch, i, sample);
+                }
+
+                if (v.level <= 0.0f && v.target <= 0.0f)
+                    v.note = -1;
+            }
+        }
+
+        std::array<Voice, 16> voices {};
+        double currentSampleRate = 44100.0;
+    };
+}
+
+//==============================================================================
+// SandboxedPlugin
+//==============================================================================
+
+class SandboxedPlugin::Connection : public juce::ChildProcessCoordinator
+{
+public:
+    explicit Connection(SandboxedPlugin& owner_) : owner(owner_) {}
+    ~Connection() override { killWorkerProcess(); }
+
+    void handleMessageFromWorker(const juce::MemoryBlock& message) override
+    {
+        if (auto xml = juce::parseXML(message.toString()))
+            owner.handleReply(*xml);
+    }
+
+    void handleConnectionLost() override
+    {
+        owner.childReady = false;
+        owner.childPid = 0;
+        owner.childLost = true;
+        owner.openEvent.signal();
+        owner.stateEvent.signal();
+    }
+
+private:
+    SandboxedPlugin& owner;
+};
+
+juce::PluginDescription SandboxedPlugin::getTestToneDescription()
+{
+    juce::PluginDescription desc;
+    desc.name = "Sandbox Test Tone";
+    desc.descriptiveName = "Out-of-process test instrument";
+    desc.pluginFormatName = "Sandbox";
+    desc.category = "Synth";
+    desc.manufacturerName = "PianoDAW";
+    desc.fileOrIdentifier = "pianodaw:sandbox-test-tone";
+    desc.isInstrument = true;
+    desc.numInputChannels = 0;
+    desc.numOutputChannels = 2;
+    return desc;
+}
+
+bool SandboxedPlugin::isTestTone(const juce::PluginDescription& desc)
+{
+    return desc.pluginFormatName == "Sandbox" && desc.fileOrIdentifier == getTestToneDescription().fileOrIdentifier;
+}
+
+SandboxedPlugin::SandboxedPlugin(const juce::PluginDescription& description_, int numChannels_, double sampleRate, int blockSize)
+    : AudioPluginInstance(BusesProperties().withOutput("Output",
+          juce::AudioChannelSet::canonicalChannelSet(juce::jlimit(1, SandboxSharedBlock::maxChannels, numChannels_)), true)),
+      description(description_),
+      numChannels(juce::jlimit(1, SandboxSharedBlock::maxChannels, numChannels_)),
+      currentSampleRate(sampleRate),
+      currentBlockSize(blockSize)
+{
+    setRateAndBufferSizeDetails(sampleRate, blockSize);
+}
+
+SandboxedPlugin::~SandboxedPlugin()
+{
+    stopTimer();
+    {
+        const juce::ScopedLock sl(connectionLock);
+        connection.reset();
+    }
+    requestSemaphore.reset();
+    replySemaphore.reset();
+    sharedMapping.reset();
+    sharedFile.deleteFile();
+}
+
+bool SandboxedPlugin::launch(int timeoutMs, juce::String& errorMessage)
+{
+    // Shared block: RAM-backed on Linux, a temp file elsewhere (the OS keeps it in the page cache)
+    sharedName = "pdaw" + juce::String::toHexString(juce::Random::getSystemRandom().nextInt64()).substring(0, 12);
+    auto folder = juce::File("/dev/shm").isDirectory() ? juce::File("/dev/shm")
+                                                        : juce::File::getSpecialLocation(juce::File::tempDirectory);
+    sharedFile = folder.getChildFile(sharedName + ".shm");
+
+    if (!sharedFile.replaceWithData(juce::MemoryBlock(sizeof(SandboxSharedBlock), true).getData(), sizeof(SandboxSharedBlock)))
+    {
+        errorMessage = "Could not create " + sharedFile.getFullPathName();
+        return false;
+    }
+
+    sharedMapping = std::make_unique<juce::MemoryMappedFile>(sharedFile, juce::MemoryMappedFile::readWrite, false);
+    if (sharedMapping->getData() == nullptr || sharedMapping->getSize() < sizeof(SandboxSharedBlock))
+    {
+        errorMessage = "Could not map shared memory";
+        return false;
+    }
+
+    shared = new (sharedMapping->getData()) SandboxSharedBlock();
+
+    requestSemaphore = std::make_unique<InterProcessSemaphore>(sharedName + "q", true);
+    replySemaphore = std::make_unique<InterProcessSemaphore>(sharedName + "p", true);
+    if (!requestSemaphore->isValid() || !replySemaphore->isValid())
+    {
+        errorMessage = "Could not create sandbox semaphores";
+        return false;
+    }
+
+    if (!startChild())
+    {
+        errorMessage = "Could not launch sandbox process";
+        return false;
+    }
+
+    openEvent.wait(timeoutMs);
+    if (!childReady)
+    {
+        const juce::ScopedLock sl(stateLock);
+        errorMessage = childError.isNotEmpty() ? childError : juce::String("Sandbox did not start");
+        return false;
+    }
+
+    startTimerHz(10);
+    return true;
+}
+
+bool SandboxedPlugin::startChild()
+{
+    // Held until OPEN is out, so a state sent meanwhile goes to the new child after it
+    const juce::ScopedLock cl(connectionLock);
+
+    // Killing the old child reports a lost connection, so do it before resetting the flags
+    connection.reset();
+
+    childReady = false;
+    childLost = false;
+    consecutiveMisses = 0;
+    openEvent.reset();
+
+    connection = std::make_unique<Connection>(*this);
+    if (!connection->launchWorkerProcess(juce::File::getSpecialLocation(juce::File::currentExecutableFile),
+                                         childProcessID, 0, 0))
+    {
+        childLost = true;
+        return false;
+    }
+
+    juce::XmlElement open("OPEN");
+    open.setAttribute("shared", sharedFile.getFullPathName());
+    open.setAttribute("name", sharedName);
+    open.setAttribute("channels", numChannels);
+    open.setAttribute("sampleRate", currentSampleRate);
+    open.setAttribute("blockSize", currentBlockSize);
+    open.setAttribute("testTone", isTestTone(description));
+
+    {
+        const juce::ScopedLock sl(stateLock);
+        if (lastState.getSize() > 0)
+            open.setAttribute("state", lastState.toBase64Encoding());
+    }
+
+    if (auto descXml = description.createXml())
+    {
+        descXml->setTagName("PLUGIN");
+        open.addChildElement(descXml.release());
+    }
+
+    send(open);
+    return true;
+}
+
+void SandboxedPlugin::killChild()
+{
+    // A hung plugin may be holding up the child's message thread too, so it cannot be asked to quit
+    childReady = false;
+
+    auto pid = childPid.exchange(0);
+    if (pid > 0)
+    {
+#if JUCE_WINDOWS
+        if (auto process = OpenProcess(PROCESS_TERMINATE, FALSE, (DWORD)pid))
+        {
+            TerminateProcess(process, 1);
+            CloseHandle(process);
+        }
+#else
+        ::kill((pid_t)pid, SIGKILL);
+#endif
+    }
+
+    childLost = true;
+}
+
+bool SandboxedPlugin::isUnresponsive() const
+{
+    auto misses = consecutiveMisses.load();
+    if (misses == 0)
+        return false;
+
+    // Caught up since: the audio thread has just not asked for another block yet
+    if (shared->replySeq.load(std::memory_order_acquire) == shared->requestSeq.load(std::memory_order_relaxed))
+        return false;
+
+    auto waitedMs = 1000.0 * juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - firstMissTicks.load());
+    return misses >= hangMissedBlocks || waitedMs >= hangTimeoutMs;
+}
+
+void SandboxedPlugin::noteMissedBlock()
+{
+    ++numMissed;
+
+    if (consecutiveMisses.load(std::memory_order_relaxed) == 0)
+        firstMissTicks.store(juce::Time::getHighResolutionTicks());
+    ++consecutiveMisses;
+}
+
+void SandboxedPlugin::send(const juce::XmlElement& message)
+{
+    const juce::ScopedLock sl(connectionLock);
+    if (connection != nullptr)
+        connection->sendMessageToWorker(toMemoryBlock(message));
+}
+
+void SandboxedPlugin::handleReply(const juce::XmlElement& reply)
+{
+    if (reply.hasTagName("OPENED"))
+    {
+        auto error = reply.getStringAttribute("error");
+        {
+            const juce::ScopedLock sl(stateLock);
+            childError = error;
+        }
+        childPid = reply.getStringAttribute("pid").getLargeIntValue();
+        childReady = error.isEmpty();
+        openEvent.signal();
+    }
+    else if (reply.hasTagName("STATE"))
+    {
+        {
+            const juce::ScopedLock sl(stateLock);
+            lastState.reset();
+            lastState.fromBase64Encoding(reply.getStringAttribute("data"));
+        }
+        stateEvent.signal();
+    }
+}
+
+void SandboxedPlugin::timerCallback()
+{
+    // A hung child keeps its connection open, so only the watchdog notices it
+    if (childReady && isUnresponsive())
+    {
+        ++numHangs;
+        DebugLogWindow::addLog("Sandbox: " + description.name + " stopped responding - killing it");
+        killChild();
+    }
+
+    if (childLost && failedRestarts < maxFailedRestarts)
+    {
+        // Relaunch with the last state the host knew; audio stays silent until it reports OPENED
+        ++numRestarts;
+        DebugLogWindow::addLog("Sandbox: " + description.name + " crashed or hung - restarting");
+
+        if (startChild())
+            failedRestarts = 0;
+        else if (++failedRestarts == maxFailedRestarts)
+            DebugLogWindow::addLog("Sandbox: Giving up on " + description.name);
+    }
+
+    // Overhead report every 30 s while audio flows
+    if (++timerTicks % 300 == 0)
+    {
+        auto stats = getStats();
+        if (stats.blocks != lastLoggedBlocks)
+        {
+            lastLoggedBlocks = stats.blocks;
+            DebugLogWindow::addLog("Sandbox: " + description.name + " overhead mean "
+                                 + juce::String(stats.meanOverheadMs, 3) + " ms, max "
+                                 + juce::String(stats.maxOverheadMs, 3) + " ms, missed "
+                                 + juce::String(stats.missedDeadlines) + "/" + juce::String(stats.blocks));
+        }
+    }
+}
+
+SandboxedPlugin::Stats SandboxedPlugin::getStats() const
+{
+    Stats stats;
+    stats.blocks = numBlocks.load();
+    stats.missedDeadlines = numMissed.load();
+    stats.restarts = numRestarts.load();
+    stats.hangs = numHangs.load();
+
+    auto completed = stats.blocks - stats.missedDeadlines;
+    if (completed > 0)
+        stats.meanOverheadMs = 1000.0 * juce::Time::highResolutionTicksToSeconds(overheadTicksTotal.load()) / (double)completed;
+    stats.maxOverheadMs = 1000.0 * juce::Time::highResolutionTicksToSeconds(overheadTicksMax.load());
+    return stats;
+}
+
+void SandboxedPlugin::fillInPluginDescription(juce::PluginDescription& desc) const
+{
+    desc = description;
+}
+
+const juce::String SandboxedPlugin::getName() const
+{
+    return description.name;
+}
+
+void SandboxedPlugin::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    currentSampleRate = sampleRate;
+    currentBlockSize = maximumExpectedSamplesPerBlock;
+    awaitingLateReply = false;
+
+    juce::XmlElement prepare("PREPARE");
+    prepare.setAttribute("sampleRate", sampleRate);
+    prepare.setAttribute("blockSize", juce::jmin(maximumExpectedSamplesPerBlock, SandboxSharedBlock::maxSamples));
+    send(prepare);
+}
+
+void SandboxedPlugin::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    if (!childReady || shared == nullptr)
+    {
+        buffer.clear();
+        return;
+    }
+
+    // A block the child overran is still in its hands: wait for it to finish before sending more
+    if (awaitingLateReply)
+    {
+        if (shared->replySeq.load(std::memory_order_acquire) != shared->requestSeq.load(std::memory_order_relaxed))
+        {
+            buffer.clear();
+            ++numBlocks;
+            noteMissedBlock();
+            return;
+        }
+        awaitingLateReply = false;
+    }
+
+    for (int start = 0; start < buffer.getNumSamples(); start += SandboxSharedBlock::maxSamples)
+        renderChunk(buffer, start, juce::jmin(SandboxSharedBlock::maxSamples, buffer.getNumSamples() - start), midiMessages);
+
+    midiMessages.clear();
+}
+
+void SandboxedPlugin::renderChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, const juce::MidiBuffer& midi)
+{
+    ++numBlocks;
+
+    if (awaitingLateReply || childLost)
+    {
+        buffer.clear(startSample, numSamples);
+        noteMissedBlock();
+        return;
+    }
+
+    int channels = juce::jmin(buffer.getNumChannels(), SandboxSharedBlock::maxChannels);
+    shared->numSamples = numSamples;
+    shared->numChannels = channels;
+
+    for (int ch = 0; ch < channels; ++ch)
+        std::memcpy(shared->audio[ch], buffer.getReadPointer(ch, startSample), (size_t)numSamples * sizeof(float));
+
+    int midiBytes = 0;
+    for (const auto metadata : midi)
+    {
+        if (metadata.samplePosition < startSample || metadata.samplePosition >= startSample + numSamples)
+            continue;
+
+        auto eventBytes = (int)(sizeof(juce::int32) + sizeof(juce::uint16)) + metadata.numBytes;
+        if (midiBytes + eventBytes > SandboxSharedBlock::midiCapacity)
+            break;
+
+        auto offset = (juce::int32)(metadata.samplePosition - startSample);
+        auto size = (juce::uint16)metadata.numBytes;
+        std::memcpy(shared->midi + midiBytes, &offset, sizeof(offset));
+        std::memcpy(shared->midi + midiBytes + sizeof(offset), &size, sizeof(size));
+        std::memcpy(shared->midi + midiBytes + sizeof(offset) + sizeof(size), metadata.data, (size_t)metadata.numBytes);
+        midiBytes += eventBytes;
+    }
+    shared->midiBytes = midiBytes;
+
+    auto sequence = shared->requestSeq.load(std::memory_order_relaxed) + 1;
+    auto deadlineMs = deadlineFraction * 1000.0 * numSamples / currentSampleRate;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    shared->requestSeq.store(sequence, std::memory_order_release);
+    requestSemaphore->post();
+
+    bool replied = false;
+    for (;;)
+    {
+        // Stale posts from blocks we already gave up on are skipped by the sequence check
+        if (shared->replySeq.load(std::memory_order_acquire) == sequence)
+        {
+            replied = true;
+            break;
+        }
+
+        auto elapsedMs = 1000.0 * juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        if (elapsedMs >= deadlineMs || childLost)
+            break;
+
+        replySemaphore->wait(deadlineMs - elapsedMs);
+    }
+
+    if (!replied)
+    {
+        awaitingLateReply = true;
+        noteMissedBlock();
+        buffer.clear(startSample, numSamples);
+        return;
+    }
+
+    consecutiveMisses.store(0, std::memory_order_relaxed);
+
+    auto overhead = juce::jmax((juce::int64)0, juce::Time::getHighResolutionTicks() - startTicks - shared->childProcessTicks);
+    overheadTicksTotal += overhead;
+    if (overhead > overheadTicksMax.load(std::memory_order_relaxed))
+        overheadTicksMax.store(overhead, std::memory_order_relaxed);
+
+    for (int ch = 0; ch < channels; ++ch)
+        buffer.copyFrom(ch, startSample, shared->audio[ch], numSamples);
+}
+
+void SandboxedPlugin::getStateInformation(juce::MemoryBlock& destData)
+{
+    if (childReady)
+    {
+        stateEvent.reset();
+        send(juce::XmlElement("GETSTATE"));
+        stateEvent.wait(5000);
+    }
+
+    // Falls back to the last state we saw if the child is gone or slow
+    const juce::ScopedLock sl(stateLock);
+    destData = lastState;
+}
+
+void SandboxedPlugin::setStateInformation(const void* data, int sizeInBytes)
+{
+    juce::MemoryBlock state(data, (size_t)sizeInBytes);
+    {
+        const juce::ScopedLock sl(stateLock);
+        lastState = state;
+    }
+
+    juce::XmlElement message("SETSTATE");
+    message.setAttribute("data", state.toBase64Encoding());
+    send(message);
+}
+
+//==============================================================================
+// PluginSandboxWorker
+//==============================================================================
+
+PluginSandboxWorker::PluginSandboxWorker()
+    : juce::Thread("Sandbox Render")
+{
+    formatManager.addDefaultFormats();
+}
+
+PluginSandboxWorker::~PluginSandboxWorker()
+{
+    stopThread(1000);
+}
+
+void PluginSandboxWorker::handleMessageFromCoordinator(const juce::MemoryBlock& message)
+{
+    std::shared_ptr<juce::XmlElement> request(juce::parseXML(message.toString()).release());
+    if (request == nullptr)
+        return;
+
+    // Plugins expect to be created and configured on the message thread
+    juce::MessageManager::callAsync([this, request]
+    {
+        if (request->hasTagName("OPEN"))
+        {
+            open(*request);
+        }
+        else if (plugin == nullptr)
+        {
+            return;
+        }
+        else if (request->hasTagName("PREPARE"))
+        {
+            const juce::ScopedLock sl(pluginLock);
+            plugin->prepareToPlay(request->getDoubleAttribute("sampleRate", 44100.0),
+                                  request->getIntAttribute("blockSize", 512));
+        }
+        else if (request->hasTagName("GETSTATE"))
+        {
+            juce::MemoryBlock state;
+            {
+                const juce::ScopedLock sl(pluginLock);
+                plugin->getStateInformation(state);
+            }
+
+            juce::XmlElement message("STATE");
+            message.setAttribute("data", state.toBase64Encoding());
+            reply(message);
+        }
+        else if (request->hasTagName("SETSTATE"))
+        {
+            juce::MemoryBlock state;
+            state.fromBase64Encoding(request->getStringAttribute("data"));
+
+            const juce::ScopedLock sl(pluginLock);
+            plugin->setStateInformation(state.getData(), (int)state.getSize());
+        }
+    });
+}
+
+void PluginSandboxWorker::open(const juce::XmlElement& request)
+{
+    juce::XmlElement result("OPENED");
+    result.setAttribute("pid", juce::String(getCurrentProcessId()));
+    auto fail = [&](const juce::String& error)
+    {
+        result.setAttribute("error", error);
+        reply(result);
+    };
+
+    sharedMapping = std::make_unique<juce::MemoryMappedFile>(juce::File(request.getStringAttribute("shared")),
+                                                             juce::MemoryMappedFile::readWrite, false);
+    if (sharedMapping->getData() == nullptr || sharedMapping->getSize() < sizeof(SandboxSharedBlock))
+        return fail("Could not map shared memory");
+
+    shared = static_cast<SandboxSharedBlock*>(sharedMapping->getData());
+
+    auto name = request.getStringAttribute("name");
+    requestSemaphore = std::make_unique<InterProcessSemaphore>(name + "q", false);
+    replySemaphore = std::make_unique<InterProcessSemaphore>(name + "p", false);
+    if (!requestSemaphore->isValid() || !replySemaphore->isValid())
+        return fail("Could not open sandbox semaphores");
+
+    auto sampleRate = request.getDoubleAttribute("sampleRate", 44100.0);
+    auto blockSize = juce::jmin(request.getIntAttribute("blockSize", 512), SandboxSharedBlock::maxSamples);
+
+    if (request.getBoolAttribute("testTone"))
+    {
+        plugin = std::make_unique<SandboxTestTone>();
+    }
+    else
+    {
+        juce::PluginDescription desc;
+        auto* descXml = request.getChildByName("PLUGIN");
+        if (descXml == nullptr || !desc.loadFromXml(*descXml))
+            return fail("Invalid plugin description");
+
+        juce::String error;
+        plugin = formatManager.createPluginInstance(desc, sampleRate, blockSize, error);
+        if (plugin == nullptr)
+            return fail(error.isNotEmpty() ? error : juce::String("Plugin could not be created"));
+    }
+
+    plugin->prepareToPlay(sampleRate, blockSize);
+
+    juce::MemoryBlock state;
+    state.fromBase64Encoding(request.getStringAttribute("state"));
+    if (state.getSize() > 0)
+        plugin->setStateInformation(state.getData(), (int)state.getSize());
+
+    int channels = juce::jmax(SandboxSharedBlock::maxChannels,
+                              plugin->getTotalNumInputChannels(), plugin->getTotalNumOutputChannels());
+    renderBuffer.setSize(channels, SandboxSharedBlock::maxSamples);
+    renderMidi.ensureSize(SandboxSharedBlock::midiCapacity);
+
+    // Anything the host sent to a previous child is void
+    shared->replySeq.store(shared->requestSeq.load());
+
+    startThread(juce::Thread::Priority::highest);
+    reply(result);
+}
+
+void PluginSandboxWorker::reply(const juce::XmlElement& message)
+{
+    sendMessageToCoordinator(toMemoryBlock(message));
+}
+
+void PluginSandboxWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        if (!requestSemaphore->wait(100.0))
+            continue;
+
+        auto sequence = shared->requestSeq.load(std::memory_order_acquire);
+        if (sequence == shared->replySeq.load(std::memory_order_relaxed))
+            continue;
+
+        auto startTicks = juce::Time::getHighResolutionTicks();
+
+        // The host may rewrite the block after giving up on us, so never trust the sizes
+        int numSamples = juce::jlimit(0, SandboxSharedBlock::maxSamples, (int)shared->numSamples);
+        int channels = juce::jlimit(0, SandboxSharedBlock::maxChannels, (int)shared->numChannels);
+        int midiBytes = juce::jlimit(0, SandboxSharedBlock::midiCapacity, (int)shared->midiBytes);
+
+        {
+            const juce::ScopedLock sl(pluginLock);
+
+            renderBuffer.setSize(renderBuffer.getNumChannels(), numSamples, false, false, true);
+            renderBuffer.clear();
+            for (int ch = 0; ch < channels; ++ch)
+                renderBuffer.copyFrom(ch, 0, shared->audio[ch], numSamples);
+
+            renderMidi.clear();
+            for (int pos = 0; pos + (int)(sizeof(juce::int32) + sizeof(juce::uint16)) <= midiBytes;)
+            {
+                juce::int32 offset;
+                juce::uint16 size;
+                std::memcpy(&offset, shared->midi + pos, sizeof(offset));
+                std::memcpy(&size, shared->midi + pos + sizeof(offset), sizeof(size));
+                pos += (int)(sizeof(offset) + sizeof(size));
+
+                if (pos + size > midiBytes)
+                    break;
+
+                renderMidi.addEvent(shared->midi + pos, size, juce::jlimit(0, juce::jmax(0, numSamples - 1), (int)offset));
+                pos += size;
+            }
+
+            plugin->processBlock(renderBuffer, renderMidi);
+
+            for (int ch = 0; ch < channels; ++ch)
+                std::memcpy(shared->audio[ch], renderBuffer.getReadPointer(ch), (size_t)numSamples * sizeof(float));
+        }
+
+        shared->childProcessTicks = juce::Time::getHighResolutionTicks() - startTicks;
+        shared->replySeq.store(sequence, std::memory_order_release);
+        replySemaphore->post();
+    }
+}
+
+void PluginSandboxWorker::handleConnectionLost()
+{
+    juce::JUCEApplicationBase::quit();
+}
+
+} // namespace pianodaw
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_events/juce_events.h>
+#include <atomic>
+#include <memory>
+
+namespace pianodaw {
+
+class InterProcessSemaphore;
+
+/**
+ * SandboxSharedBlock - Memory layout shared between host and sandbox child
+ *
+ * Lives in a memory-mapped file (/dev/shm where available). The host writes
+ * one block of input audio and packed MIDI, bumps requestSeq and posts the
+ * request semaphore; the child renders in place, sets replySeq to the same
+ * value and posts the reply semaphore. Only plain data and lock-free
+ * atomics, so both processes can map it at any address.
+ */
+struct SandboxSharedBlock
+{
+    static constexpr int maxChannels = 8;
+    static constexpr int maxSamples = 4096;
+    static constexpr int midiCapacity = 16384;   // Packed as [int32 offset][uint16 size][bytes]
+
+    std::atomic<juce::uint32> requestSeq;
+    std::atomic<juce::uint32> replySeq;
+    juce::int32 numSamples;
+    juce::int32 numChannels;
+    juce::int32 midiBytes;
+    juce::int64 childProcessTicks;               // Child's render time for the last block (high-res ticks)
+    float audio[maxChannels][maxSamples];
+    juce::uint8 midi[midiCapacity];
+};
+
+/**
+ * SandboxedPlugin - Hosts a plugin in a child process
+ *
+ * Looks like any other AudioPluginInstance to the graph, but the real plugin
+ * lives in a copy of this executable started with childProcessID. A crash or
+ * hang there only silences this instrument: the child is relaunched with the
+ * last known state, and blocks the child misses its deadline for are output
+ * as silence instead of stalling the device. A watchdog on the message thread
+ * kills a child that misses many deadlines in a row or holds on to a block
+ * for too long, since a hung child never drops its connection by itself.
+ *
+ * The round trip per block is measured; getStats() reports the transport
+ * overhead (round trip minus the child's own render time).
+ */
+class SandboxedPlugin : public juce::AudioPluginInstance,
+                        private juce::Timer
+{
+public:
+    /** Command line token that starts the app as a sandbox child process */
+    static constexpr const char* childProcessID = "pianodaw-plugin-sandbox";
+
+    /**
+     * Built-in stand-in instrument (sine per note) that runs in the child
+     * Builds with PIANODAW_SANDBOX_FAULT_HOOKS (the sandbox tests) crash it on note 0 and hang it on note 1.
+     */
+    static juce::PluginDescription getTestToneDescription();
+    static bool isTestTone(const juce::PluginDescription& description);
+
+    SandboxedPlugin(const juce::PluginDescription& description, int numChannels, double sampleRate, int blockSize);
+    ~SandboxedPlugin() override;
+
+    /** Start the child and load the plugin there, waiting up to timeoutMs for it to come up */
+    bool launch(int timeoutMs, juce::String& errorMessage);
+
+    struct Stats
+    {
+        juce::int64 blocks = 0;
+        juce::int64 missedDeadlines = 0;
+        int restarts = 0;
+        int hangs = 0;                  // Children the watchdog killed
+        double meanOverheadMs = 0.0;
+        double maxOverheadMs = 0.0;
+    };
+    Stats getStats() const;
+
+    // AudioPluginInstance
+    void fillInPluginDescription(juce::PluginDescription& description) const override;
+
+    // AudioProcessor
+    const juce::String getName() const override;
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override {}
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
+
+    double getTailLengthSeconds() const override { return 0.0; }
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return false; }
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const juce::String getProgramName(int) override { return {}; }
+    void changeProgramName(int, const juce::String&) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+private:
+    class Connection;
+
+    void timerCallback() override;
+    bool startChild();
+    void killChild();
+    bool isUnresponsive() const;
+    void noteMissedBlock();
+    void renderChunk(juce::AudioBuffer<float>& buffer, int startSample, int numSamples, const juce::MidiBuffer& midi);
+    void handleReply(const juce::XmlElement& reply);
+    void send(const juce::XmlElement& message);
+
+    juce::PluginDescription description;
+    const int numChannels;
+
+    juce::String sharedName;
+    juce::File sharedFile;
+    std::unique_ptr<juce::MemoryMappedFile> sharedMapping;
+    SandboxSharedBlock* shared = nullptr;
+    std::unique_ptr<InterProcessSemaphore> requestSemaphore, replySemaphore;
+
+    // The timer relaunches the child while loader threads may be sending it state; the audio thread never sends
+    juce::CriticalSection connectionLock;
+    std::unique_ptr<Connection> connection;
+    std::atomic<bool> childReady { false };
+    std::atomic<bool> childLost { false };
+    std::atomic<juce::int64> childPid { 0 };
+    juce::String childError;
+    juce::WaitableEvent openEvent, stateEvent;
+
+    // Last state known to the host; replayed into a relaunched child
+    juce::CriticalSection stateLock;
+    juce::MemoryBlock lastState;
+
+    // Audio thread
+    bool awaitingLateReply = false;
+    double currentSampleRate = 44100.0;
+    int currentBlockSize = 512;
+
+    // Watchdog: misses since the last reply (audio thread) and when the first of them happened
+    std::atomic<int> consecutiveMisses { 0 };
+    std::atomic<juce::int64> firstMissTicks { 0 };
+
+    // Statistics (written on the audio thread)
+    std::atomic<juce::int64> numBlocks { 0 }, numMissed { 0 }, overheadTicksTotal { 0 }, overheadTicksMax { 0 };
+    std::atomic<int> numRestarts { 0 }, numHangs { 0 };
+    int failedRestarts = 0;
+    int timerTicks = 0;
+    juce::int64 lastLoggedBlocks = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxedPlugin)
+};
+
+/**
+ * PluginSandboxWorker - Child side of the sandbox
+ *
+ * Loads the plugin on the child's message thread and renders blocks on a
+ * high-priority thread that sleeps on the request semaphore.
+ */
+class PluginSandboxWorker : public juce::ChildProcessWorker,
+                            private juce::Thread
+{
+public:
+    PluginSandboxWorker();
+    ~PluginSandboxWorker() override;
+
+    void handleMessageFromCoordinator(const juce::MemoryBlock& message) override;
+    void handleConnectionLost() override;
+
+private:
+    void run() override;
+    void open(const juce::XmlElement& request);
+    void reply(const juce::XmlElement& message);
+
+    juce::AudioPluginFormatManager formatManager;
+    std::unique_ptr<juce::AudioProcessor> plugin;
+
+    std::unique_ptr<juce::MemoryMappedFile> sharedMapping;
+    SandboxSharedBlock* shared = nullptr;
+    std::unique_ptr<InterProcessSemaphore> requestSemaphore, replySemaphore;
+
+    juce::CriticalSection pluginLock;   // Held while rendering and while state/prepare calls touch the plugin
+    juce::AudioBuffer<float> renderBuffer;
+    juce::MidiBuffer renderMidi;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginSandboxWorker)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,399 @@
+#include "PluginScanner.h"
+#include "../../ui/panels/DebugLogWindow.h"
+
+namespace pianodaw {
+
+namespace
+{
+    constexpr int scanTimeoutMs = 60000;   // A single plugin taking longer is treated as hung
+
+    /** Coordinator side of one scanner child process */
+    class ScannerCoordinator : public juce::ChildProcessCoordinator
+    {
+    public:
+        enum class Result { ok, crashed, timedOut };
+
+        bool launch()
+        {
+            return launchWorkerProcess(juce::File::getSpecialLocation(juce::File::currentExecutableFile),
+                                       PluginScanner::childProcessID, 0, 0);
+        }
+
+        Result scan(const juce::String& formatName, const juce::String& fileOrIdentifier,
+                    juce::OwnedArray<juce::PluginDescription>& result)
+        {
+            {
+                const juce::ScopedLock sl(replyLock);
+                reply.reset();
+            }
+            replyReady.reset();
+
+            juce::XmlElement request("SCAN");
+            request.setAttribute("format", formatName);
+            request.setAttribute("file", fileOrIdentifier);
+
+            juce::MemoryBlock block;
+            block.append(request.toString().toRawUTF8(), request.toString().getNumBytesAsUTF8());
+
+            if (connectionLost || !sendMessageToWorker(block))
+                return Result::crashed;
+
+            if (!replyReady.wait(scanTimeoutMs))
+                return Result::timedOut;
+
+            const juce::ScopedLock sl(replyLock);
+            if (reply == nullptr)
+                return Result::crashed;
+
+            for (auto* e : reply->getChildIterator())
+            {
+                auto desc = std::make_unique<juce::PluginDescription>();
+                if (desc->loadFromXml(*e))
+                    result.add(desc.release());
+            }
+
+            return Result::ok;
+        }
+
+        void handleMessageFromWorker(const juce::MemoryBlock& message) override
+        {
+            {
+                const juce::ScopedLock sl(replyLock);
+                reply = juce::parseXML(message.toString());
+            }
+            replyReady.signal();
+        }
+
+        void handleConnectionLost() override
+        {
+            connectionLost = true;
+            replyReady.signal();
+        }
+
+    private:
+        juce::WaitableEvent replyReady;
+        juce::CriticalSection replyLock;
+        std::unique_ptr<juce::XmlElement> reply;
+        std::atomic<bool> connectionLost { false };
+    };
+
+    /** Routes KnownPluginList::scanAndAddFile through a child process */
+    class ChildProcessPluginScanner : public juce::KnownPluginList::CustomScanner
+    {
+    public:
+        bool findPluginTypesFor(juce::AudioPluginFormat& format,
+                                juce::OwnedArray<juce::PluginDescription>& result,
+                                const juce::String& fileOrIdentifier) override
+        {
+            if (coordinator == nullptr)
+            {
+                coordinator = std::make_unique<ScannerCoordinator>();
+                if (!coordinator->launch())
+                {
+                    // No child process available: scan in-process rather than not at all
+                    coordinator.reset();
+                    format.findAllTypesForFile(result, fileOrIdentifier);
+                    return true;
+                }
+            }
+
+            auto outcome = coordinator->scan(format.getName(), fileOrIdentifier, result);
+            if (outcome == ScannerCoordinator::Result::ok)
+                return true;
+
+            DebugLogWindow::addLog(juce::String("PluginScanner: ")
+                + (outcome == ScannerCoordinator::Result::timedOut ? "Timed out" : "Crashed")
+                + " scanning " + fileOrIdentifier + " - blacklisted");
+
+            // Relaunch a fresh child for the next file; returning false blacklists this one
+            coordinator.reset();
+            return false;
+        }
+
+    private:
+        std::unique_ptr<ScannerCoordinator> coordinator;
+    };
+}
+
+//==============================================================================
+// PluginScanner
+//==============================================================================
+
+PluginScanner::PluginScanner(juce::KnownPluginList& list, const juce::File& file)
+    : juce::Thread("Plugin Scanner"), knownPluginList(list), listFile(file)
+{
+}
+
+PluginScanner::~PluginScanner()
+{
+    stopThread(scanTimeoutMs + 5000);
+}
+
+void PluginScanner::startScan()
+{
+    if (isThreadRunning())
+        return;
+
+    progress = 0.0f;
+    startThread(juce::Thread::Priority::background);
+}
+
+void PluginScanner::cancelScan()
+{
+    signalThreadShouldExit();
+}
+
+juce::String PluginScanner::getCurrentFile() const
+{
+    const juce::ScopedLock sl(stateLock);
+    return currentFile;
+}
+
+juce::FileSearchPath PluginScanner::getDefaultSearchPath()
+{
+    juce::FileSearchPath searchPath;
+#if JUCE_WINDOWS
+    searchPath.add(juce::File("C:\\Program Files\\Common Files\\VST3"));
+    searchPath.add(juce::File("C:\\Program Files\\VSTPlugins"));
+#elif JUCE_MAC
+    searchPath.add(juce::File("/Library/Audio/Plug-Ins/VST3"));
+    searchPath.add(juce::File("~/Library/Audio/Plug-Ins/VST3"));
+#elif JUCE_LINUX || JUCE_BSD
+    searchPath.add(juce::File("~/.vst3"));
+    searchPath.add(juce::File("/usr/lib/vst3"));
+    searchPath.add(juce::File("/usr/local/lib/vst3"));
+#endif
+    return searchPath;
+}
+
+juce::File PluginScanner::getDeadMansPedalFile() const
+{
+    return listFile.getSiblingFile("plugins-scanning.txt");
+}
+
+juce::int64 PluginScanner::getModificationTime(const juce::String& fileOrIdentifier)
+{
+    if (!juce::File::isAbsolutePath(fileOrIdentifier))
+        return 0;  // Identifier-based formats (AU): presence in the list is all we can cache
+
+    juce::File file(fileOrIdentifier);
+    auto newest = file.getLastModificationTime().toMilliseconds();
+
+    // VST3 bundles are folders: an updated binary does not touch the folder's own timestamp
+    if (file.isDirectory())
+    {
+        for (const auto& entry : juce::RangedDirectoryIterator(file, true, "*", juce::File::findFiles))
+            newest = juce::jmax(newest, entry.getModificationTime().toMilliseconds());
+    }
+
+    return newest;
+}
+
+bool PluginScanner::isCachedUpToDate(const juce::String& fileOrIdentifier, juce::int64 modificationTime)
+{
+    const juce::ScopedLock sl(stateLock);
+    auto it = scanCache.find(fileOrIdentifier);
+    return it != scanCache.end() && it->second == modificationTime;
+}
+
+void PluginScanner::removeVanishedPlugins()
+{
+    for (auto& type : knownPluginList.getTypes())
+    {
+        if (juce::File::isAbsolutePath(type.fileOrIdentifier) && !juce::File(type.fileOrIdentifier).exists())
+            knownPluginList.removeType(type);
+    }
+
+    const juce::ScopedLock sl(stateLock);
+    for (auto it = scanCache.begin(); it != scanCache.end();)
+    {
+        if (juce::File::isAbsolutePath(it->first) && !juce::File(it->first).exists())
+            it = scanCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void PluginScanner::run()
+{
+    // A file left on the pedal crashed or hung the host during the last scan
+    auto pedal = getDeadMansPedalFile();
+    juce::PluginDirectoryScanner::applyBlacklistingsFromDeadMansPedal(knownPluginList, pedal);
+
+    // Cache it too, so it stays blacklisted until the bundle changes
+    for (auto& crashed : juce::StringArray::fromLines(pedal.loadFileAsString()))
+    {
+        if (crashed.isNotEmpty())
+        {
+            const juce::ScopedLock sl(stateLock);
+            scanCache[crashed] = getModificationTime(crashed);
+        }
+    }
+    pedal.deleteFile();
+
+    if (useChildProcess)
+        knownPluginList.setCustomScanner(std::make_unique<ChildProcessPluginScanner>());
+
+    juce::AudioPluginFormatManager manager;
+    manager.addDefaultFormats();
+
+    // Collect work first so progress is meaningful
+    struct Job
+    {
+        juce::AudioPluginFormat* format;
+        juce::String fileOrIdentifier;
+    };
+    std::vector<Job> jobs;
+
+    for (auto* format : manager.getFormats())
+    {
+        auto searchPath = getDefaultSearchPath();
+        searchPath.addPath(format->getDefaultLocationsToSearch());
+        searchPath.removeRedundantPaths();
+
+        for (auto& file : format->searchPathsForPlugins(searchPath, true, false))
+            jobs.push_back({ format, file });
+    }
+
+    removeVanishedPlugins();
+
+    int numScanned = 0;
+    for (size_t i = 0; i < jobs.size() && !threadShouldExit(); ++i)
+    {
+        auto& job = jobs[i];
+        progress = (float)i / (float)jobs.size();
+
+        auto modificationTime = getModificationTime(job.fileOrIdentifier);
+        if (isCachedUpToDate(job.fileOrIdentifier, modificationTime))
+            continue;
+
+        // A changed bundle gets another chance even if it was blacklisted before
+        knownPluginList.removeFromBlacklist(job.fileOrIdentifier);
+
+        {
+            const juce::ScopedLock sl(stateLock);
+            currentFile = job.fileOrIdentifier;
+        }
+        sendChangeMessage();
+
+        // Drop stale descriptions from an older version of this bundle
+        for (auto& type : knownPluginList.getTypes())
+        {
+            if (type.fileOrIdentifier == job.fileOrIdentifier)
+                knownPluginList.removeType(type);
+        }
+
+        pedal.replaceWithText(job.fileOrIdentifier);
+
+        juce::OwnedArray<juce::PluginDescription> found;
+        knownPluginList.scanAndAddFile(job.fileOrIdentifier, false, found, *job.format);
+
+        pedal.deleteFile();
+        ++numScanned;
+
+        // Cache even when nothing was found, so empty/broken bundles are not rescanned
+        const juce::ScopedLock sl(stateLock);
+        scanCache[job.fileOrIdentifier] = modificationTime;
+    }
+
+    knownPluginList.setCustomScanner(nullptr);
+
+    {
+        const juce::ScopedLock sl(stateLock);
+        currentFile.clear();
+    }
+
+    progress = 1.0f;
+    saveList();
+
+    DebugLogWindow::addLog("PluginScanner: Scanned " + juce::String(numScanned) + " of "
+                         + juce::String((int)jobs.size()) + " files ("
+                         + juce::String(knownPluginList.getNumTypes()) + " plugins known)");
+    sendChangeMessage();
+}
+
+void PluginScanner::saveList()
+{
+    auto xml = knownPluginList.createXml();
+    if (xml == nullptr)
+        return;
+
+    // KnownPluginList::recreateFromXml ignores child tags it does not know
+    auto* cacheXml = xml->createNewChildElement("SCANCACHE");
+    {
+        const juce::ScopedLock sl(stateLock);
+        for (auto& entry : scanCache)
+        {
+            auto* fileXml = cacheXml->createNewChildElement("FILE");
+            fileXml->setAttribute("id", entry.first);
+            fileXml->setAttribute("modified", juce::String(entry.second));
+        }
+    }
+
+    xml->writeTo(listFile);
+}
+
+void PluginScanner::loadList()
+{
+    if (!listFile.existsAsFile())
+        return;
+
+    auto xml = juce::XmlDocument::parse(listFile);
+    if (xml == nullptr)
+        return;
+
+    knownPluginList.recreateFromXml(*xml);
+
+    const juce::ScopedLock sl(stateLock);
+    scanCache.clear();
+    if (auto* cacheXml = xml->getChildByName("SCANCACHE"))
+    {
+        for (auto* fileXml : cacheXml->getChildWithTagNameIterator("FILE"))
+            scanCache[fileXml->getStringAttribute("id")] = fileXml->getStringAttribute("modified").getLargeIntValue();
+    }
+}
+
+//==============================================================================
+// PluginScannerWorker
+//==============================================================================
+
+PluginScannerWorker::PluginScannerWorker()
+{
+    formatManager.addDefaultFormats();
+}
+
+void PluginScannerWorker::handleMessageFromCoordinator(const juce::MemoryBlock& message)
+{
+    auto request = juce::parseXML(message.toString());
+    if (request == nullptr || !request->hasTagName("SCAN"))
+        return;
+
+    auto formatName = request->getStringAttribute("format");
+    auto fileOrIdentifier = request->getStringAttribute("file");
+
+    // Plugins expect to be loaded on the message thread
+    juce::MessageManager::callAsync([this, formatName, fileOrIdentifier]
+    {
+        juce::OwnedArray<juce::PluginDescription> found;
+
+        for (auto* format : formatManager.getFormats())
+        {
+            if (format->getName() == formatName)
+                format->findAllTypesForFile(found, fileOrIdentifier);
+        }
+
+        juce::XmlElement reply("SCANRESULT");
+        for (auto* desc : found)
+            reply.addChildElement(desc->createXml().release());
+
+        auto text = reply.toString();
+        sendMessageToCoordinator(juce::MemoryBlock(text.toRawUTF8(), text.getNumBytesAsUTF8()));
+    });
+}
+
+void PluginScannerWorker::handleConnectionLost()
+{
+    juce::JUCEApplicationBase::quit();
+}
+
+} // namespace pianodaw
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_events/juce_events.h>
+#include <atomic>
+#include <map>
+
+namespace pianodaw {
+
+/**
+ * PluginScanner - Background, incremental plugin scanning
+ *
+ * Runs on its own thread so the UI never blocks. Each plugin file is scanned
+ * in a child process (PluginScannerWorker) so a crashing plugin only takes
+ * down the scanner; files that crash or hang are blacklisted. A dead-man's
+ * pedal file records the file in flight in case the host itself dies.
+ *
+ * plugins.xml keeps a SCANCACHE of file modification times, so a rescan only
+ * touches bundles that were added or changed since the last scan.
+ */
+class PluginScanner : private juce::Thread,
+                      public juce::ChangeBroadcaster
+{
+public:
+    /** Command line token that starts the app as a scanner child process */
+    static constexpr const char* childProcessID = "pianodaw-plugin-scanner";
+
+    PluginScanner(juce::KnownPluginList& list, const juce::File& listFile);
+    ~PluginScanner() override;
+
+    /** Start a background scan (no-op while one is running) */
+    void startScan();
+
+    /** Ask a running scan to stop after the current file */
+    void cancelScan();
+
+    bool isScanning() const { return isThreadRunning(); }
+    float getProgress() const { return progress.load(); }
+    juce::String getCurrentFile() const;
+
+    /** Scan in a child process (default) or in-process */
+    void setUseChildProcess(bool shouldUse) { useChildProcess = shouldUse; }
+
+    // Persistence (plugins.xml)
+    void loadList();
+    void saveList();
+
+    /** Standard VST3 locations for this platform */
+    static juce::FileSearchPath getDefaultSearchPath();
+
+private:
+    void run() override;
+
+    static juce::int64 getModificationTime(const juce::String& fileOrIdentifier);
+    bool isCachedUpToDate(const juce::String& fileOrIdentifier, juce::int64 modificationTime);
+    void removeVanishedPlugins();
+    juce::File getDeadMansPedalFile() const;
+
+    juce::KnownPluginList& knownPluginList;
+    juce::File listFile;
+
+    std::atomic<bool> useChildProcess { true };
+    std::atomic<float> progress { 0.0f };
+
+    juce::CriticalSection stateLock;
+    juce::String currentFile;
+    std::map<juce::String, juce::int64> scanCache;   // fileOrIdentifier -> modification time (ms)
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginScanner)
+};
+
+/**
+ * PluginScannerWorker - Child side of out-of-process scanning
+ *
+ * Receives one "scan this file" request at a time, scans it on the child's
+ * message thread and replies with the PluginDescriptions found.
+ */
+class PluginScannerWorker : public juce::ChildProcessWorker
+{
+public:
+    PluginScannerWorker();
+
+    void handleMessageFromCoordinator(const juce::MemoryBlock& message) override;
+    void handleConnectionLost() override;
+
+private:
+    juce::AudioPluginFormatManager formatManager;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginScannerWorker)
+};
+
+} // namespace pianodaw
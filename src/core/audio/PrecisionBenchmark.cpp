@@ -0,0 +1,88 @@
+#include "PrecisionBenchmark.h"
+#include "AudioEngine.h"
+#include "../model/Project.h"
+#include "../timeline/Transport.h"
+#include <cmath>
+#include <type_traits>
+
+namespace pianodaw {
+
+namespace
+{
+    template <typename SampleType>
+    double renderProject(Project& project, double tempoBPM, double sampleRate, int blockSize, double audioSeconds)
+    {
+        constexpr bool doublePrecision = std::is_same<SampleType, double>::value;
+
+        Transport transport;
+        transport.setTempo(tempoBPM);
+        transport.start();
+
+        AudioEngine engine(project, transport);
+        engine.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+        engine.setProcessingPrecision(doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                      : juce::AudioProcessor::singlePrecision);
+        engine.prepareToPlay(sampleRate, blockSize);
+
+        juce::AudioBuffer<SampleType> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+
+        auto numBlocks = (juce::int64)std::ceil(audioSeconds * sampleRate / blockSize);
+
+        // The engine's playhead is the clock; nothing locates the transport meanwhile
+        auto renderOne = [&]
+        {
+            midi.clear();
+            engine.processBlock(buffer, midi);
+        };
+
+        // Warm up caches and let the first notes start before timing
+        for (int i = 0; i < 16; ++i)
+            renderOne();
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for (juce::int64 i = 0; i < numBlocks; ++i)
+            renderOne();
+        auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        engine.releaseResources();
+        transport.stop();
+        return elapsed;
+    }
+}
+
+double PrecisionBenchmark::Result::getRealtimeFactor(bool doublePrecision) const
+{
+    double seconds = doublePrecision ? doubleSeconds : floatSeconds;
+    return seconds > 0.0 ? audioSeconds / seconds : 0.0;
+}
+
+juce::String PrecisionBenchmark::Result::toString() const
+{
+    juce::String text;
+    text << "Rendered " << juce::String(audioSeconds, 1) << " s at " << juce::String(sampleRate, 0)
+         << " Hz, " << blockSize << "-sample blocks\n"
+         << "  float:  " << juce::String(floatSeconds * 1000.0, 1) << " ms ("
+         << juce::String(getRealtimeFactor(false), 1) << "x realtime)\n"
+         << "  double: " << juce::String(doubleSeconds * 1000.0, 1) << " ms ("
+         << juce::String(getRealtimeFactor(true), 1) << "x realtime)";
+
+    if (floatSeconds > 0.0)
+        text << "\n  double/float time: " << juce::String(doubleSeconds / floatSeconds, 2);
+
+    return text;
+}
+
+PrecisionBenchmark::Result PrecisionBenchmark::run(Project& project, double tempoBPM, double sampleRate,
+                                                   int blockSize, double audioSeconds)
+{
+    Result result;
+    result.sampleRate = sampleRate;
+    result.blockSize = blockSize;
+    result.audioSeconds = audioSeconds;
+    result.floatSeconds = renderProject<float>(project, tempoBPM, sampleRate, blockSize, audioSeconds);
+    result.doubleSeconds = renderProject<double>(project, tempoBPM, sampleRate, blockSize, audioSeconds);
+    return result;
+}
+
+} // namespace pianodaw
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace pianodaw {
+
+class Project;
+
+/**
+ * PrecisionBenchmark - Float vs double throughput of the AudioEngine
+ *
+ * Renders the project offline, as fast as it will go, through a private
+ * AudioEngine (its own transport, the built-in synth, no hosted plugins)
+ * once in each precision, and reports how many times faster than realtime
+ * each ran. Runs on the calling (message) thread; the live engine keeps
+ * playing but competes for the project lock while it runs.
+ */
+class PrecisionBenchmark
+{
+public:
+    struct Result
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        double audioSeconds = 0.0;     // Rendered per precision
+        double floatSeconds = 0.0;     // Wall-clock time taken
+        double doubleSeconds = 0.0;
+
+        double getRealtimeFactor(bool doublePrecision) const;
+        juce::String toString() const;
+    };
+
+    static Result run(Project& project, double tempoBPM, double sampleRate, int blockSize, double audioSeconds);
+};
+
+} // namespace pianodaw
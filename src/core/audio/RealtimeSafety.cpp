@@ -0,0 +1,433 @@
+#if defined(PIANODAW_RT_CHECKS) && PIANODAW_RT_CHECKS
+ // Fortified inline wrappers of read/open would clash with the interceptors below
+ #undef _FORTIFY_SOURCE
+#endif
+
+#include "RealtimeSafety.h"
+#include <array>
+#include <atomic>
+
+#if PIANODAW_RT_CHECKS
+ #include <cerrno>
+ #include <cstdarg>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <new>
+
+ #if defined(__GLIBC__)
+  #define PIANODAW_RT_INTERPOSE_LIBC 1
+  #include <dlfcn.h>
+  #include <fcntl.h>
+  #include <pthread.h>
+  #include <time.h>
+  #include <unistd.h>
+ #else
+  #define PIANODAW_RT_INTERPOSE_LIBC 0
+ #endif
+
+ #if defined(__GLIBC__) || JUCE_MAC
+  #define PIANODAW_RT_BACKTRACE 1
+  #include <execinfo.h>
+ #else
+  #define PIANODAW_RT_BACKTRACE 0
+ #endif
+
+ #if defined(__GNUC__)
+  // Initial-exec TLS never allocates on first access, so the allocator hooks can read it
+  #define PIANODAW_RT_TLS __attribute__((tls_model("initial-exec")))
+ #else
+  #define PIANODAW_RT_TLS
+ #endif
+#endif
+
+namespace pianodaw {
+
+const char* RealtimeSafety::getKindName(Kind kind)
+{
+    switch (kind)
+    {
+        case Kind::allocation:   return "Allocation";
+        case Kind::deallocation: return "Deallocation";
+        case Kind::lockWait:     return "Lock wait";
+        case Kind::systemCall:   return "System call";
+        default:                 return "?";
+    }
+}
+
+#if PIANODAW_RT_CHECKS
+
+namespace
+{
+    // Constant-initialised: the hooks can run before any dynamic initialiser
+    struct Violation
+    {
+        std::atomic<bool> ready { false };
+        RealtimeSafety::Kind kind = RealtimeSafety::Kind::allocation;
+        const char* function = nullptr;
+        std::array<void*, RealtimeSafety::maxFrames> frames {};
+        int numFrames = 0;
+    };
+
+    std::array<Violation, RealtimeSafety::maxRecorded> recorded;
+    std::atomic<int> numViolations { 0 };
+    std::atomic<bool> enabled { false };
+    std::atomic<bool> strictLocking { false };
+
+    thread_local int realtimeDepth PIANODAW_RT_TLS = 0;
+    thread_local int allowanceDepth PIANODAW_RT_TLS = 0;
+    thread_local bool recording PIANODAW_RT_TLS = false;   // Capturing a stack may allocate itself
+
+    // check() and the interceptor that called it
+    constexpr int framesToSkip = 2;
+}
+
+RealtimeSafety::ScopedRealtime::ScopedRealtime()    { ++realtimeDepth; }
+RealtimeSafety::ScopedRealtime::~ScopedRealtime()   { --realtimeDepth; }
+RealtimeSafety::ScopedAllowance::ScopedAllowance()  { ++allowanceDepth; }
+RealtimeSafety::ScopedAllowance::~ScopedAllowance() { --allowanceDepth; }
+
+bool RealtimeSafety::isChecking()
+{
+    return realtimeDepth > 0 && allowanceDepth == 0 && !recording && enabled.load(std::memory_order_relaxed);
+}
+
+void RealtimeSafety::check(Kind kind, const char* function)
+{
+    if (!isChecking())
+        return;
+
+    recording = true;
+
+    int index = numViolations.fetch_add(1, std::memory_order_relaxed);
+    if (index < maxRecorded)
+    {
+        auto& violation = recorded[(size_t)index];
+        violation.kind = kind;
+        violation.function = function;
+       #if PIANODAW_RT_BACKTRACE
+        violation.numFrames = backtrace(violation.frames.data(), maxFrames);
+       #endif
+        violation.ready.store(true, std::memory_order_release);
+    }
+
+    recording = false;
+}
+
+void RealtimeSafety::setEnabled(bool shouldBeEnabled)
+{
+   #if PIANODAW_RT_BACKTRACE
+    // The first backtrace loads the unwinder; do it here rather than on the audio thread
+    if (shouldBeEnabled)
+    {
+        std::array<void*, 2> frames;
+        backtrace(frames.data(), (int)frames.size());
+    }
+   #endif
+
+    enabled.store(shouldBeEnabled);
+}
+
+bool RealtimeSafety::isEnabled()
+{
+    return enabled.load();
+}
+
+void RealtimeSafety::setStrictLocking(bool shouldBeStrict)
+{
+    strictLocking.store(shouldBeStrict);
+}
+
+int RealtimeSafety::getNumViolations()
+{
+    return numViolations.load();
+}
+
+void RealtimeSafety::clear()
+{
+    for (auto& violation : recorded)
+        violation.ready.store(false);
+
+    numViolations.store(0);
+}
+
+juce::String RealtimeSafety::getReport()
+{
+    int total = numViolations.load();
+    if (total == 0)
+        return "No real-time safety violations";
+
+    juce::String report;
+    report << total << " real-time safety violation" << (total == 1 ? "" : "s") << "\n";
+
+    for (int i = 0; i < juce::jmin(total, maxRecorded); ++i)
+    {
+        auto& violation = recorded[(size_t)i];
+        if (!violation.ready.load(std::memory_order_acquire))
+            continue;
+
+        report << "\n" << getKindName(violation.kind) << " in " << violation.function << "\n";
+
+       #if PIANODAW_RT_BACKTRACE
+        int numFrames = violation.numFrames - framesToSkip;
+        if (numFrames > 0)
+        {
+            if (auto** symbols = backtrace_symbols(violation.frames.data() + framesToSkip, numFrames))
+            {
+                for (int f = 0; f < numFrames; ++f)
+                    report << "  " << symbols[f] << "\n";
+                std::free(symbols);
+            }
+        }
+       #endif
+    }
+
+    if (total > maxRecorded)
+        report << "\n(" << (total - maxRecorded) << " more not recorded)\n";
+
+    return report;
+}
+
+#else
+
+void RealtimeSafety::setEnabled(bool) {}
+bool RealtimeSafety::isEnabled() { return false; }
+void RealtimeSafety::setStrictLocking(bool) {}
+int RealtimeSafety::getNumViolations() { return 0; }
+void RealtimeSafety::clear() {}
+
+juce::String RealtimeSafety::getReport()
+{
+    return "Real-time safety checks are not compiled in (PIANODAW_RT_CHECKS)";
+}
+
+#endif
+
+} // namespace pianodaw
+
+#if PIANODAW_RT_CHECKS && PIANODAW_RT_INTERPOSE_LIBC
+
+// ==============================================================================
+// glibc: the executable's definitions take precedence over libc's for every
+// caller in the process. Allocations forward to glibc's own allocator,
+// everything else to the next definition found by the dynamic linker.
+
+using pianodaw::RealtimeSafety;
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void* __libc_valloc(size_t);
+    void* __libc_pvalloc(size_t);
+    void __libc_free(void*);
+}
+
+namespace
+{
+    template <typename Function>
+    Function findNext(std::atomic<Function>& cached, const char* name)
+    {
+        auto function = cached.load(std::memory_order_relaxed);
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+            cached.store(function, std::memory_order_relaxed);
+        }
+        return function;
+    }
+
+    #define PIANODAW_RT_NEXT(type, name) \
+        ([]() -> type { static std::atomic<type> cached { nullptr }; return findNext(cached, name); }())
+}
+
+extern "C"
+{
+
+void* malloc(size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "realloc");
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "memalign");
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) noexcept
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment % sizeof(void*) != 0)
+        return EINVAL;
+
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "posix_memalign");
+    auto* memory = __libc_memalign(alignment, size);
+    if (memory == nullptr)
+        return ENOMEM;
+
+    *result = memory;
+    return 0;
+}
+
+void* valloc(size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "valloc");
+    return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) noexcept
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "pvalloc");
+    return __libc_pvalloc(size);
+}
+
+void free(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeSafety::check(RealtimeSafety::Kind::deallocation, "free");
+    __libc_free(pointer);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+{
+    using Function = int (*)(pthread_mutex_t*);
+
+    // Unless strict, only a lock the thread would have waited for counts
+    if (RealtimeSafety::isChecking())
+    {
+        if (!pianodaw::strictLocking.load(std::memory_order_relaxed)
+            && PIANODAW_RT_NEXT(Function, "pthread_mutex_trylock")(mutex) == 0)
+            return 0;
+
+        RealtimeSafety::check(RealtimeSafety::Kind::lockWait, "pthread_mutex_lock");
+    }
+
+    return PIANODAW_RT_NEXT(Function, "pthread_mutex_lock")(mutex);
+}
+
+int open(const char* path, int flags, ...)
+{
+    using Function = int (*)(const char*, int, ...);
+
+    mode_t mode = 0;
+    bool hasMode = (flags & O_CREAT) != 0;
+   #ifdef O_TMPFILE
+    hasMode = hasMode || (flags & O_TMPFILE) == O_TMPFILE;
+   #endif
+    if (hasMode)
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "open");
+    return PIANODAW_RT_NEXT(Function, "open")(path, flags, mode);
+}
+
+FILE* fopen(const char* path, const char* mode)
+{
+    using Function = FILE* (*)(const char*, const char*);
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "fopen");
+    return PIANODAW_RT_NEXT(Function, "fopen")(path, mode);
+}
+
+ssize_t read(int fd, void* buffer, size_t count)
+{
+    using Function = ssize_t (*)(int, void*, size_t);
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "read");
+    return PIANODAW_RT_NEXT(Function, "read")(fd, buffer, count);
+}
+
+ssize_t write(int fd, const void* buffer, size_t count)
+{
+    using Function = ssize_t (*)(int, const void*, size_t);
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "write");
+    return PIANODAW_RT_NEXT(Function, "write")(fd, buffer, count);
+}
+
+int close(int fd)
+{
+    using Function = int (*)(int);
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "close");
+    return PIANODAW_RT_NEXT(Function, "close")(fd);
+}
+
+int nanosleep(const struct timespec* duration, struct timespec* remaining)
+{
+    using Function = int (*)(const struct timespec*, struct timespec*);
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "nanosleep");
+    return PIANODAW_RT_NEXT(Function, "nanosleep")(duration, remaining);
+}
+
+int usleep(useconds_t microseconds)
+{
+    using Function = int (*)(useconds_t);
+    RealtimeSafety::check(RealtimeSafety::Kind::systemCall, "usleep");
+    return PIANODAW_RT_NEXT(Function, "usleep")(microseconds);
+}
+
+} // extern "C"
+
+#elif PIANODAW_RT_CHECKS
+
+// ==============================================================================
+// Elsewhere: allocations through new/delete only
+
+using pianodaw::RealtimeSafety;
+
+void* operator new(std::size_t size)
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "operator new");
+    if (auto* memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    RealtimeSafety::check(RealtimeSafety::Kind::allocation, "operator new[]");
+    if (auto* memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeSafety::check(RealtimeSafety::Kind::deallocation, "operator delete");
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        RealtimeSafety::check(RealtimeSafety::Kind::deallocation, "operator delete[]");
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept  { operator delete(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { operator delete[](pointer); }
+
+#endif
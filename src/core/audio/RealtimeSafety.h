@@ -0,0 +1,102 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#ifndef PIANODAW_RT_CHECKS
+ #define PIANODAW_RT_CHECKS 0
+#endif
+
+namespace pianodaw {
+
+/**
+ * RealtimeSafety - Debug checker for work the audio thread must never do
+ *
+ * Built with PIANODAW_RT_CHECKS, the process intercepts heap allocation and
+ * deallocation, mutex waits and blocking system calls (file I/O, sleeps).
+ * A thread inside a ScopedRealtime scope that hits one of them while the
+ * checker is enabled records a violation with its stack, without allocating
+ * or locking; getReport() symbolises them later on another thread.
+ *
+ * Locks only count when the thread would actually have waited (the mutex was
+ * held elsewhere) unless strict locking is on: an uncontended lock costs an
+ * atomic, a contended one costs a scheduler round trip.
+ *
+ * Interception is complete on glibc (malloc family, pthread_mutex_lock,
+ * open/read/write/close, fopen, sleeps). Elsewhere only operator new/delete
+ * are checked. Without PIANODAW_RT_CHECKS every call here is a no-op.
+ */
+class RealtimeSafety
+{
+public:
+    enum class Kind
+    {
+        allocation,
+        deallocation,
+        lockWait,
+        systemCall
+    };
+
+    static constexpr int maxRecorded = 64;   // Later violations are counted but not recorded
+    static constexpr int maxFrames = 32;
+
+    /** True when the interceptors are compiled in */
+    static constexpr bool isAvailable() { return PIANODAW_RT_CHECKS != 0; }
+
+    static void setEnabled(bool shouldBeEnabled);
+    static bool isEnabled();
+
+    /** Report every lock taken in a realtime scope, contended or not */
+    static void setStrictLocking(bool shouldBeStrict);
+
+    /** Violations since the last clear(), including those past maxRecorded */
+    static int getNumViolations();
+
+    /** The recorded violations with symbolised stacks (not from a realtime thread) */
+    static juce::String getReport();
+
+    static void clear();
+
+    static const char* getKindName(Kind kind);
+
+    /** Marks the calling thread as realtime while in scope (nestable) */
+    struct ScopedRealtime
+    {
+       #if PIANODAW_RT_CHECKS
+        ScopedRealtime();
+        ~ScopedRealtime();
+       #else
+        ScopedRealtime() {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtime)
+    };
+
+    /**
+     * Suspends the checks on the calling thread while in scope
+     * For reviewed exceptions only - say why at the call site.
+     */
+    struct ScopedAllowance
+    {
+       #if PIANODAW_RT_CHECKS
+        ScopedAllowance();
+        ~ScopedAllowance();
+       #else
+        ScopedAllowance() {}
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllowance)
+    };
+
+   #if PIANODAW_RT_CHECKS
+    /** Called by the interceptors; records a violation if the calling thread is being checked */
+    static void check(Kind kind, const char* function);
+
+    /** Whether the calling thread is being checked right now */
+    static bool isChecking();
+   #endif
+
+private:
+    RealtimeSafety() = delete;
+};
+
+} // namespace pianodaw
@@ -0,0 +1,328 @@
+#include "SamplePool.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+
+namespace pianodaw {
+
+//==============================================================================
+// SampleStreamer
+//==============================================================================
+
+SampleStreamer::SampleStreamer(int numSlots, int bufferSamples_)
+    : juce::Thread("Piano Sample Streamer"), bufferSamples(bufferSamples_)
+{
+    slots.reserve((size_t)numSlots);
+    for (int i = 0; i < numSlots; ++i)
+        slots.push_back(std::make_unique<Slot>(bufferSamples));
+}
+
+SampleStreamer::~SampleStreamer()
+{
+    stopThread(2000);
+}
+
+void SampleStreamer::startStream(int slotIndex, const PianoSample* sample, juce::int64 startPosition)
+{
+    auto& slot = *slots[(size_t)slotIndex];
+    slot.requestedSample.store(sample, std::memory_order_relaxed);
+    slot.requestedStart.store(startPosition, std::memory_order_relaxed);
+    slot.requestGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void SampleStreamer::stopStream(int slotIndex)
+{
+    startStream(slotIndex, nullptr, 0);
+}
+
+bool SampleStreamer::isStreamReady(int slotIndex) const
+{
+    auto& slot = *slots[(size_t)slotIndex];
+    return slot.ackGeneration.load(std::memory_order_acquire)
+        == slot.requestGeneration.load(std::memory_order_relaxed);
+}
+
+int SampleStreamer::getNumReady(int slotIndex) const
+{
+    return isStreamReady(slotIndex) ? slots[(size_t)slotIndex]->fifo.getNumReady() : 0;
+}
+
+bool SampleStreamer::isStreamFinished(int slotIndex) const
+{
+    auto& slot = *slots[(size_t)slotIndex];
+    return isStreamReady(slotIndex)
+        && slot.endOfSample.load(std::memory_order_acquire)
+        && slot.fifo.getNumReady() == 0;
+}
+
+int SampleStreamer::read(int slotIndex, juce::AudioBuffer<float>& dest, int destStart, int numSamples)
+{
+    if (!isStreamReady(slotIndex))
+        return 0;
+
+    auto& slot = *slots[(size_t)slotIndex];
+
+    int start1, size1, start2, size2;
+    slot.fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        if (size1 > 0)
+            dest.copyFrom(ch, destStart, slot.ring, ch, start1, size1);
+        if (size2 > 0)
+            dest.copyFrom(ch, destStart + size1, slot.ring, ch, start2, size2);
+    }
+
+    slot.fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+int SampleStreamer::getNumActiveStreams() const
+{
+    int count = 0;
+    for (auto& slot : slots)
+    {
+        if (slot->requestedSample.load(std::memory_order_relaxed) != nullptr)
+            ++count;
+    }
+    return count;
+}
+
+size_t SampleStreamer::getBufferBytes() const
+{
+    return slots.size() * (size_t)bufferSamples * 2 * sizeof(float);
+}
+
+void SampleStreamer::run()
+{
+    while (!threadShouldExit())
+    {
+        bool didWork = false;
+
+        for (int i = 0; i < (int)slots.size(); ++i)
+            didWork = serviceSlot(i) || didWork;
+
+        // Poll instead of being notified: waking this thread from the audio
+        // callback would mean touching a mutex/condition variable there.
+        if (!didWork)
+            wait(2);
+    }
+}
+
+bool SampleStreamer::serviceSlot(int slotIndex)
+{
+    auto& slot = *slots[(size_t)slotIndex];
+
+    // Pick up a new request: the audio thread never reads a slot until we ack it,
+    // so resetting the FIFO here cannot race with the reader side.
+    auto generation = slot.requestGeneration.load(std::memory_order_acquire);
+    if (generation != slot.ackGeneration.load(std::memory_order_relaxed))
+    {
+        slot.fifo.reset();
+        slot.sample = slot.requestedSample.load(std::memory_order_relaxed);
+        slot.readPosition = slot.requestedStart.load(std::memory_order_relaxed);
+        slot.endOfSample.store(slot.sample == nullptr, std::memory_order_relaxed);
+        slot.ackGeneration.store(generation, std::memory_order_release);
+    }
+
+    if (slot.sample == nullptr || slot.endOfSample.load(std::memory_order_relaxed))
+        return false;
+
+    auto remaining = slot.sample->lengthInSamples - slot.readPosition;
+    if (remaining <= 0)
+    {
+        slot.endOfSample.store(true, std::memory_order_release);
+        return false;
+    }
+
+    int toRead = juce::jmin(slot.fifo.getFreeSpace(), readChunkSamples,
+                            (int)juce::jmin(remaining, (juce::int64)std::numeric_limits<int>::max()));
+    if (toRead <= 0)
+        return false;
+
+    int start1, size1, start2, size2;
+    slot.fifo.prepareToWrite(toRead, start1, size1, start2, size2);
+
+    // Mono readers are duplicated into both ring channels by AudioFormatReader::read
+    if (size1 > 0)
+        slot.sample->reader->read(&slot.ring, start1, size1, slot.readPosition, true, true);
+    if (size2 > 0)
+        slot.sample->reader->read(&slot.ring, start2, size2, slot.readPosition + size1, true, true);
+
+    slot.fifo.finishedWrite(size1 + size2);
+    slot.readPosition += size1 + size2;
+
+    if (slot.readPosition >= slot.sample->lengthInSamples)
+        slot.endOfSample.store(true, std::memory_order_release);
+
+    return true;
+}
+
+//==============================================================================
+// SamplePool
+//==============================================================================
+
+SamplePool::SamplePool()
+{
+    formatManager.registerBasicFormats();
+}
+
+SamplePool::~SamplePool()
+{
+    // Stop the reader before the mapped files it reads from go away
+    streamer.reset();
+}
+
+bool SamplePool::parseZoneName(const juce::String& name, int& note, int& layer)
+{
+    // "<note>_v<layer>", e.g. "060_v2"
+    auto notePart = name.upToFirstOccurrenceOf("_v", false, true);
+    auto layerPart = name.fromFirstOccurrenceOf("_v", false, true);
+
+    if (notePart.isEmpty() || layerPart.isEmpty()
+        || !notePart.containsOnly("0123456789") || !layerPart.containsOnly("0123456789"))
+        return false;
+
+    note = notePart.getIntValue();
+    layer = layerPart.getIntValue();
+    return note >= 0 && note <= 127 && layer >= 1;
+}
+
+bool SamplePool::loadFolder(const juce::File& folder, const Options& newOptions, juce::String& errorMessage)
+{
+    jassert(streamer == nullptr);  // A pool is loaded once; create a new one to reload
+
+    options = newOptions;
+
+    if (!folder.isDirectory())
+    {
+        errorMessage = "Sample folder not found: " + folder.getFullPathName();
+        return false;
+    }
+
+    // Map every zone file
+    auto files = folder.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff");
+    std::map<int, int> layersPerNote;
+
+    for (auto& file : files)
+    {
+        int note = 0, layer = 0;
+        if (!parseZoneName(file.getFileNameWithoutExtension(), note, layer))
+            continue;
+
+        auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+        if (format == nullptr)
+            continue;
+
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(file));
+        if (reader == nullptr || !reader->mapEntireFile() || reader->lengthInSamples <= 0)
+        {
+            loadLog.add("SamplePool: Could not map " + file.getFileName());
+            continue;
+        }
+
+        auto sample = std::make_unique<PianoSample>();
+        sample->rootNote = note;
+        sample->velocityLayer = layer;
+        sample->sampleRate = reader->sampleRate;
+        sample->numChannels = juce::jlimit(1, 2, (int)reader->numChannels);
+        sample->lengthInSamples = reader->lengthInSamples;
+        sample->reader = std::move(reader);
+
+        layersPerNote[note] = juce::jmax(layersPerNote[note], layer);
+        samples.push_back(std::move(sample));
+    }
+
+    if (samples.empty())
+    {
+        errorMessage = "No mappable \"<note>_v<layer>\" WAV/AIFF files in " + folder.getFullPathName();
+        return false;
+    }
+
+    // Fit attack heads into what is left of the budget after the stream buffers
+    size_t streamBytes = (size_t)options.maxVoices * (size_t)options.streamBufferSamples * 2 * sizeof(float);
+    size_t totalChannels = 0;
+    for (auto& sample : samples)
+        totalChannels += (size_t)sample->numChannels;
+
+    if (options.ramBudgetBytes <= streamBytes)
+    {
+        errorMessage = "RAM budget too small for " + juce::String(options.maxVoices) + " voice streams";
+        samples.clear();
+        return false;
+    }
+
+    auto headBudget = (options.ramBudgetBytes - streamBytes) / (totalChannels * sizeof(float));
+    int headSamples = (int)juce::jmin((size_t)options.preferredHeadSamples, headBudget);
+
+    if (headSamples < options.minimumHeadSamples)
+    {
+        errorMessage = "RAM budget too small: attack heads would be " + juce::String(headSamples)
+                     + " samples (minimum " + juce::String(options.minimumHeadSamples) + ")";
+        samples.clear();
+        return false;
+    }
+
+    for (auto& sample : samples)
+    {
+        sample->headLength = (int)juce::jmin((juce::int64)headSamples, sample->lengthInSamples);
+        sample->head.setSize(sample->numChannels, sample->headLength);
+        sample->reader->read(&sample->head, 0, sample->headLength, 0, true, sample->numChannels > 1);
+
+        // Velocity layers split 1-127 evenly for each note
+        int numLayers = layersPerNote[sample->rootNote];
+        sample->lowVelocity = (sample->velocityLayer - 1) * 127 / numLayers + 1;
+        sample->highVelocity = sample->velocityLayer * 127 / numLayers;
+    }
+
+    // Map every MIDI note to the zones of its nearest sampled root
+    for (int note = 0; note < 128; ++note)
+    {
+        int bestRoot = -1;
+        for (auto& entry : layersPerNote)
+        {
+            if (bestRoot < 0 || std::abs(entry.first - note) < std::abs(bestRoot - note))
+                bestRoot = entry.first;
+        }
+
+        zonesByNote[(size_t)note].clear();
+        for (auto& sample : samples)
+        {
+            if (sample->rootNote == bestRoot)
+                zonesByNote[(size_t)note].push_back(sample.get());
+        }
+    }
+
+    streamer = std::make_unique<SampleStreamer>(options.maxVoices, options.streamBufferSamples);
+    streamer->startThread(juce::Thread::Priority::high);
+
+    loadLog.add("SamplePool: Loaded " + juce::String(samples.size()) + " zones, head "
+                         + juce::String(headSamples) + " samples, "
+                         + juce::String((double)getResidentBytes() / (1024.0 * 1024.0), 1) + " MB resident");
+    return true;
+}
+
+const PianoSample* SamplePool::findSample(int midiNote, int velocity) const
+{
+    if (midiNote < 0 || midiNote > 127)
+        return nullptr;
+
+    auto& zones = zonesByNote[(size_t)midiNote];
+    for (auto* zone : zones)
+    {
+        if (velocity >= zone->lowVelocity && velocity <= zone->highVelocity)
+            return zone;
+    }
+
+    return zones.empty() ? nullptr : zones.back();
+}
+
+size_t SamplePool::getResidentBytes() const
+{
+    size_t bytes = streamer != nullptr ? streamer->getBufferBytes() : 0;
+    for (auto& sample : samples)
+        bytes += (size_t)sample->head.getNumChannels() * (size_t)sample->head.getNumSamples() * sizeof(float);
+    return bytes;
+}
+
+} // namespace pianodaw
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace pianodaw {
+
+/**
+ * PianoSample - One multi-sampled piano zone
+ *
+ * The whole file stays memory-mapped; only the attack head is copied into RAM.
+ * Everything after the head is streamed by SampleStreamer.
+ */
+struct PianoSample
+{
+    int rootNote = 60;
+    int velocityLayer = 1;
+    int lowVelocity = 1;                // Inclusive velocity range (1-127)
+    int highVelocity = 127;
+
+    double sampleRate = 44100.0;
+    int numChannels = 2;
+    juce::int64 lengthInSamples = 0;
+    int headLength = 0;                 // Samples preloaded into RAM
+
+    juce::AudioBuffer<float> head;
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+
+    bool needsStreaming() const { return lengthInSamples > headLength; }
+};
+
+/**
+ * SampleStreamer - Background reader that feeds sample tails to voices
+ *
+ * Each voice owns one stream slot. The audio thread only flips atomics to
+ * request/stop a stream; the reader thread resets and fills the slot's FIFO
+ * from the memory-mapped file. No locks are shared with the audio thread.
+ */
+class SampleStreamer : public juce::Thread
+{
+public:
+    SampleStreamer(int numSlots, int bufferSamples);
+    ~SampleStreamer() override;
+
+    // === Audio thread API ===
+
+    /** Start streaming a sample from startPosition into a slot */
+    void startStream(int slot, const PianoSample* sample, juce::int64 startPosition);
+
+    /** Release a slot (the reader thread idles it on its next pass) */
+    void stopStream(int slot);
+
+    /** True once the reader thread has picked up the latest request for the slot */
+    bool isStreamReady(int slot) const;
+
+    /** Number of samples currently buffered for the slot */
+    int getNumReady(int slot) const;
+
+    /** True when the reader hit the end of the sample and the FIFO is drained */
+    bool isStreamFinished(int slot) const;
+
+    /**
+     * Pop up to numSamples from the slot into dest (2 channels) at destStart
+     * @return Number of samples actually read
+     */
+    int read(int slot, juce::AudioBuffer<float>& dest, int destStart, int numSamples);
+
+    // === Stats ===
+    int getNumSlots() const { return (int)slots.size(); }
+    int getBufferSamples() const { return bufferSamples; }
+    int getNumActiveStreams() const;
+    juce::uint32 getUnderrunCount() const { return underruns.load(); }
+    void reportUnderrun() { underruns.fetch_add(1); }
+
+    /** Bytes held by the stream ring buffers */
+    size_t getBufferBytes() const;
+
+private:
+    void run() override;
+
+    /** Service one slot; returns true if any samples were read */
+    bool serviceSlot(int slotIndex);
+
+    struct Slot
+    {
+        // Written by audio thread
+        std::atomic<const PianoSample*> requestedSample { nullptr };
+        std::atomic<juce::int64> requestedStart { 0 };
+        std::atomic<juce::uint32> requestGeneration { 0 };
+
+        // Written by reader thread
+        std::atomic<juce::uint32> ackGeneration { 0 };
+        std::atomic<bool> endOfSample { false };
+
+        // Reader thread private
+        const PianoSample* sample = nullptr;
+        juce::int64 readPosition = 0;
+
+        juce::AbstractFifo fifo;
+        juce::AudioBuffer<float> ring;
+
+        explicit Slot(int capacity) : fifo(capacity), ring(2, capacity) {}
+    };
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    int bufferSamples;
+    int readChunkSamples = 4096;        // Max samples per slot per pass (keeps slots fair)
+    std::atomic<juce::uint32> underruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleStreamer)
+};
+
+/**
+ * SamplePool - Multi-velocity piano sample set with a RAM budget
+ *
+ * Folder layout: one WAV/AIFF file per zone named "<note>_v<layer>",
+ * e.g. "060_v1.wav" .. "060_v4.wav". Layers split 1-127 evenly per note.
+ * Compressed formats cannot be memory-mapped and are rejected.
+ */
+class SamplePool
+{
+public:
+    struct Options
+    {
+        size_t ramBudgetBytes = 256 * 1024 * 1024;  // Heads + stream buffers
+        int preferredHeadSamples = 32768;           // ~0.7s at 48kHz
+        int minimumHeadSamples = 4096;              // Must cover reader wake-up + first fill
+        int streamBufferSamples = 16384;            // Per-voice ring size
+        int maxVoices = 192;                        // 88-key pedal chord + re-strikes
+    };
+
+    SamplePool();
+    ~SamplePool();
+
+    /**
+     * Map all samples in a folder and preload their attack heads.
+     * Reads every head, so call it from a worker thread before handing the
+     * pool to a synth; nothing else may touch the pool until it returns.
+     */
+    bool loadFolder(const juce::File& folder, const Options& options, juce::String& errorMessage);
+
+    /** What loadFolder() skipped and loaded, for the caller to log on the message thread */
+    const juce::StringArray& getLoadLog() const { return loadLog; }
+
+    /** Find the best zone for a note/velocity (nearest root within matching layer) */
+    const PianoSample* findSample(int midiNote, int velocity) const;
+
+    bool isLoaded() const { return !samples.empty(); }
+    int getNumSamples() const { return (int)samples.size(); }
+    const Options& getOptions() const { return options; }
+
+    /** Bytes of RAM resident for heads and stream buffers */
+    size_t getResidentBytes() const;
+
+    SampleStreamer& getStreamer() { return *streamer; }
+
+private:
+    static bool parseZoneName(const juce::String& name, int& note, int& layer);
+
+    Options options;
+    juce::StringArray loadLog;
+    juce::AudioFormatManager formatManager;
+    std::vector<std::unique_ptr<PianoSample>> samples;
+    std::unique_ptr<SampleStreamer> streamer;
+
+    // Zones indexed by note for O(1) lookup on the audio thread
+    std::array<std::vector<const PianoSample*>, 128> zonesByNote;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplePool)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,219 @@
+#include "SampledPiano.h"
+#include <cmath>
+#include <cstring>
+
+namespace pianodaw {
+
+SampledPianoVoice::SampledPianoVoice(SampleStreamer& streamer_, int streamSlot_)
+    : streamer(streamer_), streamSlot(streamSlot_)
+{
+}
+
+SampledPianoVoice::~SampledPianoVoice()
+{
+    if (sample != nullptr && sample->needsStreaming())
+        streamer.stopStream(streamSlot);
+}
+
+bool SampledPianoVoice::canPlaySound(juce::SynthesiserSound* sound)
+{
+    return dynamic_cast<SampledPianoSound*>(sound) != nullptr;
+}
+
+void SampledPianoVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound* sound, int /*currentPitchWheelPosition*/)
+{
+    auto* pianoSound = dynamic_cast<SampledPianoSound*>(sound);
+    if (pianoSound == nullptr)
+        return;
+
+    // A voice cut short mid-note may still own a stream the new zone has no use for
+    if (sample != nullptr && sample->needsStreaming())
+        streamer.stopStream(streamSlot);
+
+    int midiVelocity = juce::jlimit(1, 127, (int)(velocity * 127.0f));
+    sample = pianoSound->getPool().findSample(midiNoteNumber, midiVelocity);
+
+    if (sample == nullptr)
+    {
+        clearCurrentNote();
+        return;
+    }
+
+    pitchRatio = std::pow(2.0, (midiNoteNumber - sample->rootNote) / 12.0) * sample->sampleRate / getSampleRate();
+    pitchRatio = juce::jlimit(1.0 / maxPitchRatio, maxPitchRatio, pitchRatio);
+
+    // Layers carry most of the dynamics; keep a gentle curve inside a layer plus headroom for chords
+    noteGain = juce::jmap(velocity, 0.3f, 1.0f) * 0.5f;
+
+    releasing = false;
+    releaseLevel = 1.0f;
+    sourcePosition = 0.0;
+    windowStart = 0;
+    windowLength = 0;
+
+    // The head buys the reader thread time to prefill the tail
+    if (sample->needsStreaming())
+        streamer.startStream(streamSlot, sample, sample->headLength);
+}
+
+void SampledPianoVoice::stopNote(float /*velocity*/, bool allowTailOff)
+{
+    if (allowTailOff)
+    {
+        if (!releasing)
+        {
+            releasing = true;
+            releaseStep = 1.0f / (float)(0.25 * getSampleRate());  // ~250ms damper
+        }
+    }
+    else
+    {
+        finishNote();
+    }
+}
+
+void SampledPianoVoice::fadeOutForSteal()
+{
+    // Same ramp as the damper, from wherever it is now down to zero in a few milliseconds
+    releasing = true;
+    releaseStep = juce::jmax(releaseStep, releaseLevel / (float)(VoicePool::stealFadeSeconds * getSampleRate()));
+}
+
+void SampledPianoVoice::finishNote()
+{
+    if (sample != nullptr && sample->needsStreaming())
+        streamer.stopStream(streamSlot);
+
+    sample = nullptr;
+    clearCurrentNote();
+}
+
+bool SampledPianoVoice::fillWindow(juce::int64 lastIndex)
+{
+    // Drop source samples the play position has moved past
+    auto consumed = (juce::int64)sourcePosition - windowStart;
+    if (consumed > 0)
+    {
+        int drop = (int)juce::jmin(consumed, (juce::int64)windowLength);
+        int keep = windowLength - drop;
+
+        for (int ch = 0; ch < window.getNumChannels(); ++ch)
+        {
+            if (keep > 0)
+                std::memmove(window.getWritePointer(ch), window.getReadPointer(ch, drop), (size_t)keep * sizeof(float));
+        }
+
+        windowLength = keep;
+        windowStart += drop;
+    }
+
+    while (windowStart + windowLength <= lastIndex && windowLength < windowCapacity)
+    {
+        auto next = windowStart + windowLength;
+        int wanted = (int)juce::jmin((juce::int64)(windowCapacity - windowLength), lastIndex - next + 1);
+
+        if (next < sample->headLength)
+        {
+            int count = (int)juce::jmin((juce::int64)wanted, (juce::int64)sample->headLength - next);
+            for (int ch = 0; ch < 2; ++ch)
+                window.copyFrom(ch, windowLength, sample->head, juce::jmin(ch, sample->numChannels - 1), (int)next, count);
+            windowLength += count;
+        }
+        else if (next < sample->lengthInSamples)
+        {
+            int count = streamer.read(streamSlot, window, windowLength, wanted);
+            if (count == 0)
+            {
+                if (!streamer.isStreamFinished(streamSlot))
+                    streamer.reportUnderrun();
+                return false;
+            }
+            windowLength += count;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return windowStart + windowLength > lastIndex;
+}
+
+void SampledPianoVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
+{
+    render(outputBuffer, startSample, numSamples);
+}
+
+void SampledPianoVoice::renderNextBlock(juce::AudioBuffer<double>& outputBuffer, int startSample, int numSamples)
+{
+    render(outputBuffer, startSample, numSamples);
+}
+
+template <typename SampleType>
+void SampledPianoVoice::render(juce::AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples)
+{
+    if (sample == nullptr)
+        return;
+
+    bool stereoOut = outputBuffer.getNumChannels() > 1;
+
+    while (numSamples > 0)
+    {
+        int chunk = juce::jmin(numSamples, maxChunkSamples);
+        auto lastNeeded = juce::jmin((juce::int64)(sourcePosition + chunk * pitchRatio) + 1,
+                                     sample->lengthInSamples - 1);
+        fillWindow(lastNeeded);
+
+        auto* srcL = window.getReadPointer(0);
+        auto* srcR = window.getReadPointer(1);
+        auto* outL = outputBuffer.getWritePointer(0, startSample);
+        auto* outR = stereoOut ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+
+        for (int i = 0; i < chunk; ++i)
+        {
+            auto index = (juce::int64)sourcePosition;
+            if (index + 1 >= sample->lengthInSamples)
+            {
+                finishNote();
+                return;
+            }
+
+            // Underrun: hold position and stay silent until the stream catches up
+            auto local = (int)(index - windowStart);
+            if (local + 1 >= windowLength)
+                break;
+
+            auto frac = (float)(sourcePosition - (double)index);
+            auto gain = noteGain * releaseLevel;
+            auto left = srcL[local] + frac * (srcL[local + 1] - srcL[local]);
+            auto right = srcR[local] + frac * (srcR[local + 1] - srcR[local]);
+
+            if (outR != nullptr)
+            {
+                outL[i] += left * gain;
+                outR[i] += right * gain;
+            }
+            else
+            {
+                outL[i] += 0.5f * (left + right) * gain;
+            }
+
+            sourcePosition += pitchRatio;
+
+            if (releasing)
+            {
+                releaseLevel -= releaseStep;
+                if (releaseLevel <= 0.0f)
+                {
+                    finishNote();
+                    return;
+                }
+            }
+        }
+
+        startSample += chunk;
+        numSamples -= chunk;
+    }
+}
+
+} // namespace pianodaw
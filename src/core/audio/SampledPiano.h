@@ -0,0 +1,88 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "SamplePool.h"
+#include "VoicePool.h"
+
+namespace pianodaw {
+
+/**
+ * SampledPianoSound - Built-in multi-velocity piano backed by a SamplePool
+ */
+class SampledPianoSound : public juce::SynthesiserSound
+{
+public:
+    explicit SampledPianoSound(SamplePool& pool_) : pool(pool_) {}
+
+    bool appliesToNote(int midiNoteNumber) override { return pool.findSample(midiNoteNumber, 64) != nullptr; }
+    bool appliesToChannel(int) override { return true; }
+
+    SamplePool& getPool() { return pool; }
+
+private:
+    SamplePool& pool;
+};
+
+/**
+ * SampledPianoVoice - Plays one PianoSample zone
+ *
+ * Reads the attack from the zone's RAM head, then continues from the
+ * voice's SampleStreamer slot. Source samples are staged in a small local
+ * window so interpolation never straddles the head/stream boundary.
+ */
+class SampledPianoVoice : public PooledVoice
+{
+public:
+    SampledPianoVoice(SampleStreamer& streamer, int streamSlot);
+    ~SampledPianoVoice() override;
+
+    bool canPlaySound(juce::SynthesiserSound* sound) override;
+    void startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound* sound, int currentPitchWheelPosition) override;
+    void stopNote(float velocity, bool allowTailOff) override;
+    void pitchWheelMoved(int) override {}
+    void controllerMoved(int, int) override {}
+    void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
+    void renderNextBlock(juce::AudioBuffer<double>& outputBuffer, int startSample, int numSamples) override;
+
+    /** Velocity gain times the release ramp; the recording's own decay is not tracked */
+    float getLevel() const override { return sample != nullptr ? noteGain * releaseLevel : 0.0f; }
+
+protected:
+    void fadeOutForSteal() override;
+
+private:
+    static constexpr int maxChunkSamples = 1024;   // Output samples rendered per window refill
+    static constexpr double maxPitchRatio = 4.0;   // Source samples consumed per output sample
+    static constexpr int windowCapacity = (int)(maxChunkSamples * maxPitchRatio) + 8;
+
+    /**
+     * Make sure the window holds source samples up to lastIndex (inclusive)
+     * @return false if the source ended or the stream underran before lastIndex
+     */
+    bool fillWindow(juce::int64 lastIndex);
+
+    /** Mixes in the output's precision; the source window stays float */
+    template <typename SampleType>
+    void render(juce::AudioBuffer<SampleType>& outputBuffer, int startSample, int numSamples);
+    void finishNote();
+
+    SampleStreamer& streamer;
+    int streamSlot;
+
+    const PianoSample* sample = nullptr;
+    double sourcePosition = 0.0;
+    double pitchRatio = 1.0;
+    float noteGain = 0.0f;
+
+    bool releasing = false;
+    float releaseLevel = 1.0f;
+    float releaseStep = 0.0f;
+
+    juce::AudioBuffer<float> window { 2, windowCapacity };
+    juce::int64 windowStart = 0;     // Source index of window[0]
+    int windowLength = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampledPianoVoice)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,356 @@
+#include "TrackChain.h"
+#include "AudioClipStreamer.h"
+#include "TrackFreezer.h"
+#include "TrackSequencer.h"
+#include "../timeline/PPQ.h"
+#include <algorithm>
+#include <array>
+
+namespace pianodaw {
+
+TrackChain::TrackChain(int trackUid_)
+    : trackUid(trackUid_), aheadEvents((size_t)aheadEventCapacity)
+{
+    aheadScratch.reserve((size_t)(2 * ParameterAutomation::maxChanges));
+}
+
+TrackChain::~TrackChain() = default;
+
+void TrackChain::prepare(double sampleRate, int blockSize, int numChannels)
+{
+    buffer.setSize(juce::jmax(1, numChannels), juce::jmax(1, blockSize));
+    midi.ensureSize(1024);
+    instrument.prepare(sampleRate, blockSize, numChannels);
+    compensation.prepare(numChannels, juce::roundToInt(maxCompensationSeconds * sampleRate), blockSize,
+                         instrument.getProcessingPrecision() == juce::AudioProcessor::doublePrecision);
+    strip.prepare(sampleRate, blockSize);
+    meter.prepare(sampleRate, blockSize);
+
+    aheadPlayhead.prepare(sampleRate);
+    aheadMidi.ensureSize(1024);
+    aheadSequenceMidi.ensureSize(1024);
+    aheadRing.prepare(numChannels, juce::roundToInt(maxAheadSeconds * sampleRate) + 4 * juce::jmax(1, blockSize));
+    aheadOutput.setSize(juce::jmax(1, numChannels), juce::jmax(1, blockSize));
+    aheadEpoch.store(-1);
+    aheadBehind = 0;
+}
+
+void TrackChain::setProcessingPrecision(juce::AudioProcessor::ProcessingPrecision precision)
+{
+    instrument.setProcessingPrecision(precision);
+}
+
+void TrackChain::setInstrument(std::unique_ptr<juce::AudioProcessorGraph> graph,
+                               juce::AudioProcessorGraph::Node::Ptr node,
+                               const juce::PluginDescription& newDescription)
+{
+    instrument.submit(std::move(graph));
+    instrumentNode = node;
+    description = newDescription;
+
+    // Whichever thread renders holds this, so the parameter cache is never swapped mid-block
+    const juce::ScopedLock rl(renderLock);
+    automation.bind(getInstrument());
+}
+
+void TrackChain::clearInstrument()
+{
+    ++loadGeneration;  // A load still in flight must not resurrect the instrument
+
+    if (instrumentNode == nullptr)
+        return;
+
+    instrument.submit(nullptr);
+    instrumentNode = nullptr;
+    description = juce::PluginDescription();
+
+    const juce::ScopedLock rl(renderLock);
+    automation.bind(nullptr);
+}
+
+std::unique_ptr<FrozenTrackReader> TrackChain::setFrozen(std::unique_ptr<FrozenTrackReader> reader,
+                                                         juce::CriticalSection& projectLock)
+{
+    const juce::ScopedLock sl(projectLock);
+    std::swap(frozen, reader);
+    return reader;
+}
+
+juce::AudioProcessor* TrackChain::getInstrument() const
+{
+    return instrumentNode != nullptr ? instrumentNode->getProcessor() : nullptr;
+}
+
+void TrackChain::beginBlock()
+{
+    if (!carryMidi)
+    {
+        midi.clear();
+        parameterChanges.clear();
+    }
+
+    carryMidi = false;
+    renderedOutput = false;
+    playedAhead = false;
+    outputBus = -1;
+}
+
+bool TrackChain::render(int numSamples)
+{
+    renderedOutput = renderBuffer(numSamples, midi, parameterChanges);
+    return renderedOutput;
+}
+
+bool TrackChain::renderBuffer(int numSamples, juce::MidiBuffer& midiMessages, ParameterAutomation::Changes& changes)
+{
+    // prepare() sized this for the announced block, so only an oversized host block reallocates
+    buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+    buffer.clear();
+
+    return automation.render(instrument, buffer, numSamples, midiMessages, changes);
+}
+
+void TrackChain::renderFrozen(const BlockTickWindow* windows, int numWindows, int numSamples, double tempoBPM)
+{
+    buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+    buffer.clear();
+    renderedOutput = true;
+
+    // Stopped: nothing to stream (the tail is cut like an instrument's all-sound-off)
+    double samplesPerTick = frozen->getSampleRate() * 60.0 / (tempoBPM * PPQ::TICKS_PER_QUARTER);
+    for (int i = 0; i < numWindows; ++i)
+    {
+        const auto& window = windows[i];
+        frozen->read(buffer, window.startSample, window.numSamples, window.exactStartTick * samplesPerTick);
+    }
+}
+
+void TrackChain::renderAudio(AudioClipStreamer& streamer, const Track& track, const BlockTickWindow* windows,
+                             int numWindows, int numSamples, double tempoBPM)
+{
+    buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+    buffer.clear();
+    renderedOutput = true;
+
+    streamer.render(track, windows, numWindows, tempoBPM, buffer);
+}
+
+bool TrackChain::renderInto(juce::AudioBuffer<float>& target, juce::MidiBuffer& targetMidi)
+{
+    renderedOutput = instrument.process(target, targetMidi);
+    return renderedOutput;
+}
+
+bool TrackChain::renderInto(juce::AudioBuffer<double>& target, juce::MidiBuffer& targetMidi)
+{
+    renderedOutput = instrument.process(target, targetMidi);
+    return renderedOutput;
+}
+
+void TrackChain::compensate(juce::AudioBuffer<float>& target, int numSamples, int delaySamples)
+{
+    compensation.setDelay(delaySamples);
+    compensation.process(target, numSamples);
+}
+
+void TrackChain::compensate(juce::AudioBuffer<double>& target, int numSamples, int delaySamples)
+{
+    compensation.setDelay(delaySamples);
+    compensation.process(target, numSamples);
+}
+
+juce::AudioBuffer<float>* TrackChain::getBlockOutput()
+{
+    if (playedAhead)
+        return &aheadOutput;
+
+    return renderedOutput ? &buffer : nullptr;
+}
+
+void TrackChain::followEpoch(int epoch, const SamplePlayhead& playhead, juce::int64 nextSample)
+{
+    aheadPlayhead = playhead;
+    resetAheadSequence(nextSample);
+    aheadCursor.store(nextSample, std::memory_order_release);
+    aheadEpoch.store(epoch, std::memory_order_release);
+}
+
+void TrackChain::stopFollowing()
+{
+    // The render lock keeps workers out, so the consumer may reset the ring
+    aheadEpoch.store(-1, std::memory_order_release);
+    aheadLost.store(false);
+    aheadRing.reset();
+    aheadBehind = 0;
+    resetAheadSequence(0);
+}
+
+void TrackChain::resetAheadSequence(juce::int64 nextSample)
+{
+    // Render lock held and this is the producer, so neither end of the queue is busy
+    aheadEventFifo.reset();
+    aheadSequenced.store(nextSample, std::memory_order_release);
+}
+
+void TrackChain::sequenceAhead(const Track& track, juce::int64 upTo, int blockSize, int maxBlocks)
+{
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> windows;
+
+    for (int block = 0; block < maxBlocks; ++block)
+    {
+        auto start = aheadSequenced.load(std::memory_order_relaxed);
+        if (start + blockSize > upTo)
+            return;
+
+        // Advance a copy, so a step that doesn't fit is sequenced again next time
+        auto next = aheadPlayhead;
+        int numWindows = next.advanceFreeRunning(blockSize, windows.data());
+
+        // Mute and solo are left to the channel strip, which applies them at playback time
+        aheadSequenceMidi.clear();
+        aheadSequenceChanges.clear();
+        TrackSequencer::sequence(track, windows.data(), numWindows, aheadSequenceMidi, 0, false);
+        ParameterAutomation::sequence(track, windows.data(), numWindows, aheadSequenceChanges);
+
+        aheadScratch.clear();
+        for (const auto metadata : aheadSequenceMidi)
+        {
+            // The sequencer only writes short messages; the parameter changes keep their room
+            if (metadata.numBytes > 3 || aheadScratch.size() + ParameterAutomation::maxChanges >= aheadScratch.capacity())
+                continue;
+
+            SequencedEvent event;
+            event.sample = start + metadata.samplePosition;
+            event.order = (int)aheadScratch.size();
+            event.size = metadata.numBytes;
+            std::copy(metadata.data, metadata.data + metadata.numBytes, event.data);
+            aheadScratch.push_back(event);
+        }
+
+        for (const auto& change : aheadSequenceChanges.getChanges())
+        {
+            SequencedEvent event;
+            event.sample = start + change.sampleOffset;
+            event.order = (int)aheadScratch.size();
+            event.parameterIndex = change.parameterIndex;
+            event.value = change.value;
+            aheadScratch.push_back(event);
+        }
+
+        if ((int)aheadScratch.size() > aheadEventFifo.getFreeSpace())
+            return;
+
+        // The worker stops at the first event past its block, so the queue must be in time order
+        std::sort(aheadScratch.begin(), aheadScratch.end(), [](const SequencedEvent& a, const SequencedEvent& b)
+        {
+            return a.sample != b.sample ? a.sample < b.sample : a.order < b.order;
+        });
+
+        int start1, size1, start2, size2;
+        aheadEventFifo.prepareToWrite((int)aheadScratch.size(), start1, size1, start2, size2);
+        std::copy(aheadScratch.begin(), aheadScratch.begin() + size1, aheadEvents.begin() + start1);
+        std::copy(aheadScratch.begin() + size1, aheadScratch.begin() + size1 + size2, aheadEvents.begin() + start2);
+        aheadEventFifo.finishedWrite(size1 + size2);
+
+        aheadPlayhead = next;
+        aheadSequenced.store(start + blockSize, std::memory_order_release);
+    }
+}
+
+void TrackChain::takeAheadSequence(int numSamples)
+{
+    aheadMidi.clear();
+    aheadParameterChanges.clear();
+
+    auto start = aheadCursor.load(std::memory_order_relaxed);
+    auto end = start + numSamples;
+
+    while (aheadEventFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        aheadEventFifo.prepareToRead(1, start1, size1, start2, size2);
+
+        const auto& event = aheadEvents[(size_t)(size1 > 0 ? start1 : start2)];
+        if (event.sample >= end)
+            break;
+
+        int offset = (int)juce::jmax((juce::int64)0, event.sample - start);
+        if (event.parameterIndex < 0)
+            aheadMidi.addEvent(event.data, event.size, offset);
+        else
+            aheadParameterChanges.add(offset, event.parameterIndex, event.value);
+
+        aheadEventFifo.finishedRead(1);
+    }
+}
+
+bool TrackChain::playAhead(int numSamples, bool& underrun)
+{
+    underrun = false;
+
+    if (aheadLost.load())
+        return false;
+
+    aheadBehind -= aheadRing.discard(aheadBehind);
+    if (aheadBehind > 0)
+        return false;
+
+    int available = juce::jmin(numSamples, aheadRing.getNumReady());
+    if (available == 0)
+        return false;
+
+    aheadOutput.setSize(aheadOutput.getNumChannels(), numSamples, false, false, true);
+    aheadRing.pop(aheadOutput, 0, available);
+
+    if (available < numSamples)
+    {
+        // Worker fell behind: this track drops out briefly but stays in time
+        aheadOutput.clear(available, numSamples - available);
+        aheadBehind += numSamples - available;
+        underrun = true;
+    }
+
+    playedAhead = true;
+    return true;
+}
+
+void TrackChain::skipBlock(int numSamples)
+{
+    carryMidi = true;
+
+    if (getAheadEpoch() >= 0)
+        aheadBehind += numSamples;
+}
+
+bool TrackChain::claimForCallback()
+{
+    claimedByCallback = renderLock.tryEnter();
+
+    if (claimedByCallback && getAheadEpoch() >= 0)
+        stopFollowing();
+
+    return claimedByCallback;
+}
+
+void TrackChain::releaseFromCallback()
+{
+    if (claimedByCallback)
+        renderLock.exit();
+
+    claimedByCallback = false;
+}
+
+void TrackChain::renderAhead(int numSamples, int delaySamples)
+{
+    takeAheadSequence(numSamples);
+
+    if (renderBuffer(numSamples, aheadMidi, aheadParameterChanges))
+        compensate(buffer, numSamples, delaySamples);
+    else
+        aheadLost.store(true);   // Instrument gone: the callback takes the track back
+
+    aheadRing.push(buffer, numSamples);
+    aheadCursor.store(aheadCursor.load() + numSamples, std::memory_order_release);
+}
+
+} // namespace pianodaw
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "AudioRing.h"
+#include "DelayLine.h"
+#include "GraphSwapper.h"
+#include "LevelMeter.h"
+#include "Mixer.h"
+#include "ParameterAutomation.h"
+#include "../timeline/SamplePlayhead.h"
+#include <atomic>
+#include <vector>
+
+namespace pianodaw {
+
+class AudioClipStreamer;
+class FrozenTrackReader;
+class Track;
+
+/**
+ * TrackChain - Per-track render state owned by the AudioEngine
+ *
+ * Holds the track's hosted instrument (hot-swapped through a GraphSwapper),
+ * the MIDI the sequencer produced for it this block, its output buffer and
+ * the delay line that pads its latency up to the engine's longest path and
+ * the channel strip it is mixed into the master bus with.
+ * Chains are keyed by Track::getUid(); uid 0 is the engine's main instrument,
+ * which also plays live input and tracks without an instrument of their own.
+ *
+ * The chain list itself is guarded by the project lock (the audio thread
+ * holds it for the whole block); everything marked message thread must
+ * only be touched there.
+ *
+ * With anticipative rendering a chain that is not record-armed is rendered
+ * ahead of the callback by an AnticipativeRenderer worker into a lock-free
+ * ring. The audio thread, which holds the project lock anyway, sequences
+ * the track ahead and queues the events for the worker, so workers never
+ * touch the project. The render lock is held by whichever thread runs the
+ * instrument; the audio thread only ever try-locks it.
+ *
+ * A frozen chain has no instrument; it streams the track's rendered audio
+ * (TrackFreezer) in the callback instead. Audio tracks' chains never have
+ * one: their regions stream from disk (AudioClipStreamer) in the callback.
+ *
+ * The track's plugin parameter lanes are sequenced with its MIDI and
+ * applied at their sample offsets while the instrument renders
+ * (ParameterAutomation).
+ */
+class TrackChain
+{
+public:
+    static constexpr int mainUid = 0;
+
+    /** Longest plugin latency that can still be compensated */
+    static constexpr double maxCompensationSeconds = 1.0;
+
+    /** Longest time a chain can be rendered ahead of the callback */
+    static constexpr double maxAheadSeconds = 0.5;
+
+    explicit TrackChain(int trackUid);
+    ~TrackChain();
+
+    int getTrackUid() const { return trackUid; }
+
+    /** Allocate block-sized scratch (audio stopped, or chain not yet visible to the audio thread) */
+    void prepare(double sampleRate, int blockSize, int numChannels);
+
+    /**
+     * Precision of the instrument graph and compensation from the next prepare() on
+     * Only the main instrument renders straight into the engine's (possibly
+     * 64-bit) master buffer; track chains keep float buffers, which the
+     * ahead ring and frozen audio share, and are summed in the master's precision.
+     */
+    void setProcessingPrecision(juce::AudioProcessor::ProcessingPrecision precision);
+
+    // === Message thread ===
+
+    /** Swap in an already prepared graph; crossfades on the audio thread */
+    void setInstrument(std::unique_ptr<juce::AudioProcessorGraph> graph,
+                       juce::AudioProcessorGraph::Node::Ptr node,
+                       const juce::PluginDescription& description);
+    void clearInstrument();
+
+    bool hasInstrument() const { return instrumentNode != nullptr; }
+    juce::AudioProcessor* getInstrument() const;
+    const juce::PluginDescription& getInstrumentDescription() const { return description; }
+
+    /** Invalidates loads started earlier; returns the id a new load must present */
+    int beginLoad() { return ++loadGeneration; }
+    bool isCurrentLoad(int generation) const { return generation == loadGeneration; }
+    int getLoadGeneration() const { return loadGeneration; }
+
+    /**
+     * Play the track from frozen audio (nullptr to unfreeze)
+     * Swapped under the project lock; the previous reader is returned so it
+     * can be destroyed outside it.
+     */
+    std::unique_ptr<FrozenTrackReader> setFrozen(std::unique_ptr<FrozenTrackReader> reader, juce::CriticalSection& projectLock);
+    bool isFrozen() const { return frozen != nullptr; }
+
+    // === Audio thread ===
+
+    /** Start of a block: clears the MIDI and this block's output */
+    void beginBlock();
+
+    juce::MidiBuffer& getMidi() { return midi; }
+
+    /** Plugin parameter changes sequenced for this block, applied by render() */
+    ParameterAutomation::Changes& getParameterChanges() { return parameterChanges; }
+
+    /**
+     * Render the instrument for this block into the chain's buffer
+     * @return false when no instrument is live (MIDI is left untouched)
+     */
+    bool render(int numSamples);
+
+    /** Stream the frozen audio at the windows' positions into the chain's buffer */
+    void renderFrozen(const BlockTickWindow* windows, int numWindows, int numSamples, double tempoBPM);
+
+    /** Mix the audio track's regions at the windows' positions into the chain's buffer */
+    void renderAudio(AudioClipStreamer& streamer, const Track& track, const BlockTickWindow* windows, int numWindows,
+                     int numSamples, double tempoBPM);
+
+    /** Render straight into a caller's buffer/MIDI (used for the main instrument) */
+    bool renderInto(juce::AudioBuffer<float>& target, juce::MidiBuffer& targetMidi);
+    bool renderInto(juce::AudioBuffer<double>& target, juce::MidiBuffer& targetMidi);
+
+    /** True if the last render() produced instrument output */
+    bool hasRenderedOutput() const { return renderedOutput; }
+
+    /** Output of the last render(), numSamples long */
+    juce::AudioBuffer<float>& getBuffer() { return buffer; }
+
+    /** Latency of the live instrument path, as the audio thread last published it (any thread) */
+    int getLatencySamples() const { return instrument.getLatencySamples(); }
+    int getMaxCompensationSamples() const { return compensation.getMaxDelay(); }
+
+    /** Delay target by delaySamples (the gap between this path and the longest one) */
+    void compensate(juce::AudioBuffer<float>& target, int numSamples, int delaySamples);
+    void compensate(juce::AudioBuffer<double>& target, int numSamples, int delaySamples);
+
+    /** This block's output: rendered in the callback, played from the ahead ring, or nullptr */
+    juce::AudioBuffer<float>* getBlockOutput();
+
+    /** Volume, pan and mute/solo fades, applied when the output is summed to the master bus */
+    ChannelStrip& getStrip() { return strip; }
+
+    /** Post-fader level of the chain's output, measured as it is mixed */
+    LevelMeter& getMeter() { return meter; }
+
+    /** Bus node the strip output sums into this block, -1 = master (reset by beginBlock) */
+    void setOutputBus(int bus) { outputBus = bus; }
+    int getOutputBus() const { return outputBus; }
+
+    // === Anticipative rendering ===
+
+    juce::CriticalSection& getRenderLock() { return renderLock; }
+
+    /** Epoch the chain is being rendered ahead for, or -1 while it renders in the callback */
+    int getAheadEpoch() const { return aheadEpoch.load(std::memory_order_acquire); }
+
+    /**
+     * Audio thread, render lock held: hand the chain to the workers
+     * @param playhead Sequencer state after the block just rendered
+     * @param nextSample Engine sample position the workers continue from
+     */
+    void followEpoch(int epoch, const SamplePlayhead& playhead, juce::int64 nextSample);
+
+    /** Audio thread, render lock held: render in the callback again, dropping what was rendered ahead */
+    void stopFollowing();
+
+    /**
+     * Audio thread: take this block from the ahead ring
+     * A short ring still plays what it has; the rest is silence and skipped later.
+     * @return false if nothing usable was queued
+     */
+    bool playAhead(int numSamples, bool& underrun);
+
+    /** Audio thread: render lock busy, so the block is skipped; its MIDI carries over to the next one */
+    void skipBlock(int numSamples);
+
+    /** Audio thread: try-lock the render lock so this block renders in the callback (stops following) */
+    bool claimForCallback();
+    void releaseFromCallback();
+    bool isClaimedByCallback() const { return claimedByCallback; }
+
+    /** Audio thread: this block came from the ahead ring (no MIDI needed) */
+    bool isPlayingAhead() const { return playedAhead; }
+
+    /**
+     * Audio thread, project lock held: sequence the track for the workers
+     * Continues from where followEpoch() or the last call left off, in steps
+     * of blockSize up to engine sample position upTo, at most maxBlocks of
+     * them per call. A step that doesn't fit in the queue is retried next time.
+     */
+    void sequenceAhead(const Track& track, juce::int64 upTo, int blockSize, int maxBlocks);
+
+    // Worker, render lock held
+    juce::int64 getAheadCursor() const { return aheadCursor.load(std::memory_order_acquire); }
+    bool hasAheadSpace(int numSamples) const { return aheadRing.getFreeSpace() >= numSamples; }
+
+    /** True once the audio thread has sequenced the next numSamples to render ahead */
+    bool isAheadSequenced(int numSamples) const
+    {
+        return aheadSequenced.load(std::memory_order_acquire) >= getAheadCursor() + numSamples;
+    }
+
+    /** Render the next numSamples from the queued sequence, compensate them and queue them for the callback */
+    void renderAhead(int numSamples, int delaySamples);
+
+private:
+    /** A MIDI message or parameter change sequenced ahead, at an engine sample position */
+    struct SequencedEvent
+    {
+        juce::int64 sample = 0;
+        int order = 0;                // Keeps events on the same sample in sequencing order
+        int parameterIndex = -1;      // -1 for a MIDI message
+        float value = 0.0f;
+        juce::uint8 data[3] {};
+        int size = 0;
+    };
+
+    static constexpr int aheadEventCapacity = 8192;
+
+    bool renderBuffer(int numSamples, juce::MidiBuffer& midiMessages, ParameterAutomation::Changes& changes);
+
+    /** Worker: move the queued events before aheadCursor + numSamples into aheadMidi and aheadParameterChanges */
+    void takeAheadSequence(int numSamples);
+    void resetAheadSequence(juce::int64 nextSample);
+
+    const int trackUid;
+
+    GraphSwapper instrument;
+    juce::AudioProcessorGraph::Node::Ptr instrumentNode;  // Node in the latest submitted graph
+    juce::PluginDescription description;
+    int loadGeneration = 0;
+
+    juce::MidiBuffer midi;
+    ParameterAutomation::Changes parameterChanges;
+    ParameterAutomation automation;                // Render lock
+    juce::AudioBuffer<float> buffer;
+    bool renderedOutput = false;
+    bool playedAhead = false;
+    DelayLine compensation;
+    ChannelStrip strip;
+    LevelMeter meter;
+    int outputBus = -1;
+    std::unique_ptr<FrozenTrackReader> frozen;
+
+    // Anticipative rendering
+    juce::CriticalSection renderLock;
+    std::atomic<int> aheadEpoch { -1 };
+    std::atomic<juce::int64> aheadCursor { 0 };  // Engine sample position the next ahead block starts at
+    std::atomic<bool> aheadLost { false };       // A worker found no live instrument
+    juce::MidiBuffer aheadMidi;                  // Worker
+    ParameterAutomation::Changes aheadParameterChanges;
+
+    // Sequenced ahead by the audio thread, consumed by the worker rendering the chain
+    SamplePlayhead aheadPlayhead;                // Audio thread
+    std::atomic<juce::int64> aheadSequenced { 0 };  // Engine sample position the queue reaches
+    juce::AbstractFifo aheadEventFifo { aheadEventCapacity };
+    std::vector<SequencedEvent> aheadEvents;
+    std::vector<SequencedEvent> aheadScratch;    // Audio thread: one step, sorted before it is queued
+    juce::MidiBuffer aheadSequenceMidi;          // Audio thread
+    ParameterAutomation::Changes aheadSequenceChanges;  // Audio thread
+    AudioRing aheadRing;
+    juce::AudioBuffer<float> aheadOutput;       // Audio thread
+    int aheadBehind = 0;                         // Audio thread: queued samples that are already in the past
+    bool claimedByCallback = false;              // Audio thread
+    bool carryMidi = false;                      // Audio thread
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackChain)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,529 @@
+#include "TrackFreezer.h"
+#include "ParameterAutomation.h"
+#include "PluginLoader.h"
+#include "TrackSequencer.h"
+#include "../model/ContentHash.h"
+#include "../model/Project.h"
+#include "../model/Track.h"
+#include "../timeline/PPQ.h"
+#include "../timeline/SamplePlayhead.h"
+#include "../timeline/Transport.h"
+#include <array>
+#include <cmath>
+
+namespace pianodaw {
+
+namespace
+{
+    constexpr double streamBufferSeconds = 2.0;
+
+    const ClipRegion* findMidiRegion(const Track& track, int regionId)
+    {
+        for (const auto& region : track.getClipRegions())
+        {
+            if (region.id == regionId && region.clip != nullptr)
+                return &region;
+        }
+        return nullptr;
+    }
+
+    /**
+     * The plugin parameter lanes a render applies; only tracks that have some add
+     * to the hash, so freezes made before lanes were rendered stay valid
+     */
+    void addParameterLanes(const Track& track, ContentHash& hash)
+    {
+        for (const auto& lane : track.getAutomationLanes())
+        {
+            if (lane->getTarget() != AutomationLane::Target::PluginParameter || !lane->isEnabled() || lane->isEmpty())
+                continue;
+
+            hash.add((juce::uint64)lane->getParameterIndex());
+            for (const auto& point : lane->getPoints())
+            {
+                hash.add((juce::uint64)point.tick);
+                hash.add((juce::uint64)std::llround(point.value * 1.0e6));
+            }
+        }
+    }
+
+    /** Like TrackFreezer::computeFingerprint, for a single region */
+    juce::uint64 computeRegionFingerprint(const Track& track, const ClipRegion& region, double tempoBPM, double sampleRate)
+    {
+        ContentHash hash;
+        hash.add((juce::uint64)std::llround(tempoBPM * 1000.0));
+        hash.add((juce::uint64)std::llround(sampleRate));
+        hash.add((juce::uint64)region.startTick);
+        hash.add((juce::uint64)region.offsetTick);
+        hash.add((juce::uint64)region.lengthTick);
+        hash.add(region.clip->getVersion());
+        addParameterLanes(track, hash);
+        return hash.get();
+    }
+}
+
+//==============================================================================
+
+std::unique_ptr<FrozenTrackReader> FrozenTrackReader::open(const juce::File& file, juce::TimeSliceThread& thread,
+                                                           juce::String& errorMessage)
+{
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatReader> source(wavFormat.createReaderFor(file.createInputStream().release(), true));
+
+    if (source == nullptr)
+    {
+        errorMessage = "Could not read " + file.getFullPathName();
+        return nullptr;
+    }
+
+    int samplesToBuffer = juce::roundToInt(streamBufferSeconds * source->sampleRate);
+
+    std::unique_ptr<FrozenTrackReader> result(new FrozenTrackReader());
+    result->reader = std::make_unique<juce::BufferingAudioReader>(source.release(), thread, samplesToBuffer);
+    result->reader->setReadTimeout(0);
+    return result;
+}
+
+void FrozenTrackReader::read(juce::AudioBuffer<float>& dest, int destStart, int numSamples, double position)
+{
+    auto start = (juce::int64)std::llround(position);
+    if (nextPosition >= 0 && std::abs(start - nextPosition) <= 1)
+        start = nextPosition;
+
+    nextPosition = start + numSamples;
+
+    // Unbuffered or past the end reads as silence
+    reader->read(&dest, destStart, numSamples, start, true, true);
+}
+
+//==============================================================================
+
+struct TrackFreezer::Job
+{
+    int trackUid = 0;
+    double tempo = 120.0;
+    double sampleRate = 44100.0;
+    juce::int64 startTick = 0;
+    juce::int64 endTick = 0;
+    int blockSize = 512;
+    int numChannels = 2;
+
+    int regionId = 0;                 // Bounce: the one region rendered (0 = the whole track)
+    juce::File destination;           // Bounce: where the file goes (freezes go to the cache)
+
+    Freeze freeze;
+    std::unique_ptr<juce::AudioProcessorGraph> graph;
+    juce::AudioProcessor* instrument = nullptr;   // Inside graph: where parameter lanes go
+    juce::String error;
+
+    // What the render sequences, copied on the message thread so the worker never needs the project lock
+    std::unique_ptr<Track> track;
+    std::vector<std::unique_ptr<Clip>> clips;
+
+    /** Copy the MIDI regions to render (the bounced one only) with their clips, and the parameter lanes */
+    void snapshot(const Track& source)
+    {
+        track = std::make_unique<Track>(source.getName(), source.getType());
+        track->setMidiChannel(source.getMidiChannel());
+
+        for (const auto& region : source.getClipRegions())
+        {
+            if (region.clip == nullptr || (regionId != 0 && region.id != regionId))
+                continue;
+
+            auto clip = std::make_unique<Clip>(region.clip->getName());
+            {
+                const juce::ScopedLock sl(region.clip->getLock());
+                clip->getNotes() = region.clip->getNotes();
+                clip->getCCEvents() = region.clip->getCCEvents();
+            }
+
+            auto copy = region;
+            copy.clip = clip.get();
+            copy.muted = copy.muted && regionId == 0;   // A bounce renders its region even if it is muted
+            track->addClipRegion(copy);
+            clips.push_back(std::move(clip));
+        }
+
+        for (const auto& lane : source.getAutomationLanes())
+        {
+            if (lane->getTarget() == AutomationLane::Target::PluginParameter)
+                track->addAutomationLane(std::make_unique<AutomationLane>(*lane));
+        }
+    }
+};
+
+TrackFreezer::TrackFreezer(Project& project_, Transport& transport_, PluginLoader& loader_)
+    : project(project_), transport(transport_), loader(loader_)
+{
+    streamThread.startThread(juce::Thread::Priority::high);
+    startTimer(1000);
+}
+
+TrackFreezer::~TrackFreezer()
+{
+    stopTimer();
+
+    // A render in progress stops at its next block; results still queued are dropped by the weak reference
+    shuttingDown.store(true);
+    renderPool.removeAllJobs(true, 30000);
+    streamThread.stopThread(2000);
+}
+
+juce::File TrackFreezer::getCacheDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("PianoDAW")
+        .getChildFile("FreezeCache");
+}
+
+juce::uint64 TrackFreezer::computeFingerprint(const Track& track, double tempoBPM, double sampleRate)
+{
+    ContentHash hash;
+    hash.add((juce::uint64)std::llround(tempoBPM * 1000.0));
+    hash.add((juce::uint64)std::llround(sampleRate));
+
+    for (const auto& region : track.getClipRegions())
+    {
+        hash.add((juce::uint64)region.startTick);
+        hash.add((juce::uint64)region.offsetTick);
+        hash.add((juce::uint64)region.lengthTick);
+        hash.add(region.clip != nullptr ? region.clip->getVersion() : 0);
+
+        // Only muted regions add to the hash, so freezes saved before regions could mute stay valid
+        if (region.muted)
+            hash.add(1);
+    }
+
+    addParameterLanes(track, hash);
+    return hash.get();
+}
+
+const TrackFreezer::Freeze* TrackFreezer::getFreeze(int trackUid) const
+{
+    auto it = freezes.find(trackUid);
+    return it != freezes.end() ? &it->second : nullptr;
+}
+
+TrackFreezer::Freeze TrackFreezer::release(int trackUid)
+{
+    Freeze released;
+
+    auto it = freezes.find(trackUid);
+    if (it != freezes.end())
+    {
+        released = std::move(it->second);
+        freezes.erase(it);
+    }
+
+    return released;
+}
+
+const Track* TrackFreezer::findTrack(int trackUid) const
+{
+    for (const auto& track : project.getTracks())
+    {
+        if (track->getUid() == trackUid)
+            return track.get();
+    }
+    return nullptr;
+}
+
+void TrackFreezer::freeze(const Track& track, const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                          bool sandboxed, int blockSize, int numChannels, Callback onDone)
+{
+    auto job = std::make_shared<Job>();
+    job->trackUid = track.getUid();
+    job->tempo = transport.getTempo();
+    job->blockSize = juce::jmax(1, blockSize);
+    job->numChannels = juce::jmax(1, numChannels);
+
+    for (const auto& region : track.getClipRegions())
+        job->endTick = juce::jmax(job->endTick, (juce::int64)region.getEndTick());
+
+    job->freeze.description = description;
+    job->freeze.state = state;
+    job->freeze.sandboxed = sandboxed;
+    job->sampleRate = sampleRate.load();
+    job->freeze.fingerprint = computeFingerprint(track, job->tempo, job->sampleRate);
+    job->snapshot(track);
+
+    ++pending[job->trackUid];
+    start(job, [this, onDone](std::shared_ptr<Job> rendered) { finish(rendered, onDone); });
+}
+
+void TrackFreezer::bounce(const Track& track, int regionId, const juce::PluginDescription& description,
+                          const juce::MemoryBlock& instrumentState, bool sandboxed, int blockSize, int numChannels,
+                          const juce::File& destination, BounceCallback onDone)
+{
+    auto* region = findMidiRegion(track, regionId);
+    if (region == nullptr)
+    {
+        if (onDone != nullptr)
+            onDone({}, "Not a MIDI region of " + track.getName());
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->trackUid = track.getUid();
+    job->regionId = regionId;
+    job->tempo = transport.getTempo();
+    job->blockSize = juce::jmax(1, blockSize);
+    job->numChannels = juce::jmax(1, numChannels);
+    job->startTick = region->startTick;
+    job->endTick = region->getEndTick();
+    job->destination = destination;
+
+    job->freeze.description = description;
+    job->freeze.state = instrumentState;
+    job->freeze.sandboxed = sandboxed;
+    job->sampleRate = sampleRate.load();
+    job->freeze.fingerprint = computeRegionFingerprint(track, *region, job->tempo, job->sampleRate);
+    job->snapshot(track);
+
+    bouncing.insert({ job->trackUid, regionId });
+    start(job, [this, onDone](std::shared_ptr<Job> rendered) { finishBounce(rendered, onDone); });
+}
+
+void TrackFreezer::start(std::shared_ptr<Job> job, std::function<void(std::shared_ptr<Job>)> onRendered)
+{
+    juce::WeakReference<TrackFreezer> weakThis(this);
+
+    // A separate instance, so the live one keeps playing until the file is ready
+    loader.load(job->freeze.description, job->freeze.state, job->sampleRate, job->blockSize, job->numChannels,
+                job->freeze.sandboxed,
+        [weakThis, job, onRendered](PluginLoader::Result result)
+        {
+            auto* self = weakThis.get();
+            if (self == nullptr)
+                return;
+
+            if (result.graph == nullptr)
+            {
+                job->error = result.error;
+                onRendered(job);
+                return;
+            }
+
+            job->graph = std::move(result.graph);
+            job->instrument = result.instrumentNode != nullptr ? result.instrumentNode->getProcessor() : nullptr;
+
+            self->renderPool.addJob([self, weakThis, job, onRendered]
+            {
+                self->render(job);
+
+                // Finished on the message thread, where the freezer may already be gone
+                juce::MessageManager::callAsync([weakThis, job, onRendered]
+                {
+                    if (weakThis.get() != nullptr)
+                        onRendered(job);
+                });
+            });
+        });
+}
+
+void TrackFreezer::render(std::shared_ptr<Job> job)
+{
+    auto& graph = *job->graph;
+    double rate = job->sampleRate;
+
+    graph.setNonRealtime(true);
+    int latency = graph.getLatencySamples();
+    auto totalSamples = (juce::int64)std::ceil((PPQ::tickToSeconds(job->endTick - job->startTick, job->tempo) + tailSeconds) * rate)
+                      + latency;
+
+    auto cacheDirectory = getCacheDirectory();
+    cacheDirectory.createDirectory();
+    auto tempFile = cacheDirectory.getNonexistentChildFile("rendering", ".tmp");
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    {
+        auto stream = std::make_unique<juce::FileOutputStream>(tempFile);
+        if (stream->openedOk())
+            writer.reset(juce::WavAudioFormat().createWriterFor(stream.get(), rate, (unsigned int)job->numChannels,
+                                                                24, {}, 0));
+        if (writer != nullptr)
+            stream.release();  // Owned by the writer
+    }
+
+    if (writer == nullptr)
+    {
+        job->error = "Could not write " + tempFile.getFullPathName();
+        tempFile.deleteFile();
+        return;
+    }
+
+    SamplePlayhead playhead;
+    playhead.prepare(rate);
+
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> windows;
+    juce::AudioBuffer<float> block(job->numChannels, job->blockSize);
+    juce::MidiBuffer midi;
+    int latencyToSkip = latency;
+
+    // Parameter lanes are rendered in, as the live chain plays them
+    ParameterAutomation automation;
+    ParameterAutomation::Changes parameterChanges;
+    automation.bind(job->instrument);
+
+    for (juce::int64 position = 0; position < totalSamples && job->error.isEmpty(); position += job->blockSize)
+    {
+        if (shuttingDown.load())
+        {
+            job->error = "Cancelled";
+            break;
+        }
+
+        int numSamples = (int)juce::jmin((juce::int64)job->blockSize, totalSamples - position);
+        midi.clear();
+
+        // Sequenced from the snapshot; edits made meanwhile show up as a changed fingerprint when it finishes
+        int numWindows = position == 0 ? playhead.advance(job->startTick, 0, job->tempo, numSamples, 0, windows.data())
+                                       : playhead.advanceFreeRunning(numSamples, windows.data());
+        TrackSequencer::sequence(*job->track, windows.data(), numWindows, midi, 0, false);
+        ParameterAutomation::sequence(*job->track, windows.data(), numWindows, parameterChanges);
+
+        block.setSize(job->numChannels, numSamples, false, false, true);
+        block.clear();
+        automation.render(graph, block, numSamples, midi, parameterChanges);
+
+        // The instrument's latency is rendered and dropped, so the file starts on time
+        int skip = juce::jmin(numSamples, latencyToSkip);
+        latencyToSkip -= skip;
+
+        if (skip < numSamples && !writer->writeFromAudioSampleBuffer(block, skip, numSamples - skip))
+            job->error = "Could not write " + tempFile.getFullPathName();
+    }
+
+    writer.reset();
+
+    if (job->error.isNotEmpty())
+    {
+        tempFile.deleteFile();
+        return;
+    }
+
+    auto target = job->destination;
+    if (target == juce::File())
+        target = cacheDirectory.getNonexistentChildFile("track-" + juce::String::toHexString((juce::int64)job->freeze.fingerprint), ".wav");
+
+    if (!target.getParentDirectory().createDirectory() || !tempFile.moveFileTo(target))
+    {
+        job->error = "Could not move rendered audio to " + target.getFullPathName();
+        tempFile.deleteFile();
+        return;
+    }
+
+    job->freeze.file = target;
+}
+
+void TrackFreezer::finish(std::shared_ptr<Job> job, const Callback& onDone)
+{
+    if (--pending[job->trackUid] <= 0)
+        pending.erase(job->trackUid);
+
+    // Releasing the render instance belongs on the message thread
+    job->graph = nullptr;
+
+    juce::String error = job->error;
+
+    if (error.isEmpty())
+    {
+        auto* track = findTrack(job->trackUid);
+        if (track == nullptr)
+            error = "Track was removed";
+        else if (computeFingerprint(*track, transport.getTempo(), sampleRate.load()) != job->freeze.fingerprint)
+            error = "Track changed while it was being frozen";
+    }
+
+    std::unique_ptr<FrozenTrackReader> reader;
+    if (error.isEmpty())
+        reader = FrozenTrackReader::open(job->freeze.file, streamThread, error);
+
+    if (reader == nullptr)
+    {
+        if (job->freeze.file != juce::File())
+            job->freeze.file.deleteFile();
+
+        if (onDone != nullptr)
+            onDone(nullptr, error);
+        return;
+    }
+
+    freezes[job->trackUid] = std::move(job->freeze);
+
+    if (onDone != nullptr)
+        onDone(std::move(reader), {});
+}
+
+void TrackFreezer::finishBounce(std::shared_ptr<Job> job, const BounceCallback& onDone)
+{
+    bouncing.erase({ job->trackUid, job->regionId });
+    job->graph = nullptr;
+
+    juce::String error = job->error;
+
+    if (error.isEmpty())
+    {
+        auto* track = findTrack(job->trackUid);
+        auto* region = track != nullptr ? findMidiRegion(*track, job->regionId) : nullptr;
+        if (region == nullptr)
+            error = "Region was removed";
+        else if (computeRegionFingerprint(*track, *region, transport.getTempo(), sampleRate.load()) != job->freeze.fingerprint)
+            error = "Region changed while it was being bounced";
+    }
+
+    if (error.isNotEmpty())
+    {
+        if (job->freeze.file != juce::File())
+            job->freeze.file.deleteFile();
+
+        if (onDone != nullptr)
+            onDone({}, error);
+        return;
+    }
+
+    if (onDone != nullptr)
+        onDone(job->freeze.file, {});
+}
+
+std::unique_ptr<FrozenTrackReader> TrackFreezer::adopt(const Track& track, Freeze freeze, juce::String& errorMessage)
+{
+    if (!freeze.file.existsAsFile())
+    {
+        errorMessage = "Frozen audio is missing: " + freeze.file.getFullPathName();
+        return nullptr;
+    }
+
+    if (computeFingerprint(track, transport.getTempo(), sampleRate.load()) != freeze.fingerprint)
+    {
+        errorMessage = "Track changed since it was frozen";
+        return nullptr;
+    }
+
+    auto reader = FrozenTrackReader::open(freeze.file, streamThread, errorMessage);
+    if (reader != nullptr)
+        freezes[track.getUid()] = std::move(freeze);
+
+    return reader;
+}
+
+void TrackFreezer::timerCallback()
+{
+    if (onInvalidated == nullptr)
+        return;
+
+    // Edits happen on this thread, so the project can be read without its lock
+    std::vector<int> stale;
+    for (const auto& [trackUid, freeze] : freezes)
+    {
+        auto* track = findTrack(trackUid);
+        if (track == nullptr || computeFingerprint(*track, transport.getTempo(), sampleRate.load()) != freeze.fingerprint)
+            stale.push_back(trackUid);
+    }
+
+    for (int trackUid : stale)
+        onInvalidated(trackUid);
+}
+
+} // namespace pianodaw
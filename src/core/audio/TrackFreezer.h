@@ -0,0 +1,165 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
+
+namespace pianodaw {
+
+class Project;
+class Track;
+class Transport;
+class PluginLoader;
+
+/**
+ * FrozenTrackReader - Streams a frozen track's audio file for the audio thread
+ *
+ * Wraps a BufferingAudioReader with a zero read timeout, so a block that is
+ * not buffered yet (right after a locate) plays silence instead of waiting
+ * on the disk.
+ */
+class FrozenTrackReader
+{
+public:
+    static std::unique_ptr<FrozenTrackReader> open(const juce::File& file, juce::TimeSliceThread& thread,
+                                                   juce::String& errorMessage);
+
+    /**
+     * Audio thread: write numSamples starting at position (in file samples) into dest
+     * Positions within a sample of where the last read ended continue from there,
+     * so rounding of the tick clock never clicks.
+     */
+    void read(juce::AudioBuffer<float>& dest, int destStart, int numSamples, double position);
+
+    double getSampleRate() const { return reader->sampleRate; }
+
+private:
+    FrozenTrackReader() = default;
+
+    std::unique_ptr<juce::BufferingAudioReader> reader;
+    juce::int64 nextPosition = -1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrozenTrackReader)
+};
+
+/**
+ * TrackFreezer - Renders tracks to cached audio files so their instruments can be unloaded
+ *
+ * A freeze loads a second instance of the track's instrument (with the live
+ * plugin's state), renders the track offline on a worker thread and writes
+ * it to the freeze cache; the live instrument keeps playing meanwhile. The
+ * worker renders from a copy of the track's regions, clips and parameter
+ * lanes taken when the freeze starts, so it never takes the project lock.
+ * Frozen tracks are checked once a second: a fingerprint of their clip
+ * regions, clip contents (Clip::getVersion), tempo and sample rate that no
+ * longer matches invalidates the freeze through onInvalidated.
+ *
+ * Bouncing a region in place takes the same path for a single region: it
+ * renders from the region's start to its end plus the release tail, into a
+ * file the caller chooses.
+ *
+ * Renders are single precision whatever the engine's precision: the files
+ * are 24-bit and play back through the float frozen/audio track path.
+ *
+ * All public functions are message thread only.
+ */
+class TrackFreezer : private juce::Timer
+{
+public:
+    /** Everything needed to play a frozen track and to bring its instrument back */
+    struct Freeze
+    {
+        juce::File file;
+        juce::PluginDescription description;
+        juce::MemoryBlock state;
+        bool sandboxed = false;
+        juce::uint64 fingerprint = 0;   // computeFingerprint() when it was rendered
+    };
+
+    /** Called on the message thread; reader is nullptr on failure */
+    using Callback = std::function<void(std::unique_ptr<FrozenTrackReader> reader, const juce::String& error)>;
+
+    /** Called on the message thread; file is empty on failure */
+    using BounceCallback = std::function<void(const juce::File& file, const juce::String& error)>;
+
+    TrackFreezer(Project& project, Transport& transport, PluginLoader& loader);
+    ~TrackFreezer() override;
+
+    /** Release tail rendered after the last region ends */
+    static constexpr double tailSeconds = 2.0;
+
+    static juce::File getCacheDirectory();
+
+    /** Region layout, clip contents, plugin parameter lanes, tempo and sample rate of a track */
+    static juce::uint64 computeFingerprint(const Track& track, double tempoBPM, double sampleRate);
+
+    /** Sample rate the engine currently runs at (may be called from the audio device thread) */
+    void setSampleRate(double newSampleRate) { sampleRate.store(newSampleRate); }
+
+    /**
+     * Render the track with a fresh instance of its instrument
+     * Keeps the Freeze record once the file is written; onDone gets a reader for it.
+     */
+    void freeze(const Track& track, const juce::PluginDescription& description, const juce::MemoryBlock& state,
+                bool sandboxed, int blockSize, int numChannels, Callback onDone);
+
+    /**
+     * Render one MIDI region of the track with a fresh instance of an instrument to destination
+     * instrumentState is the state of the instrument the track plays through
+     * (its own, or the one of the track it plays through). Fails if the region
+     * or its clip is edited before the file is written.
+     */
+    void bounce(const Track& track, int regionId, const juce::PluginDescription& description,
+                const juce::MemoryBlock& instrumentState, bool sandboxed, int blockSize, int numChannels,
+                const juce::File& destination, BounceCallback onDone);
+
+    bool isBouncing(int trackUid, int regionId) const { return bouncing.count({ trackUid, regionId }) > 0; }
+
+    /** Re-open a freeze from a saved project; fails if its file is gone or the track has changed */
+    std::unique_ptr<FrozenTrackReader> adopt(const Track& track, Freeze freeze, juce::String& errorMessage);
+
+    bool isFreezing(int trackUid) const { return pending.count(trackUid) > 0; }
+    bool isFrozen(int trackUid) const { return freezes.count(trackUid) > 0; }
+    const Freeze* getFreeze(int trackUid) const;
+
+    /** Forget a freeze and hand back its record; the caller deletes the file once its reader is gone */
+    Freeze release(int trackUid);
+
+    /** Forget every freeze but keep the files (the project that refers to them was closed) */
+    void releaseAll() { freezes.clear(); }
+
+    /** Called with the uid of a frozen track whose fingerprint no longer matches */
+    std::function<void(int trackUid)> onInvalidated;
+
+private:
+    struct Job;
+
+    void timerCallback() override;
+    /** Load the job's instrument, render on the pool, then call onRendered on the message thread */
+    void start(std::shared_ptr<Job> job, std::function<void(std::shared_ptr<Job>)> onRendered);
+    void render(std::shared_ptr<Job> job);
+    void finish(std::shared_ptr<Job> job, const Callback& onDone);
+    void finishBounce(std::shared_ptr<Job> job, const BounceCallback& onDone);
+    const Track* findTrack(int trackUid) const;
+
+    Project& project;
+    Transport& transport;
+    PluginLoader& loader;
+    std::atomic<double> sampleRate { 44100.0 };
+
+    juce::ThreadPool renderPool { 1 };
+    juce::TimeSliceThread streamThread { "Frozen track streaming" };
+    std::atomic<bool> shuttingDown { false };
+
+    std::map<int, Freeze> freezes;
+    std::map<int, int> pending;   // Track uid -> freezes in flight
+    std::set<std::pair<int, int>> bouncing;   // Track uid, region id
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(TrackFreezer)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TrackFreezer)
+};
+
+} // namespace pianodaw
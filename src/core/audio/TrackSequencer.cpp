@@ -0,0 +1,147 @@
+#include "TrackSequencer.h"
+#include "../model/Clip.h"
+#include "../model/Track.h"
+
+namespace pianodaw {
+
+void TrackSequencer::sequence(const Track& track, const BlockTickWindow* windows, int numWindows,
+                              juce::MidiBuffer& midi, int sampleOffset, bool respectMute)
+{
+    // Skip muted tracks
+    if (respectMute && track.isMuted())
+        return;
+
+    for (int i = 0; i < numWindows; ++i)
+        sequenceWindow(track, windows[i], midi, sampleOffset);
+}
+
+bool TrackSequencer::sequenceRegion(const Track& track, int regionId, const BlockTickWindow* windows, int numWindows,
+                                    juce::MidiBuffer& midi, int sampleOffset)
+{
+    for (const auto& clipRegion : track.getClipRegions())
+    {
+        if (clipRegion.id != regionId || clipRegion.clip == nullptr)
+            continue;
+
+        for (int i = 0; i < numWindows; ++i)
+            sequenceRegionWindow(clipRegion, track.getMidiChannel(), windows[i], midi, sampleOffset);
+        return true;
+    }
+
+    return false;
+}
+
+void TrackSequencer::addAllNotesOff(juce::MidiBuffer& midi, juce::uint16 channelMask, int samplePosition)
+{
+    // All Notes Off leaves pedalled notes sounding, so the pedals go up too
+    for (int channel = 1; channel <= 16; ++channel)
+    {
+        if ((channelMask & getChannelBit(channel)) != 0)
+        {
+            midi.addEvent(juce::MidiMessage::allNotesOff(channel), samplePosition);
+            midi.addEvent(juce::MidiMessage::controllerEvent(channel, 64, 0), samplePosition);
+            midi.addEvent(juce::MidiMessage::controllerEvent(channel, 66, 0), samplePosition);
+        }
+    }
+}
+
+void TrackSequencer::sequenceWindow(const Track& track, const BlockTickWindow& window,
+                                    juce::MidiBuffer& midi, int sampleOffset)
+{
+    int channel = track.getMidiChannel();
+
+    // Play each clip region in the track
+    for (const auto& clipRegion : track.getClipRegions())
+    {
+        if (!clipRegion.muted)
+            sequenceRegionWindow(clipRegion, channel, window, midi, sampleOffset);
+    }
+}
+
+void TrackSequencer::sequenceRegionWindow(const ClipRegion& clipRegion, int channel, const BlockTickWindow& window,
+                                          juce::MidiBuffer& midi, int sampleOffset)
+{
+    Clip* clip = clipRegion.clip;
+    if (!clip)
+        return;
+
+    int64_t clipStartTick = clipRegion.startTick;
+    int64_t clipOffset = clipRegion.offsetTick;
+    int64_t clipLengthTick = clipRegion.lengthTick;
+    int64_t clipEndTick = clipStartTick + clipLengthTick;
+
+    // Skip clip regions this window doesn't touch (note-offs at the very end still count)
+    if (window.endTick <= clipStartTick || window.startTick > clipEndTick)
+        return;
+
+    // Controllers first, so a pedal change takes effect before a note on the same tick
+    bool sustained = false;   // Sustain pedal at the window end (or the region end, if sooner)
+    bool sostenuto = false;
+    for (const auto& cc : clip->getCCEvents())
+    {
+        int64_t ccAbsoluteTick = clipStartTick + (cc.tick - clipOffset);
+        if (ccAbsoluteTick >= window.endTick || ccAbsoluteTick >= clipEndTick)
+            break;
+        if (ccAbsoluteTick < clipStartTick)
+            continue;
+
+        if (window.contains(ccAbsoluteTick))
+        {
+            midi.addEvent(juce::MidiMessage::controllerEvent(channel, cc.cc, cc.value),
+                          sampleOffset + window.sampleOffsetFor(ccAbsoluteTick));
+        }
+
+        if (cc.isSustainPedal())
+            sustained = cc.isPedalOn();
+        else if (cc.isSostenutoPedal())
+            sostenuto = cc.isPedalOn();
+    }
+
+    // Like held notes, a held pedal is released at the region end, or else at the loop end
+    int pedalRelease = -1;
+    if (window.contains(clipEndTick))
+        pedalRelease = window.sampleOffsetFor(clipEndTick);
+    else if (window.endsAtLoopEnd)
+        pedalRelease = window.lastSample();
+
+    if (pedalRelease >= 0)
+    {
+        if (sustained)
+            midi.addEvent(juce::MidiMessage::controllerEvent(channel, 64, 0), sampleOffset + pedalRelease);
+        if (sostenuto)
+            midi.addEvent(juce::MidiMessage::controllerEvent(channel, 66, 0), sampleOffset + pedalRelease);
+    }
+
+    // Play notes from this clip
+    auto& notes = clip->getNotes();
+    for (const auto& note : notes)
+    {
+        // Convert note time to timeline time (add clip start + offset)
+        int64_t noteAbsoluteStart = clipStartTick + (note.startTick - clipOffset);
+        int64_t noteAbsoluteEnd = clipStartTick + (note.endTick - clipOffset);
+
+        // Check if note is within clip region bounds
+        if (noteAbsoluteStart < clipStartTick || noteAbsoluteEnd > clipEndTick)
+            continue;
+
+        // Note On
+        if (window.contains(noteAbsoluteStart))
+        {
+            midi.addEvent(juce::MidiMessage::noteOn(channel, note.pitch, (juce::uint8)note.velocity),
+                          sampleOffset + window.sampleOffsetFor(noteAbsoluteStart));
+        }
+
+        // Note Off (notes still held at the loop end are released there)
+        if (window.contains(noteAbsoluteEnd))
+        {
+            midi.addEvent(juce::MidiMessage::noteOff(channel, note.pitch),
+                          sampleOffset + window.sampleOffsetFor(noteAbsoluteEnd));
+        }
+        else if (window.endsAtLoopEnd && noteAbsoluteStart < window.endTick && noteAbsoluteEnd >= window.endTick)
+        {
+            midi.addEvent(juce::MidiMessage::noteOff(channel, note.pitch), sampleOffset + window.lastSample());
+        }
+    }
+}
+
+} // namespace pianodaw
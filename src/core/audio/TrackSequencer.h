@@ -0,0 +1,49 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "../timeline/SamplePlayhead.h"
+
+namespace pianodaw {
+
+class Track;
+struct ClipRegion;
+
+/**
+ * TrackSequencer - Turns a track's clip regions into MIDI for a block
+ *
+ * Stateless, so the audio thread and the anticipative render workers can
+ * sequence tracks the same way. Callers hold the project lock. Notes go out
+ * on the track's MIDI channel, so several tracks can share one
+ * multi-timbral instrument.
+ */
+class TrackSequencer
+{
+public:
+    /**
+     * Add the note and controller events (sustain pedal...) that fall inside windows (muted tracks add nothing)
+     * @param sampleOffset Added to every event position (for partial blocks)
+     * @param respectMute False to sequence muted tracks too (offline renders)
+     */
+    static void sequence(const Track& track, const BlockTickWindow* windows, int numWindows,
+                         juce::MidiBuffer& midi, int sampleOffset = 0, bool respectMute = true);
+
+    /**
+     * Like sequence(), for one region of the track only, muted or not (bounce-in-place renders)
+     * @return false if the track has no MIDI region with that id
+     */
+    static bool sequenceRegion(const Track& track, int regionId, const BlockTickWindow* windows, int numWindows,
+                               juce::MidiBuffer& midi, int sampleOffset = 0);
+
+    /** All Notes Off, then sustain and sostenuto up, on each channel in channelMask (bit 0 = channel 1) */
+    static void addAllNotesOff(juce::MidiBuffer& midi, juce::uint16 channelMask, int samplePosition);
+
+    static juce::uint16 getChannelBit(int channel) { return (juce::uint16)(1u << (juce::jlimit(1, 16, channel) - 1)); }
+
+private:
+    static void sequenceWindow(const Track& track, const BlockTickWindow& window,
+                               juce::MidiBuffer& midi, int sampleOffset);
+    static void sequenceRegionWindow(const ClipRegion& clipRegion, int channel, const BlockTickWindow& window,
+                                     juce::MidiBuffer& midi, int sampleOffset);
+};
+
+} // namespace pianodaw
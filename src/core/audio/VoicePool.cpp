@@ -0,0 +1,159 @@
+#include "VoicePool.h"
+#include <cmath>
+
+namespace pianodaw {
+
+int VoicePool::getCeiling() const
+{
+    // An eighth of the allocation (at most maxReserve) stays free for steal fades
+    int allocated = voices.size();
+    int reserve = juce::jlimit(1, maxReserve, allocated / 8);
+    return juce::jlimit(1, juce::jmax(1, allocated - reserve), maxSounding.load());
+}
+
+int VoicePool::countSounding() const
+{
+    int sounding = 0;
+    for (auto* voice : voices)
+        if (voice->isVoiceActive() && !asPooled(voice)->isStolen())
+            ++sounding;
+
+    return sounding;
+}
+
+juce::SynthesiserVoice* VoicePool::findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                                 int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    // Called from noteOn() with the synth's lock held
+    if (countSounding() >= getCeiling())
+    {
+        if (!stealIfNoneAvailable)
+            return nullptr;
+
+        if (auto* victim = findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber))
+        {
+            asPooled(victim)->steal();
+            steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    juce::SynthesiserVoice* quietestFading = nullptr;
+    for (auto* voice : voices)
+    {
+        if (!voice->canPlaySound(soundToPlay))
+            continue;
+
+        if (!voice->isVoiceActive())
+        {
+            asPooled(voice)->reuse();
+            return voice;
+        }
+
+        if (asPooled(voice)->isStolen()
+            && (quietestFading == nullptr || asPooled(voice)->getLevel() < asPooled(quietestFading)->getLevel()))
+            quietestFading = voice;
+    }
+
+    // The whole reserve is still fading: cut the quietest fade short (startVoice() stops it outright)
+    if (quietestFading != nullptr)
+    {
+        cutSteals.fetch_add(1, std::memory_order_relaxed);
+        asPooled(quietestFading)->reuse();
+        return quietestFading;
+    }
+
+    return nullptr;
+}
+
+juce::SynthesiserVoice* VoicePool::findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int, int) const
+{
+    // The lowest and highest keys held down carry the bass and the melody: they go last
+    juce::SynthesiserVoice* lowest = nullptr;
+    juce::SynthesiserVoice* highest = nullptr;
+    for (auto* voice : voices)
+    {
+        if (!voice->isVoiceActive() || !voice->isKeyDown() || asPooled(voice)->isStolen())
+            continue;
+
+        if (lowest == nullptr || voice->getCurrentlyPlayingNote() < lowest->getCurrentlyPlayingNote())
+            lowest = voice;
+        if (highest == nullptr || voice->getCurrentlyPlayingNote() > highest->getCurrentlyPlayingNote())
+            highest = voice;
+    }
+
+    auto rank = [lowest, highest](juce::SynthesiserVoice* voice)
+    {
+        if (voice->isPlayingButReleased())
+            return 0;   // Damper tail
+        if (!voice->isKeyDown())
+            return 1;   // Held by a pedal
+        return voice == lowest || voice == highest ? 3 : 2;
+    };
+
+    juce::SynthesiserVoice* best = nullptr;
+    int bestRank = 0;
+    float bestLevel = 0.0f;
+
+    for (auto* voice : voices)
+    {
+        if (!voice->isVoiceActive() || !voice->canPlaySound(soundToPlay) || asPooled(voice)->isStolen())
+            continue;
+
+        int voiceRank = rank(voice);
+        float level = asPooled(voice)->getLevel();
+
+        bool better = best == nullptr || voiceRank < bestRank
+                   || (voiceRank == bestRank && (level < bestLevel - 1.0e-3f
+                       || (std::abs(level - bestLevel) <= 1.0e-3f && voice->wasStartedBefore(*best))));
+        if (better)
+        {
+            best = voice;
+            bestRank = voiceRank;
+            bestLevel = level;
+        }
+    }
+
+    return best;
+}
+
+void VoicePool::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    Synthesiser::renderVoices(outputAudio, startSample, numSamples);
+    publishActive();
+}
+
+void VoicePool::renderVoices(juce::AudioBuffer<double>& outputAudio, int startSample, int numSamples)
+{
+    Synthesiser::renderVoices(outputAudio, startSample, numSamples);
+    publishActive();
+}
+
+void VoicePool::publishActive()
+{
+    int sounding = countSounding();
+    active.store(sounding, std::memory_order_relaxed);
+
+    if (sounding > peak.load(std::memory_order_relaxed))
+        peak.store(sounding, std::memory_order_relaxed);
+}
+
+VoicePool::Stats VoicePool::getStats() const
+{
+    Stats stats;
+    stats.active = active.load(std::memory_order_relaxed);
+    stats.peak = peak.load(std::memory_order_relaxed);
+    stats.ceiling = getCeiling();
+    stats.allocated = voices.size();
+    stats.steals = steals.load(std::memory_order_relaxed);
+    stats.cutSteals = cutSteals.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void VoicePool::resetStats()
+{
+    peak.store(active.load());
+    steals.store(0);
+    cutSteals.store(0);
+}
+
+} // namespace pianodaw
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+
+namespace pianodaw {
+
+/**
+ * PooledVoice - A voice VoicePool can rank and steal
+ */
+class PooledVoice : public juce::SynthesiserVoice
+{
+public:
+    /** Rough current gain of the note (0 = silent), so the quietest voice is stolen first */
+    virtual float getLevel() const = 0;
+
+    /** Fade out over VoicePool::stealFadeSeconds, then free itself; no longer counts against the ceiling */
+    void steal()
+    {
+        stolen = true;
+        fadeOutForSteal();
+    }
+
+    bool isStolen() const { return stolen && isVoiceActive(); }
+
+    /** The pool hands the voice out for a new note */
+    void reuse() { stolen = false; }
+
+protected:
+    virtual void fadeOutForSteal() = 0;
+
+private:
+    bool stolen = false;
+};
+
+/**
+ * VoicePool - Synthesiser with a voice ceiling and priority-based stealing
+ *
+ * Voices are preallocated; at most getMaxVoices() of them sound at once,
+ * and the rest are a reserve that lets a stolen voice fade out over a few
+ * milliseconds while the new note starts on a spare one. A note over the
+ * ceiling steals, in this order:
+ * - released voices still in their tail, then
+ * - voices only held by a pedal, then
+ * - voices whose key is down, except the lowest and highest (bass and melody).
+ * Within a group the quietest goes first, then the oldest. Only when the
+ * whole reserve is still fading is a fade cut short, so the number of
+ * voices rendered never exceeds what was allocated, whatever the MIDI.
+ *
+ * Every voice added must be a PooledVoice. The ceiling and the counters are
+ * atomics: set and read from any thread.
+ */
+class VoicePool : public juce::Synthesiser
+{
+public:
+    static constexpr int maxVoices = 128;
+    static constexpr int defaultMaxVoices = 64;
+    static constexpr int maxReserve = 16;
+    static constexpr double stealFadeSeconds = 0.005;
+
+    struct Stats
+    {
+        int active = 0;                 // Sounding in the last rendered block, stolen voices excluded
+        int peak = 0;                   // Since the last reset
+        int ceiling = 0;                // In effect for the voices allocated
+        int allocated = 0;
+        juce::int64 steals = 0;         // Faded out to make room
+        juce::int64 cutSteals = 0;      // Cut short because the reserve was still fading
+    };
+
+    VoicePool() = default;
+
+    /** Upper bound on voices sounding at once (clamped to what the allocation leaves after the reserve) */
+    void setMaxVoices(int numVoices) { maxSounding.store(juce::jlimit(1, maxVoices, numVoices)); }
+    int getMaxVoices() const { return maxSounding.load(); }
+
+    Stats getStats() const;
+    void resetStats();
+
+protected:
+    juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                          int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                             int midiNoteNumber) const override;
+
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+    void renderVoices(juce::AudioBuffer<double>& outputAudio, int startSample, int numSamples) override;
+
+private:
+    static PooledVoice* asPooled(juce::SynthesiserVoice* voice) { return static_cast<PooledVoice*>(voice); }
+
+    int getCeiling() const;
+    int countSounding() const;
+    void publishActive();
+
+    std::atomic<int> maxSounding { defaultMaxVoices };
+    std::atomic<int> active { 0 };
+    std::atomic<int> peak { 0 };
+    mutable std::atomic<juce::int64> steals { 0 };
+    mutable std::atomic<juce::int64> cutSteals { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoicePool)
+};
+
+} // namespace pianodaw
@@ -0,0 +1,328 @@
+#include "WaveformCache.h"
+#include "../model/Project.h"
+#include "../../ui/panels/DebugLogWindow.h"
+#include <vector>
+
+namespace pianodaw {
+
+namespace
+{
+    // Header: magic, version, channels, levels, samples per peak, level factor, source length, size, modification time
+    constexpr juce::uint32 peakFileMagic = 0x4b504450;   // "PDPK"
+    constexpr juce::uint32 peakFileVersion = 1;
+
+    bool shouldStop()
+    {
+        auto* job = juce::ThreadPoolJob::getCurrentThreadPoolJob();
+        return job != nullptr && job->shouldExit();
+    }
+
+    juce::int16 toPeak(float sample)
+    {
+        return (juce::int16)juce::roundToInt(juce::jlimit(-1.0f, 1.0f, sample) * 32767.0f);
+    }
+}
+
+//==============================================================================
+// PeakFile
+//==============================================================================
+
+juce::int64 PeakFile::getSamplesPerPeak(int level)
+{
+    juce::int64 samplesPerPeak = firstSamplesPerPeak;
+    for (int i = 0; i < level; ++i)
+        samplesPerPeak *= levelFactor;
+    return samplesPerPeak;
+}
+
+juce::int64 PeakFile::getNumPeaks(int level) const
+{
+    auto samplesPerPeak = getSamplesPerPeak(level);
+    return (sourceLength + samplesPerPeak - 1) / samplesPerPeak;
+}
+
+bool PeakFile::generate(const juce::File& audioFile, const juce::File& peakFile, juce::String& errorMessage)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(audioFile));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+    {
+        errorMessage = "Not a readable audio file: " + audioFile.getFileName();
+        return false;
+    }
+
+    int channels = juce::jlimit(1, maxChannels, (int)reader->numChannels);
+    auto length = reader->lengthInSamples;
+
+    // Level 0 straight from the file, a chunk of whole peaks at a time
+    std::vector<std::vector<juce::int16>> levels((size_t)numLevels);
+    auto numPeaks = (length + firstSamplesPerPeak - 1) / firstSamplesPerPeak;
+    levels[0].resize((size_t)(numPeaks * channels * 2));
+
+    constexpr int peaksPerChunk = 1024;
+    juce::AudioBuffer<float> chunk(channels, firstSamplesPerPeak * peaksPerChunk);
+
+    for (juce::int64 peak = 0; peak < numPeaks; peak += peaksPerChunk)
+    {
+        if (shouldStop())
+        {
+            errorMessage = "Cancelled";
+            return false;
+        }
+
+        auto start = peak * firstSamplesPerPeak;
+        int numSamples = (int)juce::jmin((juce::int64)chunk.getNumSamples(), length - start);
+        reader->read(&chunk, 0, numSamples, start, true, channels > 1);
+
+        for (int offset = 0, p = 0; offset < numSamples; offset += firstSamplesPerPeak, ++p)
+        {
+            int count = juce::jmin(firstSamplesPerPeak, numSamples - offset);
+            auto* out = levels[0].data() + (size_t)((peak + p) * channels * 2);
+
+            for (int ch = 0; ch < channels; ++ch)
+            {
+                auto range = juce::FloatVectorOperations::findMinAndMax(chunk.getReadPointer(ch, offset), count);
+                out[ch * 2] = toPeak(range.getStart());
+                out[ch * 2 + 1] = toPeak(range.getEnd());
+            }
+        }
+    }
+
+    // Every further level reduces the one below
+    for (int level = 1; level < numLevels; ++level)
+    {
+        const auto& finer = levels[(size_t)level - 1];
+        auto finerPeaks = (juce::int64)finer.size() / (channels * 2);
+        auto coarserPeaks = (finerPeaks + levelFactor - 1) / levelFactor;
+        auto& coarser = levels[(size_t)level];
+        coarser.resize((size_t)(coarserPeaks * channels * 2));
+
+        for (juce::int64 peak = 0; peak < coarserPeaks; ++peak)
+        {
+            for (int ch = 0; ch < channels; ++ch)
+            {
+                juce::int16 lo = 32767, hi = -32768;
+                for (auto f = peak * levelFactor; f < juce::jmin(finerPeaks, (peak + 1) * levelFactor); ++f)
+                {
+                    lo = juce::jmin(lo, finer[(size_t)((f * channels + ch) * 2)]);
+                    hi = juce::jmax(hi, finer[(size_t)((f * channels + ch) * 2 + 1)]);
+                }
+                coarser[(size_t)((peak * channels + ch) * 2)] = lo;
+                coarser[(size_t)((peak * channels + ch) * 2 + 1)] = hi;
+            }
+        }
+    }
+
+    // Written beside the target and moved over it, so a reader never maps half a file
+    if (!peakFile.getParentDirectory().createDirectory())
+    {
+        errorMessage = "Cannot create " + peakFile.getParentDirectory().getFullPathName();
+        return false;
+    }
+
+    juce::TemporaryFile temp(peakFile);
+    {
+        juce::FileOutputStream out(temp.getFile());
+        if (!out.openedOk())
+        {
+            errorMessage = "Cannot write " + temp.getFile().getFullPathName();
+            return false;
+        }
+
+        out.writeInt((int)peakFileMagic);
+        out.writeInt((int)peakFileVersion);
+        out.writeInt(channels);
+        out.writeInt(numLevels);
+        out.writeInt(firstSamplesPerPeak);
+        out.writeInt(levelFactor);
+        out.writeInt64(length);
+        out.writeInt64(audioFile.getSize());
+        out.writeInt64(audioFile.getLastModificationTime().toMilliseconds());
+
+        for (const auto& level : levels)
+            for (auto value : level)
+                out.writeShort(value);
+
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            errorMessage = out.getStatus().getErrorMessage();
+            return false;
+        }
+    }
+
+    if (!temp.overwriteTargetFileWithTemporary())
+    {
+        errorMessage = "Cannot replace " + peakFile.getFullPathName();
+        return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<PeakFile> PeakFile::open(const juce::File& peakFile, const juce::File& audioFile)
+{
+    if (!peakFile.existsAsFile())
+        return nullptr;
+
+    std::unique_ptr<PeakFile> peaks(new PeakFile());
+    peaks->mapping = std::make_unique<juce::MemoryMappedFile>(peakFile, juce::MemoryMappedFile::readOnly, false);
+
+    auto* data = static_cast<const char*>(peaks->mapping->getData());
+    auto size = peaks->mapping->getSize();
+    if (data == nullptr || size < headerSize)
+        return nullptr;
+
+    auto readInt = [data](size_t offset) { return (int)juce::ByteOrder::littleEndianInt(data + offset); };
+    auto readInt64 = [data](size_t offset) { return (juce::int64)juce::ByteOrder::littleEndianInt64(data + offset); };
+
+    if ((juce::uint32)readInt(0) != peakFileMagic || readInt(4) != (int)peakFileVersion
+        || readInt(12) != numLevels || readInt(16) != firstSamplesPerPeak || readInt(20) != levelFactor)
+        return nullptr;
+
+    // Stale once the audio file was replaced or edited
+    if (readInt64(32) != audioFile.getSize()
+        || readInt64(40) != audioFile.getLastModificationTime().toMilliseconds())
+        return nullptr;
+
+    peaks->numChannels = readInt(8);
+    peaks->sourceLength = readInt64(24);
+    if (peaks->numChannels < 1 || peaks->numChannels > maxChannels || peaks->sourceLength <= 0)
+        return nullptr;
+
+    size_t offset = headerSize;
+    for (int level = 0; level < numLevels; ++level)
+    {
+        peaks->levelData[level] = data + offset;
+        offset += (size_t)(peaks->getNumPeaks(level) * peaks->numChannels * 2) * sizeof(juce::int16);
+    }
+
+    if (offset > size)
+        return nullptr;
+
+    return peaks;
+}
+
+int PeakFile::chooseLevel(double samplesPerPixel) const
+{
+    int level = 0;
+    while (level + 1 < numLevels && (double)getSamplesPerPeak(level + 1) <= samplesPerPixel)
+        ++level;
+    return level;
+}
+
+bool PeakFile::getRange(int level, juce::int64 start, juce::int64 end, float& min, float& max) const
+{
+    auto samplesPerPeak = getSamplesPerPeak(level);
+    auto numPeaks = getNumPeaks(level);
+    auto first = juce::jmax((juce::int64)0, start / samplesPerPeak);
+    auto last = juce::jmin(numPeaks, juce::jmax(first + 1, (end + samplesPerPeak - 1) / samplesPerPeak));
+    if (first >= last)
+        return false;
+
+    int lo = 32767, hi = -32768;
+    for (auto peak = first; peak < last; ++peak)
+    {
+        auto* values = levelData[level] + (size_t)(peak * numChannels * 2) * sizeof(juce::int16);
+        for (int i = 0; i < numChannels * 2; i += 2)
+        {
+            lo = juce::jmin(lo, (int)(juce::int16)juce::ByteOrder::littleEndianShort(values + i * 2));
+            hi = juce::jmax(hi, (int)(juce::int16)juce::ByteOrder::littleEndianShort(values + i * 2 + 2));
+        }
+    }
+
+    min = (float)lo / 32767.0f;
+    max = (float)hi / 32767.0f;
+    return true;
+}
+
+//==============================================================================
+// WaveformCache
+//==============================================================================
+
+WaveformCache::WaveformCache(Project& project_)
+    : project(project_)
+{
+}
+
+WaveformCache::~WaveformCache()
+{
+    // A scan in progress stops at its next chunk; results still queued are dropped by the weak reference
+    pool.removeAllJobs(true, 10000);
+}
+
+juce::File WaveformCache::getPeakFileFor(const juce::File& audioFile) const
+{
+    auto projectFile = project.getProjectFile();
+    auto directory = projectFile != juce::File()
+        ? projectFile.getSiblingFile(projectFile.getFileNameWithoutExtension() + " Peaks")
+        : juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile("PianoDAW").getChildFile("Peaks");
+
+    // Files of the same name from different folders must not share peaks
+    return directory.getChildFile(audioFile.getFileName() + "-"
+                                  + juce::String::toHexString(audioFile.getFullPathName().hashCode64()) + ".peaks");
+}
+
+void WaveformCache::prepare(const AudioClip& clip)
+{
+    getPeaks(clip);
+}
+
+const PeakFile* WaveformCache::getPeaks(const AudioClip& clip)
+{
+    auto audioFile = clip.getFile();
+    auto peakFile = getPeakFileFor(audioFile);
+    auto key = peakFile.getFullPathName();
+    auto& entry = entries[key];
+
+    if (entry.peaks != nullptr || entry.pending || entry.failed)
+        return entry.peaks.get();
+
+    // Peaks from an earlier session are mapped straight away
+    entry.peaks = PeakFile::open(peakFile, audioFile);
+    if (entry.peaks != nullptr)
+        return entry.peaks.get();
+
+    entry.pending = true;
+    juce::WeakReference<WaveformCache> weakThis(this);
+
+    pool.addJob([weakThis, key, peakFile, audioFile]
+    {
+        juce::String error;
+        bool generated = PeakFile::generate(audioFile, peakFile, error);
+
+        // The cache may have been destroyed while the peaks were generated; check on the message thread
+        juce::MessageManager::callAsync([weakThis, key, peakFile, audioFile, generated, error]
+        {
+            if (auto* cache = weakThis.get())
+                cache->finished(key, peakFile, audioFile, generated, error);
+        });
+    });
+
+    return nullptr;
+}
+
+void WaveformCache::finished(const juce::String& key, const juce::File& peakFile, const juce::File& audioFile,
+                             bool generated, const juce::String& error)
+{
+    auto& entry = entries[key];
+    entry.pending = false;
+
+    if (generated)
+        entry.peaks = PeakFile::open(peakFile, audioFile);
+
+    if (entry.peaks == nullptr)
+    {
+        entry.failed = true;
+        DebugLogWindow::addLog("WaveformCache: No peaks for " + audioFile.getFileName()
+                             + (error.isNotEmpty() ? " (" + error + ")" : juce::String()));
+        return;
+    }
+
+    if (onPeaksReady != nullptr)
+        onPeaksReady();
+}
+
+} // namespace pianodaw
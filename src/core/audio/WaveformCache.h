@@ -0,0 +1,111 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace pianodaw {
+
+class AudioClip;
+class Project;
+
+/**
+ * PeakFile - Memory-mapped min/max peaks of an audio file at several resolutions
+ *
+ * Level 0 holds one min/max pair per channel for every firstSamplesPerPeak
+ * samples; every further level is levelFactor times coarser. A drawing
+ * picks the coarsest level still finer than a pixel, so one pixel never
+ * touches more than levelFactor peaks, whatever the zoom.
+ *
+ * The file starts with the source's length, size and modification time;
+ * open() refuses a file that no longer matches its source.
+ */
+class PeakFile
+{
+public:
+    static constexpr int numLevels = 5;
+    static constexpr int firstSamplesPerPeak = 64;
+    static constexpr int levelFactor = 4;      // 64, 256, 1024, 4096, 16384 samples per peak
+    static constexpr int maxChannels = 2;
+
+    /** Scan the audio file and write its peaks (on a worker thread; stops early if its pool job is asked to exit) */
+    static bool generate(const juce::File& audioFile, const juce::File& peakFile, juce::String& errorMessage);
+
+    /** Map a peak file, or nullptr if it is missing, corrupt or older than the audio file */
+    static std::unique_ptr<PeakFile> open(const juce::File& peakFile, const juce::File& audioFile);
+
+    int getNumChannels() const { return numChannels; }
+    juce::int64 getSourceLength() const { return sourceLength; }
+
+    /** Coarsest level whose peaks are no wider than samplesPerPixel */
+    int chooseLevel(double samplesPerPixel) const;
+
+    /**
+     * Min/max over all channels of source samples [start, end) at a level
+     * @return false if the range lies outside the file
+     */
+    bool getRange(int level, juce::int64 start, juce::int64 end, float& min, float& max) const;
+
+private:
+    PeakFile() = default;
+
+    static constexpr size_t headerSize = 48;
+
+    static juce::int64 getSamplesPerPeak(int level);
+    juce::int64 getNumPeaks(int level) const;
+
+    std::unique_ptr<juce::MemoryMappedFile> mapping;
+    int numChannels = 0;
+    juce::int64 sourceLength = 0;
+    const char* levelData[numLevels] {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PeakFile)
+};
+
+/**
+ * WaveformCache - Peak files of the project's audio clips, generated in the background
+ *
+ * Peaks are stored in a "<project> Peaks" folder next to the project file
+ * (the app's data folder until it is saved) and reused across sessions
+ * while the audio file is unchanged. Missing ones are generated on a
+ * worker; onPeaksReady is called on the message thread when one is mapped.
+ *
+ * All public functions are message thread only.
+ */
+class WaveformCache
+{
+public:
+    explicit WaveformCache(Project& project);
+    ~WaveformCache();
+
+    /** Start generating the clip's peaks, unless they exist (call on import) */
+    void prepare(const AudioClip& clip);
+
+    /** The clip's peaks, or nullptr while they are being generated (starts that if needed) */
+    const PeakFile* getPeaks(const AudioClip& clip);
+
+    std::function<void()> onPeaksReady;
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<PeakFile> peaks;
+        bool pending = false;
+        bool failed = false;     // Not retried this session
+    };
+
+    juce::File getPeakFileFor(const juce::File& audioFile) const;
+    void finished(const juce::String& key, const juce::File& peakFile, const juce::File& audioFile,
+                  bool generated, const juce::String& error);
+
+    Project& project;
+    std::map<juce::String, Entry> entries;   // By peak file path, so a saved-as project gets its own
+    juce::ThreadPool pool { 1 };
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(WaveformCache)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformCache)
+};
+
+} // namespace pianodaw
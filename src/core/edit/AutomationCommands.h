@@ -0,0 +1,288 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <memory>
+#include "../model/Project.h"
+#include "UndoStack.h"
+
+namespace pianodaw {
+
+/**
+ * AutomationLaneCommand - Base for commands that edit one automation lane
+ *
+ * Lanes are found again by track uid and target on every execute/undo, as
+ * other commands may have removed and recreated them in between. Edits take
+ * the project lock, which the audio thread holds while it reads lanes.
+ */
+class AutomationLaneCommand : public Command
+{
+protected:
+    AutomationLaneCommand(Project& project_, const Track& track, AutomationLane::Target target_, int parameterIndex_ = -1)
+        : project(project_), trackUid(track.getUid()), target(target_),
+          parameterIndex(target_ == AutomationLane::Target::PluginParameter ? parameterIndex_ : -1) {}
+
+    Track* findTrack() const { return project.findTrackByUid(trackUid); }
+
+    AutomationLane* findLane() const
+    {
+        auto* track = findTrack();
+        return track != nullptr ? track->findAutomationLane(target, parameterIndex) : nullptr;
+    }
+
+    Project& project;
+    int trackUid;
+    AutomationLane::Target target;
+    int parameterIndex;
+};
+
+/**
+ * AddAutomationLaneCommand - Adds an (empty) lane for a target
+ * Does nothing, and undoes nothing, if the track already has one.
+ */
+class AddAutomationLaneCommand : public AutomationLaneCommand
+{
+public:
+    AddAutomationLaneCommand(Project& project_, const Track& track, AutomationLane::Target target_,
+                             int parameterIndex_ = -1, const juce::String& parameterName_ = {})
+        : AutomationLaneCommand(project_, track, target_, parameterIndex_), parameterName(parameterName_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* track = findTrack();
+        created = track != nullptr && findLane() == nullptr;
+        if (created)
+            track->getOrCreateAutomationLane(target, parameterIndex).setParameterName(parameterName);
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        if (created)
+            if (auto* track = findTrack())
+                track->removeAutomationLane(findLane());
+    }
+
+    std::string getDescription() const override { return "Add Automation Lane"; }
+
+private:
+    juce::String parameterName;
+    bool created = false;
+};
+
+/**
+ * RemoveAutomationLaneCommand - Removes a lane with all its breakpoints
+ */
+class RemoveAutomationLaneCommand : public AutomationLaneCommand
+{
+public:
+    RemoveAutomationLaneCommand(Project& project_, const Track& track, AutomationLane::Target target_, int parameterIndex_ = -1)
+        : AutomationLaneCommand(project_, track, target_, parameterIndex_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        removed.reset();
+        if (auto* lane = findLane())
+        {
+            removed = std::make_unique<AutomationLane>(*lane);
+            findTrack()->removeAutomationLane(lane);
+        }
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* track = findTrack();
+        if (removed != nullptr && track != nullptr)
+            track->addAutomationLane(std::make_unique<AutomationLane>(*removed));
+    }
+
+    std::string getDescription() const override { return "Remove Automation Lane"; }
+
+private:
+    std::unique_ptr<AutomationLane> removed;
+};
+
+/**
+ * SetAutomationLaneEnabledCommand - Switches reading a lane on or off
+ */
+class SetAutomationLaneEnabledCommand : public AutomationLaneCommand
+{
+public:
+    SetAutomationLaneEnabledCommand(Project& project_, const Track& track, AutomationLane::Target target_,
+                                    int parameterIndex_, bool enabled_)
+        : AutomationLaneCommand(project_, track, target_, parameterIndex_), enabled(enabled_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        if (auto* lane = findLane())
+        {
+            wasEnabled = lane->isEnabled();
+            lane->setEnabled(enabled);
+        }
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        if (auto* lane = findLane())
+            lane->setEnabled(wasEnabled);
+    }
+
+    std::string getDescription() const override { return enabled ? "Enable Automation" : "Bypass Automation"; }
+
+private:
+    bool enabled;
+    bool wasEnabled = true;
+};
+
+/**
+ * SetAutomationPointCommand - Adds a breakpoint, or changes the value of the one at its tick
+ */
+class SetAutomationPointCommand : public AutomationLaneCommand
+{
+public:
+    SetAutomationPointCommand(Project& project_, const Track& track, AutomationLane::Target target_,
+                              int parameterIndex_, int64_t tick_, float value_)
+        : AutomationLaneCommand(project_, track, target_, parameterIndex_), point(tick_, value_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* lane = findLane();
+        if (lane == nullptr)
+            return;
+
+        int existing = lane->findPointAt(point.tick);
+        replaced = existing >= 0;
+        if (replaced)
+            previousValue = lane->getPoints()[(size_t)existing].value;
+
+        lane->addPoint(point.tick, point.value);
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* lane = findLane();
+        if (lane == nullptr)
+            return;
+
+        if (replaced)
+            lane->addPoint(point.tick, previousValue);
+        else
+            lane->removePoint(lane->findPointAt(point.tick));
+    }
+
+    std::string getDescription() const override { return "Set Automation Point"; }
+
+private:
+    AutomationPoint point;
+    bool replaced = false;
+    float previousValue = 0.0f;
+};
+
+/**
+ * RemoveAutomationPointCommand - Removes the breakpoint at a tick
+ */
+class RemoveAutomationPointCommand : public AutomationLaneCommand
+{
+public:
+    RemoveAutomationPointCommand(Project& project_, const Track& track, AutomationLane::Target target_,
+                                 int parameterIndex_, int64_t tick_)
+        : AutomationLaneCommand(project_, track, target_, parameterIndex_), tick(tick_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        removed = false;
+        if (auto* lane = findLane())
+        {
+            int index = lane->findPointAt(tick);
+            if (index >= 0)
+            {
+                removedValue = lane->getPoints()[(size_t)index].value;
+                lane->removePoint(index);
+                removed = true;
+            }
+        }
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        if (removed)
+            if (auto* lane = findLane())
+                lane->addPoint(tick, removedValue);
+    }
+
+    std::string getDescription() const override { return "Remove Automation Point"; }
+
+private:
+    int64_t tick;
+    bool removed = false;
+    float removedValue = 0.0f;
+};
+
+/**
+ * MoveAutomationPointCommand - Drags a breakpoint to a new tick and value
+ * A breakpoint already at the destination is replaced, and comes back on undo.
+ */
+class MoveAutomationPointCommand : public AutomationLaneCommand
+{
+public:
+    MoveAutomationPointCommand(Project& project_, const Track& track, AutomationLane::Target target_,
+                               int parameterIndex_, int64_t fromTick_, int64_t toTick_, float toValue_)
+        : AutomationLaneCommand(project_, track, target_, parameterIndex_),
+          fromTick(fromTick_), to(toTick_, toValue_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        moved = false;
+        auto* lane = findLane();
+        int from = lane != nullptr ? lane->findPointAt(fromTick) : -1;
+        if (from < 0)
+            return;
+
+        fromValue = lane->getPoints()[(size_t)from].value;
+        lane->removePoint(from);
+
+        int existing = lane->findPointAt(to.tick);
+        replaced = existing >= 0;
+        if (replaced)
+            replacedValue = lane->getPoints()[(size_t)existing].value;
+
+        lane->addPoint(to.tick, to.value);
+        moved = true;
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* lane = findLane();
+        if (!moved || lane == nullptr)
+            return;
+
+        if (replaced)
+            lane->addPoint(to.tick, replacedValue);
+        else
+            lane->removePoint(lane->findPointAt(to.tick));
+
+        lane->addPoint(fromTick, fromValue);
+    }
+
+    std::string getDescription() const override { return "Move Automation Point"; }
+
+private:
+    int64_t fromTick;
+    AutomationPoint to;
+    bool moved = false;
+    float fromValue = 0.0f;
+    bool replaced = false;
+    float replacedValue = 0.0f;
+};
+
+} // namespace pianodaw
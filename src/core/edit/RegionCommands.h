@@ -0,0 +1,133 @@
+#pragma once
+
+#include "../model/Project.h"
+#include "UndoStack.h"
+#include <memory>
+
+namespace pianodaw {
+
+/**
+ * ToggleRegionMuteCommand - Mutes or unmutes a clip region
+ *
+ * The region is found again by track uid and region id on every
+ * execute/undo. Takes the project lock, which the audio thread holds while
+ * it sequences regions.
+ */
+class ToggleRegionMuteCommand : public Command
+{
+public:
+    ToggleRegionMuteCommand(Project& project_, const Track& track, const ClipRegion& region)
+        : project(project_), trackUid(track.getUid()), regionId(region.id), muted(!region.muted) {}
+
+    void execute() override { setMuted(muted); }
+    void undo() override { setMuted(!muted); }
+
+    std::string getDescription() const override { return muted ? "Mute Region" : "Unmute Region"; }
+
+private:
+    void setMuted(bool shouldBeMuted)
+    {
+        const juce::ScopedLock sl(project.getLock());
+        auto* track = project.findTrackByUid(trackUid);
+        if (auto* region = track != nullptr ? track->findClipRegion(regionId) : nullptr)
+            region->muted = shouldBeMuted;
+    }
+
+    Project& project;
+    int trackUid;
+    int regionId;
+    bool muted;   // State after execute
+};
+
+/**
+ * BounceInPlaceCommand - Places a bounced region's audio and mutes the MIDI region
+ *
+ * Built once the bounce has rendered: adds the bounce track (if it is new),
+ * puts the audio clip on it at the region's start and mutes the source
+ * region, all under the project lock. Undo takes the three back, holding on
+ * to the track and clip, so a redo restores them unchanged.
+ */
+class BounceInPlaceCommand : public Command
+{
+public:
+    /**
+     * @param newTrack The bounce track if it doesn't exist yet, else nullptr
+     * @param bounceTrackUid Uid of the bounce track, new or existing
+     */
+    BounceInPlaceCommand(Project& project_, const Track& source, int regionId_, std::unique_ptr<Track> newTrack,
+                         int bounceTrackUid_, std::unique_ptr<AudioClip> audioClip_, int64_t startTick_, int64_t lengthTicks_)
+        : project(project_), sourceUid(source.getUid()), regionId(regionId_), bounceTrackUid(bounceTrackUid_),
+          ownedTrack(std::move(newTrack)), createsTrack(ownedTrack != nullptr), ownedClip(std::move(audioClip_)),
+          audioClip(ownedClip.get()), startTick(startTick_), lengthTicks(lengthTicks_) {}
+
+    void execute() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+
+        if (ownedTrack != nullptr)
+            project.addTrack(std::move(ownedTrack));
+
+        auto* bounceTrack = project.findTrackByUid(bounceTrackUid);
+        if (bounceTrack == nullptr || ownedClip == nullptr)
+            return;
+
+        project.addAudioClip(std::move(ownedClip));
+        bounceTrack->addClipRegion(ClipRegion(audioClip, startTick, lengthTicks));
+        placedRegionId = bounceTrack->getClipRegions().back().id;
+
+        // Muted, not deleted: unmuting the region brings the MIDI back
+        if (auto* region = findSourceRegion())
+        {
+            wasMuted = region->muted;
+            region->muted = true;
+        }
+
+        project.setModified(true);
+    }
+
+    void undo() override
+    {
+        const juce::ScopedLock sl(project.getLock());
+
+        if (auto* region = findSourceRegion())
+            region->muted = wasMuted;
+
+        auto* bounceTrack = project.findTrackByUid(bounceTrackUid);
+        if (bounceTrack != nullptr)
+            bounceTrack->removeClipRegion(placedRegionId);
+
+        if (ownedClip == nullptr)
+            ownedClip = project.releaseAudioClip(audioClip);
+
+        if (createsTrack && bounceTrack != nullptr)
+            ownedTrack = project.releaseTrack(bounceTrack);
+
+        project.setModified(true);
+    }
+
+    std::string getDescription() const override { return "Bounce in Place"; }
+
+    AudioClip* getAudioClip() const { return audioClip; }
+
+private:
+    ClipRegion* findSourceRegion() const
+    {
+        auto* source = project.findTrackByUid(sourceUid);
+        return source != nullptr ? source->findClipRegion(regionId) : nullptr;
+    }
+
+    Project& project;
+    int sourceUid;
+    int regionId;
+    int bounceTrackUid;
+    std::unique_ptr<Track> ownedTrack;        // While the bounce track is out of the project
+    bool createsTrack;
+    std::unique_ptr<AudioClip> ownedClip;     // While the clip is out of the pool
+    AudioClip* audioClip;
+    int64_t startTick;
+    int64_t lengthTicks;
+    int placedRegionId = 0;
+    bool wasMuted = false;
+};
+
+} // namespace pianodaw
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace pianodaw {
+
+/**
+ * AudioClip - An audio file referenced by audio track regions
+ *
+ * Only the file and its format are kept; the samples stay on disk and are
+ * streamed by the engine (AudioClipStreamer). The format is read once on
+ * import and saved with the project, so placing regions never opens the file.
+ */
+class AudioClip
+{
+public:
+    /** The clip's file, ref-counted so a stream reading it can outlive the clip */
+    class FileSource : public juce::ReferenceCountedObject
+    {
+    public:
+        using Ptr = juce::ReferenceCountedObjectPtr<FileSource>;
+
+        explicit FileSource(const juce::File& file_) : file(file_) {}
+
+        const juce::File file;
+    };
+
+    AudioClip(const juce::File& file_, const juce::String& name_)
+        : file(file_), name(name_), fileSource(new FileSource(file_)) {}
+
+    const juce::String& getName() const { return name; }
+    void setName(const juce::String& newName) { name = newName; }
+
+    const juce::File& getFile() const { return file; }
+
+    /** Take a reference before handing it to another thread */
+    FileSource* getFileSource() const { return fileSource.get(); }
+
+    double getSampleRate() const { return sampleRate; }
+    int getNumChannels() const { return numChannels; }
+    juce::int64 getLengthInSamples() const { return lengthInSamples; }
+    double getLengthSeconds() const { return sampleRate > 0.0 ? (double)lengthInSamples / sampleRate : 0.0; }
+
+    void setFormat(double newSampleRate, int newNumChannels, juce::int64 newLengthInSamples)
+    {
+        sampleRate = newSampleRate;
+        numChannels = newNumChannels;
+        lengthInSamples = newLengthInSamples;
+    }
+
+private:
+    juce::File file;
+    juce::String name;
+    double sampleRate = 44100.0;
+    int numChannels = 2;
+    juce::int64 lengthInSamples = 0;
+    FileSource::Ptr fileSource;
+
+    JUCE_LEAK_DETECTOR(AudioClip)
+};
+
+} // namespace pianodaw
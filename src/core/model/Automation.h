@@ -0,0 +1,131 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace pianodaw {
+
+/**
+ * AutomationPoint - A breakpoint of an automation lane
+ * Values are normalised to 0..1; the lane's target maps them to its range.
+ */
+struct AutomationPoint
+{
+    int64_t tick = 0;
+    float value = 0.0f;
+
+    AutomationPoint() = default;
+    AutomationPoint(int64_t tick_, float value_)
+        : tick(juce::jmax((int64_t)0, tick_)), value(juce::jlimit(0.0f, 1.0f, value_)) {}
+};
+
+/**
+ * AutomationLane - One automated parameter of a track
+ *
+ * Breakpoints are kept sorted by tick (at most one per tick), so the value
+ * at any tick is found with a binary search and the engine can walk the
+ * segments of a block from there. Between breakpoints the value ramps
+ * linearly; before the first and after the last it holds.
+ *
+ * Edited on the message thread under the project lock, which the audio
+ * thread holds while it reads lanes.
+ */
+class AutomationLane
+{
+public:
+    enum class Target { Volume, Pan, PluginParameter };
+
+    explicit AutomationLane(Target target_, int parameterIndex_ = -1)
+        : target(target_), parameterIndex(target_ == Target::PluginParameter ? parameterIndex_ : -1) {}
+
+    Target getTarget() const { return target; }
+
+    /** Index into the track instrument's getParameters(), -1 unless the target is a plugin parameter */
+    int getParameterIndex() const { return parameterIndex; }
+
+    /** Name shown for the lane (plugin parameters keep their name when the plugin isn't loaded) */
+    juce::String getName() const
+    {
+        switch (target)
+        {
+            case Target::Volume: return "Volume";
+            case Target::Pan:    return "Pan";
+            default:             return parameterName.isNotEmpty() ? parameterName : "Parameter " + juce::String(parameterIndex + 1);
+        }
+    }
+    void setParameterName(const juce::String& name) { parameterName = name; }
+
+    /** A bypassed lane leaves the parameter at its static value */
+    bool isEnabled() const { return enabled; }
+    void setEnabled(bool shouldRead) { enabled = shouldRead; }
+
+    /** Add a breakpoint, replacing one at the same tick */
+    void addPoint(int64_t tick, float value)
+    {
+        AutomationPoint point(tick, value);
+        auto it = std::lower_bound(points.begin(), points.end(), point.tick,
+                                   [](const AutomationPoint& p, int64_t t) { return p.tick < t; });
+
+        if (it != points.end() && it->tick == point.tick)
+            *it = point;
+        else
+            points.insert(it, point);
+    }
+
+    void removePoint(int index)
+    {
+        if (index >= 0 && index < (int)points.size())
+            points.erase(points.begin() + index);
+    }
+
+    /** Index of the breakpoint exactly at tick, -1 if there is none */
+    int findPointAt(int64_t tick) const
+    {
+        int index = findPoint(tick);
+        return index >= 0 && points[(size_t)index].tick == tick ? index : -1;
+    }
+
+    void clear() { points.clear(); }
+
+    const std::vector<AutomationPoint>& getPoints() const { return points; }
+    bool isEmpty() const { return points.empty(); }
+
+    /** Index of the last breakpoint at or before tick, -1 if tick is before the first (O(log n)) */
+    int findPoint(int64_t tick) const
+    {
+        auto it = std::upper_bound(points.begin(), points.end(), tick,
+                                   [](int64_t t, const AutomationPoint& p) { return t < p.tick; });
+        return (int)(it - points.begin()) - 1;
+    }
+
+    /** Value at a (fractional) tick, with segment the index findPoint() gives for it */
+    float getValueAt(double tick, int segment) const
+    {
+        if (points.empty())
+            return 0.0f;
+        if (segment < 0)
+            return points.front().value;
+        if (segment + 1 >= (int)points.size())
+            return points.back().value;
+
+        const auto& a = points[(size_t)segment];
+        const auto& b = points[(size_t)segment + 1];
+        auto fraction = (tick - (double)a.tick) / (double)(b.tick - a.tick);
+        return a.value + (b.value - a.value) * (float)juce::jlimit(0.0, 1.0, fraction);
+    }
+
+    float getValueAt(int64_t tick) const { return getValueAt((double)tick, findPoint(tick)); }
+
+private:
+    Target target;
+    int parameterIndex = -1;
+    juce::String parameterName;
+    bool enabled = true;
+    std::vector<AutomationPoint> points;
+
+    JUCE_LEAK_DETECTOR(AutomationLane)
+};
+
+} // namespace pianodaw
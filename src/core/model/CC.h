@@ -31,8 +31,11 @@ struct CCEvent
     /** Check if this is a sustain pedal event */
     bool isSustainPedal() const { return cc == 64; }
     
-    /** Check if pedal is "on" (>= 64 is on for sustain) */
-    bool isPedalOn() const { return isSustainPedal() && value >= 64; }
+    /** Check if this is a sostenuto pedal event */
+    bool isSostenutoPedal() const { return cc == 66; }
+    
+    /** Check if pedal is "on" (>= 64 is on for sustain and sostenuto) */
+    bool isPedalOn() const { return (isSustainPedal() || isSostenutoPedal()) && value >= 64; }
     
     /** Comparison for sorting by time */
     bool operator<(const CCEvent& other) const
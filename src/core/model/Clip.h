@@ -4,6 +4,7 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "Note.h"
 #include "CC.h"
+#include "ContentHash.h"
 #include <vector>
 #include <algorithm>
 #include <memory>
@@ -162,6 +163,34 @@ public:
         return maxTick;
     }
     
+    /**
+     * Content version - changes whenever a note or CC event changes
+     * Hashed from the data rather than counted, so edits made in place
+     * through findNote() are seen too. O(events); meant for occasional checks.
+     */
+    juce::uint64 getVersion() const
+    {
+        juce::ScopedLock sl(lock);
+        ContentHash hash;
+
+        for (const auto& note : notes)
+        {
+            hash.add((juce::uint64)note.pitch);
+            hash.add((juce::uint64)note.startTick);
+            hash.add((juce::uint64)note.endTick);
+            hash.add((juce::uint64)note.velocity);
+        }
+
+        for (const auto& cc : ccEvents)
+        {
+            hash.add((juce::uint64)cc.cc);
+            hash.add((juce::uint64)cc.tick);
+            hash.add((juce::uint64)cc.value);
+        }
+
+        return hash.get();
+    }
+    
     /** Export to MIDI file */
     bool exportToMidiFile(const juce::File& file, int ppq = 480) const;
     
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace pianodaw {
+
+/**
+ * ContentHash - 64-bit FNV-1a over a sequence of values
+ *
+ * For content versions and render fingerprints: cheap, stable across runs
+ * (fingerprints are saved with the project), and order-sensitive.
+ */
+class ContentHash
+{
+public:
+    void add(juce::uint64 value) { hash = (hash ^ value) * 1099511628211ull; }
+
+    juce::uint64 get() const { return hash; }
+
+private:
+    juce::uint64 hash = 14695981039346656037ull;
+};
+
+} // namespace pianodaw
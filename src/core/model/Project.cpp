@@ -5,6 +5,93 @@
 
 namespace pianodaw {
 
+Track* Project::findTrackByUid(int uid) const
+{
+    for (const auto& track : tracks)
+    {
+        if (track->getUid() == uid)
+            return track.get();
+    }
+    return nullptr;
+}
+
+int Project::getTrackIndex(const Track* track) const
+{
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (tracks[i].get() == track)
+            return (int)i;
+    }
+    return -1;
+}
+
+bool Project::setTrackOutput(Track& track, const Track* bus)
+{
+    if (bus == nullptr)
+    {
+        track.setOutputUid(0);
+        return true;
+    }
+
+    if (!bus->isBus() || bus == &track)
+        return false;
+
+    // The track must not already feed the bus, directly or further down
+    const Track* node = bus;
+    for (size_t steps = 0; node != nullptr && steps < tracks.size(); ++steps)
+    {
+        node = findTrackByUid(node->getOutputUid());
+        if (node == &track)
+            return false;
+    }
+
+    track.setOutputUid(bus->getUid());
+    return true;
+}
+
+bool Project::setTrackMidiTarget(Track& track, const Track* instrumentTrack)
+{
+    if (instrumentTrack == nullptr)
+    {
+        track.setMidiTargetUid(0);
+        return true;
+    }
+
+    if (instrumentTrack->isBus() || instrumentTrack->isAudio() || track.isAudio() || instrumentTrack == &track
+        || instrumentTrack->getMidiTargetUid() != 0 || isMidiTarget(track))
+        return false;
+
+    track.setMidiTargetUid(instrumentTrack->getUid());
+    return true;
+}
+
+bool Project::isMidiTarget(const Track& track) const
+{
+    for (const auto& other : tracks)
+    {
+        if (other.get() != &track && other->getMidiTargetUid() == track.getUid())
+            return true;
+    }
+    return false;
+}
+
+void Project::swapContents(Project& other)
+{
+    std::swap(name, other.name);
+    std::swap(tempo, other.tempo);
+    std::swap(timeSignatureNumerator, other.timeSignatureNumerator);
+    std::swap(timeSignatureDenominator, other.timeSignatureDenominator);
+    std::swap(projectLengthTicks, other.projectLengthTicks);
+    std::swap(loopStart, other.loopStart);
+    std::swap(loopEnd, other.loopEnd);
+    std::swap(tracks, other.tracks);
+    std::swap(clips, other.clips);
+    std::swap(audioClips, other.audioClips);
+    std::swap(engineState, other.engineState);
+    std::swap(projectFile, other.projectFile);
+    std::swap(modified, other.modified);
+}
+
 bool Project::saveToFile(const juce::File& file)
 {
     auto xml = std::unique_ptr<juce::XmlElement>(toXml());
@@ -90,6 +177,23 @@ juce::XmlElement* Project::toXml() const
         }
     }
     
+    // Audio clips: the file and its format, the samples stay on disk
+    auto* audioClipsXml = root->createNewChildElement("AudioClips");
+    juce::HashMap<AudioClip*, int> audioClipToId;
+    int audioClipId = 1;
+
+    for (const auto& audioClip : audioClips) {
+        audioClipToId.set(audioClip.get(), audioClipId);
+
+        auto* audioClipXml = audioClipsXml->createNewChildElement("AudioClip");
+        audioClipXml->setAttribute("id", audioClipId++);
+        audioClipXml->setAttribute("name", audioClip->getName());
+        audioClipXml->setAttribute("file", audioClip->getFile().getFullPathName());
+        audioClipXml->setAttribute("sampleRate", audioClip->getSampleRate());
+        audioClipXml->setAttribute("numChannels", audioClip->getNumChannels());
+        audioClipXml->setAttribute("length", juce::String(audioClip->getLengthInSamples()));
+    }
+    
     // Tracks
     auto* tracksXml = root->createNewChildElement("Tracks");
     int trackId = 1;
@@ -123,21 +227,56 @@ juce::XmlElement* Project::toXml() const
         trackXml->createNewChildElement("Mute")->addTextElement(track->isMuted() ? "true" : "false");
         trackXml->createNewChildElement("Volume")->addTextElement(juce::String(track->getVolume()));
         trackXml->createNewChildElement("Pan")->addTextElement(juce::String(track->getPan()));
+
+        // Output bus, by track index
+        if (auto* bus = findTrackByUid(track->getOutputUid()))
+            trackXml->setAttribute("output", getTrackIndex(bus));
+
+        // MIDI channel, and the track whose instrument plays it, by track index
+        trackXml->setAttribute("midiChannel", track->getMidiChannel());
+        if (auto* instrumentTrack = findTrackByUid(track->getMidiTargetUid()))
+            trackXml->setAttribute("midiTarget", getTrackIndex(instrumentTrack));
         
         // Clip regions
         juce::ScopedLock sl(track->getLock());
         for (const auto& region : track->getClipRegions()) {
             auto* regionXml = trackXml->createNewChildElement("ClipRegion");
             
-            int clipId = clipToId[region.clip];
-            regionXml->setAttribute("clipId", clipId);
+            if (region.isAudio())
+                regionXml->setAttribute("audioClipId", audioClipToId[region.audioClip]);
+            else
+                regionXml->setAttribute("clipId", clipToId[region.clip]);
             regionXml->setAttribute("startTick", (int)region.startTick);
             regionXml->setAttribute("offsetTick", (int)region.offsetTick);
             regionXml->setAttribute("lengthTick", (int)region.lengthTick);
             regionXml->setAttribute("muted", region.muted ? "true" : "false");
         }
+
+        // Automation lanes and their breakpoints
+        for (const auto& lane : track->getAutomationLanes()) {
+            auto* laneXml = trackXml->createNewChildElement("Automation");
+            switch (lane->getTarget()) {
+                case AutomationLane::Target::Volume:          laneXml->setAttribute("target", "volume"); break;
+                case AutomationLane::Target::Pan:             laneXml->setAttribute("target", "pan"); break;
+                case AutomationLane::Target::PluginParameter: laneXml->setAttribute("target", "parameter"); break;
+            }
+            if (lane->getTarget() == AutomationLane::Target::PluginParameter) {
+                laneXml->setAttribute("parameterIndex", lane->getParameterIndex());
+                laneXml->setAttribute("parameterName", lane->getName());
+            }
+            laneXml->setAttribute("enabled", lane->isEnabled() ? "true" : "false");
+
+            for (const auto& point : lane->getPoints()) {
+                auto* pointXml = laneXml->createNewChildElement("Point");
+                pointXml->setAttribute("tick", juce::String(point.tick));
+                pointXml->setAttribute("value", point.value);
+            }
+        }
     }
     
+    if (engineState)
+        root->addChildElement(new juce::XmlElement(*engineState));
+    
     return root;
 }
 
@@ -149,6 +288,7 @@ bool Project::fromXml(const juce::XmlElement& xml)
     // Clear existing data
     tracks.clear();
     clips.clear();
+    audioClips.clear();
     
     // Load project info
     auto* info = xml.getChildByName("ProjectInfo");
@@ -200,7 +340,27 @@ bool Project::fromXml(const juce::XmlElement& xml)
         }
     }
     
+    // Load audio clips
+    juce::HashMap<int, AudioClip*> idToAudioClip;
+
+    if (auto* audioClipsXml = xml.getChildByName("AudioClips")) {
+        for (auto* audioClipXml : audioClipsXml->getChildWithTagNameIterator("AudioClip")) {
+            auto* audioClip = addAudioClip(juce::File(audioClipXml->getStringAttribute("file")),
+                                           audioClipXml->getStringAttribute("name"));
+            audioClip->setFormat(audioClipXml->getDoubleAttribute("sampleRate", 44100.0),
+                                 audioClipXml->getIntAttribute("numChannels", 2),
+                                 audioClipXml->getStringAttribute("length").getLargeIntValue());
+            idToAudioClip.set(audioClipXml->getIntAttribute("id"), audioClip);
+
+            if (!audioClip->getFile().existsAsFile())
+                DebugLogWindow::addLog("Project: Audio file missing: " + audioClip->getFile().getFullPathName());
+        }
+    }
+    
     // Load tracks
+    std::vector<std::pair<Track*, int>> outputs;      // Resolved once every track exists
+    std::vector<std::pair<Track*, int>> midiTargets;
+
     auto* tracksXml = xml.getChildByName("Tracks");
     if (tracksXml) {
         for (auto* trackXml : tracksXml->getChildIterator()) {
@@ -237,29 +397,68 @@ bool Project::fromXml(const juce::XmlElement& xml)
                 track->setVolume(volume->getAllSubText().getFloatValue());
             if (auto* pan = trackXml->getChildByName("Pan"))
                 track->setPan(pan->getAllSubText().getFloatValue());
+            if (trackXml->hasAttribute("output"))
+                outputs.emplace_back(track, trackXml->getIntAttribute("output", -1));
+            track->setMidiChannel(trackXml->getIntAttribute("midiChannel", 1));
+            if (trackXml->hasAttribute("midiTarget"))
+                midiTargets.emplace_back(track, trackXml->getIntAttribute("midiTarget", -1));
             
             // Load clip regions
             for (auto* regionXml : trackXml->getChildIterator()) {
                 if (regionXml->getTagName() != "ClipRegion") continue;
                 
-                int clipId = regionXml->getIntAttribute("clipId");
-                Clip* clip = idToClip[clipId];
-                if (!clip) continue;
-                
                 int64_t startTick = regionXml->getIntAttribute("startTick");
                 int64_t offsetTick = regionXml->getIntAttribute("offsetTick");
                 int64_t lengthTick = regionXml->getIntAttribute("lengthTick");
                 bool muted = regionXml->getStringAttribute("muted") == "true";
                 
-                ClipRegion region(clip, startTick, lengthTick);
+                ClipRegion region;
+                if (regionXml->hasAttribute("audioClipId"))
+                    region = ClipRegion(idToAudioClip[regionXml->getIntAttribute("audioClipId")], startTick, lengthTick);
+                else
+                    region = ClipRegion(idToClip[regionXml->getIntAttribute("clipId")], startTick, lengthTick);
+
+                if (!region.clip && !region.audioClip) continue;
+
                 region.offsetTick = offsetTick;
                 region.muted = muted;
                 
                 track->addClipRegion(region);
             }
+
+            // Load automation lanes
+            for (auto* laneXml : trackXml->getChildWithTagNameIterator("Automation")) {
+                auto targetStr = laneXml->getStringAttribute("target");
+                auto target = AutomationLane::Target::Volume;
+                if (targetStr == "pan") target = AutomationLane::Target::Pan;
+                else if (targetStr == "parameter") target = AutomationLane::Target::PluginParameter;
+                else if (targetStr != "volume") continue;
+
+                int parameterIndex = laneXml->getIntAttribute("parameterIndex", -1);
+                if (target == AutomationLane::Target::PluginParameter && parameterIndex < 0) continue;
+
+                auto& lane = track->getOrCreateAutomationLane(target, parameterIndex);
+                lane.setParameterName(laneXml->getStringAttribute("parameterName"));
+                lane.setEnabled(laneXml->getStringAttribute("enabled", "true") == "true");
+
+                for (auto* pointXml : laneXml->getChildWithTagNameIterator("Point"))
+                    lane.addPoint(pointXml->getStringAttribute("tick").getLargeIntValue(),
+                                  (float)pointXml->getDoubleAttribute("value"));
+            }
         }
     }
     
+    for (auto& [track, busIndex] : outputs)
+        setTrackOutput(*track, getTrack(busIndex));
+
+    for (auto& [track, instrumentIndex] : midiTargets)
+        setTrackMidiTarget(*track, getTrack(instrumentIndex));
+
+    // Engine state is kept verbatim; the AudioEngine restores it asynchronously
+    engineState.reset();
+    if (auto* engineXml = xml.getChildByName("PianoDAWAudioSettings"))
+        engineState = std::make_unique<juce::XmlElement>(*engineXml);
+    
     return true;
 }
 
@@ -3,7 +3,9 @@
 #include <juce_core/juce_core.h>
 #include "Track.h"
 #include "Clip.h"
+#include "AudioClip.h"
 #include "../timeline/PPQ.h"
+#include <algorithm>
 #include <vector>
 #include <memory>
 
@@ -47,11 +49,40 @@ public:
         tracks.push_back(std::move(track));
         return ptr;
     }
+
+    /** Append a track built elsewhere (a command bringing it back keeps its uid) */
+    Track* addTrack(std::unique_ptr<Track> track)
+    {
+        tracks.push_back(std::move(track));
+        return tracks.back().get();
+    }
+
+    /** Take a track out without destroying it; nothing may route to it or play through it */
+    std::unique_ptr<Track> releaseTrack(const Track* track)
+    {
+        auto found = std::find_if(tracks.begin(), tracks.end(),
+                                  [track](const std::unique_ptr<Track>& t) { return t.get() == track; });
+        if (found == tracks.end())
+            return nullptr;
+
+        auto released = std::move(*found);
+        tracks.erase(found);
+        return released;
+    }
     
     void removeTrack(int index)
     {
         if (index >= 0 && index < (int)tracks.size())
         {
+            // Tracks routed into a removed bus fall back to the master, and tracks played by its instrument to their own
+            for (auto& track : tracks)
+            {
+                if (track->getOutputUid() == tracks[(size_t)index]->getUid())
+                    track->setOutputUid(0);
+                if (track->getMidiTargetUid() == tracks[(size_t)index]->getUid())
+                    track->setMidiTargetUid(0);
+            }
+
             tracks.erase(tracks.begin() + index);
         }
     }
@@ -66,6 +97,26 @@ public:
     }
     
     int getNumTracks() const { return (int)tracks.size(); }
+
+    Track* findTrackByUid(int uid) const;
+    int getTrackIndex(const Track* track) const;
+
+    /**
+     * Route a track's audio into a group/folder bus (nullptr for the master)
+     * @return false if bus isn't a bus track or the routing would form a loop
+     */
+    bool setTrackOutput(Track& track, const Track* bus);
+
+    /**
+     * Play a track's MIDI on another track's instrument, on the track's own MIDI channel
+     * (nullptr for its own instrument). One level only: the instrument track must play
+     * its own MIDI, and a track others play through can't be redirected itself.
+     * @return false if either is an audio track, instrumentTrack is a bus, the track itself, or would chain
+     */
+    bool setTrackMidiTarget(Track& track, const Track* instrumentTrack);
+
+    /** Whether any other track plays through this track's instrument */
+    bool isMidiTarget(const Track& track) const;
     
     const std::vector<std::unique_ptr<Track>>& getTracks() const { return tracks; }
     std::vector<std::unique_ptr<Track>>& getTracks() { return tracks; }
@@ -89,6 +140,51 @@ public:
     
     const std::vector<std::unique_ptr<Clip>>& getClips() const { return clips; }
     std::vector<std::unique_ptr<Clip>>& getClips() { return clips; }
+
+    // Audio clip pool: files placed on audio tracks
+    AudioClip* addAudioClip(const juce::File& file, const juce::String& clipName)
+    {
+        audioClips.push_back(std::make_unique<AudioClip>(file, clipName));
+        return audioClips.back().get();
+    }
+
+    AudioClip* addAudioClip(std::unique_ptr<AudioClip> audioClip)
+    {
+        audioClips.push_back(std::move(audioClip));
+        return audioClips.back().get();
+    }
+
+    /** Take the clip out of the pool without destroying it; its regions must be gone already */
+    std::unique_ptr<AudioClip> releaseAudioClip(const AudioClip* audioClip)
+    {
+        auto found = std::find_if(audioClips.begin(), audioClips.end(),
+                                  [audioClip](const std::unique_ptr<AudioClip>& c) { return c.get() == audioClip; });
+        if (found == audioClips.end())
+            return nullptr;
+
+        auto released = std::move(*found);
+        audioClips.erase(found);
+        return released;
+    }
+
+    /** Removes the clip and every region that places it */
+    void removeAudioClip(AudioClip* audioClip)
+    {
+        for (auto& track : tracks)
+        {
+            auto& regions = track->getClipRegions();
+            regions.erase(std::remove_if(regions.begin(), regions.end(),
+                              [audioClip](const ClipRegion& r) { return r.audioClip == audioClip; }),
+                          regions.end());
+        }
+
+        audioClips.erase(
+            std::remove_if(audioClips.begin(), audioClips.end(),
+                [audioClip](const std::unique_ptr<AudioClip>& c) { return c.get() == audioClip; }),
+            audioClips.end());
+    }
+
+    const std::vector<std::unique_ptr<AudioClip>>& getAudioClips() const { return audioClips; }
     
     // File path
     juce::File getProjectFile() const { return projectFile; }
@@ -113,6 +209,17 @@ public:
     bool loadFromFile(const juce::File& file);
     juce::XmlElement* toXml() const;
     bool fromXml(const juce::XmlElement& xml);
+
+    /**
+     * Exchange everything but the lock with another project
+     * Lets a project be parsed into a temporary outside the lock and swapped
+     * in under it; the old content leaves with the temporary.
+     */
+    void swapContents(Project& other);
+    
+    // Audio engine state (instruments, plugin state); opaque to the model, saved with the project
+    const juce::XmlElement* getEngineState() const { return engineState.get(); }
+    void setEngineState(std::unique_ptr<juce::XmlElement> state) { engineState = std::move(state); }
     
     juce::CriticalSection& getLock() { return lock; }
     
@@ -129,6 +236,8 @@ private:
     
     std::vector<std::unique_ptr<Track>> tracks;
     std::vector<std::unique_ptr<Clip>> clips;  // Clip pool
+    std::vector<std::unique_ptr<AudioClip>> audioClips;
+    std::unique_ptr<juce::XmlElement> engineState;
     
     juce::File projectFile;
     bool modified = false;
@@ -2,20 +2,26 @@
 
 #include <juce_core/juce_core.h>
 #include <juce_graphics/juce_graphics.h>
+#include "AudioClip.h"
+#include "Automation.h"
 #include "Clip.h"
 #include <vector>
 #include <memory>
+#include <atomic>
 
 namespace pianodaw {
 
 /**
  * ClipRegion - A placed instance of a Clip on a Track
- * Represents where and when a clip appears in the arrangement
+ * Represents where and when a clip appears in the arrangement.
+ * Regions on audio tracks place an AudioClip instead; their offset and
+ * length are ticks of audio at the current tempo.
  */
 struct ClipRegion
 {
     int id = 0;
     Clip* clip = nullptr;              // Pointer to the actual clip data
+    AudioClip* audioClip = nullptr;    // Audio regions only (clip is nullptr)
     int64_t startTick = 0;             // Position in timeline
     int64_t offsetTick = 0;            // Offset into clip (for loop/trim)
     int64_t lengthTick = 0;            // Duration in timeline (can be different from clip length)
@@ -24,8 +30,11 @@ struct ClipRegion
     ClipRegion() = default;
     ClipRegion(Clip* clip_, int64_t start, int64_t length)
         : clip(clip_), startTick(start), lengthTick(length) {}
+    ClipRegion(AudioClip* audioClip_, int64_t start, int64_t length)
+        : audioClip(audioClip_), startTick(start), lengthTick(length) {}
     
     int64_t getEndTick() const { return startTick + lengthTick; }
+    bool isAudio() const { return audioClip != nullptr; }
 };
 
 /**
@@ -42,6 +51,9 @@ public:
 
     ~Track() = default;
 
+    /** Unique for the lifetime of the process (not persisted); lets the engine key per-track state */
+    int getUid() const { return uid; }
+
     // Basic properties
     juce::String getName() const { return name; }
     void setName(const juce::String& n) { name = n; }
@@ -56,6 +68,24 @@ public:
     bool isFolder() const { return type == Type::Folder; }
     bool isGroup() const { return type == Type::Group; }
 
+    /** Group and folder tracks are buses: other tracks can be routed into them */
+    bool isBus() const { return isGroup() || isFolder(); }
+
+    /** Uid of the bus track this track's audio sums into, or 0 for the master bus (see Project::setTrackOutput) */
+    int getOutputUid() const { return outputUid; }
+    void setOutputUid(int busUid) { outputUid = busUid; }
+
+    /** MIDI channel (1-16) the track's notes are sequenced on */
+    int getMidiChannel() const { return midiChannel; }
+    void setMidiChannel(int channel) { midiChannel = juce::jlimit(1, 16, channel); }
+
+    /**
+     * Uid of the track whose (multi-timbral) instrument plays this track's MIDI,
+     * or 0 for its own instrument (see Project::setTrackMidiTarget)
+     */
+    int getMidiTargetUid() const { return midiTargetUid; }
+    void setMidiTargetUid(int instrumentTrackUid) { midiTargetUid = instrumentTrackUid; }
+
     juce::Colour getColour() const { return colour; }
     void setColour(juce::Colour c) { colour = c; }
 
@@ -123,9 +153,55 @@ public:
         return nullptr;
     }
     
+    // Automation lanes (edited under the project lock, like the regions)
+    AutomationLane* findAutomationLane(AutomationLane::Target target, int parameterIndex = -1) const
+    {
+        for (auto& lane : automationLanes)
+        {
+            if (lane->getTarget() == target && (target != AutomationLane::Target::PluginParameter
+                                                || lane->getParameterIndex() == parameterIndex))
+                return lane.get();
+        }
+        return nullptr;
+    }
+
+    AutomationLane& getOrCreateAutomationLane(AutomationLane::Target target, int parameterIndex = -1)
+    {
+        if (auto* lane = findAutomationLane(target, parameterIndex))
+            return *lane;
+
+        automationLanes.push_back(std::make_unique<AutomationLane>(target, parameterIndex));
+        return *automationLanes.back();
+    }
+
+    /** Put a whole lane back (undo), replacing any lane with the same target */
+    AutomationLane& addAutomationLane(std::unique_ptr<AutomationLane> lane)
+    {
+        removeAutomationLane(findAutomationLane(lane->getTarget(), lane->getParameterIndex()));
+        automationLanes.push_back(std::move(lane));
+        return *automationLanes.back();
+    }
+
+    void removeAutomationLane(const AutomationLane* lane)
+    {
+        automationLanes.erase(
+            std::remove_if(automationLanes.begin(), automationLanes.end(),
+                [lane](const std::unique_ptr<AutomationLane>& l) { return l.get() == lane; }),
+            automationLanes.end());
+    }
+
+    const std::vector<std::unique_ptr<AutomationLane>>& getAutomationLanes() const { return automationLanes; }
+    
     juce::CriticalSection& getLock() { return lock; }
     
 private:
+    static int allocateUid()
+    {
+        static std::atomic<int> counter { 0 };
+        return ++counter;
+    }
+
+    const int uid = allocateUid();
     juce::String name;
     Type type;
     juce::Colour colour = juce::Colours::blue;
@@ -134,11 +210,16 @@ private:
     bool muted = false;
     float volume = 0.8f;  // 0.0 to 1.0
     float pan = 0.0f;     // -1.0 (left) to 1.0 (right)
+    int outputUid = 0;    // 0 = master bus
+    int midiChannel = 1;
+    int midiTargetUid = 0; // 0 = own instrument
 
     QuantizeSettings quantizeSettings;
     
     std::vector<ClipRegion> clipRegions;
     int nextRegionId = 1;
+
+    std::vector<std::unique_ptr<AutomationLane>> automationLanes;
     
     juce::CriticalSection lock;
     
@@ -0,0 +1,134 @@
+#include "SamplePlayhead.h"
+#include "PPQ.h"
+
+namespace pianodaw {
+
+void SamplePlayhead::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    synced = false;
+}
+
+void SamplePlayhead::setLoop(bool shouldLoop, int64_t start, int64_t end)
+{
+    shouldLoop = shouldLoop && end > start;
+    bool changed = shouldLoop != looping || (shouldLoop && (start != loopStart || end != loopEnd));
+    loopChanged = loopChanged || changed;
+
+    // Carry on from where playback is now instead of folding all the elapsed time into the new range
+    double position = fold(audible);
+
+    looping = shouldLoop;
+    loopStart = start;
+    loopEnd = end;
+
+    if (changed && synced)
+    {
+        double lead = sequenced - audible;
+        double behind = audible - audibleFrom;
+        originTick = (int64_t)std::floor(position);
+        audible = position - (double)originTick;
+        sequenced = audible + lead;
+        audibleFrom = audible - behind;
+    }
+}
+
+double SamplePlayhead::fold(double elapsedTicks) const
+{
+    double tick = (double)originTick + elapsedTicks;
+    if (!looping || tick < (double)loopEnd)
+        return tick;
+
+    return (double)loopStart + std::fmod(tick - (double)loopEnd, (double)(loopEnd - loopStart));
+}
+
+int SamplePlayhead::advance(int64_t transportTick, juce::uint32 locateGeneration, double tempoBPM, int numSamples,
+                            int lookaheadSamples, BlockTickWindow* windows, int startOffset)
+{
+    double newTicksPerSample = tempoBPM / 60.0 * PPQ::TICKS_PER_QUARTER / sampleRate;
+    double newLookaheadTicks = juce::jmax(0, lookaheadSamples) * newTicksPerSample;
+
+    timelineChanged = loopChanged || newTicksPerSample != ticksPerSample || newLookaheadTicks != lookaheadTicks;
+    loopChanged = false;
+    ticksPerSample = newTicksPerSample;
+    lookaheadTicks = newLookaheadTicks;
+
+    // The transport follows this clock, so only an explicit locate moves it
+    jumped = false;
+    if (!synced || locateGeneration != generation)
+    {
+        jumped = synced;
+        timelineChanged = true;
+        synced = true;
+        generation = locateGeneration;
+        originTick = transportTick;
+        audible = 0.0;
+        sequenced = 0.0;
+    }
+
+    return advanceFrom(juce::jlimit(0, juce::jmax(0, numSamples), startOffset), numSamples, windows);
+}
+
+int SamplePlayhead::advanceFreeRunning(int numSamples, BlockTickWindow* windows)
+{
+    return advanceFrom(0, numSamples, windows);
+}
+
+int SamplePlayhead::advanceFrom(int firstSample, int numSamples, BlockTickWindow* windows)
+{
+    // Nothing is heard before firstSample, so time only runs from there
+    audibleFrom = audible;
+    audible += (numSamples - firstSample) * ticksPerSample;
+    lastNumSamples = numSamples;
+    lastFirstSample = firstSample;
+
+    // After a sync the first block also catches up on the lookahead, squeezed into this block
+    double from = sequenced;
+    double to = audible + lookaheadTicks;
+    if (to <= from || numSamples <= firstSample)
+        return 0;
+
+    sequenced = to;
+    return makeWindows(from, to, firstSample, numSamples, windows);
+}
+
+int SamplePlayhead::getAudibleWindows(BlockTickWindow* windows) const
+{
+    if (audible <= audibleFrom || lastNumSamples <= lastFirstSample)
+        return 0;
+
+    return makeWindows(audibleFrom, audible, lastFirstSample, lastNumSamples, windows);
+}
+
+int SamplePlayhead::makeWindows(double from, double to, int firstSample, int numSamples, BlockTickWindow* windows) const
+{
+    // The windows share out samples [firstSample, numSamples) of the block
+    int span = numSamples - firstSample;
+    int numWindows = 0;
+    for (double elapsed = from; elapsed < to && numWindows < maxWindows;)
+    {
+        double tick = fold(elapsed);
+        double end = to;
+        bool wraps = false;
+
+        if (looping && elapsed + ((double)loopEnd - tick) < to)
+        {
+            end = elapsed + ((double)loopEnd - tick);
+            wraps = true;
+        }
+
+        auto& window = windows[numWindows++];
+        window.startTick = (int64_t)std::floor(tick);
+        window.exactStartTick = tick;
+        window.endTick = wraps ? loopEnd : (int64_t)std::floor(tick + (end - elapsed));
+        window.startSample = firstSample + juce::roundToInt((elapsed - from) / (to - from) * span);
+        window.numSamples = firstSample + juce::roundToInt((end - from) / (to - from) * span) - window.startSample;
+        window.endsAtLoopEnd = wraps;
+
+        elapsed = end;
+    }
+
+    return numWindows;
+}
+
+} // namespace pianodaw
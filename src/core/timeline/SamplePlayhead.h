@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <juce_core/juce_core.h>
+
+namespace pianodaw {
+
+/**
+ * BlockTickWindow - One contiguous tick range sequenced inside an audio block
+ *
+ * Covers [startTick, endTick) and maps it onto samples
+ * [startSample, startSample + numSamples) of the block, so events can be
+ * placed at their exact sample offset instead of at the block start.
+ */
+struct BlockTickWindow
+{
+    int64_t startTick = 0;
+    int64_t endTick = 0;
+    double exactStartTick = 0.0;  // Unrounded position of startSample (for streaming audio)
+    int startSample = 0;
+    int numSamples = 0;
+    bool endsAtLoopEnd = false;   // Playback continues at the loop start after this window
+
+    bool contains(int64_t tick) const { return tick >= startTick && tick < endTick; }
+
+    /** Sample offset within the block for an event at tick (clamped to this window) */
+    int sampleOffsetFor(int64_t tick) const
+    {
+        if (endTick <= startTick || numSamples <= 0)
+            return startSample;
+
+        auto fraction = (double)(tick - startTick) / (double)(endTick - startTick);
+        return startSample + juce::jlimit(0, numSamples - 1, (int)(fraction * numSamples));
+    }
+
+    /** Last sample of the window */
+    int lastSample() const { return startSample + juce::jmax(0, numSamples - 1); }
+};
+
+/**
+ * SamplePlayhead - Audio-thread playback position driven by the sample clock
+ *
+ * The Transport advances on a 60 Hz message-thread timer, which is fine for
+ * drawing the playhead but far too coarse for scheduling events. This
+ * playhead free-runs at the device sample rate from wherever the transport
+ * is and folds around the loop range itself (the same fold as
+ * Transport::wrapToLoop). It is the clock: the engine publishes its position
+ * back to the Transport, and it only resyncs when the transport is located,
+ * which bumps the locate generation passed to advance().
+ *
+ * Events can be sequenced ahead of the audible position (lookahead); the
+ * engine uses this for plugin delay compensation. A copy keeps running from
+ * where the original was (advanceFreeRunning), which is how the audio
+ * thread sequences tracks ahead for the anticipative renderer.
+ */
+class SamplePlayhead
+{
+public:
+    static constexpr int maxWindows = 4;   // A block can cross the loop end more than once for tiny loops
+
+    void prepare(double sampleRate);
+
+    /** Forget the position; the next advance() starts from the transport again */
+    void reset() { synced = false; }
+
+    /** Loop range as set on the Transport (read at the start of every block) */
+    void setLoop(bool shouldLoop, int64_t start, int64_t end);
+
+    /**
+     * Advance by one block (audio thread)
+     * @param transportTick Where the message-thread Transport currently is
+     * @param locateGeneration Transport::getLocateGeneration(); a change relocates to transportTick
+     * @param lookaheadSamples How far ahead of the audible position events are produced
+     * @param windows Receives up to maxWindows tick ranges to sequence in this block
+     * @param startOffset First sample of the block that plays (a count-in ending mid-block);
+     *                    transportTick is heard there and the windows start there
+     * @return Number of windows written (0 while a shrinking lookahead catches up)
+     */
+    int advance(int64_t transportTick, juce::uint32 locateGeneration, double tempoBPM, int numSamples,
+                int lookaheadSamples, BlockTickWindow* windows, int startOffset = 0);
+
+    /** Advance with the tempo, loop and lookahead of the last advance(), ignoring the transport */
+    int advanceFreeRunning(int numSamples, BlockTickWindow* windows);
+
+    /** True if the last advance() relocated to a new transport position (hanging notes need stopping) */
+    bool hasJumped() const { return jumped; }
+
+    /** True if the last advance() jumped or changed tempo, loop or lookahead (copies are now stale) */
+    bool hasTimelineChanged() const { return timelineChanged; }
+
+    /**
+     * Where the last block is heard: the windows of the last advance() without
+     * the lookahead, for output that is compensated rather than sequenced
+     * (automation of the mixed, latency-compensated track outputs)
+     */
+    int getAudibleWindows(BlockTickWindow* windows) const;
+
+    /** Audible position at the end of the last block */
+    int64_t getPosition() const { return (int64_t)std::floor(fold(audible)); }
+
+    /** Locate generation the position follows (published back with it) */
+    juce::uint32 getLocateGeneration() const { return generation; }
+
+private:
+    double fold(double elapsedTicks) const;
+    int advanceFrom(int firstSample, int numSamples, BlockTickWindow* windows);
+    int makeWindows(double from, double to, int firstSample, int numSamples, BlockTickWindow* windows) const;
+
+    double sampleRate = 44100.0;
+
+    bool looping = false;
+    int64_t loopStart = 0;
+    int64_t loopEnd = 0;
+
+    double ticksPerSample = 0.0;
+    double lookaheadTicks = 0.0;
+
+    bool synced = false;
+    bool jumped = false;
+    bool loopChanged = false;
+    bool timelineChanged = false;
+    juce::uint32 generation = 0;
+    int64_t originTick = 0;   // Transport tick we last synced to
+    double audible = 0.0;     // Ticks elapsed since origin (never folded)
+    double sequenced = 0.0;   // Ticks elapsed since origin that events were produced for
+    double audibleFrom = 0.0; // audible before the last block
+    int lastNumSamples = 0;
+    int lastFirstSample = 0;  // Where the last block's windows started
+};
+
+} // namespace pianodaw
@@ -1,9 +1,14 @@
 #include "Transport.h"
 #include "PPQ.h"
-#include "../../ui/panels/DebugLogWindow.h"
 
 namespace pianodaw {
 
+namespace
+{
+    // Without a clock update for this long there is no audio callback to follow
+    constexpr juce::uint32 clockTimeoutMs = 200;
+}
+
 Transport::Transport()
 {
 }
@@ -20,17 +25,28 @@ void Transport::start()
     {
         playing = true;
         lastTimeMs = juce::Time::getMillisecondCounter();
+        lastClockMs = lastTimeMs;
         startTimerHz(60); // 60 FPS for smooth playhead
         if (onStatusChanged) onStatusChanged();
     }
 }
 
+void Transport::startAfterCountIn(double countInSeconds)
+{
+    if (playing)
+        return;
+
+    countInRemaining = std::max(0.0, countInSeconds);
+    start();
+}
+
 void Transport::stop()
 {
     DBG("Transport::stop() called");
     if (playing)
     {
         playing = false;
+        countInRemaining = 0.0;
         stopTimer();
         if (onStatusChanged) onStatusChanged();
     }
@@ -51,9 +67,25 @@ void Transport::setPlaying(bool play)
 void Transport::setPosition(int64_t ticks)
 {
     currentTick = std::max((int64_t)0, ticks);
+    locateGeneration.fetch_add(1, std::memory_order_release);
     if (onPositionChanged) onPositionChanged(currentTick);
 }
 
+void Transport::publishClockPosition(int64_t tick, juce::uint32 generation)
+{
+    clockTick.store(tick, std::memory_order_relaxed);
+    clockGeneration.store(generation, std::memory_order_relaxed);
+    clockUpdates.fetch_add(1, std::memory_order_release);
+}
+
+int64_t Transport::wrapToLoop(int64_t tick, int64_t loopStart, int64_t loopEnd)
+{
+    if (loopEnd <= loopStart || tick < loopEnd)
+        return tick;
+
+    return loopStart + (tick - loopEnd) % (loopEnd - loopStart);
+}
+
 void Transport::setTempo(double bpm)
 {
     currentBPM = std::max(1.0, bpm);
@@ -70,18 +102,41 @@ void Transport::timerCallback()
     // Convert time delta to ticks
     // ms -> seconds -> beats -> ticks
     double deltaSeconds = deltaMs / 1000.0;
-    double beatsPerSecond = currentBPM / 60.0;
-    double deltaTicks = deltaSeconds * beatsPerSecond * PPQ::TICKS_PER_QUARTER;
 
-    currentTick += (int64_t)std::round(deltaTicks);
+    auto updates = clockUpdates.load(std::memory_order_acquire);
+    if (updates != seenClockUpdates)
+    {
+        // The engine is playing, so any count-in is over; a locate it has not picked up yet wins
+        seenClockUpdates = updates;
+        lastClockMs = now;
+        countInRemaining = 0.0;
 
-    // Looping
-    if (looping && currentTick >= loopEnd)
+        if (clockGeneration.load(std::memory_order_relaxed) == locateGeneration.load())
+            currentTick = clockTick.load(std::memory_order_relaxed);
+    }
+    else
     {
-        currentTick = loopStart + (currentTick % (loopEnd - loopStart));
-        DebugLogWindow::addLog("Transport: Loop! Position reset to " + juce::String(loopStart) + ", tick " + juce::String(currentTick % (loopEnd - loopStart)));
+        // The position only moves once the count-in is over
+        if (countInRemaining > 0.0)
+        {
+            auto counted = std::min(countInRemaining, deltaSeconds);
+            countInRemaining -= counted;
+            deltaSeconds -= counted;
+            lastClockMs = now;
+        }
+
+        // The engine has yet to pick up, or is late by a timer tick or two: hold the position
+        if (now - lastClockMs < clockTimeoutMs)
+            return;
+
+        // No audio callback: estimate from the wall clock
+        double beatsPerSecond = currentBPM / 60.0;
+        double deltaTicks = deltaSeconds * beatsPerSecond * PPQ::TICKS_PER_QUARTER;
+
+        auto tick = currentTick.load() + (int64_t)std::round(deltaTicks);
+        currentTick = looping ? wrapToLoop(tick, loopStart, loopEnd) : tick;
     }
-    
+
     if (onPositionChanged) onPositionChanged(currentTick);
 }
 
@@ -3,12 +3,19 @@
 #include <cstdint>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_events/juce_events.h>
+#include <atomic>
 #include <functional>
 
 namespace pianodaw {
 
 /**
  * Transport - Manages project playback state and timing
+ *
+ * While the audio device runs, the engine's sample clock drives the position:
+ * the engine publishes where its playhead is every block and the 60 Hz timer
+ * picks that up for the UI. Without audio callbacks the timer estimates the
+ * position from the wall clock instead. Only setPosition() moves the engine's
+ * playhead, by bumping the locate generation it watches.
  */
 class Transport : private juce::Timer
 {
@@ -18,6 +25,10 @@ public:
 
     // Playback control
     void start();
+
+    /** Start, holding the position for countInSeconds first (the engine clicks the count-in meanwhile) */
+    void startAfterCountIn(double countInSeconds);
+    bool isCountingIn() const { return playing && countInRemaining > 0.0; }
     void stop();
     void togglePlay();
     void setPlaying(bool play);
@@ -25,7 +36,19 @@ public:
 
     // Timing
     void setPosition(int64_t ticks);
-    int64_t getPosition() const { return currentTick; }
+    int64_t getPosition() const { return currentTick.load(); }
+
+    /** Bumped by every setPosition(); the engine relocates its playhead when it changes */
+    juce::uint32 getLocateGeneration() const { return locateGeneration.load(std::memory_order_acquire); }
+
+    /** Audio thread: where the engine's playhead is after a block, and the locate generation it follows */
+    void publishClockPosition(int64_t tick, juce::uint32 generation);
+
+    /** Last position the engine published (getPosition() only picks it up on the timer) */
+    int64_t getClockPosition() const { return clockTick.load(std::memory_order_relaxed); }
+
+    /** Where the position lands after running past the loop end (same fold as the engine's playhead) */
+    static int64_t wrapToLoop(int64_t tick, int64_t loopStart, int64_t loopEnd);
     
     void setTempo(double bpm);
     double getTempo() const { return currentBPM; }
@@ -33,6 +56,8 @@ public:
     void setLooping(bool loop) { looping = loop; }
     bool isLooping() const { return looping; }
     void setLoopRange(int64_t start, int64_t end) { loopStart = start; loopEnd = end; }
+    int64_t getLoopStart() const { return loopStart; }
+    int64_t getLoopEnd() const { return loopEnd; }
 
     // Callbacks
     std::function<void()> onStatusChanged;
@@ -43,13 +68,22 @@ private:
 
     bool playing = false;
     bool looping = false;
-    int64_t currentTick = 0;
+    std::atomic<int64_t> currentTick { 0 };
     double currentBPM = 120.0;
     
     int64_t loopStart = 0;
     int64_t loopEnd = 960 * 16; // 4 bars default
     
     juce::uint32 lastTimeMs = 0;
+    double countInRemaining = 0.0;   // Seconds
+
+    // Engine clock, written by the audio thread (the update count last, so it covers the rest)
+    std::atomic<juce::uint32> locateGeneration { 0 };
+    std::atomic<int64_t> clockTick { 0 };
+    std::atomic<juce::uint32> clockGeneration { 0 };
+    std::atomic<juce::uint32> clockUpdates { 0 };
+    juce::uint32 seenClockUpdates = 0;
+    juce::uint32 lastClockMs = 0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Transport)
 };
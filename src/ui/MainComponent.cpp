@@ -1,6 +1,7 @@
 #include "MainComponent.h"
 #include "../core/edit/UndoStack.h"
 #include "../core/edit/EditCommands.h"
+#include "../core/edit/RegionCommands.h"
 #include "../core/timeline/PPQ.h"
 #include "../core/timeline/Transport.h"
 #include "../core/audio/MidiRecorder.h"
@@ -22,7 +23,7 @@ MainComponent::MainComponent(Project& project_, UndoStack& undoStack_, Transport
     addAndMakeVisible(trackListPanel.get());
     
     // Create arrangement view (with Transport for playhead)
-    arrangementView = std::make_unique<ArrangementView>(project, &transport);
+    arrangementView = std::make_unique<ArrangementView>(project, undoStack, &transport);
     addAndMakeVisible(arrangementView.get());
     
     // Setup transport bar callbacks
@@ -55,6 +56,10 @@ MainComponent::MainComponent(Project& project_, UndoStack& undoStack_, Transport
         transport.setLooping(looping);
     };
     
+    transportBar->onMetronomeToggle = [this](bool shouldClick) {
+        audioEngine.getMetronome().setEnabled(shouldClick);
+    };
+    
     transportBar->onRecordToggle = [this](bool recording) {
         if (recording) {
             startRecording();  // 즉시 녹음 시작 (자동 재생 포함)
@@ -76,11 +81,81 @@ MainComponent::MainComponent(Project& project_, UndoStack& undoStack_, Transport
         recordArmedTrackIndex = armed ? trackIndex : -1;
         audioEngine.setRecordArmedTrack(recordArmedTrackIndex);
     };
+
+    trackListPanel->isTrackFrozen = [this](int trackIndex) {
+        auto* track = project.getTrack(trackIndex);
+        return track != nullptr && audioEngine.isTrackFrozen(*track);
+    };
+
+    trackListPanel->onImportAudio = [this](int trackIndex) {
+        auto chooser = std::make_shared<juce::FileChooser>("Import Audio File", juce::File(), "*.wav;*.aif;*.aiff;*.flac;*.ogg");
+        chooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+            [this, trackIndex, chooser](const juce::FileChooser& fc) {
+                auto* track = project.getTrack(trackIndex);
+                auto file = fc.getResult();
+                if (track == nullptr || !file.existsAsFile())
+                    return;
+
+                // Placed at the playhead
+                juce::String error;
+                if (audioEngine.importAudioFile(file, *track, transport.getPosition(), error)) {
+                    // Peaks are scanned in the background; the region shows its waveform once they are ready
+                    arrangementView->getWaveformCache().prepare(*track->getClipRegions().back().audioClip);
+                    arrangementView->repaint();
+                }
+                else
+                    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Import Failed", error);
+            });
+    };
+
+    trackListPanel->readTrackMeter = [this](int trackIndex, LevelMeter::Reading& reading) {
+        auto* track = project.getTrack(trackIndex);
+        return track != nullptr && audioEngine.readTrackMeter(*track, reading);
+    };
+
+    trackListPanel->readMasterMeter = [this](LevelMeter::Reading& reading) {
+        return audioEngine.readMasterMeter(reading);
+    };
+
+    trackListPanel->onFreezeToggled = [this](int trackIndex) {
+        auto* track = project.getTrack(trackIndex);
+        if (track == nullptr)
+            return;
+
+        if (audioEngine.isTrackFrozen(*track)) {
+            audioEngine.unfreezeTrack(*track);
+            trackListPanel->repaint();
+        } else {
+            audioEngine.freezeTrack(*track, [this](bool, const juce::String&) {
+                trackListPanel->repaint();
+            });
+        }
+    };
     
     // Setup arrangement view callbacks
     arrangementView->onClipRegionDoubleClick = [this](Track* track, ClipRegion* clipRegion) {
         onClipRegionDoubleClicked(track, clipRegion);
     };
+
+    arrangementView->onBounceRegion = [this](Track* track, ClipRegion* clipRegion) {
+        audioEngine.bounceRegion(*track, clipRegion->id, [this](std::unique_ptr<BounceInPlaceCommand> bounce, const juce::String& error) {
+            if (bounce == nullptr) {
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Bounce Failed", error);
+                return;
+            }
+
+            // The region shows its waveform once the peaks are scanned
+            auto* audioClip = bounce->getAudioClip();
+            undoStack.execute(std::move(bounce));
+            arrangementView->getWaveformCache().prepare(*audioClip);
+            trackListPanel->refreshTracks();
+            arrangementView->repaint();
+        });
+    };
+
+    arrangementView->isRegionBouncing = [this](const Track& track, const ClipRegion& clipRegion) {
+        return audioEngine.isRegionBouncing(track, clipRegion.id);
+    };
     
     setSize(1280, 720);
     setWantsKeyboardFocus(true);
@@ -151,6 +226,9 @@ bool MainComponent::keyPressed(const juce::KeyPress& key)
         if (undoStack.canUndo()) {
             undoStack.undo();
             DebugLogWindow::addLog("Undo performed");
+            // Tracks and regions may have come or gone (bounces)
+            arrangementView->clearSelection();
+            trackListPanel->refreshTracks();
             // Repaint all views to reflect undo changes
             arrangementView->repaint();
             if (pianoRollView) pianoRollView->repaint();
@@ -165,6 +243,9 @@ bool MainComponent::keyPressed(const juce::KeyPress& key)
         if (undoStack.canRedo()) {
             undoStack.redo();
             DebugLogWindow::addLog("Redo performed");
+            // Tracks and regions may have come or gone (bounces)
+            arrangementView->clearSelection();
+            trackListPanel->refreshTracks();
             // Repaint all views to reflect redo changes
             arrangementView->repaint();
             if (pianoRollView) pianoRollView->repaint();
@@ -213,6 +294,9 @@ void MainComponent::onClipRegionDoubleClicked(Track* track, ClipRegion* clipRegi
         DebugLogWindow::addLog("MainComponent: ERROR - clipRegion is NULL");
         return;
     }
+    if (clipRegion->isAudio()) {
+        return;  // No editor for audio regions
+    }
     if (!clipRegion->clip) {
         DebugLogWindow::addLog("MainComponent: ERROR - clipRegion->clip is NULL");
         return;
@@ -336,6 +420,12 @@ void MainComponent::onClipRegionDoubleClicked(Track* track, ClipRegion* clipRegi
     if (!statusLine) {
         statusLine = std::make_unique<StatusLine>();
         addAndMakeVisible(statusLine.get());
+        
+        statusLine->readPerformance = [this] { return audioEngine.getPerformance(); };
+        statusLine->onPerformanceClicked = [this](juce::Component& anchor) {
+            juce::CallOutBox::launchAsynchronously(std::make_unique<PerformancePanel>(audioEngine),
+                                                   anchor.getScreenBounds(), nullptr);
+        };
     } else {
         statusLine->setVisible(true);
     }
@@ -529,6 +619,22 @@ void MainComponent::startRecording()
         transportBar->setRecording(false);
         return;
     }
+
+    // Audio tracks record the input into a take of their own
+    if (track->isAudio())
+    {
+        juce::String error;
+        if (!audioEngine.startAudioRecording(*track, error))
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Cannot Record", error);
+            transportBar->setRecording(false);
+            return;
+        }
+
+        isRecording = true;
+        startTransportForRecording();
+        return;
+    }
     
     // Create a new clip for recording or use existing one
     Clip* recordClip = nullptr;
@@ -565,10 +671,26 @@ void MainComponent::startRecording()
     isRecording = true;
     
     // Start playback if not already playing
-    if (!transport.isPlaying())
+    startTransportForRecording();
+}
+
+void MainComponent::startTransportForRecording()
+{
+    if (transport.isPlaying())
+        return;
+
+    int bars = transportBar->getCountInBars();
+    if (bars <= 0)
     {
         transport.start();
+        return;
     }
+
+    // The engine clicks the count-in on the sample clock and starts at its downbeat; the transport waits as long
+    int64_t barTicks = (int64_t)PPQ::TICKS_PER_QUARTER * 4 / project.getTimeSignatureDenominator()
+                     * project.getTimeSignatureNumerator();
+    audioEngine.getMetronome().requestCountIn(bars, transport.getPosition());
+    transport.startAfterCountIn(PPQ::tickToSeconds(bars * barTicks, transport.getTempo()));
 }
 
 void MainComponent::stopRecording()
@@ -576,8 +698,19 @@ void MainComponent::stopRecording()
     if (!isRecording)
         return;
     
-    // Stop the MidiRecorder
-    audioEngine.getMidiRecorder().stopRecording();
+    if (audioEngine.isRecordingAudio())
+    {
+        juce::String error;
+        if (auto* take = audioEngine.stopAudioRecording(error))
+            arrangementView->getWaveformCache().prepare(*take);
+        else
+            DebugLogWindow::addLog("MainComponent: No audio take (" + error + ")");
+    }
+    else
+    {
+        // Stop the MidiRecorder
+        audioEngine.getMidiRecorder().stopRecording();
+    }
     
     isRecording = false;
     transportBar->setRecording(false);
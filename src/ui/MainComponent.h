@@ -12,6 +12,7 @@
 #include "pianoroll/PedalLane.h"
 #include "panels/VstBrowserPanel.h"
 #include "panels/QuantizePanel.h"
+#include "panels/PerformancePanel.h"
 #include "panels/PromptBar.h"
 #include "panels/TheoryToolbar.h"
 #include "transport/TransportBar.h"
@@ -59,6 +60,7 @@ private:
     // Recording
     void startRecording();
     void stopRecording();
+    void startTransportForRecording();
 
     UndoStack& undoStack;
     Transport& transport;
@@ -1,14 +1,17 @@
 #include "ArrangementView.h"
 #include "../../core/timeline/Transport.h"
+#include "../../core/edit/RegionCommands.h"
 #include "../panels/DebugLogWindow.h"
 
 namespace pianodaw {
 
-ArrangementView::ArrangementView(Project& proj, Transport* trans)
-    : project(proj), transport(trans)
+ArrangementView::ArrangementView(Project& proj, UndoStack& undo, Transport* trans)
+    : project(proj), undoStack(undo), transport(trans), waveformCache(proj)
 {
     setOpaque(false);  // 반투명하게 - 그리드가 보이도록
     setWantsKeyboardFocus(true);  // Enable keyboard input
+
+    waveformCache.onPeaksReady = [this] { repaint(); };
     
     // 30fps로 재생바 업데이트
     startTimer(33);
@@ -52,6 +55,13 @@ void ArrangementView::mouseDown(const juce::MouseEvent& event)
     
     selectedTrack = hit.track;
     selectedClipRegion = hit.clipRegion;
+
+    if (event.mods.isPopupMenu()) {
+        if (selectedClipRegion && selectedTrack)
+            showClipRegionMenu(*selectedTrack, *selectedClipRegion);
+        repaint();
+        return;
+    }
     
     if (selectedClipRegion && selectedTrack) {
         int clipStartX = ticksToX(selectedClipRegion->startTick);
@@ -84,6 +94,39 @@ void ArrangementView::mouseDown(const juce::MouseEvent& event)
     repaint();
 }
 
+void ArrangementView::showClipRegionMenu(Track& track, ClipRegion& region)
+{
+    enum { bounceId = 1, muteId };
+
+    juce::PopupMenu menu;
+    if (onBounceRegion && !region.isAudio()) {
+        bool bouncing = isRegionBouncing && isRegionBouncing(track, region);
+        menu.addItem(bounceId, bouncing ? "Bouncing..." : "Bounce in Place", !bouncing);
+    }
+    menu.addItem(muteId, region.muted ? "Unmute Region" : "Mute Region");
+
+    int trackUid = track.getUid();
+    int regionId = region.id;
+    menu.showMenuAsync(juce::PopupMenu::Options(), [this, trackUid, regionId](int result) {
+        // The project may have changed while the menu was open
+        Track* target = project.findTrackByUid(trackUid);
+        ClipRegion* targetRegion = target ? target->findClipRegion(regionId) : nullptr;
+        if (result == 0 || !targetRegion)
+            return;
+
+        if (result == bounceId) {
+            if (onBounceRegion)
+                onBounceRegion(target, targetRegion);
+        }
+        else if (result == muteId) {
+            undoStack.execute(std::make_unique<ToggleRegionMuteCommand>(project, *target, *targetRegion));
+            project.setModified(true);
+        }
+
+        repaint();
+    });
+}
+
 void ArrangementView::mouseDoubleClick(const juce::MouseEvent& event)
 {
     DebugLogWindow::addLog("ArrangementView: mouseDoubleClick at x=" + juce::String(event.x) + " y=" + juce::String(event.y));
@@ -91,7 +134,7 @@ void ArrangementView::mouseDoubleClick(const juce::MouseEvent& event)
     auto hit = findClipRegionAt(event.x, event.y);
     
     if (hit.clipRegion) {
-        DebugLogWindow::addLog("ArrangementView: Clip found: " + (hit.clipRegion->clip ? hit.clipRegion->clip->getName() : "NULL CLIP"));
+        DebugLogWindow::addLog("ArrangementView: Clip found: " + (hit.clipRegion->clip ? hit.clipRegion->clip->getName() : hit.clipRegion->audioClip ? hit.clipRegion->audioClip->getName() : "NULL CLIP"));
         
         if (onClipRegionDoubleClick) {
             DebugLogWindow::addLog("ArrangementView: Calling callback...");
@@ -373,10 +416,14 @@ void ArrangementView::drawClipRegion(juce::Graphics& g, Track* track, ClipRegion
     g.setColour(clipColour);
     g.drawRoundedRectangle(x1 + 2, trackY + 4, width - 4, trackHeight - 8, 4.0f, 2.0f);
     
+    // Waveform below the name
+    if (region->isAudio())
+        drawWaveform(g, *region, juce::Rectangle<int>(x1 + 4, trackY + 26, width - 8, trackHeight - 34));
+    
     // Clip name
-    if (region->clip) {
+    if (region->clip || region->audioClip) {
         g.setColour(juce::Colours::white);
-        g.drawText(region->clip->getName(), 
+        g.drawText(region->clip ? region->clip->getName() : region->audioClip->getName(), 
                    x1 + 6, trackY + 8, width - 12, 20,
                    juce::Justification::centredLeft);
     }
@@ -388,6 +435,43 @@ void ArrangementView::drawClipRegion(juce::Graphics& g, Track* track, ClipRegion
     }
 }
 
+void ArrangementView::drawWaveform(juce::Graphics& g, const ClipRegion& region, juce::Rectangle<int> area)
+{
+    // Only the visible columns; each reads at most PeakFile::levelFactor peaks
+    auto visible = area.getIntersection(getLocalBounds());
+    if (visible.isEmpty())
+        return;
+
+    auto* peaks = waveformCache.getPeaks(*region.audioClip);
+    if (peaks == nullptr)
+        return;   // Still being generated; repainted when ready
+
+    double tempo = transport != nullptr ? transport->getTempo() : project.getTempo();
+    double samplesPerTick = region.audioClip->getSampleRate() * 60.0 / (tempo * PPQ::TICKS_PER_QUARTER);
+    double samplesPerPixel = samplesPerTick / pixelsPerTick;
+    int level = peaks->chooseLevel(samplesPerPixel);
+
+    // Source sample under the left edge of column x
+    auto sampleAt = [&](int x)
+    {
+        double tick = (x + viewportX) / pixelsPerTick;
+        return (juce::int64)((tick - (double)region.startTick + (double)region.offsetTick) * samplesPerTick);
+    };
+
+    float centre = (float)area.getCentreY();
+    float halfHeight = (float)area.getHeight() * 0.5f;
+    g.setColour(juce::Colours::white.withAlpha(0.6f));
+
+    for (int x = visible.getX(); x < visible.getRight(); ++x)
+    {
+        float min = 0.0f, max = 0.0f;
+        if (!peaks->getRange(level, sampleAt(x), sampleAt(x + 1), min, max))
+            continue;
+
+        g.drawVerticalLine(x, centre - max * halfHeight, centre - min * halfHeight + 1.0f);
+    }
+}
+
 void ArrangementView::drawPlayhead(juce::Graphics& g)
 {
     if (!transport)
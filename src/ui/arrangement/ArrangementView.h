@@ -3,6 +3,8 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../../core/model/Project.h"
 #include "../../core/model/Track.h"
+#include "../../core/edit/UndoStack.h"
+#include "../../core/audio/WaveformCache.h"
 
 namespace pianodaw {
 
@@ -13,9 +15,10 @@ class Transport;
  * 
  * Features:
  * - Horizontal timeline with measures/beats grid
- * - Displays ClipRegion blocks on each track
+ * - Displays ClipRegion blocks on each track, audio regions with their waveform
  * - Click to select clip region
  * - Double-click to open in PianoRollEditor
+ * - Right-click a region to mute it or bounce it in place
  * - Horizontal/vertical scrolling and zooming
  * - Playhead visualization
  */
@@ -23,7 +26,7 @@ class ArrangementView : public juce::Component,
                         private juce::Timer
 {
 public:
-    ArrangementView(Project& project, Transport* transport = nullptr);
+    ArrangementView(Project& project, UndoStack& undoStack, Transport* transport = nullptr);
     ~ArrangementView() override = default;
 
     // Component overrides
@@ -49,10 +52,17 @@ public:
     // Selection
     ClipRegion* getSelectedClipRegion() { return selectedClipRegion; }
     Track* getSelectedTrack() { return selectedTrack; }
+    void clearSelection() { selectedTrack = nullptr; selectedClipRegion = nullptr; }
     
+    /** Peaks of the project's audio clips; ask it to prepare a clip's when it is imported */
+    WaveformCache& getWaveformCache() { return waveformCache; }
+
     // Callback for double-click on clip region
     std::function<void(Track*, ClipRegion*)> onClipRegionDoubleClick;
 
+    std::function<void(Track*, ClipRegion*)> onBounceRegion;   // Right-click "Bounce in Place" on a MIDI region
+    std::function<bool(const Track&, const ClipRegion&)> isRegionBouncing;
+
 private:
     // Convert between time (ticks) and screen coordinates
     int ticksToX(int ticks) const;
@@ -67,11 +77,13 @@ private:
         int trackIndex = -1;
     };
     ClipRegionHit findClipRegionAt(int x, int y);
+    void showClipRegionMenu(Track& track, ClipRegion& region);
 
     // Draw grid and clips
     void drawGrid(juce::Graphics& g);
     void drawTracks(juce::Graphics& g);
     void drawClipRegion(juce::Graphics& g, Track* track, ClipRegion* region, int trackY);
+    void drawWaveform(juce::Graphics& g, const ClipRegion& region, juce::Rectangle<int> area);
     void drawPlayhead(juce::Graphics& g);
     
     // Timer callback
@@ -79,7 +91,9 @@ private:
 
     // Reference to project
     Project& project;
+    UndoStack& undoStack;
     Transport* transport = nullptr;  // For playhead position
+    WaveformCache waveformCache;
 
     // View state
     double pixelsPerTick = 0.05;  // Zoom level (pixels per tick)
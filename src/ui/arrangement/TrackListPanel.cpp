@@ -15,6 +15,8 @@ TrackListPanel::TrackListPanel(Project& proj)
     addChildComponent(removeTrackButton.get());
     
     updateTrackRows();
+
+    startTimerHz(30);
 }
 
 void TrackListPanel::paint(juce::Graphics& g)
@@ -29,6 +31,9 @@ void TrackListPanel::paint(juce::Graphics& g)
     g.setColour(juce::Colour(0xffcccccc));
     g.drawText("TRACKS", 10, 0, getWidth() - 20, headerHeight,
                juce::Justification::centredLeft);
+
+    if (masterMeter.valid)
+        drawMeter(g, getMasterMeterArea(), masterMeter);
     
     // Draw track rows
     int numTracks = project.getNumTracks();
@@ -138,6 +143,12 @@ void TrackListPanel::setSelectedTrack(int trackIndex)
     repaint();
 }
 
+void TrackListPanel::refreshTracks()
+{
+    updateTrackRows();
+    repaint();
+}
+
 void TrackListPanel::drawTrackRow(juce::Graphics& g, int trackIndex, const juce::Rectangle<int>& bounds)
 {
     Track* track = project.getTrack(trackIndex);
@@ -166,12 +177,34 @@ void TrackListPanel::drawTrackRow(juce::Graphics& g, int trackIndex, const juce:
     // Track type
     g.setColour(juce::Colour(0xff888888));
     g.setFont(11.0f);
-    juce::String typeStr = (track->getType() == Track::Type::MIDI) ? "MIDI" : "AUDIO";
+    juce::String typeStr = (track->getType() == Track::Type::MIDI) ? "MIDI"
+                         : (track->getType() == Track::Type::Group) ? "GROUP"
+                         : (track->getType() == Track::Type::Folder) ? "FOLDER" : "AUDIO";
+    if (!track->isBus() && !track->isAudio())
+        typeStr << " ch " << track->getMidiChannel();
+    if (Track* instrumentTrack = project.findTrackByUid(track->getMidiTargetUid()))
+        typeStr << " on " << instrumentTrack->getName();
+    if (Track* bus = project.findTrackByUid(track->getOutputUid()))
+        typeStr << "  -> " << bus->getName();
     g.drawText(typeStr,
                bounds.getX() + 12, bounds.getY() + 26,
                bounds.getWidth() - 24, 16,
                juce::Justification::centredLeft);
+
+    // Frozen tracks play rendered audio; their instrument is unloaded
+    if (isTrackFrozen && isTrackFrozen(trackIndex)) {
+        g.setColour(juce::Colour(0xff66ccff));
+        g.drawText("FROZEN",
+                   bounds.getX() + 12, bounds.getY() + 26,
+                   bounds.getWidth() - 24, 16,
+                   juce::Justification::centredRight);
+    }
     
+    // Post-fader level of the track's own instrument or bus
+    auto meter = trackMeters.find(track->getUid());
+    if (meter != trackMeters.end() && meter->second.valid)
+        drawMeter(g, getTrackMeterArea(trackIndex), meter->second);
+
     // Separator
     g.setColour(juce::Colour(0xff1a1a1a));
     g.drawLine(bounds.getX(), bounds.getBottom(), 
@@ -180,15 +213,139 @@ void TrackListPanel::drawTrackRow(juce::Graphics& g, int trackIndex, const juce:
 
 void TrackListPanel::mouseDown(const juce::MouseEvent& event)
 {
+    // Clicking a meter clears its clip LED
+    if (getMasterMeterArea().contains(event.getPosition())) {
+        masterMeter.clipped = false;
+        repaint(getMasterMeterArea());
+        return;
+    }
+
+    int meterTrack = getTrackIndexAt(event.y);
+    if (meterTrack >= 0 && getTrackMeterArea(meterTrack).contains(event.getPosition())) {
+        trackMeters[project.getTrack(meterTrack)->getUid()].clipped = false;
+        repaint(getTrackMeterArea(meterTrack));
+        return;
+    }
+
     int trackIndex = getTrackIndexAt(event.y);
     if (trackIndex >= 0) {
         setSelectedTrack(trackIndex);
         
         if (onTrackSelected)
             onTrackSelected(trackIndex);
+
+        if (event.mods.isPopupMenu())
+            showTrackMenu(trackIndex);
     }
 }
 
+void TrackListPanel::showTrackMenu(int trackIndex)
+{
+    Track* track = project.getTrack(trackIndex);
+    if (!track) return;
+
+    enum { freezeId = 1, addGroupId, addAudioId, importAudioId, masterOutputId, firstBusOutputId,
+           firstChannelId = 100000, ownInstrumentId = firstChannelId + 16, firstMidiTargetId };
+
+    juce::PopupMenu menu;
+    if (onImportAudio && track->isAudio())
+        menu.addItem(importAudioId, "Import Audio File...");
+
+    if (onFreezeToggled && !track->isBus() && !track->isAudio()) {
+        bool frozen = isTrackFrozen && isTrackFrozen(trackIndex);
+        menu.addItem(freezeId, frozen ? "Unfreeze Track" : "Freeze Track");
+    }
+
+    // Buses this track could feed; ones that would close a loop are greyed out
+    juce::PopupMenu outputMenu;
+    outputMenu.addItem(masterOutputId, "Master", true, track->getOutputUid() == 0);
+    for (int i = 0; i < project.getNumTracks(); ++i) {
+        Track* bus = project.getTrack(i);
+        if (bus == track || !bus->isBus())
+            continue;
+
+        bool current = track->getOutputUid() == bus->getUid();
+        bool wouldLoop = false;
+        for (Track* node = bus; node != nullptr && !wouldLoop; node = project.findTrackByUid(node->getOutputUid()))
+            wouldLoop = node->getOutputUid() == track->getUid();
+
+        outputMenu.addItem(firstBusOutputId + i, bus->getName(), !wouldLoop, current);
+    }
+
+    menu.addSubMenu("Output", outputMenu);
+
+    if (!track->isBus() && !track->isAudio()) {
+        juce::PopupMenu channelMenu;
+        for (int channel = 1; channel <= 16; ++channel)
+            channelMenu.addItem(firstChannelId + channel - 1, juce::String(channel), true, track->getMidiChannel() == channel);
+        menu.addSubMenu("MIDI Channel", channelMenu);
+
+        // Another track's multi-timbral instrument, one level deep; frozen instruments don't take MIDI
+        bool playedThrough = project.isMidiTarget(*track);
+        juce::PopupMenu instrumentMenu;
+        instrumentMenu.addItem(ownInstrumentId, "Own Instrument", true, track->getMidiTargetUid() == 0);
+        for (int i = 0; i < project.getNumTracks(); ++i) {
+            Track* other = project.getTrack(i);
+            if (other == track || other->isBus())
+                continue;
+
+            bool usable = !playedThrough && !other->isAudio() && other->getMidiTargetUid() == 0 && !(isTrackFrozen && isTrackFrozen(i));
+            instrumentMenu.addItem(firstMidiTargetId + i, other->getName(), usable, track->getMidiTargetUid() == other->getUid());
+        }
+        menu.addSubMenu("Play Through Instrument", instrumentMenu);
+    }
+
+    menu.addSeparator();
+    menu.addItem(addGroupId, "Add Group Track");
+    menu.addItem(addAudioId, "Add Audio Track");
+
+    int trackUid = track->getUid();
+    menu.showMenuAsync(juce::PopupMenu::Options(), [this, trackUid](int result) {
+        // The project may have changed while the menu was open
+        Track* target = project.findTrackByUid(trackUid);
+        if (result == 0 || !target)
+            return;
+
+        if (result == freezeId) {
+            if (onFreezeToggled)
+                onFreezeToggled(project.getTrackIndex(target));
+        }
+        else if (result == importAudioId) {
+            if (onImportAudio)
+                onImportAudio(project.getTrackIndex(target));
+        }
+        else if (result == addGroupId || result == addAudioId) {
+            bool group = result == addGroupId;
+            Track* added = project.addTrack((group ? "Group " : "Audio ") + juce::String(project.getNumTracks() + 1),
+                                            group ? Track::Type::Group : Track::Type::Audio);
+            added->setColour(juce::Colour::fromHSV(juce::Random::getSystemRandom().nextFloat(), 0.4f, 0.6f, 1.0f));
+
+            updateTrackRows();
+            repaint();
+
+            if (onTracksChanged)
+                onTracksChanged();
+        }
+        else if (result >= firstMidiTargetId) {
+            if (project.setTrackMidiTarget(*target, project.getTrack(result - firstMidiTargetId)))
+                repaint();
+        }
+        else if (result == ownInstrumentId) {
+            project.setTrackMidiTarget(*target, nullptr);
+            repaint();
+        }
+        else if (result >= firstChannelId) {
+            target->setMidiChannel(result - firstChannelId + 1);
+            repaint();
+        }
+        else {
+            const Track* bus = result == masterOutputId ? nullptr : project.getTrack(result - firstBusOutputId);
+            if (project.setTrackOutput(*target, bus))
+                repaint();
+        }
+    });
+}
+
 void TrackListPanel::updateTrackRows()
 {
     trackRows.clear();
@@ -231,6 +388,110 @@ void TrackListPanel::updateTrackRows()
     }
 }
 
+void TrackListPanel::timerCallback()
+{
+    LevelMeter::Reading reading;
+
+    if (readMasterMeter) {
+        bool hasReading = readMasterMeter(reading);
+        updateMeter(masterMeter, hasReading, reading);
+        repaint(getMasterMeterArea());
+    }
+
+    if (!readTrackMeter)
+        return;
+
+    // Forget meters of tracks that are gone
+    for (auto it = trackMeters.begin(); it != trackMeters.end();) {
+        if (project.findTrackByUid(it->first) == nullptr)
+            it = trackMeters.erase(it);
+        else
+            ++it;
+    }
+
+    for (int i = 0; i < project.getNumTracks(); ++i) {
+        auto& state = trackMeters[project.getTrack(i)->getUid()];
+        bool wasValid = state.valid;
+        bool hasReading = readTrackMeter(i, reading);
+        updateMeter(state, hasReading, reading);
+
+        if (state.valid || wasValid)
+            repaint(getTrackMeterArea(i));
+    }
+}
+
+void TrackListPanel::updateMeter(MeterState& state, bool hasReading, const LevelMeter::Reading& reading)
+{
+    // Peaks fall at about 20 dB/s at 30 Hz
+    const float falloff = 0.926f;
+
+    if (!hasReading) {
+        state.valid = false;
+        return;
+    }
+
+    for (int ch = 0; ch < LevelMeter::maxChannels; ++ch) {
+        int source = juce::jmin(ch, juce::jmax(0, reading.numChannels - 1));   // Mono shows on both bars
+        state.peak[(size_t)ch] = juce::jmax(reading.peak[(size_t)source], state.peak[(size_t)ch] * falloff);
+        state.rms[(size_t)ch] = reading.rms[(size_t)source];
+    }
+
+    if (state.valid && reading.overs != state.overs)
+        state.clipped = true;
+
+    state.overs = reading.overs;
+    state.valid = true;
+}
+
+void TrackListPanel::drawMeter(juce::Graphics& g, juce::Rectangle<int> area, const MeterState& state)
+{
+    const float minDb = -60.0f, maxDb = 6.0f;
+    auto led = area.removeFromRight(area.getHeight()).toFloat();
+    area.removeFromRight(2);
+
+    g.setColour(juce::Colour(0xff151515));
+    g.fillRect(area);
+
+    auto toWidth = [&](float level) {
+        float db = juce::Decibels::gainToDecibels(level, minDb);
+        return juce::jlimit(0.0f, 1.0f, (db - minDb) / (maxDb - minDb)) * (float)area.getWidth();
+    };
+    float zeroDbX = (float)area.getX() + toWidth(1.0f);
+
+    int barHeight = juce::jmax(1, (area.getHeight() - 1) / 2);
+    for (int ch = 0; ch < LevelMeter::maxChannels; ++ch) {
+        auto bar = area.withHeight(barHeight).translated(0, ch * (barHeight + 1)).toFloat();
+        float peak = state.peak[(size_t)ch];
+        auto colour = peak >= 1.0f ? juce::Colours::red
+                    : peak >= juce::Decibels::decibelsToGain(-6.0f) ? juce::Colours::yellow
+                    : juce::Colour(0xff40c040);
+
+        g.setColour(colour.withAlpha(0.45f));
+        g.fillRect(bar.withWidth(toWidth(peak)));
+        g.setColour(colour);
+        g.fillRect(bar.withWidth(toWidth(state.rms[(size_t)ch])));
+    }
+
+    // 0 dBFS mark
+    g.setColour(juce::Colour(0xff888888));
+    g.drawVerticalLine(juce::roundToInt(zeroDbX), (float)area.getY(), (float)area.getBottom());
+
+    g.setColour(state.clipped ? juce::Colours::red : juce::Colour(0xff402020));
+    g.fillRect(led);
+}
+
+juce::Rectangle<int> TrackListPanel::getTrackMeterArea(int trackIndex) const
+{
+    int y = headerHeight + trackIndex * trackHeight;
+    return { 12, y + trackHeight - 7, juce::jmax(0, getWidth() - 17), 5 };
+}
+
+juce::Rectangle<int> TrackListPanel::getMasterMeterArea() const
+{
+    int width = getWidth() / 2;
+    return { getWidth() - width - 5, (headerHeight - 7) / 2, width, 7 };
+}
+
 int TrackListPanel::getTrackIndexAt(int y)
 {
     if (y < headerHeight) return -1;
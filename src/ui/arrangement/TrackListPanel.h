@@ -2,6 +2,8 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "../../core/model/Project.h"
+#include "../../core/audio/LevelMeter.h"
+#include <map>
 
 namespace pianodaw {
 
@@ -13,10 +15,13 @@ namespace pianodaw {
  * - Solo/Mute buttons per track
  * - Track color indicator
  * - Add/Remove track buttons at bottom
+ * - Right-click menu: freeze/unfreeze, output bus routing, add group/audio track, import audio
+ * - Peak/RMS meters per track and on master, with latched clip LEDs (click to reset)
  * - Drag to reorder tracks (future)
  */
 class TrackListPanel : public juce::Component,
-                       public juce::Button::Listener
+                       public juce::Button::Listener,
+                       private juce::Timer
 {
 public:
     TrackListPanel(Project& project);
@@ -32,11 +37,19 @@ public:
     // Selection
     void setSelectedTrack(int trackIndex);
     int getSelectedTrack() const { return selectedTrackIndex; }
+
+    /** Rebuild the rows after tracks were added elsewhere (e.g. a bounce track) */
+    void refreshTracks();
     
     // Callbacks
     std::function<void(int trackIndex)> onTrackSelected;
     std::function<void()> onTracksChanged;
     std::function<void(int trackIndex, bool armed)> onRecordArmChanged;
+    std::function<void(int trackIndex)> onFreezeToggled;   // Right-click "Freeze Track"/"Unfreeze Track"
+    std::function<bool(int trackIndex)> isTrackFrozen;
+    std::function<void(int trackIndex)> onImportAudio;    // Right-click "Import Audio File..." on an audio track
+    std::function<bool(int trackIndex, LevelMeter::Reading&)> readTrackMeter;   // Polled at display rate
+    std::function<bool(LevelMeter::Reading&)> readMasterMeter;
 
 private:
     struct TrackRow {
@@ -47,8 +60,23 @@ private:
         std::unique_ptr<juce::TextButton> muteButton;
     };
 
+    struct MeterState {
+        bool valid = false;
+        std::array<float, LevelMeter::maxChannels> peak {};   // Displayed, with falloff
+        std::array<float, LevelMeter::maxChannels> rms {};
+        bool clipped = false;                                  // Latched until clicked
+        juce::uint32 overs = 0;
+    };
+
+    void timerCallback() override;
+    void updateMeter(MeterState& state, bool hasReading, const LevelMeter::Reading& reading);
+    void drawMeter(juce::Graphics& g, juce::Rectangle<int> area, const MeterState& state);
+    juce::Rectangle<int> getTrackMeterArea(int trackIndex) const;
+    juce::Rectangle<int> getMasterMeterArea() const;
+
     void drawTrackRow(juce::Graphics& g, int trackIndex, const juce::Rectangle<int>& bounds);
     void mouseDown(const juce::MouseEvent& event) override;
+    void showTrackMenu(int trackIndex);
     void updateTrackRows();
     int getTrackIndexAt(int y);
 
@@ -62,6 +90,10 @@ private:
 
     // Track rows with buttons
     juce::OwnedArray<TrackRow> trackRows;
+
+    // Meters, by track uid so they survive row rebuilds
+    std::map<int, MeterState> trackMeters;
+    MeterState masterMeter;
     
     // Add/Remove track buttons
     std::unique_ptr<juce::TextButton> addTrackButton;
@@ -1,16 +1,20 @@
 #pragma once
 
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "../../core/audio/CallbackProfiler.h"
 #include "../../core/timeline/PPQ.h"
+#include <functional>
 
 namespace pianodaw {
 
 /**
  * StatusLine - Displays current cursor position and musical context
  * 
- * Shows: Bar:Beat:Tick, Pitch name, Chord detection, Snap/Grid status
+ * Shows: Bar:Beat:Tick, Pitch name, Chord detection, Snap/Grid status,
+ * and the audio callback's DSP load and xruns (click for details)
  */
-class StatusLine : public juce::Component
+class StatusLine : public juce::Component,
+                   private juce::Timer
 {
 public:
     StatusLine()
@@ -31,10 +35,24 @@ public:
         snapLabel.setJustificationType(juce::Justification::centredRight);
         snapLabel.setColour(juce::Label::textColourId, juce::Colours::lightgreen);
         
+        addAndMakeVisible(performanceButton);
+        performanceButton.setColour(juce::TextButton::buttonColourId, juce::Colours::transparentBlack);
+        performanceButton.setColour(juce::TextButton::textColourOffId, juce::Colours::lightgrey);
+        performanceButton.setTooltip("Audio callback load - click for details");
+        performanceButton.onClick = [this] {
+            if (onPerformanceClicked)
+                onPerformanceClicked(performanceButton);
+        };
+        
         updatePosition(0, 0);
         updateSnap(true, "1/16");
+        startTimerHz(4);
     }
     
+    /** Polled a few times per second for the DSP readout */
+    std::function<CallbackProfiler::Snapshot()> readPerformance;
+    std::function<void(juce::Component& anchor)> onPerformanceClicked;
+    
     void updatePosition(int64_t ticks, int pitch)
     {
         // Format: Bar:Beat:Tick
@@ -101,13 +119,37 @@ public:
         chordLabel.setBounds(area.removeFromLeft(200));
         
         snapLabel.setBounds(area.removeFromRight(150));
+        area.removeFromRight(10);
+        
+        performanceButton.setBounds(area.removeFromRight(220));
     }
     
 private:
+    void timerCallback() override
+    {
+        if (!readPerformance)
+            return;
+        
+        auto perf = readPerformance();
+        int xruns = (int)perf.overruns + juce::jmax(0, perf.deviceXRuns);
+        
+        juce::String text = "DSP " + juce::String(juce::roundToInt(perf.averageLoad * 100.0f)) + "%"
+                          + "  peak " + juce::String(juce::roundToInt(perf.peakLoad * 100.0f)) + "%"
+                          + "  " + juce::String(xruns) + (xruns == 1 ? " xrun" : " xruns");
+        performanceButton.setButtonText(text);
+        
+        auto colour = xruns > 0 || perf.peakLoad > 1.0f ? juce::Colours::red
+                    : perf.averageLoad > 0.7f ? juce::Colours::orange
+                    : juce::Colours::lightgrey;
+        performanceButton.setColour(juce::TextButton::textColourOffId, colour);
+    }
+    
+
     juce::Label positionLabel;
     juce::Label pitchLabel;
     juce::Label chordLabel;
     juce::Label snapLabel;
+    juce::TextButton performanceButton { "DSP --" };
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StatusLine)
 };
@@ -0,0 +1,160 @@
+#include "PerformancePanel.h"
+#include "../../core/audio/AudioEngine.h"
+#include <cmath>
+
+namespace pianodaw {
+
+namespace
+{
+    juce::String asPercent(float load)
+    {
+        return juce::String(load * 100.0f, 1) + "%";
+    }
+}
+
+PerformancePanel::PerformancePanel(AudioEngine& engine)
+    : audioEngine(engine)
+{
+    resetButton = std::make_unique<juce::TextButton>("Reset");
+    resetButton->addListener(this);
+    addAndMakeVisible(*resetButton);
+
+    exportButton = std::make_unique<juce::TextButton>("Export Report...");
+    exportButton->addListener(this);
+    addAndMakeVisible(*exportButton);
+
+    setSize(360, 420);
+    timerCallback();
+    startTimerHz(4);
+}
+
+PerformancePanel::~PerformancePanel() {}
+
+void PerformancePanel::timerCallback()
+{
+    snapshot = audioEngine.getPerformance();
+    repaint();
+}
+
+void PerformancePanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff222222));
+
+    auto area = getLocalBounds().reduced(10, 0);
+    g.setColour(juce::Colours::white);
+    g.setFont(18.0f);
+    g.drawText("Audio Performance", area.removeFromTop(40), juce::Justification::centredLeft);
+
+    // Totals
+    g.setFont(12.0f);
+    auto line = [&](const juce::String& name, const juce::String& value, juce::Colour colour)
+    {
+        auto row = area.removeFromTop(18);
+        g.setColour(juce::Colours::grey);
+        g.drawText(name, row.removeFromLeft(130), juce::Justification::centredLeft);
+        g.setColour(colour);
+        g.drawText(value, row, juce::Justification::centredLeft);
+    };
+
+    float deadlineMs = snapshot.sampleRate > 0.0 ? (float)(1000.0 * snapshot.blockSize / snapshot.sampleRate) : 0.0f;
+    auto lightgrey = juce::Colours::lightgrey;
+    auto warn = [](bool bad) { return bad ? juce::Colours::red : juce::Colours::lightgrey; };
+
+    line("Block", juce::String(snapshot.blockSize) + " samples, " + juce::String(deadlineMs, 2) + " ms", lightgrey);
+    line("Load average / peak", asPercent(snapshot.averageLoad) + " / " + asPercent(snapshot.peakLoad), warn(snapshot.peakLoad > 1.0f));
+    line("p50 / p99 / p99.9", asPercent(snapshot.getLoadPercentile(0.5)) + " / " + asPercent(snapshot.getLoadPercentile(0.99))
+                              + " / " + asPercent(snapshot.getLoadPercentile(0.999)), lightgrey);
+    line("Callbacks", juce::String((int)snapshot.numBlocks), lightgrey);
+    line("Over deadline", juce::String((int)snapshot.overruns), warn(snapshot.overruns > 0));
+    line("Late callbacks", juce::String((int)snapshot.lateCallbacks), warn(snapshot.lateCallbacks > 0));
+    line("Device xruns", snapshot.deviceXRuns >= 0 ? juce::String(snapshot.deviceXRuns) : juce::String("not reported"),
+         warn(snapshot.deviceXRuns > 0));
+
+    // Stage bars, as a share of the deadline
+    area.removeFromTop(10);
+    for (int s = 0; s < CallbackProfiler::numStages; ++s)
+    {
+        auto row = area.removeFromTop(16);
+        float load = snapshot.stageLoad[(size_t)s];
+
+        g.setColour(juce::Colours::grey);
+        g.drawText(CallbackProfiler::getStageName(s), row.removeFromLeft(80), juce::Justification::centredLeft);
+        g.drawText(asPercent(load), row.removeFromRight(50), juce::Justification::centredRight);
+
+        auto bar = row.reduced(4, 3);
+        g.setColour(juce::Colour(0xff333333));
+        g.fillRect(bar);
+        g.setColour(juce::Colours::cornflowerblue);
+        g.fillRect(bar.withWidth(juce::roundToInt((float)bar.getWidth() * juce::jlimit(0.0f, 1.0f, load))));
+    }
+
+    // Histogram of callback durations, log-scaled counts; the deadline is marked
+    area.removeFromTop(10);
+    g.setColour(juce::Colours::grey);
+    g.drawText("Callback duration (0 - 200% of deadline)", area.removeFromTop(16), juce::Justification::centredLeft);
+
+    auto chart = area.removeFromTop(90);
+    g.setColour(juce::Colour(0xff1a1a1a));
+    g.fillRect(chart);
+
+    juce::uint32 fullest = 1;
+    for (auto count : snapshot.histogram)
+        fullest = juce::jmax(fullest, count);
+
+    float barWidth = (float)chart.getWidth() / (float)CallbackProfiler::numBuckets;
+    float logFullest = std::log1p((float)fullest);
+
+    for (int i = 0; i < CallbackProfiler::numBuckets; ++i)
+    {
+        auto count = snapshot.histogram[(size_t)i];
+        if (count == 0)
+            continue;
+
+        float height = (float)chart.getHeight() * std::log1p((float)count) / logFullest;
+        bool late = (float)i * CallbackProfiler::bucketWidth >= 1.0f;
+        g.setColour(late ? juce::Colours::red : juce::Colours::lightgreen);
+        g.fillRect(juce::Rectangle<float>((float)chart.getX() + (float)i * barWidth, (float)chart.getBottom() - height,
+                                          juce::jmax(1.0f, barWidth - 1.0f), height));
+    }
+
+    float deadlineX = (float)chart.getX() + barWidth * (1.0f / CallbackProfiler::bucketWidth);
+    g.setColour(juce::Colours::orange);
+    g.drawVerticalLine(juce::roundToInt(deadlineX), (float)chart.getY(), (float)chart.getBottom());
+}
+
+void PerformancePanel::resized()
+{
+    auto area = getLocalBounds().reduced(10);
+    auto buttons = area.removeFromBottom(30);
+    resetButton->setBounds(buttons.removeFromLeft(80));
+    exportButton->setBounds(buttons.removeFromRight(130));
+}
+
+void PerformancePanel::buttonClicked(juce::Button* button)
+{
+    if (button == resetButton.get())
+    {
+        audioEngine.resetPerformance();
+    }
+    else if (button == exportButton.get())
+    {
+        reportChooser = std::make_unique<juce::FileChooser>("Export Performance Report",
+            juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("PianoDAW Performance.txt"), "*.txt");
+        reportChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                   | juce::FileBrowserComponent::warnAboutOverwriting,
+            [this](const juce::FileChooser& fc)
+            {
+                auto file = fc.getResult();
+                if (file == juce::File())
+                    return;
+
+                if (!file.replaceWithText(audioEngine.createPerformanceReport()))
+                {
+                    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                        "Performance Report", "Could not write " + file.getFullPathName());
+                }
+            });
+    }
+}
+
+} // namespace pianodaw
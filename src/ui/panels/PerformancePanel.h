@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "../../core/audio/CallbackProfiler.h"
+
+namespace pianodaw {
+
+class AudioEngine;
+
+/**
+ * PerformancePanel - Audio callback load per stage, load histogram and xruns
+ * Refreshes a few times per second; the report can be exported as text.
+ */
+class PerformancePanel : public juce::Component,
+                         public juce::Button::Listener,
+                         private juce::Timer
+{
+public:
+    explicit PerformancePanel(AudioEngine& engine);
+    ~PerformancePanel() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+    void buttonClicked(juce::Button* button) override;
+
+private:
+    void timerCallback() override;
+
+    AudioEngine& audioEngine;
+    CallbackProfiler::Snapshot snapshot;
+
+    std::unique_ptr<juce::TextButton> resetButton;
+    std::unique_ptr<juce::TextButton> exportButton;
+    std::unique_ptr<juce::FileChooser> reportChooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformancePanel)
+};
+
+} // namespace pianodaw
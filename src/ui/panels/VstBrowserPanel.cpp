@@ -1,5 +1,7 @@
 #include "VstBrowserPanel.h"
 #include "PluginEditorWindow.h"
+#include "../../core/audio/PluginSandbox.h"
+#include "../../core/audio/PluginScanner.h"
 
 namespace pianodaw {
 
@@ -9,15 +11,32 @@ VstBrowserPanel::VstBrowserPanel(AudioEngine& engine) : audioEngine(engine)
     scanButton->addListener(this);
     addAndMakeVisible(*scanButton);
 
+    samplesButton = std::make_unique<juce::TextButton>("Piano Samples...");
+    samplesButton->addListener(this);
+    addAndMakeVisible(*samplesButton);
+
+    reverbButton = std::make_unique<juce::TextButton>("Master Reverb...");
+    reverbButton->setTooltip("Convolve the master with an impulse response (built-in reverb)");
+    reverbButton->addListener(this);
+    addAndMakeVisible(*reverbButton);
+
+    sandboxToggle = std::make_unique<juce::ToggleButton>("Sandbox");
+    sandboxToggle->setTooltip("Run newly loaded plugins in a separate process");
+    sandboxToggle->setToggleState(audioEngine.isSandboxingNewPlugins(), juce::dontSendNotification);
+    sandboxToggle->addListener(this);
+    addAndMakeVisible(*sandboxToggle);
+
     pluginListBox = std::make_unique<juce::ListBox>("PluginList", this);
     pluginListBox->setRowHeight(30);
     addAndMakeVisible(*pluginListBox);
 
+    audioEngine.getPluginScanner().addChangeListener(this);
     updatePluginList();
 }
 
 VstBrowserPanel::~VstBrowserPanel()
 {
+    audioEngine.getPluginScanner().removeChangeListener(this);
 }
 
 void VstBrowserPanel::paint(juce::Graphics& g)
@@ -32,10 +51,14 @@ void VstBrowserPanel::paint(juce::Graphics& g)
 void VstBrowserPanel::resized()
 {
     auto area = getLocalBounds();
-    area.removeFromTop(40); // Title area
+    auto titleArea = area.removeFromTop(40); // Title area
+    sandboxToggle->setBounds(titleArea.removeFromRight(100).reduced(5, 8));
 
     auto buttonArea = area.removeFromTop(40).reduced(10, 5);
-    scanButton->setBounds(buttonArea);
+    int buttonWidth = buttonArea.getWidth() / 3;
+    scanButton->setBounds(buttonArea.removeFromLeft(buttonWidth).withTrimmedRight(5));
+    samplesButton->setBounds(buttonArea.removeFromLeft(buttonWidth).withTrimmedRight(5));
+    reverbButton->setBounds(buttonArea);
 
     pluginListBox->setBounds(area.reduced(10));
 }
@@ -44,8 +67,58 @@ void VstBrowserPanel::buttonClicked(juce::Button* button)
 {
     if (button == scanButton.get())
     {
-        audioEngine.scanPlugins();
-        updatePluginList();
+        auto& scanner = audioEngine.getPluginScanner();
+        if (scanner.isScanning())
+            scanner.cancelScan();
+        else
+            audioEngine.scanPlugins();
+    }
+    else if (button == sandboxToggle.get())
+    {
+        audioEngine.setSandboxNewPlugins(sandboxToggle->getToggleState());
+    }
+    else if (button == samplesButton.get())
+    {
+        sampleFolderChooser = std::make_unique<juce::FileChooser>("Select piano sample folder");
+        sampleFolderChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectDirectories,
+            [this](const juce::FileChooser& fc)
+            {
+                auto folder = fc.getResult();
+                if (!folder.isDirectory())
+                    return;
+
+                // Heads are read in the background; the current piano plays until the samples are in
+                audioEngine.loadSampledPiano(folder, (size_t)256 * 1024 * 1024, [](bool loaded, const juce::String& error)
+                {
+                    if (!loaded)
+                        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                            "Piano Samples", "Could not load samples:\n" + error);
+                });
+            });
+    }
+    else if (button == reverbButton.get())
+    {
+        impulseChooser = std::make_unique<juce::FileChooser>("Select an impulse response", juce::File(), "*.wav;*.aif;*.aiff;*.flac");
+        impulseChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+            [this](const juce::FileChooser& fc)
+            {
+                auto file = fc.getResult();
+                if (!file.existsAsFile())
+                    return;
+
+                // Read and partitioned in the background; the editor opens once the reverb is live
+                audioEngine.loadConvolutionReverb(file, nullptr, [file](juce::AudioProcessor* reverb, const juce::String& error)
+                {
+                    if (reverb == nullptr)
+                    {
+                        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                            "Master Reverb", "Could not load " + file.getFileName() + ":\n" + error);
+                        return;
+                    }
+
+                    new PluginEditorWindow(*reverb);
+                });
+            });
     }
 }
 
@@ -72,25 +145,42 @@ void VstBrowserPanel::listBoxItemDoubleClicked(int row, const juce::MouseEvent&)
 {
     if (row < plugins.size())
     {
-        if (audioEngine.loadPlugin(plugins[row]))
+        auto name = plugins[row].name;
+
+        // Loads in the background; the editor opens once the instrument is live
+        audioEngine.loadPlugin(plugins[row], nullptr, [name](juce::AudioProcessor* proc, const juce::String& error)
         {
-            if (auto* proc = audioEngine.getCurrentPlugin())
+            if (proc == nullptr)
             {
-                if (proc->hasEditor())
-                {
-                    // Open the editor window
-                    // Re-use current implementation pattern for simplicity
-                    new PluginEditorWindow(*proc);
-                }
+                juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon,
+                    "Load Plugin", "Could not load " + name + ":\n" + error);
+                return;
             }
-        }
-        else
-        {
-             DBG("VstBrowserPanel: Failed to load plugin " + plugins[row].name);
-        }
+
+            if (proc->hasEditor())
+                new PluginEditorWindow(*proc);
+        });
     }
 }
 
+void VstBrowserPanel::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    auto& scanner = audioEngine.getPluginScanner();
+    // The final message can arrive while the thread is still winding down
+    if (scanner.isScanning() && scanner.getProgress() < 1.0f)
+    {
+        scanButton->setButtonText("Scanning " + juce::String(juce::roundToInt(scanner.getProgress() * 100.0f)) + "%");
+        scanButton->setTooltip(scanner.getCurrentFile());
+    }
+    else
+    {
+        scanButton->setButtonText("Scan VST3");
+        scanButton->setTooltip({});
+    }
+
+    updatePluginList();
+}
+
 void VstBrowserPanel::updatePluginList()
 {
     plugins.clear();
@@ -99,6 +189,9 @@ void VstBrowserPanel::updatePluginList()
     {
         plugins.add(desc);
     }
+
+    // Always available; exercises the out-of-process host without third-party plugins
+    plugins.add(SandboxedPlugin::getTestToneDescription());
     pluginListBox->updateContent();
 }
 
@@ -7,7 +7,8 @@ namespace pianodaw {
 
 class VstBrowserPanel : public juce::Component,
                         public juce::Button::Listener,
-                        public juce::ListBoxModel
+                        public juce::ListBoxModel,
+                        public juce::ChangeListener
 {
 public:
     VstBrowserPanel(AudioEngine& engine);
@@ -24,10 +25,18 @@ public:
     void paintListBoxItem(int rowNumber, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
     void listBoxItemDoubleClicked(int row, const juce::MouseEvent&) override;
 
+    // ChangeListener (scan progress)
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
 private:
     AudioEngine& audioEngine;
     
     std::unique_ptr<juce::TextButton> scanButton;
+    std::unique_ptr<juce::TextButton> samplesButton;
+    std::unique_ptr<juce::TextButton> reverbButton;
+    std::unique_ptr<juce::ToggleButton> sandboxToggle;
+    std::unique_ptr<juce::FileChooser> sampleFolderChooser;
+    std::unique_ptr<juce::FileChooser> impulseChooser;
     std::unique_ptr<juce::ListBox> pluginListBox;
 
     juce::Array<juce::PluginDescription> plugins;
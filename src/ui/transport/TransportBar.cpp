@@ -76,6 +76,20 @@ void TransportBar::setupButtons()
         if (onLoopToggle) onLoopToggle(loopButton->getToggleState());
     };
     addAndMakeVisible(loopButton.get());
+
+    // Metronome and count-in
+    clickButton = std::make_unique<juce::ToggleButton>("Click");
+    clickButton->onClick = [this]() {
+        if (onMetronomeToggle) onMetronomeToggle(clickButton->getToggleState());
+    };
+    addAndMakeVisible(clickButton.get());
+
+    countInBox = std::make_unique<juce::ComboBox>("Count-in");
+    countInBox->addItem("No count-in", 1);
+    countInBox->addItem("Count-in 1 bar", 2);
+    countInBox->addItem("Count-in 2 bars", 3);
+    countInBox->setSelectedId(1, juce::dontSendNotification);
+    addAndMakeVisible(countInBox.get());
     
     // Position label
     positionLabel = std::make_unique<juce::Label>("Position", "0:0:0");
@@ -107,6 +121,12 @@ void TransportBar::resized()
     bounds.removeFromLeft(4);
     
     loopButton->setBounds(bounds.removeFromLeft(80));
+    bounds.removeFromLeft(4);
+
+    clickButton->setBounds(bounds.removeFromLeft(70));
+    bounds.removeFromLeft(4);
+
+    countInBox->setBounds(bounds.removeFromLeft(130).reduced(0, 8));
     bounds.removeFromLeft(20);
     
     positionLabel->setBounds(bounds.removeFromLeft(120));
@@ -125,6 +145,11 @@ void TransportBar::setTempoText(const juce::String& text)
     tempoLabel->setText(text, juce::dontSendNotification);
 }
 
+int TransportBar::getCountInBars() const
+{
+    return countInBox->getSelectedId() - 1;
+}
+
 void TransportBar::setRecording(bool isRecording)
 {
     recording = isRecording;
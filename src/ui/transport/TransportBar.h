@@ -26,16 +26,22 @@ public:
     std::function<void()> onStopDoubleClick;  // Stop double-click -> rewind
     std::function<void(bool)> onRecordToggle;  // Record toggle -> bool state
     std::function<void(bool)> onLoopToggle;
+    std::function<void(bool)> onMetronomeToggle;
     
     // State
     void setRecording(bool isRecording);
     bool isRecording() const { return recording; }
+
+    /** Bars to count in before recording from stopped (0 = none) */
+    int getCountInBars() const;
     
 private:
     std::unique_ptr<juce::TextButton> playButton;
     std::unique_ptr<juce::TextButton> stopButton;
     std::unique_ptr<juce::TextButton> recordButton;
     std::unique_ptr<juce::ToggleButton> loopButton;
+    std::unique_ptr<juce::ToggleButton> clickButton;
+    std::unique_ptr<juce::ComboBox> countInBox;
     std::unique_ptr<juce::Label> positionLabel;
     std::unique_ptr<juce::Label> tempoLabel;
     
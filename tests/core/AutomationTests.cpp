@@ -0,0 +1,284 @@
+#include "core/audio/AutomationEvaluator.h"
+#include "core/edit/AutomationCommands.h"
+#include "core/model/Automation.h"
+#include "core/model/Project.h"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    bool near(float a, float b, float tolerance = 1.0e-4f)
+    {
+        return std::abs(a - b) <= tolerance;
+    }
+
+    BlockTickWindow makeWindow(double startTick, int64_t endTick, int startSample, int numSamples, bool endsAtLoopEnd = false)
+    {
+        BlockTickWindow window;
+        window.startTick = (int64_t)std::floor(startTick);
+        window.exactStartTick = startTick;
+        window.endTick = endTick;
+        window.startSample = startSample;
+        window.numSamples = numSamples;
+        window.endsAtLoopEnd = endsAtLoopEnd;
+        return window;
+    }
+
+    /**
+     * Render the lane over the windows and compare every sample with the lane's own
+     * value at that sample's tick (holdTick's value outside the windows)
+     */
+    void expectCurve(const AutomationLane& lane, const std::vector<BlockTickWindow>& windows, int64_t holdTick,
+                     int numSamples, const juce::String& what)
+    {
+        std::vector<float> curve((size_t)numSamples, -1.0f);
+        AutomationEvaluator::renderCurve(lane, windows.data(), (int)windows.size(), holdTick, curve.data(), numSamples);
+
+        std::vector<float> expected((size_t)numSamples, lane.getValueAt(holdTick));
+        for (const auto& window : windows)
+        {
+            double ticksPerSample = ((double)window.endTick - window.exactStartTick) / window.numSamples;
+            for (int i = 0; i < window.numSamples && window.startSample + i < numSamples; ++i)
+            {
+                double tick = window.exactStartTick + i * ticksPerSample;
+                expected[(size_t)(window.startSample + i)] = lane.getValueAt(tick, lane.findPoint((int64_t)std::floor(tick)));
+            }
+        }
+
+        int wrong = 0;
+        int firstWrong = -1;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (!near(curve[(size_t)i], expected[(size_t)i]))
+            {
+                if (firstWrong < 0)
+                    firstWrong = i;
+                ++wrong;
+            }
+        }
+
+        expect(wrong == 0, what + ": " + juce::String(wrong) + " samples off, first at " + juce::String(firstWrong)
+                           + (firstWrong >= 0 ? " (" + juce::String(curve[(size_t)firstWrong]) + " instead of "
+                                                + juce::String(expected[(size_t)firstWrong]) + ")" : juce::String()));
+    }
+}
+
+// Breakpoints stay sorted, one per tick, values clamped to 0..1
+void testLanePoints()
+{
+    AutomationLane lane(AutomationLane::Target::Volume);
+    lane.addPoint(300, 0.25f);
+    lane.addPoint(100, 0.5f);
+    lane.addPoint(200, 2.0f);
+    lane.addPoint(100, 0.75f);
+
+    const auto& points = lane.getPoints();
+    expect(points.size() == 3, "a breakpoint at an existing tick was not replaced");
+    expect(points[0].tick == 100 && points[1].tick == 200 && points[2].tick == 300, "breakpoints are not sorted");
+    expect(near(points[0].value, 0.75f), "replaced breakpoint kept its old value");
+    expect(near(points[1].value, 1.0f), "breakpoint value was not clamped");
+
+    expect(lane.findPointAt(200) == 1 && lane.findPointAt(250) == -1, "findPointAt");
+}
+
+// findPoint gives the last breakpoint at or before a tick
+void testFindPoint()
+{
+    AutomationLane lane(AutomationLane::Target::Pan);
+    expect(lane.findPoint(0) == -1, "findPoint on an empty lane");
+
+    lane.addPoint(100, 0.0f);
+    lane.addPoint(200, 1.0f);
+    lane.addPoint(300, 0.5f);
+
+    expect(lane.findPoint(0) == -1, "findPoint before the first breakpoint");
+    expect(lane.findPoint(99) == -1, "findPoint just before the first breakpoint");
+    expect(lane.findPoint(100) == 0, "findPoint on the first breakpoint");
+    expect(lane.findPoint(199) == 0, "findPoint inside the first segment");
+    expect(lane.findPoint(200) == 1, "findPoint on a middle breakpoint");
+    expect(lane.findPoint(300) == 2, "findPoint on the last breakpoint");
+    expect(lane.findPoint(100000) == 2, "findPoint after the last breakpoint");
+}
+
+// Linear between breakpoints, held before the first and after the last
+void testGetValueAt()
+{
+    AutomationLane lane(AutomationLane::Target::Volume);
+    expect(near(lane.getValueAt((int64_t)500), 0.0f), "empty lane is not 0");
+
+    lane.addPoint(100, 0.2f);
+    expect(near(lane.getValueAt((int64_t)0), 0.2f) && near(lane.getValueAt((int64_t)1000), 0.2f),
+           "a single breakpoint does not hold everywhere");
+
+    lane.addPoint(200, 1.0f);
+    lane.addPoint(400, 0.0f);
+
+    expect(near(lane.getValueAt((int64_t)0), 0.2f), "value before the first breakpoint is not held");
+    expect(near(lane.getValueAt((int64_t)100), 0.2f), "value on the first breakpoint");
+    expect(near(lane.getValueAt((int64_t)150), 0.6f), "value halfway up the first ramp");
+    expect(near(lane.getValueAt((int64_t)200), 1.0f), "value on a middle breakpoint");
+    expect(near(lane.getValueAt((int64_t)300), 0.5f), "value halfway down the second ramp");
+    expect(near(lane.getValueAt((int64_t)400), 0.0f), "value on the last breakpoint");
+    expect(near(lane.getValueAt((int64_t)5000), 0.0f), "value after the last breakpoint is not held");
+    expect(near(lane.getValueAt(250.5, lane.findPoint(250)), 0.7475f), "value at a fractional tick");
+}
+
+// One ramp across a whole block, and a block entirely before or after the breakpoints
+void testEvaluatorRamp()
+{
+    AutomationLane lane(AutomationLane::Target::Volume);
+    lane.addPoint(0, 0.0f);
+    lane.addPoint(1000, 1.0f);
+
+    expectCurve(lane, { makeWindow(0.0, 1000, 0, 1000) }, 0, 1000, "ramp over a whole block");
+    expectCurve(lane, { makeWindow(250.0, 378, 0, 128) }, 0, 128, "block inside a ramp");
+    expectCurve(lane, { makeWindow(2000.0, 2128, 0, 128) }, 0, 128, "block after the last breakpoint");
+
+    // Fractional tick at the block start, several ticks per sample
+    expectCurve(lane, { makeWindow(333.75, 845, 0, 100) }, 0, 100, "fractional start, coarse ticks");
+}
+
+// Breakpoints inside a block turn the ramp around mid-block, including two in a row and one on a sample
+void testEvaluatorBreakpointsInsideBlock()
+{
+    AutomationLane lane(AutomationLane::Target::Volume);
+    lane.addPoint(0, 0.0f);
+    lane.addPoint(500, 1.0f);
+    lane.addPoint(501, 0.2f);
+    lane.addPoint(700, 0.2f);
+    lane.addPoint(1000, 0.9f);
+
+    expectCurve(lane, { makeWindow(0.0, 1000, 0, 1000) }, 0, 1000, "one tick per sample");
+    expectCurve(lane, { makeWindow(0.0, 1000, 0, 256) }, 0, 256, "several ticks per sample");
+    expectCurve(lane, { makeWindow(450.0, 550, 0, 512) }, 0, 512, "several samples per tick");
+    expectCurve(lane, { makeWindow(499.5, 730, 0, 173) }, 0, 173, "odd block across a step");
+
+    std::vector<float> curve(1000);
+    BlockTickWindow window = makeWindow(0.0, 1000, 0, 1000);
+    AutomationEvaluator::renderCurve(lane, &window, 1, 0, curve.data(), 1000);
+    expect(near(curve[500], 1.0f) && near(curve[501], 0.2f), "breakpoints on samples are not hit exactly");
+}
+
+// A block crossing the loop end continues from the loop start in its second window
+void testEvaluatorLoopWrap()
+{
+    AutomationLane lane(AutomationLane::Target::Pan);
+    lane.addPoint(0, 0.0f);
+    lane.addPoint(960, 1.0f);
+    lane.addPoint(1920, 0.5f);
+
+    // Loop [0, 1920), block of 256 samples at 1 tick per sample: 100 before the end, 156 after
+    std::vector<BlockTickWindow> windows { makeWindow(1820.0, 1920, 0, 100, true), makeWindow(0.0, 156, 100, 156) };
+    expectCurve(lane, windows, 0, 256, "loop wrap");
+
+    std::vector<float> curve(256);
+    AutomationEvaluator::renderCurve(lane, windows.data(), 2, 0, curve.data(), 256);
+    expect(curve[99] > 0.5f && near(curve[100], 0.0f), "value did not jump back at the loop start");
+
+    // A loop shorter than a block wraps more than once; and a window may start at a fractional tick
+    std::vector<BlockTickWindow> tiny { makeWindow(900.0, 1000, 0, 50, true), makeWindow(900.0, 1000, 50, 50, true),
+                                        makeWindow(900.0, 950, 100, 25) };
+    expectCurve(lane, tiny, 900, 125, "tiny loop");
+
+    std::vector<BlockTickWindow> fractional { makeWindow(1910.4, 1920, 0, 10, true), makeWindow(0.0, 118, 10, 118) };
+    expectCurve(lane, fractional, 0, 128, "loop wrap from a fractional tick");
+}
+
+// Samples outside every window (stopped, or a shrinking lookahead) hold the value at holdTick
+void testEvaluatorHold()
+{
+    AutomationLane lane(AutomationLane::Target::Volume);
+    lane.addPoint(0, 0.0f);
+    lane.addPoint(1000, 1.0f);
+
+    expectCurve(lane, {}, 250, 64, "no windows");
+    expectCurve(lane, { makeWindow(0.0, 32, 32, 32) }, 500, 64, "window covering half the block");
+}
+
+// Lanes and breakpoints authored through commands, undone and redone
+void testAutomationCommands()
+{
+    Project project("Automation");
+    auto* track = project.addTrack("Piano", Track::Type::MIDI);
+    UndoStack undoStack;
+
+    using Target = AutomationLane::Target;
+
+    undoStack.execute(std::make_unique<AddAutomationLaneCommand>(project, *track, Target::PluginParameter, 3, "Cutoff"));
+    auto* lane = track->findAutomationLane(Target::PluginParameter, 3);
+    expect(lane != nullptr && lane->getName() == "Cutoff", "lane was not added");
+
+    undoStack.execute(std::make_unique<SetAutomationPointCommand>(project, *track, Target::PluginParameter, 3, 0, 0.1f));
+    undoStack.execute(std::make_unique<SetAutomationPointCommand>(project, *track, Target::PluginParameter, 3, 960, 0.9f));
+    undoStack.execute(std::make_unique<SetAutomationPointCommand>(project, *track, Target::PluginParameter, 3, 960, 0.5f));
+    expect(lane->getPoints().size() == 2 && near(lane->getValueAt((int64_t)960), 0.5f), "breakpoints were not set");
+
+    undoStack.undo();
+    expect(near(lane->getValueAt((int64_t)960), 0.9f), "undo did not restore the replaced value");
+
+    undoStack.execute(std::make_unique<MoveAutomationPointCommand>(project, *track, Target::PluginParameter, 3, 960, 0, 0.7f));
+    expect(lane->getPoints().size() == 1 && near(lane->getValueAt((int64_t)0), 0.7f), "move did not replace the breakpoint it landed on");
+
+    undoStack.undo();
+    expect(lane->getPoints().size() == 2 && near(lane->getValueAt((int64_t)0), 0.1f)
+               && near(lane->getValueAt((int64_t)960), 0.9f), "undoing a move did not restore both breakpoints");
+
+    undoStack.execute(std::make_unique<RemoveAutomationPointCommand>(project, *track, Target::PluginParameter, 3, 0));
+    expect(lane->getPoints().size() == 1, "breakpoint was not removed");
+    undoStack.undo();
+    expect(lane->getPoints().size() == 2, "breakpoint removal was not undone");
+
+    undoStack.execute(std::make_unique<SetAutomationLaneEnabledCommand>(project, *track, Target::PluginParameter, 3, false));
+    expect(!lane->isEnabled(), "lane was not bypassed");
+
+    undoStack.execute(std::make_unique<RemoveAutomationLaneCommand>(project, *track, Target::PluginParameter, 3));
+    expect(track->findAutomationLane(Target::PluginParameter, 3) == nullptr, "lane was not removed");
+
+    undoStack.undo();
+    lane = track->findAutomationLane(Target::PluginParameter, 3);
+    expect(lane != nullptr && lane->getPoints().size() == 2 && !lane->isEnabled() && lane->getName() == "Cutoff",
+           "lane removal was not undone with its breakpoints and settings");
+
+    undoStack.redo();
+    expect(track->findAutomationLane(Target::PluginParameter, 3) == nullptr, "lane removal was not redone");
+
+    // Adding a lane that exists must not remove it on undo
+    track->getOrCreateAutomationLane(Target::Volume);
+    undoStack.execute(std::make_unique<AddAutomationLaneCommand>(project, *track, Target::Volume));
+    undoStack.undo();
+    expect(track->findAutomationLane(Target::Volume) != nullptr, "undoing a no-op add removed an existing lane");
+}
+
+} // namespace pianodaw
+
+int main()
+{
+    pianodaw::testLanePoints();
+    pianodaw::testFindPoint();
+    pianodaw::testGetValueAt();
+    pianodaw::testEvaluatorRamp();
+    pianodaw::testEvaluatorBreakpointsInsideBlock();
+    pianodaw::testEvaluatorLoopWrap();
+    pianodaw::testEvaluatorHold();
+    pianodaw::testAutomationCommands();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "AutomationTests passed" << std::endl;
+    return 0;
+}
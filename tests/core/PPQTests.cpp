@@ -1,35 +1,61 @@
-#include "PPQ.h"
-#include <cassert>
+#include "core/timeline/PPQ.h"
+#include <juce_core/juce_core.h>
 #include <cmath>
+#include <iostream>
 
 namespace pianodaw {
 
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+}
+
 // Test basic conversion
 void testPPQConversions()
 {
     // Test tick to beat
-    assert(std::abs(PPQ::tickToBeat(960) - 1.0) < 0.001);
-    assert(std::abs(PPQ::tickToBeat(480) - 0.5) < 0.001);
-    
+    expect(std::abs(PPQ::tickToBeat(960) - 1.0) < 0.001, "960 ticks is not one beat");
+    expect(std::abs(PPQ::tickToBeat(480) - 0.5) < 0.001, "480 ticks is not half a beat");
+
     // Test beat to tick
-    assert(PPQ::beatToTick(1.0) == 960);
-    assert(PPQ::beatToTick(0.5) == 480);
-    
+    expect(PPQ::beatToTick(1.0) == 960, "one beat is not 960 ticks");
+    expect(PPQ::beatToTick(0.5) == 480, "half a beat is not 480 ticks");
+
     // Test tick to seconds (120 BPM = 2 beats per second)
     double seconds = PPQ::tickToSeconds(960, 120.0);
-    assert(std::abs(seconds - 0.5) < 0.001); // 1 beat at 120 BPM is 0.5 seconds
-    
+    expect(std::abs(seconds - 0.5) < 0.001, "one beat at 120 BPM is " + juce::String(seconds) + " seconds");
+
     // Test seconds to tick
     int64_t tick = PPQ::secondsToTick(0.5, 120.0);
-    assert(tick == 960);
-    
+    expect(tick == 960, "half a second at 120 BPM is " + juce::String(tick) + " ticks");
+
     // Test bar:beat conversion (4/4 time)
     int bar, beat, tickInBeat;
     PPQ::tickToBarBeat(960 * 4, 4, bar, beat, tickInBeat);  // 4 beats = 1 bar
-    assert(bar == 2 && beat == 0 && tickInBeat == 0);  // Start of bar 2
-    
+    expect(bar == 2 && beat == 0 && tickInBeat == 0, "4 beats is not the start of bar 2");
+
     int64_t reconstructed = PPQ::barBeatToTick(2, 0, 0, 4);
-    assert(reconstructed == 960 * 4);
+    expect(reconstructed == 960 * 4, "bar 2 starts at tick " + juce::String(reconstructed));
 }
 
 } // namespace pianodaw
+
+int main()
+{
+    pianodaw::testPPQConversions();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "PPQTests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "core/audio/PartitionedConvolver.h"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    /** Decaying noise normalised to unit energy, like the reverb's responses */
+    std::vector<float> makeImpulse(int length, juce::Random& random)
+    {
+        std::vector<float> impulse((size_t)length);
+        double energy = 0.0;
+        for (int i = 0; i < length; ++i)
+        {
+            impulse[(size_t)i] = (random.nextFloat() * 2.0f - 1.0f) * std::exp(-3.0f * (float)i / (float)length);
+            energy += impulse[(size_t)i] * impulse[(size_t)i];
+        }
+
+        for (auto& tap : impulse)
+            tap /= (float)std::sqrt(energy);
+
+        return impulse;
+    }
+
+    std::vector<float> makeNoise(int length, juce::Random& random)
+    {
+        std::vector<float> noise((size_t)length);
+        for (auto& sample : noise)
+            sample = random.nextFloat() * 2.0f - 1.0f;
+        return noise;
+    }
+
+    /** Reference: the convolution sum, in double, truncated to the input's length */
+    std::vector<float> convolveDirect(const std::vector<float>& input, const std::vector<float>& impulse)
+    {
+        std::vector<float> output(input.size());
+        for (size_t n = 0; n < input.size(); ++n)
+        {
+            double sum = 0.0;
+            for (size_t k = 0; k < impulse.size() && k <= n; ++k)
+                sum += (double)input[n - k] * impulse[k];
+            output[n] = (float)sum;
+        }
+        return output;
+    }
+
+    /** process() the input in blocks of blockSize (the last one shorter), in place if asked */
+    std::vector<float> convolvePartitioned(PartitionedConvolver& convolver, const std::vector<float>& input,
+                                           int blockSize, bool inPlace)
+    {
+        std::vector<float> output(inPlace ? input : std::vector<float>(input.size()));
+        for (int start = 0; start < (int)input.size(); start += blockSize)
+        {
+            int n = juce::jmin(blockSize, (int)input.size() - start);
+            convolver.process(inPlace ? output.data() + start : input.data() + start, output.data() + start, n);
+        }
+        return output;
+    }
+
+    float maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        float difference = 0.0f;
+        for (size_t i = 0; i < a.size(); ++i)
+            difference = juce::jmax(difference, std::abs(a[i] - b[i]));
+        return difference;
+    }
+
+    // Lengths either side of the head and of where the 512 and 4096 stages start
+    constexpr int impulseLengths[] = { 63, 64, 65, 1023, 1024, 1025, 8191, 8192, 8193 };
+
+    // Odd sizes never line up with a partition, so every stage fills across calls
+    constexpr int blockSizes[] = { 1, 7, 127, 333, 1000 };
+
+    constexpr float tolerance = 1.0e-4f;
+}
+
+// Noise through every stage layout matches the convolution sum, however the input is blocked
+void testMatchesDirectConvolution()
+{
+    juce::Random random(47);
+
+    for (int length : impulseLengths)
+    {
+        auto impulse = makeImpulse(length, random);
+        auto input = makeNoise(length + 3 * 4096, random);
+        auto expected = convolveDirect(input, impulse);
+
+        PartitionedConvolver convolver;
+        convolver.load(impulse.data(), length);
+        expect(convolver.getLength() == length, "length not kept for " + juce::String(length) + " taps");
+
+        for (int blockSize : blockSizes)
+        {
+            // reset() between runs must leave no history behind
+            convolver.reset();
+            bool inPlace = blockSize == 333;
+            auto output = convolvePartitioned(convolver, input, blockSize, inPlace);
+
+            auto difference = maxDifference(output, expected);
+            expect(difference < tolerance,
+                   juce::String(length) + " taps in blocks of " + juce::String(blockSize)
+                   + (inPlace ? " (in place)" : "") + " differ from direct convolution by " + juce::String(difference));
+        }
+    }
+}
+
+// A unit impulse comes back as the response itself, starting on the very first sample
+void testZeroLatency()
+{
+    juce::Random random(48);
+
+    for (int length : impulseLengths)
+    {
+        auto impulse = makeImpulse(length, random);
+
+        PartitionedConvolver convolver;
+        convolver.load(impulse.data(), length);
+
+        for (int blockSize : blockSizes)
+        {
+            convolver.reset();
+
+            std::vector<float> input((size_t)(length + 4096), 0.0f);
+            input[0] = 1.0f;
+            auto output = convolvePartitioned(convolver, input, blockSize, false);
+
+            expect(output[0] == impulse[0],
+                   "first sample delayed for " + juce::String(length) + " taps in blocks of " + juce::String(blockSize));
+
+            impulse.resize(input.size(), 0.0f);
+            auto difference = maxDifference(output, impulse);
+            impulse.resize((size_t)length);
+
+            expect(difference < tolerance,
+                   "impulse response of " + juce::String(length) + " taps in blocks of " + juce::String(blockSize)
+                   + " off by " + juce::String(difference));
+        }
+    }
+}
+
+} // namespace pianodaw
+
+int main()
+{
+    pianodaw::testMatchesDirectConvolution();
+    pianodaw::testZeroLatency();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "PartitionedConvolverTests passed" << std::endl;
+    return 0;
+}
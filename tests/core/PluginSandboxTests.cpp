@@ -0,0 +1,114 @@
+#include "core/audio/PluginSandbox.h"
+#include <iostream>
+#include <memory>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    /**
+     * Render roughly in real time, pumping the message loop so the sandbox's timer
+     * (restarts and the watchdog) runs, until restarts reach expectedRestarts and
+     * the relaunched child is heard again. triggerNote goes out with the first block.
+     */
+    bool renderUntilRecovered(SandboxedPlugin& plugin, int triggerNote, int expectedRestarts, int timeoutMs)
+    {
+        juce::AudioBuffer<float> buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        auto deadline = juce::Time::getMillisecondCounter() + (juce::uint32)timeoutMs;
+
+        for (int block = 0; juce::Time::getMillisecondCounter() < deadline; ++block)
+        {
+            midi.clear();
+            if (block == 0 && triggerNote >= 0)
+                midi.addEvent(juce::MidiMessage::noteOn(1, triggerNote, (juce::uint8)100), 0);
+            else if (block % 40 == 0)
+                midi.addEvent(juce::MidiMessage::noteOn(1, 60, (juce::uint8)100), 0);
+
+            buffer.clear();
+            plugin.processBlock(buffer, midi);
+
+            if (plugin.getStats().restarts >= expectedRestarts && buffer.getMagnitude(0, blockSize) > 0.0f)
+                return true;
+
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
+        }
+
+        return false;
+    }
+}
+
+// The test tone plays through the child process at all
+void testTestToneRenders(SandboxedPlugin& plugin)
+{
+    expect(renderUntilRecovered(plugin, 60, 0, 5000), "sandboxed test tone rendered silence");
+}
+
+// Note 0 aborts the child: the lost connection triggers a relaunch and sound comes back
+void testCrashRecovery(SandboxedPlugin& plugin)
+{
+    expect(renderUntilRecovered(plugin, 0, 1, 10000), "sandbox did not recover from a crashed child");
+    expect(plugin.getStats().hangs == 0, "a crash was reported as a hang");
+}
+
+// Note 1 hangs the child with its connection still open: only the watchdog can kill and relaunch it
+void testHangRecovery(SandboxedPlugin& plugin)
+{
+    expect(renderUntilRecovered(plugin, 1, 2, 10000), "sandbox did not recover from a hung child");
+    expect(plugin.getStats().hangs == 1, "watchdog did not kill the hung child");
+}
+
+} // namespace pianodaw
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    juce::StringArray args(argv + 1, argc - 1);
+    auto commandLine = args.joinIntoString(" ");
+
+    // Started by SandboxedPlugin as its child: host the test tone until the connection goes
+    if (commandLine.contains(pianodaw::SandboxedPlugin::childProcessID))
+    {
+        auto worker = std::make_unique<pianodaw::PluginSandboxWorker>();
+        if (!worker->initialiseFromCommandLine(commandLine, pianodaw::SandboxedPlugin::childProcessID))
+            return 1;
+
+        juce::MessageManager::getInstance()->runDispatchLoop();
+        return 0;
+    }
+
+    pianodaw::SandboxedPlugin plugin(pianodaw::SandboxedPlugin::getTestToneDescription(), 2,
+                                     pianodaw::sampleRate, pianodaw::blockSize);
+
+    juce::String error;
+    if (!plugin.launch(10000, error))
+    {
+        std::cerr << "FAILED: sandbox did not launch: " << error << std::endl;
+        return 1;
+    }
+
+    pianodaw::testTestToneRenders(plugin);
+    pianodaw::testCrashRecovery(plugin);
+    pianodaw::testHangRecovery(plugin);
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "PluginSandboxTests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,339 @@
+#include "core/audio/AudioEngine.h"
+#include "core/audio/RealtimeSafety.h"
+#include "core/model/Project.h"
+#include "core/timeline/PPQ.h"
+#include "core/timeline/Transport.h"
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    void* volatile escaped = nullptr;   // Keeps the optimiser from eliding the test allocation
+
+    /** A sine per held note: enough for every chain and bus to carry signal, and nothing allocated once prepared */
+    class TestSynth : public juce::AudioPluginInstance
+    {
+    public:
+        TestSynth()
+            : AudioPluginInstance(BusesProperties().withOutput("Output", juce::AudioChannelSet::stereo(), true))
+        {
+        }
+
+        // AudioPluginInstance
+        void fillInPluginDescription(juce::PluginDescription& description) const override
+        {
+            description.name = getName();
+            description.pluginFormatName = "Internal";
+            description.isInstrument = true;
+            description.numInputChannels = 0;
+            description.numOutputChannels = 2;
+        }
+
+        // AudioProcessor
+        const juce::String getName() const override { return "Test Synth"; }
+
+        void prepareToPlay(double newSampleRate, int) override
+        {
+            sampleRate = newSampleRate;
+            levels.fill(0.0f);
+            phases.fill(0.0);
+        }
+
+        void releaseResources() override {}
+
+        void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+        {
+            buffer.clear();
+            int position = 0;
+
+            for (const auto metadata : midiMessages)
+            {
+                int eventSample = juce::jlimit(position, buffer.getNumSamples(), metadata.samplePosition);
+                render(buffer, position, eventSample);
+                position = eventSample;
+
+                auto message = metadata.getMessage();
+                if (message.isNoteOn())
+                    levels[(size_t)message.getNoteNumber()] = message.getFloatVelocity() * 0.05f;
+                else if (message.isNoteOff())
+                    levels[(size_t)message.getNoteNumber()] = 0.0f;
+                else if (message.isAllNotesOff() || message.isAllSoundOff())
+                    levels.fill(0.0f);
+            }
+
+            render(buffer, position, buffer.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return true; }
+        bool producesMidi() const override { return false; }
+
+        juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram(int) override {}
+        const juce::String getProgramName(int) override { return {}; }
+        void changeProgramName(int, const juce::String&) override {}
+
+        void getStateInformation(juce::MemoryBlock&) override {}
+        void setStateInformation(const void*, int) override {}
+
+    private:
+        void render(juce::AudioBuffer<float>& buffer, int start, int end)
+        {
+            for (size_t note = 0; note < levels.size(); ++note)
+            {
+                if (levels[note] <= 0.0f)
+                    continue;
+
+                auto increment = juce::MathConstants<double>::twoPi
+                               * juce::MidiMessage::getMidiNoteInHertz((int)note) / sampleRate;
+                for (int i = start; i < end; ++i)
+                {
+                    auto value = levels[note] * (float)std::sin(phases[note]);
+                    phases[note] += increment;
+                    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                        buffer.addSample(channel, i, value);
+                }
+                phases[note] = std::fmod(phases[note], juce::MathConstants<double>::twoPi);
+            }
+        }
+
+        double sampleRate = 44100.0;
+        std::array<float, 128> levels {};
+        std::array<double, 128> phases {};
+    };
+
+    /** A quarter second of decaying noise, written to a temporary WAV for the convolution reverb */
+    juce::File writeImpulseResponse(double sampleRate)
+    {
+        auto file = juce::File::createTempFile(".wav");
+        auto length = (int)(sampleRate / 4);
+
+        juce::AudioBuffer<float> impulse(2, length);
+        juce::Random random(39);
+        for (int channel = 0; channel < 2; ++channel)
+            for (int i = 0; i < length; ++i)
+                impulse.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * std::exp(-6.0f * (float)i / (float)length));
+
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return {};
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, 2, 24, {}, 0));
+        if (writer == nullptr)
+            return {};
+
+        stream.release();   // Owned by the writer now
+        writer->writeFromAudioSampleBuffer(impulse, 0, length);
+        return file;
+    }
+
+    struct SyntheticTracks
+    {
+        Track* group = nullptr;
+        Track* chords = nullptr;
+        Track* melody = nullptr;
+    };
+
+    // A few bars of chords and a melody on two tracks, one routed through a group bus
+    SyntheticTracks createSyntheticProject(Project& project)
+    {
+        int64_t beat = PPQ::TICKS_PER_QUARTER;
+        int64_t bar = beat * 4;
+
+        auto* group = project.addTrack("Group", Track::Type::Group);
+
+        auto* chords = project.addTrack("Chords", Track::Type::MIDI);
+        auto* chordClip = project.addClip("Chords");
+        chords->addClipRegion(ClipRegion(chordClip, 0, bar * 4));
+        const int roots[] = { 60, 65, 67, 60 };
+        for (int i = 0; i < 4; ++i)
+        {
+            chordClip->addNote(roots[i], bar * i, bar * (i + 1), 100);
+            chordClip->addNote(roots[i] + 4, bar * i, bar * (i + 1), 95);
+            chordClip->addNote(roots[i] + 7, bar * i, bar * (i + 1), 90);
+        }
+
+        auto* melody = project.addTrack("Melody", Track::Type::MIDI);
+        auto* melodyClip = project.addClip("Melody");
+        melody->addClipRegion(ClipRegion(melodyClip, 0, bar * 4));
+        for (int i = 0; i < 32; ++i)
+            melodyClip->addNote(72 + (i * 5) % 12, beat / 2 * i, beat / 2 * (i + 1), 80 + i % 40);
+
+        project.setTrackOutput(*melody, group);
+        return { group, chords, melody };
+    }
+
+    bool isAudible(const LevelMeter::Reading& reading)
+    {
+        for (int channel = 0; channel < reading.numChannels; ++channel)
+            if (reading.peak[(size_t)channel] > 0.0f)
+                return true;
+        return false;
+    }
+}
+
+// The checker itself must catch an allocation, and stay quiet outside realtime scopes and allowances
+void testCheckerDetectsAllocation()
+{
+    if (!RealtimeSafety::isAvailable())
+        return;
+
+    RealtimeSafety::clear();
+    RealtimeSafety::setEnabled(true);
+
+    {
+        auto outside = std::make_unique<int[]>(16);
+        escaped = outside.get();
+    }
+    expect(RealtimeSafety::getNumViolations() == 0, "allocation outside a realtime scope was reported");
+
+    {
+        const RealtimeSafety::ScopedRealtime realtime;
+        const RealtimeSafety::ScopedAllowance allowance;
+        auto allowed = std::make_unique<int[]>(16);
+        escaped = allowed.get();
+    }
+    expect(RealtimeSafety::getNumViolations() == 0, "allocation under an allowance was reported");
+
+    {
+        const RealtimeSafety::ScopedRealtime realtime;
+        auto inside = std::make_unique<int[]>(16);
+        escaped = inside.get();
+    }
+    expect(RealtimeSafety::getNumViolations() >= 1, "allocation in a realtime scope was not reported");
+
+    RealtimeSafety::setEnabled(false);
+    RealtimeSafety::clear();
+}
+
+// The synthetic project through the engine from start to end, with instruments on both
+// tracks and a reverb on the group bus, with no violation allowed
+void renderSyntheticProject(bool renderAhead)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256;
+    constexpr double tempo = 120.0;
+    const juce::String pass = renderAhead ? " (rendering ahead)" : "";
+
+    Project project("Realtime safety");
+    auto tracks = createSyntheticProject(project);
+
+    Transport transport;
+    transport.setTempo(tempo);
+    transport.start();
+
+    AudioEngine engine(project, transport);
+    engine.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+    engine.prepareToPlay(sampleRate, blockSize);
+    engine.setAnticipativeRendering(renderAhead);
+
+    engine.setInstrument(std::make_unique<TestSynth>(), tracks.chords);
+    engine.setInstrument(std::make_unique<TestSynth>(), tracks.melody);
+
+    // The reverb is read and partitioned in the background, and arrives through the message loop
+    auto impulseResponse = writeImpulseResponse(sampleRate);
+    bool reverbLoaded = false;
+    juce::String reverbError;
+    engine.loadConvolutionReverb(impulseResponse, tracks.group,
+                                 [&reverbLoaded, &reverbError](juce::AudioProcessor* effect, const juce::String& error)
+                                 {
+                                     reverbLoaded = effect != nullptr;
+                                     reverbError = error;
+                                 });
+
+    auto deadline = juce::Time::getMillisecondCounter() + 10000;
+    while (!reverbLoaded && reverbError.isEmpty() && juce::Time::getMillisecondCounter() < deadline)
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(10);
+
+    expect(reverbLoaded, "group bus reverb didn't load" + pass + ": " + reverbError);
+
+    // The host's buffers are sized before the callback starts, as AudioProcessorPlayer does
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    midi.ensureSize(2048);
+
+    RealtimeSafety::clear();
+    RealtimeSafety::setEnabled(true);
+
+    juce::int64 renderedSamples = 0;
+    float loudest = 0.0f;
+    int jumps = 0;
+    auto numBlocks = (int)(PPQ::tickToSeconds(PPQ::TICKS_PER_QUARTER * 4 * 4, tempo) * sampleRate / blockSize);
+    for (int i = 0; i < numBlocks; ++i)
+    {
+        midi.clear();
+        if (i % 50 == 0)
+            midi.addEvent(juce::MidiMessage::noteOn(1, 48 + i % 24, (juce::uint8)100), i % blockSize);
+
+        engine.processBlock(buffer, midi);
+        renderedSamples += blockSize;
+        loudest = juce::jmax(loudest, buffer.getMagnitude(0, blockSize));
+
+        // Nothing locates the transport, so the engine's clock must run straight through
+        auto expectedTick = (int64_t)std::floor((double)renderedSamples / sampleRate * tempo / 60.0 * PPQ::TICKS_PER_QUARTER);
+        if (std::abs(transport.getClockPosition() - expectedTick) > 1)
+            ++jumps;
+    }
+
+    RealtimeSafety::setEnabled(false);
+
+    expect(loudest > 0.0f, "engine rendered silence" + pass);
+    expect(jumps == 0, "playhead jumped in " + juce::String(jumps) + " of " + juce::String(numBlocks) + " blocks" + pass);
+    expect(transport.getLocateGeneration() == 0, "rendering located the transport" + pass);
+    expect(RealtimeSafety::getNumViolations() == 0, RealtimeSafety::getReport());
+
+    // Each track played through its own chain, and the melody through the group bus
+    LevelMeter::Reading reading;
+    expect(engine.readTrackMeter(*tracks.chords, reading) && isAudible(reading), "chords chain rendered silence" + pass);
+    expect(engine.readTrackMeter(*tracks.melody, reading) && isAudible(reading), "melody chain rendered silence" + pass);
+    expect(engine.readTrackMeter(*tracks.group, reading) && isAudible(reading), "group bus rendered silence" + pass);
+
+    engine.releaseResources();
+    transport.stop();
+    impulseResponse.deleteFile();
+}
+
+void testEngineRendersRealtimeSafe()
+{
+    renderSyntheticProject(false);
+    renderSyntheticProject(true);
+}
+
+} // namespace pianodaw
+
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juce;
+
+    if (!pianodaw::RealtimeSafety::isAvailable())
+        std::cout << "Built without PIANODAW_RT_CHECKS: only the engine render is exercised" << std::endl;
+
+    pianodaw::testCheckerDetectsAllocation();
+    pianodaw::testEngineRendersRealtimeSafe();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "RealtimeSafetyTests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "core/edit/RegionCommands.h"
+#include "core/model/Project.h"
+#include <iostream>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    /** A MIDI track with one region of a one-bar clip at beat 4 */
+    Track* addMidiTrack(Project& project)
+    {
+        auto* clip = project.addClip("Phrase");
+        auto* track = project.addTrack("Piano", Track::Type::Instrument);
+        track->addClipRegion(ClipRegion(clip, 4 * PPQ::TICKS_PER_QUARTER, 4 * PPQ::TICKS_PER_QUARTER));
+        return track;
+    }
+
+    std::unique_ptr<AudioClip> makeBounceClip()
+    {
+        return std::make_unique<AudioClip>(juce::File("/tmp/Piano Bounce.wav"), "Piano Bounce");
+    }
+}
+
+// Mute and unmute go through the stack, and each undo restores the previous state
+void testToggleRegionMute()
+{
+    Project project;
+    auto* track = addMidiTrack(project);
+    int regionId = track->getClipRegions().front().id;
+    UndoStack undoStack;
+
+    undoStack.execute(std::make_unique<ToggleRegionMuteCommand>(project, *track, *track->findClipRegion(regionId)));
+    expect(track->findClipRegion(regionId)->muted, "region not muted");
+
+    undoStack.execute(std::make_unique<ToggleRegionMuteCommand>(project, *track, *track->findClipRegion(regionId)));
+    expect(!track->findClipRegion(regionId)->muted, "region not unmuted");
+
+    undoStack.undo();
+    expect(track->findClipRegion(regionId)->muted, "undoing the unmute left the region unmuted");
+
+    undoStack.undo();
+    expect(!track->findClipRegion(regionId)->muted, "undoing the mute left the region muted");
+
+    undoStack.redo();
+    expect(track->findClipRegion(regionId)->muted, "redoing the mute left the region unmuted");
+}
+
+// A bounce onto a new track adds the track, the clip and the region, and mutes the source;
+// undo takes all of it back and redo brings back the same track
+void testBounceOntoNewTrack()
+{
+    Project project;
+    auto* source = addMidiTrack(project);
+    const auto& sourceRegion = source->getClipRegions().front();
+    int regionId = sourceRegion.id;
+    UndoStack undoStack;
+
+    auto bounceTrack = std::make_unique<Track>("Piano Bounce", Track::Type::Audio);
+    int bounceUid = bounceTrack->getUid();
+    auto bounce = std::make_unique<BounceInPlaceCommand>(project, *source, regionId, std::move(bounceTrack), bounceUid,
+                                                         makeBounceClip(), sourceRegion.startTick, sourceRegion.lengthTick);
+    auto* audioClip = bounce->getAudioClip();
+    undoStack.execute(std::move(bounce));
+
+    auto* placed = project.findTrackByUid(bounceUid);
+    expect(project.getNumTracks() == 2, "bounce track not added");
+    expect(placed != nullptr && placed->getClipRegions().size() == 1, "bounced region not placed");
+    if (placed != nullptr && placed->getClipRegions().size() == 1)
+    {
+        const auto& region = placed->getClipRegions().front();
+        expect(region.audioClip == audioClip, "bounced region doesn't place the bounce's clip");
+        expect(region.startTick == 4 * PPQ::TICKS_PER_QUARTER, "bounced region not at the source region's start");
+    }
+    expect(project.getAudioClips().size() == 1, "bounce clip not in the pool");
+    expect(source->findClipRegion(regionId)->muted, "source region not muted");
+
+    undoStack.undo();
+    expect(project.getNumTracks() == 1 && project.findTrackByUid(bounceUid) == nullptr, "undo left the bounce track");
+    expect(project.getAudioClips().empty(), "undo left the bounce clip in the pool");
+    expect(!source->findClipRegion(regionId)->muted, "undo left the source region muted");
+
+    undoStack.redo();
+    placed = project.findTrackByUid(bounceUid);
+    expect(placed != nullptr, "redo didn't bring back the bounce track with its uid");
+    expect(placed != nullptr && placed->getClipRegions().size() == 1
+               && placed->getClipRegions().front().audioClip == audioClip,
+           "redo didn't place the same clip again");
+    expect(source->findClipRegion(regionId)->muted, "redo left the source region unmuted");
+}
+
+// Bouncing again onto an existing bounce track only adds a region; undo keeps the track
+// and leaves a region that was already muted muted
+void testBounceOntoExistingTrack()
+{
+    Project project;
+    auto* source = addMidiTrack(project);
+    int regionId = source->getClipRegions().front().id;
+    source->findClipRegion(regionId)->muted = true;
+    auto* existing = project.addTrack("Piano Bounce", Track::Type::Audio);
+    UndoStack undoStack;
+
+    undoStack.execute(std::make_unique<BounceInPlaceCommand>(project, *source, regionId, nullptr, existing->getUid(),
+                                                             makeBounceClip(), 0, PPQ::TICKS_PER_QUARTER));
+    expect(project.getNumTracks() == 2, "a track was added for an existing bounce track");
+    expect(existing->getClipRegions().size() == 1, "bounced region not placed on the existing track");
+
+    undoStack.undo();
+    expect(project.findTrackByUid(existing->getUid()) == existing, "undo removed the existing bounce track");
+    expect(existing->getClipRegions().empty(), "undo left the bounced region");
+    expect(source->findClipRegion(regionId)->muted, "undo unmuted a region that was muted before the bounce");
+}
+
+} // namespace pianodaw
+
+int main()
+{
+    pianodaw::testToggleRegionMute();
+    pianodaw::testBounceOntoNewTrack();
+    pianodaw::testBounceOntoExistingTrack();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "RegionCommandsTests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "core/timeline/PPQ.h"
+#include "core/timeline/SamplePlayhead.h"
+#include <array>
+#include <iostream>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    constexpr double sampleRate = 48000.0;
+    constexpr double tempo = 120.0;   // 1920 ticks a second at 960 ppq: 25 samples a tick
+    constexpr int blockSize = 480;
+}
+
+// A count-in ending mid-block: the windows start on the downbeat sample at the downbeat tick
+void testStartOffset()
+{
+    SamplePlayhead playhead;
+    playhead.prepare(sampleRate);
+
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> windows;
+    const int64_t downbeat = 4 * PPQ::TICKS_PER_QUARTER;
+    const int startOffset = 200;
+
+    int numWindows = playhead.advance(downbeat, 1, tempo, blockSize, 0, windows.data(), startOffset);
+    expect(numWindows == 1, "expected one window, got " + juce::String(numWindows));
+    expect(windows[0].startSample == startOffset, "window starts at sample " + juce::String(windows[0].startSample));
+    expect(windows[0].startTick == downbeat, "window starts at tick " + juce::String(windows[0].startTick));
+    expect(windows[0].startSample + windows[0].numSamples == blockSize, "window doesn't reach the block end");
+    expect(windows[0].endTick == downbeat + (blockSize - startOffset) / 25, "window ends at tick " + juce::String(windows[0].endTick));
+    expect(windows[0].sampleOffsetFor(downbeat) == startOffset, "downbeat event not on the downbeat sample");
+
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> audible;
+    expect(playhead.getAudibleWindows(audible.data()) == 1 && audible[0].startSample == startOffset,
+           "audible window doesn't start at the downbeat sample");
+
+    // The next block runs from sample 0 where the first one stopped
+    numWindows = playhead.advance(downbeat, 1, tempo, blockSize, 0, windows.data());
+    expect(numWindows == 1 && windows[0].startSample == 0 && windows[0].startTick == downbeat + (blockSize - startOffset) / 25,
+           "next block doesn't continue from the first");
+}
+
+// Crossing the loop end splits the block where the loop end falls
+void testLoopWrap()
+{
+    SamplePlayhead playhead;
+    playhead.prepare(sampleRate);
+    playhead.setLoop(true, 0, 10);
+
+    std::array<BlockTickWindow, SamplePlayhead::maxWindows> windows;
+    int numWindows = playhead.advance(0, 1, tempo, blockSize, 0, windows.data());
+
+    // 19.2 ticks through a 10 tick loop
+    expect(numWindows == 2, "expected two windows, got " + juce::String(numWindows));
+    expect(windows[0].endsAtLoopEnd && windows[0].endTick == 10, "first window doesn't end at the loop end");
+    expect(windows[0].numSamples == 250, "first window is " + juce::String(windows[0].numSamples) + " samples");
+    expect(windows[1].startTick == 0 && windows[1].startSample == 250, "second window doesn't start at the loop start");
+    expect(windows[1].startSample + windows[1].numSamples == blockSize, "second window doesn't reach the block end");
+}
+
+} // namespace pianodaw
+
+int main()
+{
+    pianodaw::testStartOffset();
+    pianodaw::testLoopWrap();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "SamplePlayheadTests passed" << std::endl;
+    return 0;
+}
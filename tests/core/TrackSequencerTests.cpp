@@ -0,0 +1,131 @@
+#include "core/audio/TrackSequencer.h"
+#include "core/model/Clip.h"
+#include "core/model/Track.h"
+#include "core/timeline/PPQ.h"
+#include <iostream>
+#include <vector>
+
+namespace pianodaw {
+
+namespace
+{
+    int failures = 0;
+
+    void expect(bool condition, const juce::String& message)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failures;
+        }
+    }
+
+    constexpr int64_t bar = 4 * PPQ::TICKS_PER_QUARTER;
+
+    /** A window of numSamples samples, one sample per tick, starting at sample 0 */
+    BlockTickWindow makeWindow(int64_t startTick, int numSamples, bool endsAtLoopEnd = false)
+    {
+        BlockTickWindow window;
+        window.startTick = startTick;
+        window.endTick = startTick + numSamples;
+        window.exactStartTick = (double)startTick;
+        window.numSamples = numSamples;
+        window.endsAtLoopEnd = endsAtLoopEnd;
+        return window;
+    }
+
+    /** Sample positions of the pedal-up events for this controller */
+    std::vector<int> findPedalReleases(const juce::MidiBuffer& midi, int controller)
+    {
+        std::vector<int> positions;
+        for (const auto metadata : midi)
+        {
+            auto message = metadata.getMessage();
+            if (message.isController() && message.getControllerNumber() == controller && message.getControllerValue() < 64)
+                positions.push_back(metadata.samplePosition);
+        }
+        return positions;
+    }
+
+    /** Place the first bar of a clip whose sustain and sostenuto go down at its start, at bar 2 */
+    void addPedalledRegion(Track& track, Clip& clip)
+    {
+        clip.addCCEvent(64, 0, 127);
+        clip.addCCEvent(66, 0, 127);
+        clip.addNote(60, 0, bar / 2, 100);
+        track.addClipRegion(ClipRegion(&clip, bar, bar));
+    }
+}
+
+// Pedals still down at the region end go up there, even when the clip holds them longer
+void testPedalReleasedAtRegionEnd()
+{
+    Clip clip("Pedalled");
+    Track track("Piano", Track::Type::MIDI);
+    addPedalledRegion(track, clip);
+
+    juce::MidiBuffer midi;
+    auto window = makeWindow(2 * bar - 100, 200);
+    TrackSequencer::sequence(track, &window, 1, midi);
+
+    auto sustain = findPedalReleases(midi, 64);
+    auto sostenuto = findPedalReleases(midi, 66);
+    expect(sustain.size() == 1 && sustain.front() == 100, "sustain not released at the region end");
+    expect(sostenuto.size() == 1 && sostenuto.front() == 100, "sostenuto not released at the region end");
+
+    // Already up before the region end: nothing more to release
+    clip.addCCEvent(64, bar / 2, 0);
+    midi.clear();
+    TrackSequencer::sequence(track, &window, 1, midi);
+    expect(findPedalReleases(midi, 64).empty(), "sustain released again after the clip lifted it");
+    expect(findPedalReleases(midi, 66).size() == 1, "sostenuto no longer released at the region end");
+}
+
+// A pedal held across the loop end goes up on the window's last sample, before the wrap
+void testPedalReleasedAtLoopWrap()
+{
+    Clip clip("Pedalled");
+    Track track("Piano", Track::Type::MIDI);
+    addPedalledRegion(track, clip);
+
+    juce::MidiBuffer midi;
+    auto window = makeWindow(bar + 100, 300, true);
+    TrackSequencer::sequence(track, &window, 1, midi);
+
+    auto sustain = findPedalReleases(midi, 64);
+    expect(sustain.size() == 1 && sustain.front() == window.lastSample(), "sustain not released at the loop end");
+    expect(findPedalReleases(midi, 66).size() == 1, "sostenuto not released at the loop end");
+
+    // The same stretch without a wrap keeps the pedal down
+    midi.clear();
+    window.endsAtLoopEnd = false;
+    TrackSequencer::sequence(track, &window, 1, midi);
+    expect(findPedalReleases(midi, 64).empty(), "sustain released mid-region without a loop wrap");
+
+    // The window after the wrap puts the pedal back down on the region's first tick
+    midi.clear();
+    auto wrapped = makeWindow(bar, 100);
+    TrackSequencer::sequence(track, &wrapped, 1, midi);
+    bool pedalDown = false;
+    for (const auto metadata : midi)
+    {
+        auto message = metadata.getMessage();
+        if (message.isController() && message.getControllerNumber() == 64 && message.getControllerValue() >= 64)
+            pedalDown = metadata.samplePosition == 0;
+    }
+    expect(pedalDown, "sustain not put back down at the loop start");
+}
+
+} // namespace pianodaw
+
+int main()
+{
+    pianodaw::testPedalReleasedAtRegionEnd();
+    pianodaw::testPedalReleasedAtLoopWrap();
+
+    if (pianodaw::failures > 0)
+        return 1;
+
+    std::cout << "TrackSequencerTests passed" << std::endl;
+    return 0;
+}